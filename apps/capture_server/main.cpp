@@ -1,26 +1,69 @@
+#include <algorithm>
+#include <cerrno>
 #include <csignal>
 #include <cstdlib>
 #include <cstdint>
 #include <exception>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include <gst/gst.h>
+
 #if defined(G_OS_UNIX)
-#include <glib-unix.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #endif
 
+#include "gstreamer_worker/control/network_clock.hpp"
 #include "gstreamer_worker/control/pipeline_controller.hpp"
+#include "gstreamer_worker/control/shared_task_pool.hpp"
 #include "gstreamer_worker/pipeline/capture_pipeline.hpp"
+#include "gstreamer_worker/pipeline/capture_qos.hpp"
+#include "gstreamer_worker/pipeline/codec.hpp"
 #include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/encoded_stats.hpp"
+#include "gstreamer_worker/pipeline/format_probe.hpp"
+#include "gstreamer_worker/pipeline/motion_gate.hpp"
+#include "gstreamer_worker/pipeline/pre_event_recorder.hpp"
 #include "gstreamer_worker/zerocopy/frame_meta.hpp"
+#include "gstreamer_worker/zerocopy/imu_ring.hpp"
+#include "gstreamer_worker/zerocopy/rtp_metadata.hpp"
 
+using gstreamer_worker::control::NetworkClock;
+using gstreamer_worker::control::NetworkClockConfig;
 using gstreamer_worker::control::PipelineController;
+using gstreamer_worker::control::SharedTaskPool;
+using gstreamer_worker::control::ThreadPolicy;
+using gstreamer_worker::control::parse_clock_spec;
+using gstreamer_worker::control::parse_thread_rule;
 using gstreamer_worker::pipeline::CapturePipelineConfig;
+using gstreamer_worker::pipeline::CaptureQosController;
+using gstreamer_worker::pipeline::EncodedStats;
+using gstreamer_worker::pipeline::EncodingLayer;
+using gstreamer_worker::pipeline::MotionGate;
+using gstreamer_worker::pipeline::MotionGateConfig;
+using gstreamer_worker::pipeline::PreEventRecorder;
+using gstreamer_worker::pipeline::QualityStep;
+using gstreamer_worker::pipeline::kEncodedParserName;
+using gstreamer_worker::pipeline::kPayloaderName;
+using gstreamer_worker::pipeline::RecordingContainer;
+using gstreamer_worker::pipeline::format_encoded_stats;
+using gstreamer_worker::pipeline::installed_software_encoder;
+using gstreamer_worker::pipeline::parse_codec;
 using gstreamer_worker::pipeline::make_capture_pipeline;
+using gstreamer_worker::pipeline::negotiate_source_format;
 using gstreamer_worker::zerocopy::FrameMetadata;
 using gstreamer_worker::zerocopy::add_frame_meta;
+using gstreamer_worker::zerocopy::ImuRing;
+using gstreamer_worker::zerocopy::ImuSample;
+using gstreamer_worker::zerocopy::install_rtp_metadata_writer;
 using gstreamer_worker::zerocopy::make_frame_metadata;
 
 namespace {
@@ -28,20 +71,86 @@ namespace {
 struct Options {
     CapturePipelineConfig config{};
     std::string sensor_id{"cam0"};
+    std::string imu_fifo;
+    bool auto_format{false};
+    std::string format_cache;
+    ThreadPolicy thread_policy{};
+    bool task_pool{false};
+    std::size_t task_pool_workers{0};
+    // 0 leaves overflow threads unbounded; otherwise tasks past it are refused.
+    std::size_t task_pool_max_overflow{0};
+    bool shared_clock{false};
+    bool encoded_stats{false};
+    // Seconds between encoded-stats reports while running; 0 reports at exit only.
+    std::uint32_t encoded_stats_interval{0};
+    NetworkClockConfig clock{};
 };
 
 void print_usage(const char* program) {
     std::cout << "Usage: " << program
               << " [--device /dev/video0] [--host 192.168.1.10] [--port 5000]\n"
               << "             [--width 1920] [--height 1080] [--fps 60] [--bitrate 8000000]\n"
-              << "             [--no-nvenc] [--no-zero-copy] [--fec <percentage>] [--sensor-id cam0]\n"
-              << "             [--use-test-pattern] [--test-pattern smpte]\n";
+              << "             [--codec h264|h265|av1] [--low-latency] [--refresh-frames 30]\n"
+              << "             [--redundant HOST:PORT] [--encoded-stats <seconds, 0=at exit>]\n"
+              << "             [--no-nvenc] [--no-zero-copy] [--fec <percentage>] [--mtu 1400]\n"
+              << "             [--sensor-id cam0] [--use-test-pattern] [--test-pattern smpte]\n"
+              << "             [--pre-event-seconds 30] [--record-dir .] [--record-format ts|mp4]\n"
+              << "             [--layer WIDTHxHEIGHT@BITRATE[:PORT]]...\n"
+              << "             [--qos] [--qos-step WIDTHxHEIGHT@FPS]...\n"
+              << "             [--auto-format] [--format-cache <path>] [--imu-fifo <path>]\n"
+              << "             [--thread-rule PATTERN:CPUS[:fifo=PRIO|nice=N]]... [--task-pool <workers, 0=auto>]\n"
+              << "             [--task-pool-max-overflow <threads, 0=unbounded>]\n"
+              << "             [--clock provide[:PORT]|ptp[:DOMAIN]] [--motion-gate THRESHOLD[:KEEPALIVE_MS]]\n";
 }
 
 std::uint32_t parse_u32(const std::string& value) {
     return static_cast<std::uint32_t>(std::stoul(value));
 }
 
+// Parses "640x360@500000" or "640x360@500000:5002".
+EncodingLayer parse_layer(const std::string& value) {
+    EncodingLayer layer;
+    const auto x = value.find('x');
+    const auto at = value.find('@');
+    if (x == std::string::npos || at == std::string::npos || at < x) {
+        throw std::invalid_argument("--layer expects WIDTHxHEIGHT@BITRATE[:PORT]");
+    }
+    const auto colon = value.find(':', at);
+    layer.width = parse_u32(value.substr(0, x));
+    layer.height = parse_u32(value.substr(x + 1, at - x - 1));
+    layer.bitrate = parse_u32(value.substr(at + 1, colon == std::string::npos ? std::string::npos : colon - at - 1));
+    if (colon != std::string::npos) {
+        layer.port = static_cast<std::uint16_t>(std::stoul(value.substr(colon + 1)));
+    }
+    return layer;
+}
+
+// Parses "1280x720@30".
+MotionGateConfig parse_motion_gate(const std::string& value) {
+    MotionGateConfig gate;
+    gate.enabled = true;
+    const auto colon = value.find(':');
+    try {
+        gate.threshold = std::stod(value.substr(0, colon));
+    } catch (const std::exception&) {
+        throw std::invalid_argument("--motion-gate expects THRESHOLD[:KEEPALIVE_MS]");
+    }
+    if (colon != std::string::npos) {
+        gate.keepalive_ms = parse_u32(value.substr(colon + 1));
+    }
+    return gate;
+}
+
+QualityStep parse_quality_step(const std::string& value) {
+    const auto x = value.find('x');
+    const auto at = value.find('@');
+    if (x == std::string::npos || at == std::string::npos || at < x) {
+        throw std::invalid_argument("--qos-step expects WIDTHxHEIGHT@FPS");
+    }
+    return QualityStep{parse_u32(value.substr(0, x)), parse_u32(value.substr(x + 1, at - x - 1)),
+                       parse_u32(value.substr(at + 1))};
+}
+
 Options parse_args(int argc, char** argv) {
     Options options;
 
@@ -60,6 +169,18 @@ Options parse_args(int argc, char** argv) {
             options.config.network.host = require_value("--host");
         } else if (arg == "--port") {
             options.config.network.port = static_cast<std::uint16_t>(std::stoul(require_value("--port")));
+        } else if (arg == "--redundant") {
+            const std::string target = require_value("--redundant");
+            const auto colon = target.rfind(':');
+            if (colon == std::string::npos || colon == 0) {
+                throw std::invalid_argument("--redundant expects HOST:PORT");
+            }
+            options.config.redundancy.enabled = true;
+            options.config.redundancy.secondary.host = target.substr(0, colon);
+            options.config.redundancy.secondary.port = static_cast<std::uint16_t>(std::stoul(target.substr(colon + 1)));
+        } else if (arg == "--encoded-stats") {
+            options.encoded_stats = true;
+            options.encoded_stats_interval = parse_u32(require_value("--encoded-stats"));
         } else if (arg == "--width") {
             options.config.width = parse_u32(require_value("--width"));
         } else if (arg == "--height") {
@@ -68,6 +189,15 @@ Options parse_args(int argc, char** argv) {
             options.config.framerate = parse_u32(require_value("--fps"));
         } else if (arg == "--bitrate") {
             options.config.bitrate = parse_u32(require_value("--bitrate"));
+        } else if (arg == "--codec") {
+            options.config.codec = parse_codec(require_value("--codec"));
+        } else if (arg == "--low-latency") {
+            options.config.low_latency.enabled = true;
+        } else if (arg == "--refresh-frames") {
+            options.config.low_latency.enabled = true;
+            options.config.low_latency.refresh_frames = parse_u32(require_value("--refresh-frames"));
+        } else if (arg == "--imu-fifo") {
+            options.imu_fifo = require_value("--imu-fifo");
         } else if (arg == "--sensor-id") {
             options.sensor_id = require_value("--sensor-id");
         } else if (arg == "--no-nvenc") {
@@ -77,6 +207,8 @@ Options parse_args(int argc, char** argv) {
         } else if (arg == "--fec") {
             options.config.enable_fec = true;
             options.config.fec_percentage = parse_u32(require_value("--fec"));
+        } else if (arg == "--mtu") {
+            options.config.mtu = parse_u32(require_value("--mtu"));
         } else if (arg == "--queue-size") {
             options.config.queue_size = parse_u32(require_value("--queue-size"));
         } else if (arg == "--use-test-pattern") {
@@ -84,6 +216,43 @@ Options parse_args(int argc, char** argv) {
         } else if (arg == "--test-pattern") {
             options.config.use_test_pattern = true;
             options.config.test_pattern = require_value("--test-pattern");
+        } else if (arg == "--pre-event-seconds") {
+            options.config.recorder.enabled = true;
+            options.config.recorder.pre_event_seconds = parse_u32(require_value("--pre-event-seconds"));
+        } else if (arg == "--record-dir") {
+            options.config.recorder.output_directory = require_value("--record-dir");
+        } else if (arg == "--record-format") {
+            const std::string format = require_value("--record-format");
+            options.config.recorder.container =
+                format == "mp4" ? RecordingContainer::FragmentedMp4 : RecordingContainer::MpegTs;
+        } else if (arg == "--layer") {
+            options.config.layers.push_back(parse_layer(require_value("--layer")));
+        } else if (arg == "--qos") {
+            options.config.qos.enabled = true;
+        } else if (arg == "--qos-step") {
+            options.config.qos.enabled = true;
+            options.config.qos.ladder.push_back(parse_quality_step(require_value("--qos-step")));
+        } else if (arg == "--auto-format") {
+            options.auto_format = true;
+        } else if (arg == "--format-cache") {
+            options.auto_format = true;
+            options.format_cache = require_value("--format-cache");
+        } else if (arg == "--task-pool") {
+            options.task_pool = true;
+            options.task_pool_workers = std::stoul(require_value("--task-pool"));
+        } else if (arg == "--task-pool-max-overflow") {
+            options.task_pool = true;
+            options.task_pool_max_overflow = std::stoul(require_value("--task-pool-max-overflow"));
+        } else if (arg == "--motion-gate") {
+            options.config.motion_gate = parse_motion_gate(require_value("--motion-gate"));
+        } else if (arg == "--clock") {
+            options.shared_clock = true;
+            options.clock = parse_clock_spec(require_value("--clock"));
+            if (options.clock.mode == NetworkClockConfig::Mode::Follow) {
+                throw std::invalid_argument("capture_server provides the clock or follows PTP: --clock provide|ptp");
+            }
+        } else if (arg == "--thread-rule") {
+            options.thread_policy.rules.push_back(parse_thread_rule(require_value("--thread-rule")));
         } else if (arg == "--help" || arg == "-h") {
             print_usage(argv[0]);
             std::exit(0);
@@ -98,6 +267,8 @@ Options parse_args(int argc, char** argv) {
 struct MetadataProbeData {
     std::string sensor_id;
     guint64 frame_counter{0};
+    const ImuRing* imu{nullptr};
+    const NetworkClock* clock{nullptr};
 };
 
 GstPadProbeReturn metadata_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
@@ -116,16 +287,27 @@ GstPadProbeReturn metadata_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointe
         return GST_PAD_PROBE_OK;
     }
 
-    FrameMetadata metadata = make_frame_metadata(++data->frame_counter, gst_util_get_timestamp(), data->sensor_id);
-    metadata.encode_ts = gst_util_get_timestamp();
+    // IMU samples are stamped on the host monotonic clock; capture_ts is on the
+    // shared clock when there is one, so receivers can compare it with theirs.
+    const GstClockTime local_ts = gst_util_get_timestamp();
+    const GstClockTime capture_ts = data->clock ? data->clock->now() : local_ts;
+    FrameMetadata metadata = make_frame_metadata(++data->frame_counter, capture_ts, data->sensor_id);
+    metadata.clock_error = data->clock ? data->clock->error_estimate() : 0;
     metadata.gain = 1.0;
+    if (data->imu) {
+        // Lock-free; a miss leaves the orientation at zero rather than waiting.
+        data->imu->interpolate(local_ts, metadata.imu_rpy);
+    }
     add_frame_meta(writable, metadata);
     auto** info_data = reinterpret_cast<GstMiniObject**>(&GST_PAD_PROBE_INFO_DATA(info));
     gst_mini_object_replace(info_data, GST_MINI_OBJECT_CAST(writable));
     return GST_PAD_PROBE_OK;
 }
 
-void install_metadata_probe(GstElement* pipeline, const std::string& sensor_id) {
+void install_metadata_probe(GstElement* pipeline,
+                            const std::string& sensor_id,
+                            const ImuRing* imu,
+                            const NetworkClock* clock) {
     if (!pipeline) {
         return;
     }
@@ -141,7 +323,7 @@ void install_metadata_probe(GstElement* pipeline, const std::string& sensor_id)
         return;
     }
 
-    auto* data = new MetadataProbeData{sensor_id, 0};
+    auto* data = new MetadataProbeData{sensor_id, 0, imu, clock};
     gst_pad_add_probe(pad,
                       GST_PAD_PROBE_TYPE_BUFFER,
                       metadata_probe,
@@ -154,6 +336,122 @@ void install_metadata_probe(GstElement* pipeline, const std::string& sensor_id)
     gst_object_unref(source);
 }
 
+// Carries each frame's metadata over RTP; encode_ts is stamped as it leaves.
+void install_metadata_writers(GstElement* pipeline, std::size_t layers, const NetworkClock* clock) {
+    for (std::size_t index = 0; index < layers; ++index) {
+        const std::string name =
+            std::string{kPayloaderName} + (index == 0 ? std::string{} : "_" + std::to_string(index));
+        GstElement* payloader = gst_bin_get_by_name(GST_BIN(pipeline), name.c_str());
+        if (!payloader || !install_rtp_metadata_writer(payloader, clock ? clock->clock() : nullptr)) {
+            std::cerr << "Unable to attach RTP metadata to " << name << "\n";
+        }
+        if (payloader) {
+            gst_object_unref(payloader);
+        }
+    }
+}
+
+// Sensor thread: one "timestamp_ns roll pitch yaw" line per sample, with
+// timestamps on the gst_util_get_timestamp() clock (CLOCK_MONOTONIC). The
+// source is read without blocking, so stop() ends the thread even while a
+// FIFO has no writer; it also ends at end of file.
+class ImuFeed {
+  public:
+    explicit ImuFeed(ImuRing& ring) : ring_(ring) {}
+    ~ImuFeed() { stop(); }
+
+    ImuFeed(const ImuFeed&) = delete;
+    ImuFeed& operator=(const ImuFeed&) = delete;
+
+    bool start(const std::string& path) {
+#if defined(G_OS_UNIX)
+        const int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "Unable to open IMU source " << path << ": " << g_strerror(errno) << "\n";
+            return false;
+        }
+        if (pipe(wake_) != 0) {
+            close(fd);
+            return false;
+        }
+        thread_ = std::thread([this, fd] {
+            run(fd);
+            close(fd);
+        });
+        return true;
+#else
+        std::cerr << "--imu-fifo is only supported on POSIX systems (" << path << ")\n";
+        return false;
+#endif
+    }
+
+    void stop() {
+#if defined(G_OS_UNIX)
+        if (thread_.joinable()) {
+            const char byte = 0;
+            if (write(wake_[1], &byte, 1) < 0) {
+                std::cerr << "Unable to wake the IMU reader\n";
+            }
+            thread_.join();
+        }
+        for (int& fd : wake_) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+#endif
+    }
+
+  private:
+#if defined(G_OS_UNIX)
+    void run(int fd) {
+        std::string pending;
+        char chunk[4096];
+        while (true) {
+            pollfd fds[2] = {{fd, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            if (fds[1].revents != 0) {
+                break;
+            }
+            const ssize_t count = read(fd, chunk, sizeof(chunk));
+            if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            if (count <= 0) {
+                break;
+            }
+            pending.append(chunk, static_cast<std::size_t>(count));
+            std::size_t begin = 0;
+            for (std::size_t end = pending.find('\n'); end != std::string::npos;
+                 begin = end + 1, end = pending.find('\n', begin)) {
+                push_line(std::string_view{pending}.substr(begin, end - begin));
+            }
+            pending.erase(0, begin);
+        }
+    }
+#endif
+
+    void push_line(std::string_view line) {
+        std::istringstream input{std::string{line}};
+        ImuSample sample;
+        guint64 timestamp = 0;
+        if (input >> timestamp >> sample.rpy[0] >> sample.rpy[1] >> sample.rpy[2]) {
+            sample.timestamp = timestamp;
+            ring_.push(sample);
+        }
+    }
+
+    ImuRing& ring_;
+    int wake_[2]{-1, -1};
+    std::thread thread_;
+};
+
 #if defined(G_OS_UNIX)
 gboolean handle_signal(gpointer controller_ptr) {
     auto* controller = static_cast<PipelineController*>(controller_ptr);
@@ -162,8 +460,67 @@ gboolean handle_signal(gpointer controller_ptr) {
     }
     return G_SOURCE_REMOVE;
 }
+
+gboolean handle_record_trigger(gpointer recorder_ptr) {
+    auto* recorder = static_cast<PreEventRecorder*>(recorder_ptr);
+    if (recorder) {
+        const std::string path = recorder->trigger();
+        if (path.empty()) {
+            g_print("Pre-event ring is empty, nothing to save\n");
+        } else {
+            g_print("Saving pre-event segment to %s\n", path.c_str());
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
 #endif
 
+// One EncodedStats per layer on the parser ahead of its payloader.
+using LayerStats = std::vector<std::unique_ptr<EncodedStats>>;
+
+LayerStats attach_encoded_stats(GstElement* pipeline, const CapturePipelineConfig& config, GstClock* clock) {
+    LayerStats stats;
+    const std::size_t layers = std::max<std::size_t>(1, config.layers.size());
+    for (std::size_t index = 0; index < layers; ++index) {
+        const std::string name =
+            std::string{kEncodedParserName} + (index == 0 ? std::string{} : "_" + std::to_string(index));
+        GstElement* parser = gst_bin_get_by_name(GST_BIN(pipeline), name.c_str());
+        auto layer = std::make_unique<EncodedStats>();
+        if (!parser || !layer->attach(parser, config.codec, clock)) {
+            std::cerr << "Unable to collect encoded stats from " << name << "\n";
+        }
+        if (parser) {
+            gst_object_unref(parser);
+        }
+        stats.push_back(std::move(layer));
+    }
+    return stats;
+}
+
+void print_encoded_stats(const LayerStats& stats) {
+    for (std::size_t index = 0; index < stats.size(); ++index) {
+        if (stats.size() > 1) {
+            std::cout << "Layer " << index << " ";
+        }
+        std::cout << format_encoded_stats(stats[index]->snapshot()) << std::endl;
+    }
+}
+
+gboolean report_encoded_stats(gpointer stats_ptr) {
+    const auto* stats = static_cast<const LayerStats*>(stats_ptr);
+    if (stats) {
+        print_encoded_stats(*stats);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+void print_thread_usage(PipelineController& controller) {
+    for (const auto& thread : controller.thread_usage()) {
+        std::cout << "Thread " << thread.element << " (tid " << thread.tid << "): " << thread.cpu_seconds
+                  << " s CPU" << (thread.placed ? ", placed" : "") << std::endl;
+    }
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -177,6 +534,16 @@ int main(int argc, char** argv) {
         print_usage(argv[0]);
         return 1;
     }
+    // The only registry lookup for the encoder; the builders take it as given.
+    if (options.config.encoder.empty()) {
+        options.config.encoder = installed_software_encoder(options.config.codec);
+    }
+
+    if (options.auto_format && !options.config.use_test_pattern) {
+        if (auto source = negotiate_source_format(options.config, options.format_cache)) {
+            options.config.source_format = *source;
+        }
+    }
 
     GError* error = nullptr;
     GstElement* pipeline = nullptr;
@@ -196,12 +563,90 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    install_metadata_probe(pipeline, options.sensor_id);
+    std::unique_ptr<NetworkClock> clock;
+    if (options.shared_clock) {
+        try {
+            clock = std::make_unique<NetworkClock>(options.clock);
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << "\n";
+            gst_object_unref(pipeline);
+            return 1;
+        }
+        clock->apply(pipeline);
+    }
+
+    // The feed is declared after the ring so its thread is joined first; the
+    // metadata probe only reads the ring while the pipeline runs.
+    std::unique_ptr<ImuRing> imu;
+    std::unique_ptr<ImuFeed> imu_feed;
+    if (!options.imu_fifo.empty()) {
+        imu = std::make_unique<ImuRing>();
+        imu_feed = std::make_unique<ImuFeed>(*imu);
+        if (!imu_feed->start(options.imu_fifo)) {
+            imu_feed.reset();
+        }
+    }
+    install_metadata_probe(pipeline, options.sensor_id, imu.get(), clock.get());
+    install_metadata_writers(pipeline, std::max<std::size_t>(1, options.config.layers.size()), clock.get());
+
+    std::unique_ptr<PreEventRecorder> recorder;
+    if (options.config.recorder.enabled) {
+        recorder = std::make_unique<PreEventRecorder>(options.config.recorder);
+        if (!recorder->attach(pipeline)) {
+            std::cerr << "Unable to find recorder sink " << options.config.recorder.appsink_name << "\n";
+            gst_object_unref(pipeline);
+            return 1;
+        }
+    }
+
+    std::unique_ptr<CaptureQosController> qos;
+    if (options.config.qos.enabled && options.config.layers.empty()) {
+        qos = std::make_unique<CaptureQosController>(options.config);
+        if (!qos->attach(pipeline)) {
+            std::cerr << "Unable to attach capture QoS controller\n";
+            gst_object_unref(pipeline);
+            return 1;
+        }
+    }
+
+    LayerStats encoded_stats;
+    if (options.encoded_stats) {
+        encoded_stats = attach_encoded_stats(pipeline, options.config, clock ? clock->clock() : nullptr);
+    }
+
+    MotionGate motion_gate;
+    if (options.config.motion_gate.enabled && !motion_gate.attach(pipeline, options.config.motion_gate)) {
+        std::cerr << "Unable to attach motion gate\n";
+        gst_object_unref(pipeline);
+        return 1;
+    }
+
+    // Declared before the controller so it outlives the pipeline's tasks.
+    std::unique_ptr<SharedTaskPool> task_pool;
+    if (options.task_pool) {
+        task_pool = std::make_unique<SharedTaskPool>(options.task_pool_workers, options.task_pool_max_overflow);
+    }
 
     PipelineController controller;
+    if (task_pool) {
+        controller.set_task_pool(*task_pool, options.sensor_id);
+    }
+    controller.set_thread_policy(options.thread_policy);
     controller.set_pipeline(pipeline);
 
     controller.set_bus_handler([pipeline](const GstMessage& message) {
+        if (GST_MESSAGE_TYPE(&message) == GST_MESSAGE_ELEMENT) {
+            const GstStructure* structure = gst_message_get_structure(const_cast<GstMessage*>(&message));
+            guint step = 0, width = 0, height = 0, framerate = 0;
+            if (structure && gst_structure_has_name(structure, "capture-qos") &&
+                gst_structure_get_uint(structure, "step", &step) &&
+                gst_structure_get_uint(structure, "width", &width) &&
+                gst_structure_get_uint(structure, "height", &height) &&
+                gst_structure_get_uint(structure, "framerate", &framerate)) {
+                g_print("Capture QoS step %u: %ux%u@%u\n", step, width, height, framerate);
+            }
+            return;
+        }
         if (GST_MESSAGE_TYPE(&message) != GST_MESSAGE_STATE_CHANGED) {
             return;
         }
@@ -215,9 +660,16 @@ int main(int argc, char** argv) {
                 gst_element_state_get_name(new_state));
     });
 
+    if (!encoded_stats.empty() && options.encoded_stats_interval > 0) {
+        controller.add_timeout(options.encoded_stats_interval * 1000, report_encoded_stats, &encoded_stats);
+    }
+
 #if defined(G_OS_UNIX)
-    g_unix_signal_add(SIGINT, handle_signal, &controller);
-    g_unix_signal_add(SIGTERM, handle_signal, &controller);
+    controller.add_unix_signal(SIGINT, handle_signal, &controller);
+    controller.add_unix_signal(SIGTERM, handle_signal, &controller);
+    if (recorder) {
+        controller.add_unix_signal(SIGUSR1, handle_record_trigger, recorder.get());
+    }
 #endif
 
     if (!controller.play()) {
@@ -227,9 +679,42 @@ int main(int argc, char** argv) {
     }
 
     std::cout << "Capture pipeline running. Press Ctrl+C to stop." << std::endl;
+    if (options.config.low_latency.enabled) {
+        std::cout << "Low-latency profile: intra refresh every " << options.config.low_latency.refresh_frames
+                  << " frames; run the viewer with --low-latency " << options.config.framerate << std::endl;
+    }
     controller.run();
 
     controller.stop();
+    print_thread_usage(controller);
+    if (imu) {
+        imu_feed.reset();
+        const auto stats = imu->stats();
+        std::cout << "IMU: " << stats.pushed << " samples, " << stats.interpolated << " frames interpolated, "
+                  << stats.held << " held, " << stats.missed << " missed" << std::endl;
+    }
+    if (options.config.motion_gate.enabled) {
+        const auto stats = motion_gate.stats();
+        std::cout << "Motion gate: sent " << stats.sent << "/" << stats.frames << " frames (" << stats.motion
+                  << " with motion, " << stats.keepalives << " keepalives), skipped " << stats.skipped << std::endl;
+        motion_gate.detach();
+    }
+    if (!encoded_stats.empty()) {
+        print_encoded_stats(encoded_stats);
+        encoded_stats.clear();
+    }
+    if (task_pool) {
+        const auto stats = task_pool->stats();
+        std::cout << "Task pool: " << stats.workers << "/" << stats.max_workers << " workers, "
+                  << stats.saturation_events << " overflow tasks, " << stats.rejected << " refused" << std::endl;
+    }
+    if (qos) {
+        const auto stats = qos->stats();
+        std::cout << "Capture QoS: step " << stats.step << ", " << stats.downgrades << " downgrades, "
+                  << stats.upgrades << " upgrades" << std::endl;
+        qos.reset();
+    }
+    recorder.reset();
     if (pipeline) {
         gst_object_unref(pipeline);
     }
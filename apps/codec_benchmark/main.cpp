@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/gst.h>
+
+#include <sys/resource.h>
+
+#include "gstreamer_worker/pipeline/codec.hpp"
+#include "gstreamer_worker/pipeline/config.hpp"
+
+using gstreamer_worker::pipeline::CodecElements;
+using gstreamer_worker::pipeline::EncoderSettings;
+using gstreamer_worker::pipeline::VideoCodec;
+using gstreamer_worker::pipeline::codec_elements;
+using gstreamer_worker::pipeline::codec_name;
+using gstreamer_worker::pipeline::installed_software_decoder;
+using gstreamer_worker::pipeline::installed_software_encoder;
+using gstreamer_worker::pipeline::parse_codec;
+using gstreamer_worker::pipeline::software_decoder;
+using gstreamer_worker::pipeline::software_encoder;
+
+namespace {
+
+struct Options {
+    std::vector<VideoCodec> codecs{VideoCodec::H264, VideoCodec::H265, VideoCodec::AV1};
+    std::uint32_t width{1280};
+    std::uint32_t height{720};
+    std::uint32_t framerate{30};
+    std::uint32_t frames{300};
+    std::uint32_t bitrate{4'000'000};
+    std::uint32_t keyframe_interval{30};
+    std::string pattern{"smpte"};
+    // Also run every codec with LowLatencyEncoderConfig to compare frame sizes.
+    bool compare_low_latency{false};
+};
+
+struct PassResult {
+    bool ok{false};
+    double cpu_seconds{0.0};
+    double wall_seconds{0.0};
+};
+
+struct CodecResult {
+    PassResult encode{};
+    bool rtp_ok{false};
+    PassResult decode{};
+    std::uint64_t bytes{0};
+    std::uint64_t access_units{0};
+    double max_frame_bytes{0.0};
+    double frame_stddev{0.0};
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [--codecs h264,h265,av1] [--width 1280] [--height 720] [--fps 30]\n"
+              << "             [--frames 300] [--bitrate 4000000] [--keyint 30] [--pattern smpte]\n"
+              << "             [--low-latency]\n";
+}
+
+std::uint32_t parse_u32(const std::string& value) {
+    return static_cast<std::uint32_t>(std::stoul(value));
+}
+
+std::vector<VideoCodec> parse_codecs(const std::string& value) {
+    std::vector<VideoCodec> codecs;
+    std::size_t start = 0;
+    while (start <= value.size()) {
+        const auto comma = value.find(',', start);
+        const auto end = comma == std::string::npos ? value.size() : comma;
+        if (end > start) {
+            codecs.push_back(parse_codec(value.substr(start, end - start)));
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    if (codecs.empty()) {
+        throw std::invalid_argument("--codecs expects a comma-separated list");
+    }
+    return codecs;
+}
+
+Options parse_args(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto require_value = [&](const char* flag) -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(std::string(flag) + " requires a value");
+            }
+            return std::string(argv[++i]);
+        };
+
+        if (arg == "--codecs") {
+            options.codecs = parse_codecs(require_value("--codecs"));
+        } else if (arg == "--width") {
+            options.width = parse_u32(require_value("--width"));
+        } else if (arg == "--height") {
+            options.height = parse_u32(require_value("--height"));
+        } else if (arg == "--fps") {
+            options.framerate = parse_u32(require_value("--fps"));
+        } else if (arg == "--frames") {
+            options.frames = parse_u32(require_value("--frames"));
+        } else if (arg == "--bitrate") {
+            options.bitrate = parse_u32(require_value("--bitrate"));
+        } else if (arg == "--keyint") {
+            options.keyframe_interval = parse_u32(require_value("--keyint"));
+        } else if (arg == "--pattern") {
+            options.pattern = require_value("--pattern");
+        } else if (arg == "--low-latency") {
+            options.compare_low_latency = true;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(0);
+        } else {
+            throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    }
+    if (options.framerate == 0 || options.frames == 0) {
+        throw std::invalid_argument("--fps and --frames must be positive");
+    }
+    return options;
+}
+
+// User + system time of the whole process. Passes run one at a time, so the
+// delta is the pipeline's CPU cost.
+double process_cpu_seconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+bool factory_exists(const char* name) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) {
+        return false;
+    }
+    gst_object_unref(factory);
+    return true;
+}
+
+std::string missing_elements(VideoCodec codec, const char* encoder, const char* decoder) {
+    const CodecElements& elements = codec_elements(codec);
+    const char* required[] = {encoder, elements.parser, elements.payloader, elements.depayloader, decoder};
+    std::string missing;
+    for (const char* name : required) {
+        if (!factory_exists(name)) {
+            missing += missing.empty() ? name : std::string{", "} + name;
+        }
+    }
+    return missing;
+}
+
+std::string source_launch(const Options& options) {
+    std::ostringstream stream;
+    stream << "videotestsrc num-buffers=" << options.frames << " pattern=" << options.pattern
+           << " ! video/x-raw,format=I420,width=" << options.width << ",height=" << options.height
+           << ",framerate=" << options.framerate << "/1";
+    return stream.str();
+}
+
+GstElement* launch(const std::string& description) {
+    GError* error = nullptr;
+    GstElement* pipeline = gst_parse_launch(description.c_str(), &error);
+    if (!pipeline) {
+        std::cerr << "Pipeline error: " << (error ? error->message : "unknown") << "\n  " << description << "\n";
+        if (error) {
+            g_error_free(error);
+        }
+    }
+    return pipeline;
+}
+
+// Waits for EOS; false on an error message.
+bool wait_for_eos(GstElement* pipeline) {
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* message = gst_bus_timed_pop_filtered(
+        bus, GST_CLOCK_TIME_NONE, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    bool ok = message && GST_MESSAGE_TYPE(message) == GST_MESSAGE_EOS;
+    if (message && !ok) {
+        GError* error = nullptr;
+        gst_message_parse_error(message, &error, nullptr);
+        std::cerr << "Pipeline error: " << (error ? error->message : "unknown") << "\n";
+        if (error) {
+            g_error_free(error);
+        }
+    }
+    if (message) {
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+    return ok;
+}
+
+// Runs the synthetic source into a fakesink; its CPU is subtracted from the
+// encode pass so only the encoder remains.
+PassResult run_source_baseline(const Options& options) {
+    PassResult result;
+    GstElement* pipeline = launch(source_launch(options) + " ! fakesink sync=false");
+    if (!pipeline) {
+        return result;
+    }
+    const double cpu = process_cpu_seconds();
+    const gint64 wall = g_get_monotonic_time();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    result.ok = wait_for_eos(pipeline);
+    result.cpu_seconds = process_cpu_seconds() - cpu;
+    result.wall_seconds = static_cast<double>(g_get_monotonic_time() - wall) / 1e6;
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return result;
+}
+
+// Encodes the synthetic clip straight into an appsink, so the pass CPU minus
+// the source baseline is the encoder's alone.
+PassResult run_encode(const Options& options,
+                      VideoCodec codec,
+                      const EncoderSettings& settings,
+                      std::vector<GstSample*>& samples) {
+    std::ostringstream stream;
+    stream << source_launch(options) << " ! " << software_encoder(codec, settings)
+           << " ! appsink name=encoded sync=false max-buffers=0";
+
+    PassResult result;
+    GstElement* pipeline = launch(stream.str());
+    if (!pipeline) {
+        return result;
+    }
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "encoded");
+
+    const double cpu = process_cpu_seconds();
+    const gint64 wall = g_get_monotonic_time();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    while (GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink))) {
+        samples.push_back(sample);
+    }
+    result.ok = wait_for_eos(pipeline);
+    result.cpu_seconds = process_cpu_seconds() - cpu;
+    result.wall_seconds = static_cast<double>(g_get_monotonic_time() - wall) / 1e6;
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    return result;
+}
+
+// Queues every sample on the appsrc named "encoded" and ends the stream. The
+// source holds them all, so a timed pass measures the elements behind it, not
+// the feeding loop.
+void push_samples(GstElement* pipeline, const std::vector<GstSample*>& samples) {
+    GstElement* source = gst_bin_get_by_name(GST_BIN(pipeline), "encoded");
+    for (GstSample* sample : samples) {
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        if (!buffer || gst_app_src_push_buffer(GST_APP_SRC(source), gst_buffer_ref(buffer)) != GST_FLOW_OK) {
+            break;
+        }
+    }
+    gst_app_src_end_of_stream(GST_APP_SRC(source));
+    gst_object_unref(source);
+}
+
+GstElement* launch_sample_source(const std::string& description, const std::vector<GstSample*>& samples) {
+    GstElement* pipeline = launch(description);
+    if (!pipeline) {
+        return nullptr;
+    }
+    GstElement* source = gst_bin_get_by_name(GST_BIN(pipeline), "encoded");
+    gst_app_src_set_caps(GST_APP_SRC(source), gst_sample_get_caps(samples.front()));
+    g_object_set(source, "max-bytes", static_cast<guint64>(0), nullptr);
+    gst_object_unref(source);
+    return pipeline;
+}
+
+// Payloads and depayloads the encoded units in one process (RTP loopback
+// without the socket). Not timed; it checks the stream survives packetization
+// and yields the access units the decoder would receive.
+bool run_rtp_loopback(VideoCodec codec,
+                      const std::vector<GstSample*>& encoded,
+                      std::vector<GstSample*>& received) {
+    if (encoded.empty()) {
+        return false;
+    }
+    const CodecElements& elements = codec_elements(codec);
+    std::ostringstream stream;
+    stream << "appsrc name=encoded format=time is-live=false ! " << elements.parser << " ! " << elements.payloader
+           << " pt=96 mtu=1200 ! " << elements.depayloader << " ! " << elements.parser << " ! " << elements.caps
+           << " ! appsink name=received sync=false max-buffers=0";
+    GstElement* pipeline = launch_sample_source(stream.str(), encoded);
+    if (!pipeline) {
+        return false;
+    }
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "received");
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    push_samples(pipeline, encoded);
+    while (GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink))) {
+        received.push_back(sample);
+    }
+    const bool ok = wait_for_eos(pipeline);
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    return ok;
+}
+
+PassResult run_decode(VideoCodec codec, const char* decoder, const std::vector<GstSample*>& samples) {
+    PassResult result;
+    if (samples.empty()) {
+        return result;
+    }
+    const CodecElements& elements = codec_elements(codec);
+    std::ostringstream stream;
+    stream << "appsrc name=encoded format=time is-live=false ! " << elements.parser << " ! "
+           << software_decoder(codec, decoder) << " ! fakesink sync=false";
+    GstElement* pipeline = launch_sample_source(stream.str(), samples);
+    if (!pipeline) {
+        return result;
+    }
+
+    const double cpu = process_cpu_seconds();
+    const gint64 wall = g_get_monotonic_time();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    push_samples(pipeline, samples);
+    result.ok = wait_for_eos(pipeline);
+    result.cpu_seconds = process_cpu_seconds() - cpu;
+    result.wall_seconds = static_cast<double>(g_get_monotonic_time() - wall) / 1e6;
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return result;
+}
+
+CodecResult benchmark(const Options& options,
+                      VideoCodec codec,
+                      const char* encoder,
+                      const char* decoder,
+                      bool low_latency,
+                      double source_cpu) {
+    EncoderSettings settings;
+    settings.factory = encoder;
+    settings.bitrate = options.bitrate;
+    settings.width = options.width;
+    settings.height = options.height;
+    settings.framerate = options.framerate;
+    settings.keyframe_interval = options.keyframe_interval;
+    settings.low_latency.enabled = low_latency;
+    settings.low_latency.refresh_frames = options.keyframe_interval;
+
+    CodecResult result;
+    std::vector<GstSample*> encoded;
+    encoded.reserve(options.frames);
+    result.encode = run_encode(options, codec, settings, encoded);
+    result.encode.cpu_seconds = std::max(0.0, result.encode.cpu_seconds - source_cpu);
+    std::vector<GstSample*> samples;
+    samples.reserve(options.frames);
+    result.rtp_ok = result.encode.ok && run_rtp_loopback(codec, encoded, samples);
+    for (GstSample* sample : encoded) {
+        gst_sample_unref(sample);
+    }
+    // Sizes and the decode pass use the access units as a viewer receives them.
+    // Welford's running variance over access unit sizes.
+    double mean = 0.0;
+    double m2 = 0.0;
+    for (GstSample* sample : samples) {
+        if (GstBuffer* buffer = gst_sample_get_buffer(sample)) {
+            const double size = static_cast<double>(gst_buffer_get_size(buffer));
+            result.bytes += gst_buffer_get_size(buffer);
+            ++result.access_units;
+            const double delta = size - mean;
+            mean += delta / static_cast<double>(result.access_units);
+            m2 += delta * (size - mean);
+            result.max_frame_bytes = std::max(result.max_frame_bytes, size);
+        }
+    }
+    if (result.access_units > 1) {
+        result.frame_stddev = std::sqrt(m2 / static_cast<double>(result.access_units - 1));
+    }
+    if (result.rtp_ok) {
+        result.decode = run_decode(codec, decoder, samples);
+    }
+    for (GstSample* sample : samples) {
+        gst_sample_unref(sample);
+    }
+    return result;
+}
+
+// CPU as a share of one core while keeping up with the configured framerate.
+double core_percent(double cpu_seconds, double content_seconds) {
+    return content_seconds > 0.0 ? 100.0 * cpu_seconds / content_seconds : 0.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+
+    Options options;
+    try {
+        options = parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const double content_seconds = static_cast<double>(options.frames) / options.framerate;
+    const PassResult baseline = run_source_baseline(options);
+    if (!baseline.ok) {
+        std::cerr << "Synthetic source failed; nothing to compare\n";
+        return 1;
+    }
+
+    std::cout << options.frames << " frames of " << options.width << "x" << options.height << "@"
+              << options.framerate << " (" << options.pattern << "), target " << options.bitrate / 1000
+              << " kbit/s\n";
+    std::cout << std::left << std::setw(9) << "codec" << std::setw(12) << "encoder" << std::setw(12) << "decoder"
+              << std::right << std::setw(10) << "kbit/s" << std::setw(11) << "size sd%" << std::setw(10)
+              << "max/mean" << std::setw(11) << "enc %core" << std::setw(11) << "dec %core" << std::setw(10)
+              << "enc fps" << std::setw(10) << "dec fps" << "\n";
+
+    int status = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    for (VideoCodec codec : options.codecs) {
+        const char* encoder = installed_software_encoder(codec);
+        const char* decoder = installed_software_decoder(codec);
+        const std::string missing = missing_elements(codec, encoder, decoder);
+        if (!missing.empty()) {
+            std::cout << std::left << std::setw(9) << codec_name(codec) << "skipped, missing " << missing << "\n";
+            continue;
+        }
+        for (const bool low_latency : {false, true}) {
+            if (low_latency && !options.compare_low_latency) {
+                break;
+            }
+            const CodecResult result =
+                benchmark(options, codec, encoder, decoder, low_latency, baseline.cpu_seconds);
+            std::cout << std::left << std::setw(9) << (std::string{codec_name(codec)} + (low_latency ? " ll" : ""))
+                      << std::setw(12) << encoder << std::setw(12) << decoder;
+            if (!result.encode.ok || !result.rtp_ok || !result.decode.ok) {
+                std::cout << (!result.encode.ok ? "encode failed"
+                              : !result.rtp_ok  ? "RTP loopback failed"
+                                                : "decode failed")
+                          << "\n";
+                status = 1;
+                continue;
+            }
+            const double kbps = static_cast<double>(result.bytes) * 8.0 / content_seconds / 1000.0;
+            const double frames = static_cast<double>(result.access_units);
+            const double mean = static_cast<double>(result.bytes) / std::max(frames, 1.0);
+            std::cout << std::right << std::setw(10) << kbps << std::setw(11) << 100.0 * result.frame_stddev / mean
+                      << std::setw(10) << result.max_frame_bytes / mean << std::setw(11)
+                      << core_percent(result.encode.cpu_seconds, content_seconds) << std::setw(11)
+                      << core_percent(result.decode.cpu_seconds, content_seconds) << std::setw(10)
+                      << frames / std::max(result.encode.wall_seconds, 1e-6) << std::setw(10)
+                      << frames / std::max(result.decode.wall_seconds, 1e-6) << "\n";
+        }
+    }
+    return status;
+}
@@ -1,11 +1,16 @@
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <cmath>
 #include <csignal>
 #include <cstdlib>
 #include <cstdint>
 #include <exception>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <gst/app/gstappsink.h>
 #include <gst/gst.h>
@@ -14,30 +19,95 @@
 #include <unistd.h>
 #endif
 
+#include "gstreamer_worker/control/network_clock.hpp"
 #include "gstreamer_worker/control/pipeline_controller.hpp"
+#include "gstreamer_worker/pipeline/codec.hpp"
 #include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/encoded_stats.hpp"
+#include "gstreamer_worker/pipeline/layer_switcher.hpp"
+#include "gstreamer_worker/pipeline/load_shedder.hpp"
+#include "gstreamer_worker/pipeline/mosaic_compositor.hpp"
+#include "gstreamer_worker/pipeline/path_merger.hpp"
+#include "gstreamer_worker/pipeline/pre_event_recorder.hpp"
+#include "gstreamer_worker/pipeline/replay_source.hpp"
 #include "gstreamer_worker/pipeline/viewer_pipeline.hpp"
 #include "gstreamer_worker/zerocopy/buffer_exporter.hpp"
+#include "gstreamer_worker/zerocopy/encoded_exporter.hpp"
+#include "gstreamer_worker/zerocopy/frame_collator.hpp"
+#include "gstreamer_worker/zerocopy/rtp_metadata.hpp"
 
+using gstreamer_worker::control::NetworkClock;
+using gstreamer_worker::control::NetworkClockConfig;
 using gstreamer_worker::control::PipelineController;
+using gstreamer_worker::control::ThreadPolicy;
+using gstreamer_worker::control::parse_clock_spec;
+using gstreamer_worker::control::parse_thread_rule;
 using gstreamer_worker::pipeline::DecoderBackend;
+using gstreamer_worker::pipeline::EncodedStats;
+using gstreamer_worker::pipeline::LayerSwitcher;
+using gstreamer_worker::pipeline::LoadShedder;
+using gstreamer_worker::pipeline::MosaicCompositor;
+using gstreamer_worker::pipeline::PathMerger;
+using gstreamer_worker::pipeline::PreEventRecorder;
+using gstreamer_worker::pipeline::RecordingContainer;
+using gstreamer_worker::pipeline::ReplayFormat;
+using gstreamer_worker::pipeline::ReplaySource;
 using gstreamer_worker::pipeline::ViewerPipelineConfig;
+using gstreamer_worker::pipeline::kDepayloaderName;
+using gstreamer_worker::pipeline::format_encoded_stats;
+using gstreamer_worker::pipeline::format_mosaic_stats;
+using gstreamer_worker::pipeline::installed_software_decoder;
+using gstreamer_worker::pipeline::parse_codec;
+using gstreamer_worker::pipeline::resolve_replay_format;
 using gstreamer_worker::pipeline::make_viewer_pipeline;
+using gstreamer_worker::pipeline::matched_jitter_latency_ms;
+using gstreamer_worker::pipeline::mosaic_sink_name;
 using gstreamer_worker::zerocopy::BufferExporter;
+using gstreamer_worker::zerocopy::CollatedBatch;
+using gstreamer_worker::zerocopy::EncodedExporter;
+using gstreamer_worker::zerocopy::EncodedPacket;
 using gstreamer_worker::zerocopy::ExportPacket;
+using gstreamer_worker::zerocopy::FrameCollator;
+using gstreamer_worker::zerocopy::FrameCollatorConfig;
+using gstreamer_worker::zerocopy::FrameMetadata;
+using gstreamer_worker::zerocopy::MetaArena;
+using gstreamer_worker::zerocopy::install_rtp_metadata_reader;
 
 namespace {
 
 struct Options {
     ViewerPipelineConfig config{};
     bool verbose{true};
+    ThreadPolicy thread_policy{};
+    bool shared_clock{false};
+    NetworkClockConfig clock{};
+    bool encoded_stats{false};
+    // Seconds between encoded-stats reports while running; 0 reports at exit only.
+    std::uint32_t encoded_stats_interval{0};
+    // Seconds between mosaic tile reports while running; 0 reports at exit only.
+    std::uint32_t mosaic_report_interval{0};
+    // Hand the mosaic streams to a FrameCollator as capture-time batches
+    // instead of composing them; streams is filled from the mosaic ports.
+    bool collate{false};
+    FrameCollatorConfig collate_config{};
 };
 
 void print_usage(const char* program) {
     std::cout << "Usage: " << program
               << " [--listen 0.0.0.0] [--port 5000] [--latency 32]\n"
-              << "             [--backend auto|nvidia|software] [--appsink-name display_sink]\n"
-              << "             [--no-zero-copy]\n";
+              << "             [--backend auto|nvidia|software] [--codec h264|h265|av1]\n"
+              << "             [--appsink-name display_sink]\n"
+              << "             [--no-zero-copy] [--pre-event-seconds 30] [--record-dir .]\n"
+              << "             [--record-format ts|mp4] [--layer-ports 5000,5002] [--layer 0]\n"
+              << "             [--shed-load] [--thread-rule PATTERN:CPUS[:fifo=PRIO|nice=N]]...\n"
+              << "             [--clock HOST[:PORT]|ptp[:DOMAIN]] [--export-encoded] [--low-latency FPS]\n"
+              << "             [--redundant-port 5100] [--redundant-listen 0.0.0.0]\n"
+              << "             [--replay FILE] [--replay-speed 1|N|max] [--replay-original-timing]\n"
+              << "             [--replay-fps 30] [--encoded-stats <seconds, 0=at exit>]\n"
+              << "             [--mosaic 5000,5002,...] [--mosaic-size 1920x1080] [--mosaic-columns 0]\n"
+              << "             [--mosaic-fps 30] [--mosaic-decimate 1,2,...] [--mosaic-stale-ms 1000]\n"
+              << "             [--mosaic-report <seconds, 0=at exit>] [--collate <tolerance ms>]\n"
+              << "             [--collate-wait 50]\n";
 }
 
 DecoderBackend to_backend(std::string value) {
@@ -51,8 +121,32 @@ DecoderBackend to_backend(std::string value) {
     return DecoderBackend::Auto;
 }
 
+template <typename T>
+std::vector<T> parse_list(const std::string& value) {
+    std::vector<T> items;
+    std::size_t start = 0;
+    while (start <= value.size()) {
+        const auto comma = value.find(',', start);
+        const auto token = value.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        if (!token.empty()) {
+            items.push_back(static_cast<T>(std::stoul(token)));
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return items;
+}
+
+std::vector<std::uint16_t> parse_ports(const std::string& value) {
+    return parse_list<std::uint16_t>(value);
+}
+
 Options parse_args(int argc, char** argv) {
     Options options;
+    bool latency_set = false;
+    std::uint32_t low_latency_fps = 0;
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         auto require_value = [&](const char* flag) -> std::string {
@@ -67,14 +161,92 @@ Options parse_args(int argc, char** argv) {
             options.config.listen.port = static_cast<std::uint16_t>(std::stoul(require_value("--port")));
         } else if (arg == "--latency") {
             options.config.latency_ms = static_cast<std::uint32_t>(std::stoul(require_value("--latency")));
+            latency_set = true;
+        } else if (arg == "--low-latency") {
+            low_latency_fps = static_cast<std::uint32_t>(std::stoul(require_value("--low-latency")));
+        } else if (arg == "--redundant-port") {
+            options.config.redundancy.enabled = true;
+            options.config.redundancy.secondary.port =
+                static_cast<std::uint16_t>(std::stoul(require_value("--redundant-port")));
+        } else if (arg == "--redundant-listen") {
+            options.config.redundancy.enabled = true;
+            options.config.redundancy.secondary.host = require_value("--redundant-listen");
+        } else if (arg == "--replay") {
+            options.config.replay.enabled = true;
+            options.config.replay.path = require_value("--replay");
+        } else if (arg == "--replay-speed") {
+            const std::string speed = require_value("--replay-speed");
+            options.config.replay.speed = speed == "max" ? 0.0 : std::stod(speed);
+        } else if (arg == "--replay-original-timing") {
+            options.config.replay.original_timing = true;
+        } else if (arg == "--replay-fps") {
+            options.config.replay.framerate = static_cast<std::uint32_t>(std::stoul(require_value("--replay-fps")));
+        } else if (arg == "--encoded-stats") {
+            options.encoded_stats = true;
+            options.encoded_stats_interval =
+                static_cast<std::uint32_t>(std::stoul(require_value("--encoded-stats")));
+        } else if (arg == "--mosaic") {
+            options.config.mosaic.enabled = true;
+            options.config.mosaic.ports = parse_ports(require_value("--mosaic"));
+        } else if (arg == "--mosaic-size") {
+            const std::string size = require_value("--mosaic-size");
+            const auto separator = size.find('x');
+            if (separator == std::string::npos) {
+                throw std::invalid_argument("--mosaic-size expects WIDTHxHEIGHT");
+            }
+            options.config.mosaic.width = static_cast<std::uint32_t>(std::stoul(size.substr(0, separator)));
+            options.config.mosaic.height = static_cast<std::uint32_t>(std::stoul(size.substr(separator + 1)));
+        } else if (arg == "--mosaic-columns") {
+            options.config.mosaic.columns = static_cast<std::uint32_t>(std::stoul(require_value("--mosaic-columns")));
+        } else if (arg == "--mosaic-fps") {
+            options.config.mosaic.framerate = static_cast<std::uint32_t>(std::stoul(require_value("--mosaic-fps")));
+        } else if (arg == "--mosaic-decimate") {
+            options.config.mosaic.decimation = parse_list<std::uint32_t>(require_value("--mosaic-decimate"));
+        } else if (arg == "--mosaic-stale-ms") {
+            options.config.mosaic.stale_ms = static_cast<std::uint32_t>(std::stoul(require_value("--mosaic-stale-ms")));
+        } else if (arg == "--mosaic-report") {
+            options.mosaic_report_interval = static_cast<std::uint32_t>(std::stoul(require_value("--mosaic-report")));
+        } else if (arg == "--collate") {
+            options.collate = true;
+            options.collate_config.tolerance = std::stoul(require_value("--collate")) * GST_MSECOND;
+        } else if (arg == "--collate-wait") {
+            options.collate_config.max_wait = std::chrono::milliseconds(std::stoul(require_value("--collate-wait")));
         } else if (arg == "--backend") {
             options.config.backend = to_backend(require_value("--backend"));
+        } else if (arg == "--codec") {
+            options.config.codec = parse_codec(require_value("--codec"));
         } else if (arg == "--appsink-name") {
             options.config.appsink_name = require_value("--appsink-name");
         } else if (arg == "--no-zero-copy") {
             options.config.request_zero_copy = false;
+        } else if (arg == "--pre-event-seconds") {
+            options.config.recorder.enabled = true;
+            options.config.recorder.pre_event_seconds =
+                static_cast<std::uint32_t>(std::stoul(require_value("--pre-event-seconds")));
+        } else if (arg == "--record-dir") {
+            options.config.recorder.output_directory = require_value("--record-dir");
+        } else if (arg == "--record-format") {
+            const std::string format = require_value("--record-format");
+            options.config.recorder.container =
+                format == "mp4" ? RecordingContainer::FragmentedMp4 : RecordingContainer::MpegTs;
+        } else if (arg == "--layer-ports") {
+            options.config.layer_ports = parse_ports(require_value("--layer-ports"));
+        } else if (arg == "--layer") {
+            options.config.initial_layer = std::stoul(require_value("--layer"));
+        } else if (arg == "--shed-load") {
+            options.config.load_shedding.enabled = true;
         } else if (arg == "--quiet") {
             options.verbose = false;
+        } else if (arg == "--export-encoded") {
+            options.config.encoded_export.enabled = true;
+        } else if (arg == "--clock") {
+            options.shared_clock = true;
+            options.clock = parse_clock_spec(require_value("--clock"));
+            if (options.clock.mode == NetworkClockConfig::Mode::Provide) {
+                throw std::invalid_argument("viewer_client follows the capture clock: --clock HOST[:PORT]|ptp");
+            }
+        } else if (arg == "--thread-rule") {
+            options.thread_policy.rules.push_back(parse_thread_rule(require_value("--thread-rule")));
         } else if (arg == "--help" || arg == "-h") {
             print_usage(argv[0]);
             std::exit(0);
@@ -82,18 +254,90 @@ Options parse_args(int argc, char** argv) {
             throw std::invalid_argument("Unknown argument: " + arg);
         }
     }
+    if (options.collate) {
+        if (!options.config.mosaic.enabled) {
+            throw std::invalid_argument("--collate batches the --mosaic ports");
+        }
+        options.collate_config.streams = options.config.mosaic.ports.size();
+    }
+    if (low_latency_fps != 0) {
+        // An explicit --latency still wins over the matched value.
+        options.config.drop_on_latency = true;
+        if (!latency_set) {
+            options.config.latency_ms = matched_jitter_latency_ms(low_latency_fps);
+        }
+    }
     return options;
 }
 
+// Mean, deviation and peak of a series, updated from one streaming thread and
+// read once the pipeline has stopped.
+struct RunningStats {
+    guint64 count{0};
+    double mean{0.0};
+    double m2{0.0};
+    double max{0.0};
+
+    void add(double value) {
+        ++count;
+        const double delta = value - mean;
+        mean += delta / static_cast<double>(count);
+        m2 += delta * (value - mean);
+        max = std::max(max, value);
+    }
+
+    double stddev() const { return count > 1 ? std::sqrt(m2 / static_cast<double>(count - 1)) : 0.0; }
+};
+
+// Capture-to-export latency on the shared clock. The bound adds the error
+// estimates of both ends, since each host's offset is only known that well.
+void print_latency(const FrameMetadata& metadata, const NetworkClock& clock) {
+    const GstClockTime now = clock.now();
+    if (!GST_CLOCK_TIME_IS_VALID(metadata.capture_ts) || now < metadata.capture_ts) {
+        return;
+    }
+    GstClockTime error = clock.error_estimate();
+    if (GST_CLOCK_TIME_IS_VALID(error) && GST_CLOCK_TIME_IS_VALID(metadata.clock_error)) {
+        error += metadata.clock_error;
+    }
+    const double latency_ms = static_cast<double>(now - metadata.capture_ts) / GST_MSECOND;
+    const double encode_ms = metadata.encode_ts >= metadata.capture_ts
+                                 ? static_cast<double>(metadata.encode_ts - metadata.capture_ts) / GST_MSECOND
+                                 : 0.0;
+    if (GST_CLOCK_TIME_IS_VALID(error)) {
+        g_print("  latency %.2f ms (+/- %.2f ms), encoded after %.2f ms\n", latency_ms,
+                static_cast<double>(error) / GST_MSECOND, encode_ms);
+    } else {
+        g_print("  latency %.2f ms (clock not measured yet), encoded after %.2f ms\n", latency_ms, encode_ms);
+    }
+}
+
 class SampleConsumer {
   public:
-    explicit SampleConsumer(bool verbose)
-        : exporter_([verbose](const ExportPacket& packet) {
+    SampleConsumer(bool verbose, const NetworkClock* clock, ReplaySource* replay = nullptr)
+        : replay_(replay),
+          exporter_([this, verbose, clock](const ExportPacket& packet) {
+              if (clock && packet.metadata.frame_id != 0 && GST_CLOCK_TIME_IS_VALID(packet.metadata.capture_ts)) {
+                  const GstClockTime now = clock->now();
+                  if (now >= packet.metadata.capture_ts) {
+                      latency_.add(static_cast<double>(now - packet.metadata.capture_ts) / GST_MSECOND);
+                  }
+              }
               if (verbose) {
                   gchar* caps_str = packet.caps ? gst_caps_to_string(packet.caps) : nullptr;
                   g_print("Frame %llu fd=%d caps=%s\n", static_cast<unsigned long long>(packet.metadata.frame_id),
                           packet.dma_fd, caps_str ? caps_str : "<unknown>");
                   g_free(caps_str);
+                  if (packet.metadata.skipped_frames > 0) {
+                      g_print("  %u static frames skipped before it\n", packet.metadata.skipped_frames);
+                  }
+                  if (!packet.sections.empty()) {
+                      g_print("  %zu metadata sections (%zu bytes)\n", packet.sections.count(),
+                              packet.sections.bytes().size());
+                  }
+                  if (clock && packet.metadata.frame_id != 0) {
+                      print_latency(packet.metadata, *clock);
+                  }
               }
 #if defined(G_OS_UNIX)
               if (packet.dma_fd >= 0) {
@@ -107,15 +351,157 @@ class SampleConsumer {
         if (!sample) {
             return GST_FLOW_ERROR;
         }
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        const GstClockTime pts = buffer ? GST_BUFFER_PTS(buffer) : GST_CLOCK_TIME_NONE;
         const bool ok = exporter_.export_sample(sample);
         gst_sample_unref(sample);
+        if (replay_) {
+            const double latency_ms = replay_->frame_exported(pts);
+            if (latency_ms >= 0.0) {
+                replay_latency_.add(latency_ms);
+            }
+        }
         return ok ? GST_FLOW_OK : GST_FLOW_ERROR;
     }
 
+    // Also fed by MosaicCompositor in mosaic mode.
+    const BufferExporter& exporter() const { return exporter_; }
+
+    // Capture-to-display latency in ms; empty without a shared clock.
+    const RunningStats& latency() const { return latency_; }
+    // Push-to-export latency of replayed frames in ms; empty without replay.
+    const RunningStats& replay_latency() const { return replay_latency_; }
+
   private:
+    ReplaySource* replay_{nullptr};
+    RunningStats latency_{};
+    RunningStats replay_latency_{};
     BufferExporter exporter_;
 };
 
+// Batches the mosaic tiles by capture_ts for a multi-camera consumer such as
+// batched inference: each tile's appsink feeds its own exporter into the
+// collator, and every batch arrives as one callback with all the fds. Here the
+// batches are logged and their fds closed.
+class BatchConsumer {
+  public:
+    BatchConsumer(const FrameCollatorConfig& config, bool verbose)
+        : collator_(config, [verbose](const CollatedBatch& batch) {
+              if (verbose) {
+                  g_print("Batch at %.3f s: %zu/%zu streams, spread %.2f ms\n",
+                          static_cast<double>(batch.capture_ts) / GST_SECOND, batch.present, batch.frames.size(),
+                          static_cast<double>(batch.spread) / GST_MSECOND);
+              }
+#if defined(G_OS_UNIX)
+              for (const ExportPacket& frame : batch.frames) {
+                  if (frame.dma_fd >= 0) {
+                      close(frame.dma_fd);
+                  }
+              }
+#endif
+          }) {
+        for (std::size_t stream = 0; stream < config.streams; ++stream) {
+            exporters_.push_back(std::make_unique<BufferExporter>(collator_.input(stream)));
+        }
+    }
+
+    bool attach(GstElement* pipeline) {
+        for (std::size_t stream = 0; stream < exporters_.size(); ++stream) {
+            GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), mosaic_sink_name(stream).c_str());
+            if (!sink) {
+                std::cerr << "Unable to find mosaic sink " << mosaic_sink_name(stream) << "\n";
+                return false;
+            }
+            g_signal_connect(sink, "new-sample", G_CALLBACK(on_new_sample), exporters_[stream].get());
+            gst_object_unref(sink);
+        }
+        return true;
+    }
+
+    // Releases batches past max_wait when no stream pushes to do it.
+    void poll() { collator_.poll(); }
+
+    // Releases frames still waiting for their batch; call once the pipeline
+    // has stopped.
+    void flush() { collator_.flush(); }
+
+    FrameCollator::Stats stats() const { return collator_.stats(); }
+
+  private:
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer exporter_ptr) {
+        GstSample* sample = gst_app_sink_pull_sample(sink);
+        if (!sample) {
+            return GST_FLOW_ERROR;
+        }
+        const bool ok = static_cast<const BufferExporter*>(exporter_ptr)->export_sample(sample);
+        gst_sample_unref(sample);
+        return ok ? GST_FLOW_OK : GST_FLOW_ERROR;
+    }
+
+    FrameCollator collator_;
+    std::vector<std::unique_ptr<BufferExporter>> exporters_;
+};
+
+// Receives parsed access units next to the decoder. A real consumer would
+// forward them; here they are counted and keyframes logged.
+class EncodedConsumer {
+  public:
+    struct Stats {
+        guint64 access_units{0};
+        guint64 keyframes{0};
+        guint64 bytes{0};
+    };
+
+    explicit EncodedConsumer(bool verbose)
+        : exporter_([this, verbose](const EncodedPacket& packet) {
+              access_units_.fetch_add(1, std::memory_order_relaxed);
+              bytes_.fetch_add(packet.size, std::memory_order_relaxed);
+              frame_size_.add(static_cast<double>(packet.size));
+              if (packet.keyframe) {
+                  keyframes_.fetch_add(1, std::memory_order_relaxed);
+                  if (verbose) {
+                      g_print("Keyframe AU %llu: %zu bytes in %zu chunk(s)\n",
+                              static_cast<unsigned long long>(packet.metadata.frame_id),
+                              static_cast<std::size_t>(packet.size), packet.chunk_count);
+                  }
+              }
+          }) {}
+
+    GstFlowReturn on_new_sample(GstAppSink* sink) {
+        GstSample* sample = gst_app_sink_pull_sample(sink);
+        if (!sample) {
+            return GST_FLOW_ERROR;
+        }
+        exporter_.export_sample(sample);
+        gst_sample_unref(sample);
+        // A consumer failure must not stop the decode branch behind the tee.
+        return GST_FLOW_OK;
+    }
+
+    Stats stats() const {
+        return Stats{access_units_.load(std::memory_order_relaxed), keyframes_.load(std::memory_order_relaxed),
+                     bytes_.load(std::memory_order_relaxed)};
+    }
+
+    // Access unit sizes in bytes; valid once the pipeline has stopped.
+    const RunningStats& frame_size() const { return frame_size_; }
+
+  private:
+    std::atomic<guint64> access_units_{0};
+    std::atomic<guint64> keyframes_{0};
+    std::atomic<guint64> bytes_{0};
+    RunningStats frame_size_{};
+    EncodedExporter exporter_;
+};
+
+GstFlowReturn on_encoded_sample_proxy(GstAppSink* sink, gpointer user_data) {
+    auto* consumer = static_cast<EncodedConsumer*>(user_data);
+    if (!consumer) {
+        return GST_FLOW_ERROR;
+    }
+    return consumer->on_new_sample(sink);
+}
+
 GstFlowReturn on_new_sample_proxy(GstAppSink* sink, gpointer user_data) {
     auto* consumer = static_cast<SampleConsumer*>(user_data);
     if (!consumer) {
@@ -132,8 +518,82 @@ gboolean handle_signal(gpointer controller_ptr) {
     }
     return G_SOURCE_REMOVE;
 }
+
+gboolean handle_layer_cycle(gpointer switcher_ptr) {
+    auto* switcher = static_cast<LayerSwitcher*>(switcher_ptr);
+    if (switcher && switcher->layer_count() > 0) {
+        const std::size_t next = (switcher->active_layer() + 1) % switcher->layer_count();
+        switcher->request_layer(next);
+        g_print("Switching to layer %zu at the next IDR\n", next);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean handle_record_trigger(gpointer recorder_ptr) {
+    auto* recorder = static_cast<PreEventRecorder*>(recorder_ptr);
+    if (recorder) {
+        const std::string path = recorder->trigger();
+        if (path.empty()) {
+            g_print("Pre-event ring is empty, nothing to save\n");
+        } else {
+            g_print("Saving pre-event segment to %s\n", path.c_str());
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
 #endif
 
+// One EncodedStats per receive chain on its depayloader.
+using ChainStats = std::vector<std::unique_ptr<EncodedStats>>;
+
+void print_encoded_stats(const ChainStats& stats, const char* chain_label) {
+    for (std::size_t index = 0; index < stats.size(); ++index) {
+        if (stats.size() > 1) {
+            std::cout << chain_label << " " << index << " ";
+        }
+        std::cout << format_encoded_stats(stats[index]->snapshot()) << std::endl;
+    }
+}
+
+gboolean report_encoded_stats(gpointer stats_ptr) {
+    const auto* stats = static_cast<const ChainStats*>(stats_ptr);
+    if (stats) {
+        print_encoded_stats(*stats, "Layer");
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean report_tile_encoded_stats(gpointer stats_ptr) {
+    const auto* stats = static_cast<const ChainStats*>(stats_ptr);
+    if (stats) {
+        print_encoded_stats(*stats, "Tile");
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean poll_batches(gpointer batches_ptr) {
+    auto* batches = static_cast<BatchConsumer*>(batches_ptr);
+    if (batches) {
+        batches->poll();
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean report_mosaic_stats(gpointer mosaic_ptr) {
+    const auto* mosaic = static_cast<const MosaicCompositor*>(mosaic_ptr);
+    if (mosaic) {
+        std::cout << format_mosaic_stats(mosaic->stats()) << std::endl;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+void print_thread_usage(PipelineController& controller) {
+    for (const auto& thread : controller.thread_usage()) {
+        std::cout << "Thread " << thread.element << " (tid " << thread.tid << "): " << thread.cpu_seconds
+                  << " s CPU" << (thread.placed ? ", placed" : "") << std::endl;
+    }
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -147,6 +607,10 @@ int main(int argc, char** argv) {
         print_usage(argv[0]);
         return 1;
     }
+    // The only registry lookup for the decoder; the builders take it as given.
+    if (options.config.decoder.empty()) {
+        options.config.decoder = installed_software_decoder(options.config.codec);
+    }
 
     GError* error = nullptr;
     GstElement* pipeline = nullptr;
@@ -166,36 +630,206 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), options.config.appsink_name.c_str());
-    if (!sink) {
-        std::cerr << "Unable to find appsink named " << options.config.appsink_name << "\n";
+    // Mosaic mode has one appsink per tile, read by MosaicCompositor or the collator.
+    GstElement* sink = nullptr;
+    if (!options.config.mosaic.enabled) {
+        sink = gst_bin_get_by_name(GST_BIN(pipeline), options.config.appsink_name.c_str());
+        if (!sink) {
+            std::cerr << "Unable to find appsink named " << options.config.appsink_name << "\n";
+            gst_object_unref(pipeline);
+            return 1;
+        }
+    }
+
+    std::unique_ptr<NetworkClock> clock;
+    if (options.shared_clock) {
+        try {
+            clock = std::make_unique<NetworkClock>(options.clock);
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << "\n";
+            gst_clear_object(&sink);
+            gst_object_unref(pipeline);
+            return 1;
+        }
+        clock->apply(pipeline);
+    }
+
+    // Metadata arrives in RTP header extensions; reattach it after each
+    // depayloader. Section blocks are rebuilt in a pool shared by all chains.
+    MetaArena arena;
+    ChainStats encoded_stats;
+    // Replayed elementary streams bypass the depayloader.
+    std::size_t chains = std::max<std::size_t>(1, options.config.layer_ports.size());
+    if (options.config.mosaic.enabled) {
+        chains = options.config.mosaic.ports.size();
+    } else if (options.config.replay.enabled &&
+               resolve_replay_format(options.config.replay) == ReplayFormat::ElementaryStream) {
+        chains = 0;
+    }
+    for (std::size_t index = 0; index < chains; ++index) {
+        const std::string name =
+            std::string{kDepayloaderName} + (index == 0 ? std::string{} : "_" + std::to_string(index));
+        GstElement* depayloader = gst_bin_get_by_name(GST_BIN(pipeline), name.c_str());
+        if (!depayloader || !install_rtp_metadata_reader(depayloader, &arena)) {
+            std::cerr << "Unable to read RTP metadata from " << name << "\n";
+        }
+        // Added after the reader so each frame already carries its FrameMeta.
+        if (options.encoded_stats) {
+            auto chain = std::make_unique<EncodedStats>();
+            if (!depayloader || !chain->attach(depayloader, options.config.codec)) {
+                std::cerr << "Unable to collect encoded stats from " << name << "\n";
+            }
+            encoded_stats.push_back(std::move(chain));
+        }
+        if (depayloader) {
+            gst_object_unref(depayloader);
+        }
+    }
+
+    ReplaySource replay;
+    if (options.config.replay.enabled && !replay.attach(pipeline, options.config)) {
+        std::cerr << "Unable to replay " << options.config.replay.path << "\n";
+        gst_clear_object(&sink);
+        gst_object_unref(pipeline);
+        return 1;
+    }
+
+    SampleConsumer consumer(options.verbose, clock.get(), options.config.replay.enabled ? &replay : nullptr);
+    if (sink) {
+        GstAppSink* app_sink = GST_APP_SINK(sink);
+        gst_app_sink_set_emit_signals(app_sink, TRUE);
+        gst_app_sink_set_max_buffers(app_sink, 1);
+        // Replay counts every decoded frame, so the sink blocks instead.
+        gst_app_sink_set_drop(app_sink, options.config.replay.enabled ? FALSE : TRUE);
+        g_signal_connect(app_sink, "new-sample", G_CALLBACK(on_new_sample_proxy), &consumer);
+    }
+
+    // With --collate the tiles go to the collator and nothing is composed.
+    std::unique_ptr<BatchConsumer> batches;
+    MosaicCompositor mosaic;
+    if (options.collate) {
+        batches = std::make_unique<BatchConsumer>(options.collate_config, options.verbose);
+        if (!batches->attach(pipeline)) {
+            gst_object_unref(pipeline);
+            return 1;
+        }
+    } else if (options.config.mosaic.enabled &&
+               !mosaic.attach(pipeline, options.config.mosaic, &consumer.exporter())) {
+        std::cerr << "Unable to attach mosaic compositor\n";
+        gst_object_unref(pipeline);
+        return 1;
+    }
+
+    EncodedConsumer encoded_consumer(options.verbose);
+    if (options.config.encoded_export.enabled) {
+        GstElement* encoded_sink = gst_bin_get_by_name(GST_BIN(pipeline), options.config.encoded_export.appsink_name.c_str());
+        if (!encoded_sink) {
+            std::cerr << "Unable to find appsink named " << options.config.encoded_export.appsink_name << "\n";
+            gst_clear_object(&sink);
+            gst_object_unref(pipeline);
+            return 1;
+        }
+        g_signal_connect(encoded_sink, "new-sample", G_CALLBACK(on_encoded_sample_proxy), &encoded_consumer);
+        gst_object_unref(encoded_sink);
+    }
+
+    std::unique_ptr<PreEventRecorder> recorder;
+    if (options.config.recorder.enabled) {
+        recorder = std::make_unique<PreEventRecorder>(options.config.recorder);
+        if (!recorder->attach(pipeline)) {
+            std::cerr << "Unable to find recorder sink " << options.config.recorder.appsink_name << "\n";
+            gst_clear_object(&sink);
+            gst_object_unref(pipeline);
+            return 1;
+        }
+    }
+
+    LayerSwitcher layer_switcher;
+    if (!options.config.layer_ports.empty() && !layer_switcher.attach(pipeline, options.config)) {
+        std::cerr << "Unable to attach simulcast layer selector\n";
+        gst_clear_object(&sink);
+        gst_object_unref(pipeline);
+        return 1;
+    }
+
+    LoadShedder load_shedder;
+    if (options.config.load_shedding.enabled &&
+        !load_shedder.attach(pipeline, options.config.load_shedding, options.config.codec)) {
+        std::cerr << "Unable to attach load shedder to " << gstreamer_worker::pipeline::kDecodeQueueName << "\n";
+        gst_clear_object(&sink);
         gst_object_unref(pipeline);
         return 1;
     }
 
-    SampleConsumer consumer(options.verbose);
-    GstAppSink* app_sink = GST_APP_SINK(sink);
-    gst_app_sink_set_emit_signals(app_sink, TRUE);
-    gst_app_sink_set_max_buffers(app_sink, 1);
-    gst_app_sink_set_drop(app_sink, TRUE);
-    g_signal_connect(app_sink, "new-sample", G_CALLBACK(on_new_sample_proxy), &consumer);
+    PathMerger path_merger;
+    if (options.config.redundancy.enabled && !path_merger.attach(pipeline, options.config)) {
+        std::cerr << "Unable to attach redundant path merger to " << gstreamer_worker::pipeline::kPrimarySourceName
+                  << "\n";
+        gst_clear_object(&sink);
+        gst_object_unref(pipeline);
+        return 1;
+    }
 
     PipelineController controller;
+    controller.set_thread_policy(options.thread_policy);
     controller.set_pipeline(pipeline);
 
+    if (!encoded_stats.empty() && options.encoded_stats_interval > 0) {
+        controller.add_timeout(options.encoded_stats_interval * 1000,
+                               options.config.mosaic.enabled ? report_tile_encoded_stats : report_encoded_stats,
+                               &encoded_stats);
+    }
+    if (batches) {
+        const auto wait_ms = static_cast<guint>(options.collate_config.max_wait.count());
+        controller.add_timeout(std::max<guint>(1, wait_ms), poll_batches, batches.get());
+    }
+    if (options.config.mosaic.enabled && !batches && options.mosaic_report_interval > 0) {
+        controller.add_timeout(options.mosaic_report_interval * 1000, report_mosaic_stats, &mosaic);
+    }
+
 #if defined(G_OS_UNIX)
-    g_unix_signal_add(SIGINT, handle_signal, &controller);
-    g_unix_signal_add(SIGTERM, handle_signal, &controller);
+    controller.add_unix_signal(SIGINT, handle_signal, &controller);
+    controller.add_unix_signal(SIGTERM, handle_signal, &controller);
+    if (recorder) {
+        controller.add_unix_signal(SIGUSR1, handle_record_trigger, recorder.get());
+    }
+    if (layer_switcher.layer_count() > 0) {
+        controller.add_unix_signal(SIGUSR2, handle_layer_cycle, &layer_switcher);
+    }
 #endif
 
     if (!controller.play()) {
         std::cerr << "Unable to transition pipeline to PLAYING." << std::endl;
-        gst_object_unref(sink);
+        gst_clear_object(&sink);
         gst_object_unref(pipeline);
         return 1;
     }
 
-    if (options.verbose) {
+    if (options.config.replay.enabled) {
+        replay.start();
+        if (options.verbose) {
+            std::cout << "Replaying " << options.config.replay.path << " at ";
+            if (options.config.replay.speed > 0.0) {
+                std::cout << options.config.replay.speed << "x" << std::endl;
+            } else {
+                std::cout << "maximum speed" << std::endl;
+            }
+        }
+    } else if (batches) {
+        if (options.verbose) {
+            std::cout << "Collating " << options.collate_config.streams << " streams on "
+                      << options.config.listen.host << " within "
+                      << static_cast<double>(options.collate_config.tolerance) / GST_MSECOND << " ms" << std::endl;
+        }
+    } else if (options.config.mosaic.enabled) {
+        mosaic.start();
+        if (options.verbose) {
+            std::cout << "Mosaic of " << options.config.mosaic.ports.size() << " streams on "
+                      << options.config.listen.host << ", " << options.config.mosaic.width << "x"
+                      << options.config.mosaic.height << " at " << options.config.mosaic.framerate << " fps"
+                      << std::endl;
+        }
+    } else if (options.verbose) {
         std::cout << "Viewer listening on " << options.config.listen.host << ":" << options.config.listen.port
                   << std::endl;
     }
@@ -203,7 +837,82 @@ int main(int argc, char** argv) {
     controller.run();
 
     controller.stop();
-    gst_object_unref(sink);
+    print_thread_usage(controller);
+    if (options.config.load_shedding.enabled) {
+        const auto shed = load_shedder.stats();
+        std::cout << "Load shedding: decoded " << shed.passed << ", shed " << shed.shed_total() << " ("
+                  << shed.shed_non_reference << " non-reference, " << shed.shed_gop_frames << " in "
+                  << shed.gop_skips << " GOP tails)" << std::endl;
+    }
+    if (!encoded_stats.empty()) {
+        print_encoded_stats(encoded_stats, options.config.mosaic.enabled ? "Tile" : "Layer");
+        encoded_stats.clear();
+    }
+    if (batches) {
+        batches->flush();
+        const auto collated = batches->stats();
+        std::cout << "Collator: " << collated.batches << " batches (" << collated.complete << " complete, "
+                  << collated.partial << " partial), dropped " << collated.dropped_late << " late, "
+                  << collated.dropped_overflow << " overflowed, " << collated.dropped_partial << " partial batches"
+                  << std::endl;
+    } else if (options.config.mosaic.enabled) {
+        std::cout << format_mosaic_stats(mosaic.stats()) << std::endl;
+    }
+    if (options.config.replay.enabled) {
+        replay.detach();
+        const auto replayed = replay.stats();
+        std::cout << "Replay: pushed " << replayed.frames_pushed << " frames (" << replayed.packets_pushed
+                  << " packets, " << replayed.bytes_pushed << " bytes), exported " << replayed.frames_exported
+                  << " in " << replayed.elapsed_seconds << " s = " << replayed.decode_fps << " fps" << std::endl;
+        const RunningStats& latency = consumer.replay_latency();
+        if (latency.count > 0) {
+            std::cout << "Push-to-export latency: mean " << latency.mean << " ms, stddev " << latency.stddev()
+                      << " ms, max " << latency.max << " ms over " << latency.count << " frames" << std::endl;
+        }
+    }
+    if (options.config.redundancy.enabled) {
+        const auto merged = path_merger.stats();
+        std::cout << "Redundant paths: forwarded " << merged.forwarded << ", dropped " << merged.duplicates
+                  << " duplicates" << std::endl;
+        const char* labels[] = {"primary", "secondary"};
+        for (std::size_t path = 0; path < merged.paths.size(); ++path) {
+            std::cout << "  " << labels[path] << ": received " << merged.paths[path].received << ", lost "
+                      << merged.paths[path].lost << ", first " << merged.paths[path].first << std::endl;
+        }
+        std::cout << "  skew (secondary - primary): mean " << merged.mean_skew_ms << " ms, max "
+                  << merged.max_skew_ms << " ms" << std::endl;
+    }
+    if (options.config.encoded_export.enabled) {
+        const auto encoded = encoded_consumer.stats();
+        std::cout << "Encoded export: " << encoded.access_units << " access units (" << encoded.keyframes
+                  << " keyframes), " << encoded.bytes << " bytes" << std::endl;
+        // Peaks well above the mean are what the jitterbuffer latency has to absorb.
+        const RunningStats& size = encoded_consumer.frame_size();
+        if (size.count > 0) {
+            std::cout << "Encoded frame size: mean " << static_cast<guint64>(size.mean) << " B, stddev "
+                      << static_cast<guint64>(size.stddev()) << " B (" << 100.0 * size.stddev() / size.mean
+                      << "% of mean), max " << static_cast<guint64>(size.max) << " B" << std::endl;
+        }
+    }
+    if (consumer.latency().count > 0) {
+        const RunningStats& latency = consumer.latency();
+        std::cout << "Capture-to-display latency: mean " << latency.mean << " ms, stddev " << latency.stddev()
+                  << " ms, max " << latency.max << " ms over " << latency.count << " frames" << std::endl;
+    }
+    if (clock) {
+        const GstClockTime error = clock->error_estimate();
+        std::cout << "Shared clock: " << (clock->synced() ? "synced" : "not synced");
+        if (GST_CLOCK_TIME_IS_VALID(error)) {
+            std::cout << ", error estimate " << static_cast<double>(error) / GST_MSECOND << " ms";
+        }
+        std::cout << std::endl;
+    }
+    mosaic.detach();
+    path_merger.detach();
+    load_shedder.detach();
+    layer_switcher.detach();
+    recorder.reset();
+    gst_clear_object(&sink);
     gst_object_unref(pipeline);
     return 0;
 }
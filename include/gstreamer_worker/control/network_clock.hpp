@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <gst/gst.h>
+
+namespace gstreamer_worker::control {
+
+struct NetworkClockConfig {
+    enum class Mode {
+        // Host monotonic clock; timestamps only comparable on this host.
+        Local,
+        // Serve this host's system clock with GstNetTimeProvider.
+        Provide,
+        // Slave to a GstNetTimeProvider with GstNetClientClock.
+        Follow,
+        // Slave to the PTP grandmaster of `ptp_domain`.
+        Ptp,
+    };
+
+    Mode mode{Mode::Local};
+    // Bind address when providing, server address when following.
+    std::string address{"0.0.0.0"};
+    // 0 lets a provider pick a free port; see NetworkClock::port().
+    std::uint16_t port{5637};
+    guint ptp_domain{0};
+    GstClockTime sync_timeout{5 * GST_SECOND};
+};
+
+// Parses "provide[:PORT]", "HOST[:PORT]" (follow) or "ptp[:DOMAIN]". Throws
+// std::invalid_argument on malformed input.
+NetworkClockConfig parse_clock_spec(std::string_view spec);
+
+// The clock that FrameMetadata timestamps are expressed in. In the shared modes
+// every host reads the provider's (or PTP grandmaster's) time, so capture_ts
+// from one host can be subtracted from now() on another.
+class NetworkClock {
+  public:
+    // Throws std::runtime_error when the provider or client cannot be created.
+    // A client that has not synchronised within sync_timeout is kept (it keeps
+    // converging) and reported through synced().
+    explicit NetworkClock(NetworkClockConfig config = {});
+    ~NetworkClock();
+
+    NetworkClock(const NetworkClock&) = delete;
+    NetworkClock& operator=(const NetworkClock&) = delete;
+
+    GstClock* clock() const { return clock_; }
+    const NetworkClockConfig& config() const { return config_; }
+    // Port the provider is bound to, or the configured port in the other modes.
+    std::uint16_t port() const;
+
+    // Makes `pipeline` run on this clock so buffer running times share it too.
+    void apply(GstElement* pipeline) const;
+
+    GstClockTime now() const;
+    bool synced() const;
+
+    // Estimated offset error against the shared timebase: 0 on the provider,
+    // half the filtered round trip for a net client, the mean path delay for
+    // PTP, GST_CLOCK_TIME_NONE before the first measurement.
+    GstClockTime error_estimate() const;
+
+  private:
+    static GstBusSyncReply on_client_stats(GstBus* bus, GstMessage* message, gpointer user_data);
+    static gboolean on_ptp_stats(guint8 domain, const GstStructure* stats, gpointer user_data);
+
+    NetworkClockConfig config_;
+    GstClock* clock_{nullptr};
+    GstObject* provider_{nullptr};
+    GstBus* stats_bus_{nullptr};
+    gulong ptp_stats_id_{0};
+    std::atomic<GstClockTime> error_{GST_CLOCK_TIME_NONE};
+};
+
+}  // namespace gstreamer_worker::control
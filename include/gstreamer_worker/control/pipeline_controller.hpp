@@ -1,37 +1,120 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gst/gst.h>
 
+#include "gstreamer_worker/control/shared_task_pool.hpp"
+#include "gstreamer_worker/control/thread_policy.hpp"
+
 namespace gstreamer_worker::control {
 
 class PipelineController {
   public:
-    PipelineController();
+    struct ThreadUsage {
+        std::string element;
+        int tid{0};
+        bool active{false};
+        // A policy rule matched and was applied without error.
+        bool placed{false};
+        double cpu_seconds{0.0};
+        // Share of one core since the previous thread_usage() call.
+        double cpu_percent{0.0};
+    };
+
+    // With `own_context` the controller dispatches its bus watch, signal
+    // sources and commands on a private GMainContext instead of the global
+    // default one, so a slow handler only delays its own pipeline.
+    explicit PipelineController(bool own_context = false);
     ~PipelineController();
 
+    PipelineController(const PipelineController&) = delete;
+    PipelineController& operator=(const PipelineController&) = delete;
+
+    // Context the controller's sources are attached to.
+    GMainContext* context() const;
+
     void set_pipeline(GstElement* pipeline);
     bool set_state(GstState state);
     bool play();
     void stop();
 
+    // Runs the loop on the calling thread until request_stop(), EOS or error.
     void run();
+    // Runs the loop on a thread owned by the controller; requires own_context.
+    void start();
+    // Waits for the thread started by start() to leave its loop.
+    void join();
     void request_stop();
 
+    // Queues `command` to run on the controller's loop. Safe to call from any
+    // thread; commands run in the order they were posted.
+    using Command = std::function<void()>;
+    void post(Command command);
+
+    // Attaches a callback to the controller's context and returns its source id.
+    guint add_timeout(guint interval_ms, GSourceFunc callback, gpointer user_data);
+    guint add_unix_signal(int signum, GSourceFunc callback, gpointer user_data);
+
     using BusHandler = std::function<void(const GstMessage&)>;
     void set_bus_handler(BusHandler handler);
 
+    // Places streaming threads as they start (GST_MESSAGE_STREAM_STATUS ENTER).
+    // Set it before the pipeline leaves NULL; threads that already run keep
+    // their placement.
+    void set_thread_policy(ThreadPolicy policy);
+    std::vector<ThreadUsage> thread_usage();
+
+    // Runs this pipeline's streaming tasks on `pool` (installed on each GstTask
+    // at STREAM_STATUS CREATE). Call before the pipeline leaves NULL; the pool
+    // must outlive the controller.
+    void set_task_pool(SharedTaskPool& pool, const std::string& pipeline_name);
+
   private:
+    struct ThreadRecord {
+        std::string element;
+        bool active{false};
+        bool placed{false};
+        bool restore{false};
+        ThreadRule previous{};
+        double cpu_seconds{0.0};
+        double sampled_cpu{0.0};
+        std::chrono::steady_clock::time_point sampled_at{};
+    };
+
     static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer user_data);
+    static GstBusSyncReply sync_callback(GstBus* bus, GstMessage* message, gpointer user_data);
+    static gboolean drain_commands(gpointer user_data);
+
+    guint attach_source(GSource* source, GSourceFunc callback, gpointer user_data);
 
     void ensure_watch();
+    void install_sync_handler();
+    void remove_sync_handler();
+    void handle_stream_status(GstMessage* message);
 
     GstElement* pipeline_{nullptr};
+    GMainContext* context_{nullptr};
     GMainLoop* loop_{nullptr};
-    guint bus_watch_id_{0};
+    GSource* bus_watch_{nullptr};
     BusHandler bus_handler_{};
+    std::thread loop_thread_;
+
+    std::deque<Command> commands_;
+    GSource* drain_source_{nullptr};
+    std::mutex commands_mutex_;
+
+    ThreadPolicy thread_policy_{};
+    GstTaskPool* task_pool_{nullptr};
+    std::map<int, ThreadRecord> threads_;
+    std::mutex threads_mutex_;
 };
 
 }  // namespace gstreamer_worker::control
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/gst.h>
+
+namespace gstreamer_worker::control {
+
+// Worker threads shared by the streaming tasks of several pipelines. Each
+// pipeline gets its own GstTaskPool handle from client(); PipelineController
+// installs it on every GstTask at STREAM_STATUS CREATE.
+//
+// A GStreamer streaming task occupies its worker for as long as the task runs
+// (a queue or source loop runs until the element stops), so tasks are never
+// queued behind each other: that would stall a pipeline. Up to `max_workers`
+// threads are pooled and reused across pipelines and state changes, handed out
+// so that no pipeline holds more than its fair share while others are waiting;
+// beyond that a task runs on an overflow thread and is counted as saturation.
+// The pool therefore does not lower the thread count: every task still gets a
+// thread. Overflow threads can be capped (`max_overflow`, off by default); a
+// task past the cap is refused and logged, which fails the state change of
+// the element that started it.
+class SharedTaskPool {
+  public:
+    struct PipelineStats {
+        std::string name;
+        std::size_t active{0};
+        std::size_t pooled{0};
+        std::size_t peak_active{0};
+        guint64 started{0};
+        guint64 overflowed{0};
+        guint64 rejected{0};
+    };
+
+    struct Stats {
+        std::size_t max_workers{0};
+        std::size_t workers{0};
+        std::size_t idle_workers{0};
+        std::size_t max_overflow{0};
+        std::size_t overflow_threads{0};
+        guint64 saturation_events{0};
+        guint64 rejected{0};
+        std::vector<PipelineStats> pipelines;
+    };
+
+    // max_workers 0 selects two workers per hardware thread; max_overflow 0
+    // leaves overflow threads unbounded.
+    explicit SharedTaskPool(std::size_t max_workers = 0, std::size_t max_overflow = 0);
+    ~SharedTaskPool();
+
+    SharedTaskPool(const SharedTaskPool&) = delete;
+    SharedTaskPool& operator=(const SharedTaskPool&) = delete;
+
+    // New GstTaskPool (transfer full) whose tasks are accounted to `pipeline_name`.
+    // The SharedTaskPool must outlive every handle.
+    GstTaskPool* client(const std::string& pipeline_name);
+
+    Stats stats() const;
+
+    // Called by the handles returned from client(). push() returns nullptr
+    // when the task would need an overflow thread past a set `max_overflow`.
+    struct Job;
+    Job* push(std::size_t client, GstTaskPoolFunction function, gpointer user_data);
+    void join(Job* job);
+    void release_client(std::size_t client);
+
+  private:
+    struct Client {
+        PipelineStats stats;
+        bool alive{true};
+    };
+
+    void worker_loop();
+    void run_job(Job* job);
+    std::size_t fair_share() const;
+
+    std::size_t max_workers_{0};
+    std::size_t max_overflow_{0};
+    std::vector<std::thread> workers_;
+    std::size_t idle_workers_{0};
+    std::size_t overflow_threads_{0};
+    std::deque<Job*> ready_;
+    std::map<std::size_t, Client> clients_;
+    std::size_t next_client_{0};
+    guint64 saturation_events_{0};
+    guint64 rejected_{0};
+    bool stopping_{false};
+    mutable std::mutex mutex_;
+    std::condition_variable ready_cv_;
+};
+
+}  // namespace gstreamer_worker::control
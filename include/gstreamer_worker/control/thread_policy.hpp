@@ -0,0 +1,53 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gstreamer_worker::control {
+
+// Placement for the streaming threads of elements whose name matches
+// `element_pattern` (a glob, e.g. "encoder*" or "udpsrc*").
+struct ThreadRule {
+    std::string element_pattern;
+    // CPUs the thread may run on; empty leaves the inherited affinity.
+    std::vector<int> cpus;
+    // SCHED_FIFO priority (1-99); 0 keeps SCHED_OTHER.
+    int realtime_priority{0};
+    // Nice value; implies SCHED_OTHER when no realtime priority is set.
+    std::optional<int> nice;
+};
+
+// Rules are matched in order; the first match wins. Threads that match no
+// rule keep their defaults.
+struct ThreadPolicy {
+    std::vector<ThreadRule> rules;
+
+    const ThreadRule* match(std::string_view element_name) const;
+};
+
+// Parses "PATTERN:CPUS[:fifo=PRIO|nice=N]", for example "encoder*:2-3:fifo=40"
+// or "udpsrc*:*:nice=-5" ("*" leaves the affinity alone). Throws
+// std::invalid_argument on malformed input.
+ThreadRule parse_thread_rule(std::string_view spec);
+
+// Applies `rule` to the calling thread. Returns false (and leaves a message in
+// `error`) when any part is refused, typically SCHED_FIFO without CAP_SYS_NICE.
+bool apply_thread_rule(const ThreadRule& rule, std::string* error = nullptr);
+
+// Placement currently in effect for the calling thread, so a pooled thread
+// can be restored when it leaves the element it was placed for.
+ThreadRule current_thread_placement();
+
+// Kernel thread id of the calling thread.
+int current_thread_id();
+
+// CPU time consumed so far by the calling thread, in seconds.
+double current_thread_cpu_seconds();
+
+// CPU time consumed by thread `tid` of this process, or a negative value when
+// the thread no longer exists.
+double thread_cpu_seconds(int tid);
+
+}  // namespace gstreamer_worker::control
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+enum class FrameType { Unknown, I, P, B };
+
+// Summary of one Annex B access unit (or AV1 temporal unit), enough to decide whether it can be
+// dropped without breaking the decoder's reference chain.
+struct AccessUnitInfo {
+    bool idr{false};
+    // True when any slice is used for reference (nal_ref_idc != 0).
+    bool reference{false};
+    FrameType type{FrameType::Unknown};
+    std::uint32_t slices{0};
+    // An SEI recovery point: with intra refresh, decoding may restart here and
+    // is clean again once the refresh cycle completes.
+    bool recovery_point{false};
+    // H.265 CRA picture: decoding may restart here like at an IDR, except
+    // that the RASL pictures following it reference frames from before it.
+    bool cra{false};
+    // H.265 leading picture (RADL or RASL) of the last IRAP picture. RASL
+    // ones are undecodable when decoding restarted at their CRA.
+    bool leading{false};
+    bool rasl{false};
+};
+
+// NAL units are delimited by Annex B start codes, or by big-endian length
+// prefixes of `nal_length_size` bytes (avc/hvc1 stream formats) when non-zero.
+AccessUnitInfo inspect_h264_access_unit(const std::uint8_t* data, std::size_t size, std::size_t nal_length_size = 0);
+// `idr` is set for IDR and BLA pictures (the decoder drops a BLA's RASL
+// pictures itself), `cra` for CRA; `type` comes from the first slice segment.
+AccessUnitInfo inspect_h265_access_unit(const std::uint8_t* data, std::size_t size, std::size_t nal_length_size = 0);
+// Low-overhead OBU stream. `idr` marks key frames; every coded frame counts as
+// a reference, and `slices` counts frame and tile group OBUs.
+AccessUnitInfo inspect_av1_temporal_unit(const std::uint8_t* data, std::size_t size);
+AccessUnitInfo inspect_access_unit(VideoCodec codec,
+                                   const std::uint8_t* data,
+                                   std::size_t size,
+                                   std::size_t nal_length_size = 0);
+
+// Byte offsets at which each access unit of an Annex B stream starts, the first
+// being 0. Empty for AV1, whose temporal units need a container to delimit.
+std::vector<std::size_t> access_unit_offsets(VideoCodec codec, const std::uint8_t* data, std::size_t size);
+
+}  // namespace gstreamer_worker::pipeline
@@ -8,6 +8,21 @@
 
 namespace gstreamer_worker::pipeline {
 
+inline constexpr const char* kSourceQueueName = "source_queue";
+// Simulcast layers past the first append "_<index>" to the encoder name.
+inline constexpr const char* kEncoderName = "encoder";
+inline constexpr const char* kQosCapsName = "qos_caps";
+// identity the MotionGate probes; present when motion_gate.enabled.
+inline constexpr const char* kMotionGateName = "motion_gate";
+// Per-layer RTP payloader, suffixed like the encoder.
+inline constexpr const char* kPayloaderName = "payloader";
+// Per-layer parser ahead of the payloader, suffixed like the encoder; emits
+// whole access units for EncodedStats.
+inline constexpr const char* kEncodedParserName = "encoded_parser";
+
+// Caps the QoS capsfilter enforces for `step`.
+std::string quality_step_caps(const CapturePipelineConfig& config, const QualityStep& step);
+
 std::string build_capture_launch(const CapturePipelineConfig& config);
 GstElement* make_capture_pipeline(const CapturePipelineConfig& config, GError** error = nullptr);
 
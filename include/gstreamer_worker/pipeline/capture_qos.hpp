@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// Watches per-frame encode time and source queue fill on a running capture
+// pipeline and walks the configured quality ladder by renegotiating the QoS
+// capsfilter. Steps down quickly when the encoder misses its frame budget and
+// climbs back only after a long stretch with headroom.
+class CaptureQosController {
+  public:
+    struct Stats {
+        std::size_t step{0};
+        QualityStep current{};
+        double encode_ms{0.0};
+        guint queue_level{0};
+        guint64 downgrades{0};
+        guint64 upgrades{0};
+    };
+
+    explicit CaptureQosController(const CapturePipelineConfig& config);
+    ~CaptureQosController();
+
+    CaptureQosController(const CaptureQosController&) = delete;
+    CaptureQosController& operator=(const CaptureQosController&) = delete;
+
+    bool attach(GstElement* pipeline);
+    void detach();
+
+    const std::vector<QualityStep>& ladder() const { return ladder_; }
+    Stats stats() const;
+
+  private:
+    struct PendingFrame {
+        GstClockTime pts{GST_CLOCK_TIME_NONE};
+        GstClockTime arrival{0};
+    };
+
+    static GstPadProbeReturn encoder_sink_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static GstPadProbeReturn encoder_src_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static void apply_step(GstElement* capsfilter, gpointer user_data);
+
+    void on_encoded(GstClockTime pts);
+    void change_step(std::size_t step);
+
+    CapturePipelineConfig config_;
+    std::vector<QualityStep> ladder_;
+
+    GstElement* capsfilter_{nullptr};
+    GstElement* queue_{nullptr};
+    GstPad* encoder_sink_{nullptr};
+    GstPad* encoder_src_{nullptr};
+    gulong sink_probe_id_{0};
+    gulong src_probe_id_{0};
+
+    std::mutex pending_mutex_;
+    std::array<PendingFrame, 64> pending_{};
+    std::size_t pending_next_{0};
+
+    // Evaluation state, owned by the encoder's output thread.
+    double encode_ewma_ns_{0.0};
+    std::uint32_t over_budget_{0};
+    std::uint32_t under_budget_{0};
+
+    std::atomic<std::size_t> step_{0};
+    std::atomic<double> encode_ms_{0.0};
+    std::atomic<guint> queue_level_{0};
+    std::atomic<guint64> downgrades_{0};
+    std::atomic<guint64> upgrades_{0};
+};
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// Fixed per-codec elements. Encoders and decoders with several
+// implementations are chosen by the app (installed_software_encoder()) and
+// passed to software_encoder() and software_decoder().
+struct CodecElements {
+    const char* name;
+    // Parsed caps the recorder, load shedder and encoded export branches expect.
+    const char* caps;
+    // RTP `encoding-name` negotiated on the viewer's udpsrc.
+    const char* encoding_name;
+    const char* parser;
+    const char* payloader;
+    const char* depayloader;
+    // Jetson V4L2 encoder; nvv4l2decoder handles every codec on the way back.
+    const char* nvidia_encoder;
+    // Whether the encoder can repeat parameter sets in-band (`insert-sps-pps`,
+    // parser/payloader `config-interval`). AV1 repeats the sequence header on
+    // keyframes instead.
+    bool parameter_sets;
+};
+
+const CodecElements& codec_elements(VideoCodec codec);
+
+// "h264", "h265"/"hevc" or "av1"; throws std::invalid_argument otherwise.
+VideoCodec parse_codec(std::string_view name);
+const char* codec_name(VideoCodec codec);
+// Codec of parsed caps (video/x-h264, video/x-h265, video/x-av1).
+std::optional<VideoCodec> codec_from_caps(const GstCaps* caps);
+
+// Factory name of the preferred software encoder (decoder) for `codec`. Does
+// not look at the plugin registry, so launch lines built from it are the same
+// on every host.
+const char* software_encoder_factory(VideoCodec codec);
+const char* software_decoder_factory(VideoCodec codec);
+// First installed software encoder (decoder) for `codec` in order of
+// preference; the preferred one when none is installed, or before gst_init, so
+// launch errors name the missing plugin. Apps resolve it once and store it in
+// CapturePipelineConfig::encoder / ViewerPipelineConfig::decoder.
+const char* installed_software_encoder(VideoCodec codec);
+const char* installed_software_decoder(VideoCodec codec);
+
+struct EncoderSettings {
+    // Software encoder factory; empty uses software_encoder_factory().
+    std::string factory{};
+    // Bits per second.
+    std::uint32_t bitrate{0};
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+    std::uint32_t framerate{30};
+    // Frames between keyframes when intra refresh is off.
+    std::uint32_t keyframe_interval{30};
+    LowLatencyEncoderConfig low_latency{};
+};
+
+// Software encoder element tuned for real time: CBR, no frame reordering and,
+// with `low_latency.enabled`, intra refresh, a one-frame VBV and slices where
+// the encoder supports them (AV1 encoders keep periodic keyframes).
+std::string software_encoder(VideoCodec codec, const EncoderSettings& settings, std::string_view name = {});
+// Jetson V4L2 encoder element with the same tuning.
+std::string nvidia_encoder(VideoCodec codec, const EncoderSettings& settings, std::string_view name = {});
+// `factory` empty uses software_decoder_factory().
+std::string software_decoder(VideoCodec codec, std::string_view factory = {});
+
+}  // namespace gstreamer_worker::pipeline
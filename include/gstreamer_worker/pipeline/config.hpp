@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace gstreamer_worker::pipeline {
 
@@ -10,32 +12,226 @@ struct NetworkTarget {
     std::uint16_t port{5000};
 };
 
+// Second network path for SMPTE 2022-7 style redundancy: the sender
+// transmits every RTP packet on both paths and the receiver forwards whichever
+// copy arrives first. Simulcast layers keep the offset between `secondary.port`
+// and the primary port.
+struct RedundantPathConfig {
+    bool enabled{false};
+    NetworkTarget secondary{"127.0.0.1", 5100};
+};
+
+enum class RecordingContainer { MpegTs, FragmentedMp4 };
+
+// Encoded video format on the wire. Encoders, parsers, RTP (de)payloaders and
+// decoders are picked from it (see codec.hpp).
+enum class VideoCodec { H264, H265, AV1 };
+
+// Pre-event recorder branch teed off after the parser. Encoded access units are
+// kept in a fixed-size ring so a trigger can persist the last N seconds without
+// re-encoding.
+struct PreEventRecorderConfig {
+    bool enabled{false};
+    std::uint32_t pre_event_seconds{30};
+    std::size_t ring_bytes{96U * 1024U * 1024U};
+    std::size_t max_access_units{8192};
+    RecordingContainer container{RecordingContainer::MpegTs};
+    std::string output_directory{"."};
+    std::string appsink_name{"recorder_sink"};
+};
+
+// One simulcast encoding of the captured frame. Zero width/height/bitrate fall
+// back to the capture settings; a zero port is assigned from `network.port`
+// (+2 per layer so RTCP neighbours stay free).
+struct EncodingLayer {
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+    std::uint32_t bitrate{0};
+    std::uint16_t port{0};
+    std::uint32_t ssrc{0};
+};
+
+struct QualityStep {
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+    std::uint32_t framerate{0};
+};
+
+// Encoder overload control for the single-stream path. Step 0 is the configured
+// width/height/framerate; `ladder` lists progressively cheaper steps (lower
+// framerate first, then resolution). An empty ladder uses half the framerate
+// followed by half the resolution.
+struct CaptureQosConfig {
+    bool enabled{false};
+    std::vector<QualityStep> ladder{};
+    // Smoothed encode time as a fraction of the frame interval.
+    double overload_ratio{0.85};
+    double recover_ratio{0.5};
+    // Consecutive frames over budget before stepping down, and under budget
+    // before stepping back up.
+    std::uint32_t downgrade_frames{15};
+    std::uint32_t upgrade_frames{300};
+};
+
+// Camera output selected by the format probe (see format_probe.hpp). An empty
+// `media` keeps the fixed videoconvert + format caps path.
+struct SourceFormat {
+    std::string media{};
+    std::string format{};
+    // Decoder for compressed camera output (image/jpeg), empty for raw.
+    std::string decoder{};
+    // Conversion stage when the encoder cannot take the camera format directly.
+    std::string converter{};
+};
+
+// Replaces periodic IDRs with gradual intra refresh so every frame costs about
+// the same on the link. A decoder joining mid-stream (or recovering from loss)
+// is clean again after one `refresh_frames` cycle. The rate control buffer
+// (VBV) holds `vbv_frames` frames at the target bitrate, and each frame is cut
+// into `slices` slices so packets leave while the rest is still encoding.
+struct LowLatencyEncoderConfig {
+    bool enabled{false};
+    std::uint32_t refresh_frames{30};
+    double vbv_frames{1.0};
+    std::uint32_t slices{4};
+};
+
+// Drops frames of a static scene before they reach the encoder. Each frame is
+// compared with the last one sent by the mean absolute difference of every
+// `row_step`-th row of its first plane (luma). Below `threshold` only one
+// frame per `keepalive_ms` is sent; a frame at or above it goes out at once
+// and keeps the full rate for `hold_frames` more frames.
+struct MotionGateConfig {
+    bool enabled{false};
+    double threshold{2.0};
+    std::uint32_t keepalive_ms{1000};
+    std::uint32_t row_step{4};
+    std::uint32_t hold_frames{30};
+};
+
 struct CapturePipelineConfig {
     std::string name{"capture-pipeline"};
     std::string device{"/dev/video0"};
     bool use_test_pattern{false};
     std::string test_pattern{"smpte"};
+    SourceFormat source_format{};
     std::uint32_t width{1920};
     std::uint32_t height{1080};
     std::uint32_t framerate{60};
     std::uint32_t bitrate{8'000'000};
+    VideoCodec codec{VideoCodec::H264};
+    // Software encoder factory; empty uses the codec's preferred one. Apps fill
+    // it from installed_software_encoder() (codec.hpp).
+    std::string encoder{};
+    LowLatencyEncoderConfig low_latency{};
     bool use_nvenc{true};
     bool use_zero_copy{true};
     bool enable_fec{false};
     std::uint32_t fec_percentage{5};
     std::uint32_t queue_size{4};
     NetworkTarget network{};
+    // Path MTU of the RTP packets. Payloaders are set below it by the room the
+    // per-frame metadata header extensions need (see rtp_metadata.hpp).
+    std::uint32_t mtu{1400};
+    RedundantPathConfig redundancy{};
+    // Empty keeps the single width x height stream on `network.port`.
+    std::vector<EncodingLayer> layers{};
+    CaptureQosConfig qos{};
+    MotionGateConfig motion_gate{};
+    PreEventRecorderConfig recorder{};
 };
 
 enum class DecoderBackend { Auto, Nvidia, Software };
 
+// Drops encoded frames in front of the decoder when it falls behind. The decode
+// queue fill level selects how aggressive shedding is: non-reference frames
+// first, then the rest of the GOP up to the next IDR. The capture encoders run
+// without B-frames and mark every frame as a reference, so their streams only
+// ever see the GOP tier; the first tier applies to other senders.
+struct LoadSheddingConfig {
+    bool enabled{false};
+    std::uint32_t queue_buffers{8};
+    std::uint32_t non_reference_level{2};
+    std::uint32_t gop_level{5};
+};
+
+// Appsink branch teed off after the parser that hands whole encoded access
+// units to an EncodedExporter (forwarding, re-streaming) next to the decoder.
+struct EncodedExportConfig {
+    bool enabled{false};
+    std::string appsink_name{"encoded_sink"};
+    // Access units queued for a slow consumer before the oldest are dropped.
+    std::uint32_t max_buffers{8};
+};
+
+enum class ReplayFormat { Auto, RtpDump, ElementaryStream };
+
+// Replaces the network input with a recorded file pushed through an appsrc
+// (see ReplaySource). An rtpdump file goes through the depayloader like live
+// RTP. An Annex B elementary stream in `codec` goes straight to the parser.
+struct ReplayConfig {
+    bool enabled{false};
+    std::string path{};
+    // Auto tells the formats apart by the rtpdump file header.
+    ReplayFormat format{ReplayFormat::Auto};
+    // Multiple of the recorded rate; 0 pushes as fast as the decoder drains.
+    double speed{1.0};
+    // rtpdump only: pace packets by their recorded arrival offsets instead of
+    // sending each frame's packets together at its RTP timestamp.
+    bool original_timing{false};
+    // Elementary streams carry no timing; frames are spaced at this rate.
+    std::uint32_t framerate{30};
+};
+
+// Receives one stream per port and scales every decoded frame straight into
+// its tile of a single NV12 frame (see MosaicCompositor), which is exported in
+// place of the per-stream frames. Meant for monitoring walls without a GPU.
+struct MosaicConfig {
+    bool enabled{false};
+    // One tile per port, filled row by row.
+    std::vector<std::uint16_t> ports{};
+    // 0 picks the smallest square grid holding every port.
+    std::uint32_t columns{0};
+    std::uint32_t width{1920};
+    std::uint32_t height{1080};
+    // Mosaic frames exported per second; frames where no tile changed are skipped.
+    std::uint32_t framerate{30};
+    // Per tile in port order: scale one decoded frame in N. Missing or zero
+    // entries scale every frame.
+    std::vector<std::uint32_t> decimation{};
+    // A tile whose newest decoded frame is older than this is reported stale.
+    std::uint32_t stale_ms{1000};
+};
+
 struct ViewerPipelineConfig {
     std::string name{"viewer-pipeline"};
     DecoderBackend backend{DecoderBackend::Auto};
+    // Must match the capture side.
+    VideoCodec codec{VideoCodec::H264};
+    // Decoder factory for DecoderBackend::Software; empty uses the codec's
+    // preferred one. Apps fill it from installed_software_decoder().
+    std::string decoder{};
     NetworkTarget listen{"0.0.0.0", 5000};
+    // `secondary` is the address and port the second path is received on.
+    RedundantPathConfig redundancy{false, {"0.0.0.0", 5100}};
     std::uint32_t latency_ms{32};
+    // Drop packets that miss `latency_ms` instead of letting latency grow.
+    // Meant for senders using LowLatencyEncoderConfig, whose frames fit in it.
+    bool drop_on_latency{false};
     std::string appsink_name{"display_sink"};
     bool request_zero_copy{true};
+    // Simulcast ports, one per layer in the capture-side order. Empty receives a
+    // single stream on `listen.port`.
+    std::vector<std::uint16_t> layer_ports{};
+    std::size_t initial_layer{0};
+    LoadSheddingConfig load_shedding{};
+    PreEventRecorderConfig recorder{};
+    EncodedExportConfig encoded_export{};
+    // Single stream only; `listen`, `redundancy` and `layer_ports` are unused.
+    ReplayConfig replay{};
+    // Replaces `appsink_name` with one appsink per mosaic port; `listen.port`
+    // is unused.
+    MosaicConfig mosaic{};
 };
 
 }  // namespace gstreamer_worker::pipeline
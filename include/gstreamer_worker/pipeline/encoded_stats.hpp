@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// Power-of-two buckets, updated lock-free from a streaming thread: bucket 0
+// counts zeros, bucket i values in [2^(i-1), 2^i).
+class Log2Histogram {
+  public:
+    static constexpr std::size_t kBuckets = 33;
+
+    struct Snapshot {
+        guint64 count{0};
+        guint64 sum{0};
+        guint64 max{0};
+        std::array<guint64, kBuckets> buckets{};
+
+        double mean() const;
+        // Upper bound of the bucket holding quantile `q`, capped at max.
+        guint64 quantile(double q) const;
+    };
+
+    void add(guint64 value);
+    Snapshot snapshot() const;
+
+  private:
+    std::array<std::atomic<guint64>, kBuckets> buckets_{};
+    std::atomic<guint64> count_{0};
+    std::atomic<guint64> sum_{0};
+    std::atomic<guint64> max_{0};
+};
+
+// Bytes per 10 ms bin in a ring, so the bitrate over any window up to the
+// ring length can be read back without locks.
+class SlidingBitrate {
+  public:
+    static constexpr gint64 kBinUs = 10'000;
+    static constexpr std::size_t kBins = 256;
+
+    void add(gint64 now_us, guint64 bytes);
+    // Bits per second over the `window_us` ending at `now_us`; windows longer
+    // than the ring are clamped to it.
+    double bitrate(gint64 now_us, gint64 window_us) const;
+
+  private:
+    struct Bin {
+        // Absolute bin number the bytes belong to.
+        std::atomic<gint64> index{-1};
+        std::atomic<guint64> bytes{0};
+    };
+
+    std::array<Bin, kBins> bins_{};
+};
+
+// Per-frame statistics of an encoded stream, collected by a probe on the src
+// pad of an element that emits whole access units: the parser on capture,
+// the depayloader on the viewer. Frame size, type, slice count and encode
+// duration go into lock-free histograms, and arrival bytes into a sliding
+// bitrate window whose peaks show what the link must carry.
+class EncodedStats {
+  public:
+    // 1..15 slices, then 16 or more.
+    static constexpr std::size_t kSliceBuckets = 17;
+
+    struct FrameTypes {
+        guint64 idr{0};
+        guint64 i{0};
+        guint64 p{0};
+        guint64 b{0};
+        guint64 unknown{0};
+    };
+
+    struct Snapshot {
+        guint64 frames{0};
+        FrameTypes types{};
+        Log2Histogram::Snapshot frame_bytes{};
+        Log2Histogram::Snapshot keyframe_bytes{};
+        // Capture to encoder output in microseconds, for frames with FrameMeta.
+        Log2Histogram::Snapshot encode_us{};
+        std::array<guint64, kSliceBuckets> slices{};
+        // Bits per second over the windows ending now, and the highest seen.
+        double bitrate_100ms{0.0};
+        double bitrate_1s{0.0};
+        double peak_bitrate_100ms{0.0};
+        double peak_bitrate_1s{0.0};
+        double mean_bitrate{0.0};
+    };
+
+    EncodedStats() = default;
+    ~EncodedStats();
+
+    EncodedStats(const EncodedStats&) = delete;
+    EncodedStats& operator=(const EncodedStats&) = delete;
+
+    // Probes the src pad of `element`. Encode duration is encode_ts minus
+    // capture_ts when the frame's FrameMeta carries encode_ts (viewer), and
+    // the time on `clock` (host monotonic when null) otherwise, since capture
+    // stamps encode_ts only at the payloader.
+    bool attach(GstElement* element, VideoCodec codec, GstClock* clock = nullptr);
+    void detach();
+
+    Snapshot snapshot() const;
+
+  private:
+    struct ProbeContext {
+        EncodedStats* self;
+        VideoCodec codec;
+        GstClock* clock;
+        // NAL length prefix size from avc/hvc1 caps; 0 for byte-stream.
+        std::atomic<std::size_t> nal_length_size{0};
+    };
+
+    static GstPadProbeReturn probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    void record(ProbeContext& context, GstBuffer* buffer);
+
+    GstPad* pad_{nullptr};
+    gulong probe_id_{0};
+
+    std::atomic<guint64> frames_{0};
+    std::atomic<guint64> idr_{0};
+    std::atomic<guint64> i_{0};
+    std::atomic<guint64> p_{0};
+    std::atomic<guint64> b_{0};
+    std::atomic<guint64> unknown_{0};
+    Log2Histogram frame_bytes_{};
+    Log2Histogram keyframe_bytes_{};
+    Log2Histogram encode_us_{};
+    std::array<std::atomic<guint64>, kSliceBuckets> slices_{};
+    SlidingBitrate bitrate_{};
+    std::atomic<guint64> peak_100ms_{0};
+    std::atomic<guint64> peak_1s_{0};
+    std::atomic<gint64> first_us_{0};
+    std::atomic<gint64> last_us_{0};
+    std::atomic<guint64> bytes_{0};
+};
+
+// Multi-line report of `stats` for the CLI tools.
+std::string format_encoded_stats(const EncodedStats::Snapshot& stats);
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+struct FormatCandidate {
+    SourceFormat source{};
+    // Relative CPU cost per captured pixel; 0 means the encoder takes the
+    // camera output as is.
+    double cost{0.0};
+};
+
+// Camera outputs (media type + raw format) that can deliver the configured
+// width x height at the configured framerate.
+std::vector<SourceFormat> probe_camera_formats(const CapturePipelineConfig& config);
+
+// Orders camera outputs by conversion work for the configured encoder, using
+// the encoder (or nvvidconv) sink caps and the JPEG decoders that are installed.
+std::vector<FormatCandidate> rank_source_formats(const std::vector<SourceFormat>& camera,
+                                                 const CapturePipelineConfig& config);
+
+// Probes, ranks and logs the cheapest camera output. Results are cached per
+// device and mode in-process and, when `cache_path` is set, in a key file so
+// later starts skip the probe.
+std::optional<SourceFormat> negotiate_source_format(const CapturePipelineConfig& config,
+                                                    const std::string& cache_path = {});
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+inline constexpr const char* kLayerSelectorName = "layer_select";
+
+// Moves the viewer's input-selector between simulcast layers. A requested
+// switch is held until the target layer delivers an IDR so the decoder never
+// sees a delta frame without its reference.
+class LayerSwitcher {
+  public:
+    LayerSwitcher() = default;
+    ~LayerSwitcher();
+
+    LayerSwitcher(const LayerSwitcher&) = delete;
+    LayerSwitcher& operator=(const LayerSwitcher&) = delete;
+
+    bool attach(GstElement* pipeline, const ViewerPipelineConfig& config);
+    void detach();
+
+    void request_layer(std::size_t index);
+    std::size_t active_layer() const { return active_.load(std::memory_order_relaxed); }
+    std::size_t layer_count() const { return pads_.size(); }
+
+  private:
+    struct ProbeContext {
+        LayerSwitcher* self;
+        std::size_t index;
+    };
+
+    static GstPadProbeReturn keyframe_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+
+    GstElement* selector_{nullptr};
+    std::vector<GstPad*> pads_;
+    std::vector<gulong> probe_ids_;
+    std::atomic<std::size_t> active_{0};
+    std::atomic<long> pending_{-1};
+};
+
+}  // namespace gstreamer_worker::pipeline
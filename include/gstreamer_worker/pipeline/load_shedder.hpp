@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+inline constexpr const char* kDecodeQueueName = "decode_queue";
+
+// Sheds encoded frames on the decode queue's sink pad so an overloaded decoder
+// catches up instead of decoding frames that would be discarded afterwards.
+// The queue fill level is the only signal: the viewer's appsink runs with
+// sync=false, so no QoS events ever reach the decoder.
+class LoadShedder {
+  public:
+    struct Stats {
+        guint64 passed{0};
+        guint64 shed_non_reference{0};
+        guint64 shed_gop_frames{0};
+        guint64 gop_skips{0};
+
+        guint64 shed_total() const { return shed_non_reference + shed_gop_frames; }
+    };
+
+    LoadShedder() = default;
+    ~LoadShedder();
+
+    LoadShedder(const LoadShedder&) = delete;
+    LoadShedder& operator=(const LoadShedder&) = delete;
+
+    // `codec` selects the bitstream parser that classifies access units.
+    bool attach(GstElement* pipeline, const LoadSheddingConfig& config, VideoCodec codec = VideoCodec::H264);
+    void detach();
+
+    Stats stats() const;
+
+  private:
+    static GstPadProbeReturn buffer_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+
+    GstPadProbeReturn on_buffer(GstBuffer* buffer);
+
+    LoadSheddingConfig config_{};
+    VideoCodec codec_{VideoCodec::H264};
+    GstElement* queue_{nullptr};
+    GstPad* sink_pad_{nullptr};
+    gulong buffer_probe_id_{0};
+
+    // Only touched from the queue's upstream streaming thread.
+    bool skipping_gop_{false};
+    // Set when a GOP skip ended at a CRA, whose RASL pictures go with it.
+    bool skipping_rasl_{false};
+
+    std::atomic<guint64> passed_{0};
+    std::atomic<guint64> shed_non_reference_{0};
+    std::atomic<guint64> shed_gop_frames_{0};
+    std::atomic<guint64> gop_skips_{0};
+};
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/zerocopy/buffer_exporter.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// Decoded NV12 or I420 appsink of mosaic tile 0; tiles past the first append
+// "_<index>" like the depayloaders.
+inline constexpr const char* kMosaicSinkName = "mosaic_sink";
+
+std::string mosaic_sink_name(std::size_t index);
+
+struct MosaicTile {
+    std::uint32_t x{0};
+    std::uint32_t y{0};
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+};
+
+// Tile rectangles in port order, on even coordinates so chroma sites line up.
+// Throws std::invalid_argument when there are no ports or a tile would be
+// smaller than 2x2.
+std::vector<MosaicTile> mosaic_layout(const MosaicConfig& config);
+
+// Builds the monitoring-wall frame from the per-port appsinks. Each port keeps
+// only a reference to its newest decoded frame; a composer thread ticking at
+// `framerate` scales the tiles that changed straight from those frames (NV12,
+// or the I420 software decoders emit) into one of a small pool of NV12 output
+// frames (SIMD bilinear, no full-size copy)
+// and hands it to a BufferExporter. Output frames are memfd-backed where
+// available, so the export carries an fd consumers can mmap. A frame is only
+// rewritten once nothing but the compositor references its buffer: consumers
+// that read it after the export callback hold ExportPacket::buffer until they
+// are done. The pool grows while consumers hold frames, up to a bound past
+// which ticks are skipped.
+class MosaicCompositor {
+  public:
+    struct TileStats {
+        std::uint16_t port{0};
+        std::uint32_t decimation{1};
+        guint64 received{0};
+        // Frames skipped by decimation.
+        guint64 decimated{0};
+        // Scales into an output frame; a changed tile is scaled into each
+        // output frame once.
+        guint64 scaled{0};
+        // Age of the newest frame, or negative before the first one.
+        double age_ms{-1.0};
+        bool stale{true};
+        // Times the tile went from live to stale.
+        guint64 stalls{0};
+    };
+
+    struct Stats {
+        guint64 frames_exported{0};
+        // Ticks where no tile changed.
+        guint64 frames_unchanged{0};
+        // Ticks skipped because consumers still held every output frame.
+        guint64 frames_held{0};
+        std::size_t output_frames{0};
+        double mean_compose_ms{0.0};
+        std::vector<TileStats> tiles{};
+    };
+
+    MosaicCompositor() = default;
+    ~MosaicCompositor();
+
+    MosaicCompositor(const MosaicCompositor&) = delete;
+    MosaicCompositor& operator=(const MosaicCompositor&) = delete;
+
+    // Connects to every mosaic appsink of `pipeline` and allocates the output
+    // frames; false when mosaic mode is off or a sink is missing. `exporter`
+    // must outlive detach().
+    bool attach(GstElement* pipeline, const MosaicConfig& config, const zerocopy::BufferExporter* exporter);
+    // Starts the composer once the pipeline is PLAYING.
+    bool start();
+    // Call once the pipeline has stopped; the appsink callbacks use the tiles.
+    void detach();
+
+    Stats stats() const;
+
+  private:
+    struct Tile {
+        MosaicTile rect{};
+        std::uint16_t port{0};
+        std::uint32_t decimation{1};
+        GstElement* sink{nullptr};
+        gulong handler{0};
+
+        std::mutex mutex;
+        // Newest decoded frame and its sequence number, under `mutex`.
+        GstSample* latest{nullptr};
+        guint64 generation{0};
+
+        std::atomic<guint64> received{0};
+        std::atomic<guint64> decimated{0};
+        std::atomic<guint64> scaled{0};
+        std::atomic<guint64> stalls{0};
+        std::atomic<gint64> last_us{0};
+        std::atomic<bool> stale{true};
+    };
+
+    // Output frames allocated up front: one being composed, the rest with
+    // consumers. More are added while consumers hold on to frames.
+    static constexpr std::size_t kInitialOutputFrames = 3;
+    static constexpr std::size_t kMaxOutputFrames = 8;
+
+    struct Output {
+        GstBuffer* buffer{nullptr};
+        // Tile generation each frame shows; 0 is the blank fill.
+        std::vector<guint64> generations;
+        // Export order, 0 before the first export.
+        guint64 exported{0};
+    };
+
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+    GstBuffer* allocate_output() const;
+    bool add_output();
+    Output* acquire_output();
+    void update_staleness(gint64 now);
+    void compose(Output& output);
+    void run();
+
+    std::vector<std::unique_ptr<Tile>> tiles_;
+    // Only touched by attach()/detach() and the composer thread.
+    std::vector<Output> outputs_;
+    guint64 exports_{0};
+    std::vector<guint64> exported_generations_;
+    GstVideoInfo info_{};
+    GstCaps* caps_{nullptr};
+    GstAllocator* allocator_{nullptr};
+    const zerocopy::BufferExporter* exporter_{nullptr};
+    std::uint32_t framerate_{30};
+    gint64 stale_us_{0};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+
+    std::atomic<guint64> frames_exported_{0};
+    std::atomic<guint64> frames_unchanged_{0};
+    std::atomic<guint64> frames_held_{0};
+    std::atomic<std::size_t> output_frames_{0};
+    std::atomic<gint64> compose_us_{0};
+};
+
+// Multi-line per-tile report of `stats` for the CLI tools.
+std::string format_mosaic_stats(const MosaicCompositor::Stats& stats);
+
+}  // namespace gstreamer_worker::pipeline
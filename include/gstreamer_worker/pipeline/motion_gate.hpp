@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// Drops static-scene frames on the motion_gate identity's sink pad (see
+// MotionGateConfig). Sent frames record in FrameMeta how many were skipped
+// before them, so receivers can tell a gated stream from a lossy one.
+class MotionGate {
+  public:
+    struct Stats {
+        guint64 frames{0};
+        guint64 sent{0};
+        guint64 skipped{0};
+        // Frames sent only because the keepalive interval ran out.
+        guint64 keepalives{0};
+        // Frames at or above the threshold.
+        guint64 motion{0};
+        // Mean absolute difference of the last frame compared.
+        double last_difference{0.0};
+    };
+
+    MotionGate() = default;
+    ~MotionGate();
+
+    MotionGate(const MotionGate&) = delete;
+    MotionGate& operator=(const MotionGate&) = delete;
+
+    bool attach(GstElement* pipeline, const MotionGateConfig& config);
+    void detach();
+
+    Stats stats() const;
+
+  private:
+    static GstPadProbeReturn probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+
+    GstPadProbeReturn on_buffer(GstPadProbeInfo* info, GstBuffer* buffer);
+    bool should_send(double difference, GstClockTime timestamp);
+    void record_skips(GstPadProbeInfo* info, GstBuffer* buffer);
+
+    MotionGateConfig config_{};
+    GstElement* gate_{nullptr};
+    GstPad* sink_pad_{nullptr};
+    gulong probe_id_{0};
+
+    // Only touched from the gate's streaming thread.
+    GstVideoInfo info_{};
+    bool have_info_{false};
+    std::vector<std::uint8_t> reference_;
+    bool have_reference_{false};
+    GstClockTime last_sent_{GST_CLOCK_TIME_NONE};
+    std::uint32_t hold_{0};
+    std::uint32_t pending_skips_{0};
+
+    std::atomic<guint64> frames_{0};
+    std::atomic<guint64> sent_{0};
+    std::atomic<guint64> skipped_{0};
+    std::atomic<guint64> keepalives_{0};
+    std::atomic<guint64> motion_{0};
+    std::atomic<double> last_difference_{0.0};
+};
+
+}  // namespace gstreamer_worker::pipeline
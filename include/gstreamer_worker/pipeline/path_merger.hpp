@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// With redundancy enabled each receive chain has a udpsrc per path feeding a
+// funnel ahead of the jitterbuffer. Simulcast chains past the first append
+// "_<index>" like the depayloaders.
+inline constexpr const char* kPrimarySourceName = "rtp_source";
+inline constexpr const char* kSecondarySourceName = "rtp_source_redundant";
+inline constexpr const char* kPathMergeName = "path_merge";
+
+// Merges the two copies of a redundant RTP stream by sequence number. Probes on
+// both udpsrc pads forward the first copy of every packet and drop the second,
+// so losing either path costs nothing and the surviving path adds no latency.
+// Dedup is lock-free: a slot per sequence number remembers when and on which
+// path it was last seen.
+class PathMerger {
+  public:
+    struct PathStats {
+        guint64 received{0};
+        // Gaps in this path's own sequence numbers.
+        guint64 lost{0};
+        // Packets this path delivered before the other one.
+        guint64 first{0};
+    };
+
+    struct Stats {
+        guint64 forwarded{0};
+        guint64 duplicates{0};
+        std::array<PathStats, 2> paths{};
+        // Arrival of the secondary copy minus the primary one, over packets
+        // seen on both paths; negative when the secondary path leads.
+        double mean_skew_ms{0.0};
+        // Largest skew either way.
+        double max_skew_ms{0.0};
+    };
+
+    PathMerger() = default;
+    ~PathMerger();
+
+    PathMerger(const PathMerger&) = delete;
+    PathMerger& operator=(const PathMerger&) = delete;
+
+    // Attaches to every receive chain of `pipeline`; false when redundancy is
+    // off or a path source is missing.
+    bool attach(GstElement* pipeline, const ViewerPipelineConfig& config);
+    void detach();
+
+    // Totals over all chains.
+    Stats stats() const;
+
+  private:
+    struct Path {
+        // Extended sequence numbers; only the path's streaming thread writes.
+        std::int64_t base{-1};
+        std::int64_t highest{-1};
+        std::atomic<guint64> received{0};
+        std::atomic<std::int64_t> expected{0};
+        std::atomic<guint64> first{0};
+    };
+
+    // One per receive chain. Each slot holds (arrival_us << 1) | path.
+    struct Chain {
+        std::vector<std::atomic<std::uint64_t>> slots;
+        std::array<Path, 2> paths;
+        std::atomic<guint64> forwarded{0};
+        std::atomic<guint64> duplicates{0};
+        // Duplicates whose first copy came from the other path.
+        std::atomic<guint64> skewed{0};
+        std::atomic<std::int64_t> skew_sum_us{0};
+        std::atomic<std::int64_t> max_skew_us{0};
+
+        Chain();
+    };
+
+    struct ProbeContext {
+        Chain* chain;
+        std::size_t path;
+    };
+
+    static GstPadProbeReturn path_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+
+    // True when `buffer` is the first copy of its packet.
+    static bool admit(Chain& chain, std::size_t path, GstBuffer* buffer);
+
+    std::vector<std::unique_ptr<Chain>> chains_;
+    std::vector<GstPad*> pads_;
+    std::vector<gulong> probe_ids_;
+};
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gst/app/gstappsink.h>
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// Launch fragment for the recorder branch hanging off `tee_name`. The builders
+// append it after the main chain when `config.enabled` is set.
+std::string recorder_branch_launch(const PreEventRecorderConfig& config,
+                                   std::string_view tee_name,
+                                   VideoCodec codec = VideoCodec::H264);
+
+// Keeps the most recent encoded access units in a preallocated byte ring. The
+// oldest retained unit is always an IDR so a saved segment decodes from its
+// first frame. Storing a unit is a memcpy into the ring; nothing is allocated
+// per frame until a save is requested.
+class PreEventRecorder {
+  public:
+    struct Stats {
+        std::size_t access_units{0};
+        std::size_t bytes{0};
+        GstClockTime span{0};
+        guint64 stored{0};
+        guint64 oversized{0};
+        guint64 saved_segments{0};
+    };
+
+    explicit PreEventRecorder(PreEventRecorderConfig config);
+    ~PreEventRecorder();
+
+    PreEventRecorder(const PreEventRecorder&) = delete;
+    PreEventRecorder& operator=(const PreEventRecorder&) = delete;
+
+    // Connects to the recorder appsink inside `pipeline`.
+    bool attach(GstElement* pipeline);
+    void detach();
+
+    bool push(GstBuffer* buffer, GstCaps* caps = nullptr);
+
+    // Writes the ring contents to `path` and blocks until the file is finalized.
+    bool save(const std::string& path);
+    // Snapshots the ring and writes it on a background thread. Returns the
+    // path of the segment being written, or an empty string when the ring holds
+    // no decodable GOP yet.
+    std::string trigger(std::string_view label = {});
+
+    Stats stats() const;
+
+  private:
+    struct Slot {
+        std::size_t offset{0};
+        std::size_t size{0};
+        GstClockTime pts{GST_CLOCK_TIME_NONE};
+        GstClockTime dts{GST_CLOCK_TIME_NONE};
+        GstClockTime duration{GST_CLOCK_TIME_NONE};
+        GstClockTime arrival{0};
+        bool keyframe{false};
+    };
+
+    struct Snapshot {
+        std::vector<guint8> data;
+        std::vector<Slot> slots;
+        GstCaps* caps{nullptr};
+    };
+
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+
+    const Slot& slot_at(std::size_t index) const;
+    void evict_oldest();
+    void evict_to_keyframe();
+    void evict_expired(GstClockTime now);
+    bool take_snapshot(Snapshot& snapshot) const;
+    bool write_snapshot(Snapshot& snapshot, const std::string& path);
+    std::string next_segment_path(std::string_view label) const;
+
+    PreEventRecorderConfig config_;
+    std::vector<guint8> ring_;
+    std::vector<Slot> slots_;
+    std::size_t head_{0};
+    std::size_t count_{0};
+    std::size_t bytes_{0};
+    GstCaps* caps_{nullptr};
+    guint64 stored_{0};
+    guint64 oversized_{0};
+    guint64 saved_segments_{0};
+    mutable std::mutex mutex_;
+
+    GstElement* sink_{nullptr};
+    gulong signal_id_{0};
+    std::thread writer_;
+};
+
+}  // namespace gstreamer_worker::pipeline
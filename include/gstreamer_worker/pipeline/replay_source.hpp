@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+// appsrc that replaces the udpsrc when ViewerPipelineConfig::replay is enabled.
+inline constexpr const char* kReplaySourceName = "replay_source";
+
+// `config.format`, or the format detected from the file header when it is
+// Auto. Throws std::runtime_error when the file cannot be opened.
+ReplayFormat resolve_replay_format(const ReplayConfig& config);
+
+// One buffer of a replay file, as a byte range of the mapped file.
+struct ReplayPacket {
+    std::size_t offset{0};
+    std::size_t size{0};
+    GstClockTime pts{0};
+    // Push time relative to the first packet at 1x.
+    GstClockTime due{0};
+    bool frame_end{false};
+};
+
+// Splits an rtpdump capture into its RTP packets. RTCP and records too short
+// for an RTP header are skipped, and a record running past the end stops the
+// split. PTS follow the unwrapped RTP timestamps, rebased on the earliest. A
+// frame ends at the marker bit or, where the capture lost it, at the next
+// timestamp change.
+std::vector<ReplayPacket> split_rtpdump(const std::uint8_t* data, std::size_t size, const ReplayConfig& config);
+// Splits an Annex B stream into access units spaced at `replay.framerate`.
+// Throws std::runtime_error for AV1, which has no Annex B form.
+std::vector<ReplayPacket> split_elementary(const std::uint8_t* data,
+                                           std::size_t size,
+                                           const ViewerPipelineConfig& config);
+
+// Pushes a recorded stream into the viewer pipeline for decode benchmarking.
+// The file is memory-mapped and every packet is handed downstream as a
+// read-only buffer wrapping the mapping, so replay costs no copies. A feeder
+// thread paces packets at `speed` times their recorded timing, or pushes them
+// back to back when `speed` is 0, with the appsrc blocking on the decoder.
+class ReplaySource {
+  public:
+    struct Stats {
+        guint64 frames_pushed{0};
+        guint64 packets_pushed{0};
+        guint64 bytes_pushed{0};
+        guint64 frames_exported{0};
+        // From the first push to the last export.
+        double elapsed_seconds{0.0};
+        double decode_fps{0.0};
+    };
+
+    ReplaySource() = default;
+    ~ReplaySource();
+
+    ReplaySource(const ReplaySource&) = delete;
+    ReplaySource& operator=(const ReplaySource&) = delete;
+
+    // Maps `config.replay.path`, splits it into packets and finds the appsrc;
+    // false when the file cannot be read or holds no packets.
+    bool attach(GstElement* pipeline, const ViewerPipelineConfig& config);
+    // Starts the feeder once the pipeline is PLAYING. The stream ends in EOS.
+    bool start();
+    void detach();
+
+    // Records that the frame with `pts` was exported from the appsink and
+    // returns the milliseconds since its last packet was pushed, or a negative
+    // value when the frame is no longer (or was never) tracked.
+    double frame_exported(GstClockTime pts);
+
+    Stats stats() const;
+
+  private:
+    // Push times of recent frames, matched by PTS when they are exported.
+    struct PushRecord {
+        std::atomic<GstClockTime> pts{GST_CLOCK_TIME_NONE};
+        std::atomic<gint64> pushed_us{0};
+    };
+    static constexpr std::size_t kPushRecords = 256;
+
+    void run();
+
+    GMappedFile* file_{nullptr};
+    GstElement* source_{nullptr};
+    std::vector<ReplayPacket> packets_;
+    double speed_{1.0};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+
+    std::array<PushRecord, kPushRecords> pushes_{};
+    std::atomic<std::size_t> next_push_{0};
+    std::atomic<guint64> frames_pushed_{0};
+    std::atomic<guint64> packets_pushed_{0};
+    std::atomic<guint64> bytes_pushed_{0};
+    std::atomic<guint64> frames_exported_{0};
+    std::atomic<gint64> first_push_us_{0};
+    std::atomic<gint64> last_export_us_{0};
+};
+
+}  // namespace gstreamer_worker::pipeline
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <gst/gst.h>
@@ -8,6 +9,13 @@
 
 namespace gstreamer_worker::pipeline {
 
+// Simulcast receive chains past the first append "_<index>".
+inline constexpr const char* kDepayloaderName = "depayloader";
+
+// Jitterbuffer latency for a sender using LowLatencyEncoderConfig at
+// `framerate` with a VBV of `vbv_frames` frames.
+std::uint32_t matched_jitter_latency_ms(std::uint32_t framerate, double vbv_frames = 1.0);
+
 std::string build_viewer_launch(const ViewerPipelineConfig& config);
 GstElement* make_viewer_pipeline(const ViewerPipelineConfig& config, GError** error = nullptr);
 
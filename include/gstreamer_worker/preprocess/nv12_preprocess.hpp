@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gstreamer_worker::preprocess {
+
+// Read-only view of an NV12 frame in mapped memory. Plane pointers and strides
+// come from the buffer's video layout (GstVideoMeta / GstVideoInfo offsets and
+// strides), so padded rows and non-contiguous planes work as is.
+struct Nv12Image {
+    const std::uint8_t* y{nullptr};
+    const std::uint8_t* uv{nullptr};
+    std::size_t y_stride{0};
+    std::size_t uv_stride{0};
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+    // Set for planar 4:2:0 (I420), as software decoders emit it: `uv` is then
+    // the U plane and `v` the V plane, each half width. Only nv12_scale()
+    // reads planar frames.
+    const std::uint8_t* v{nullptr};
+    std::size_t v_stride{0};
+};
+
+// Builds an Nv12Image from a mapped base pointer plus per-plane offsets and
+// strides, exactly as GstVideoInfo reports them.
+Nv12Image nv12_view(const void* base,
+                    std::uint32_t width,
+                    std::uint32_t height,
+                    const std::size_t offsets[2],
+                    const std::size_t strides[2]);
+
+enum class ChannelOrder { Rgb, Bgr };
+
+enum class ColorMatrix { Bt601, Bt709 };
+
+struct Rect {
+    std::uint32_t x{0};
+    std::uint32_t y{0};
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+};
+
+// Writable NV12 region, such as one tile of a larger frame: plane pointers at
+// the region's top-left corner with the strides of the whole frame.
+struct Nv12Target {
+    std::uint8_t* y{nullptr};
+    std::uint8_t* uv{nullptr};
+    std::size_t y_stride{0};
+    std::size_t uv_stride{0};
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+};
+
+// Region `rect` of the width x height NV12 frame at `base`, laid out as for
+// nv12_view(). Throws std::invalid_argument when the rect leaves the frame or
+// has an odd position or size, which would split chroma sites.
+Nv12Target nv12_region(void* base,
+                       std::uint32_t width,
+                       std::uint32_t height,
+                       const std::size_t offsets[2],
+                       const std::size_t strides[2],
+                       const Rect& rect);
+
+struct PreprocessParams {
+    // Source region; an empty rect selects the whole frame.
+    Rect crop{};
+    std::uint32_t output_width{0};
+    std::uint32_t output_height{0};
+    ChannelOrder order{ChannelOrder::Rgb};
+    ColorMatrix matrix{ColorMatrix::Bt601};
+    bool full_range{false};
+    // Applied per output channel (in `order`) to 0-255 values: (v - mean) * scale.
+    std::array<float, 3> mean{0.0F, 0.0F, 0.0F};
+    std::array<float, 3> scale{1.0F / 255.0F, 1.0F / 255.0F, 1.0F / 255.0F};
+};
+
+enum class Backend { Auto, Scalar, Avx2, Neon };
+
+// Fastest backend this CPU supports.
+Backend best_backend();
+const char* backend_name(Backend backend);
+
+// Converts `image` to planar float (three output_width x output_height planes,
+// channel-major) with bilinear resize of the crop, colour conversion and
+// normalization fused into one pass. Single-threaded; Backend::Scalar is the
+// reference the SIMD kernels are tested against. Throws std::invalid_argument
+// on an empty image, output size or a crop outside the frame.
+void nv12_to_planar(const Nv12Image& image, const PreprocessParams& params, float* output,
+                    Backend backend = Backend::Auto);
+
+// Bilinear NV12 (or I420) to NV12 resize of the whole `image` straight into
+// `target`; bytes outside the target rows and columns are left alone. Single-threaded;
+// Backend::Scalar is the reference, the SIMD kernels round within one level of
+// it. Throws std::invalid_argument on an empty image or an empty or odd-sized
+// target.
+void nv12_scale(const Nv12Image& image, const Nv12Target& target, Backend backend = Backend::Auto);
+
+// Sum of absolute differences between every `row_step`-th row of an 8-bit
+// plane (`width` bytes per row) and `reference`, which holds just those rows
+// packed back to back. Meant for cheap change detection on the luma plane.
+std::uint64_t sampled_plane_sad(const std::uint8_t* plane,
+                                std::size_t stride,
+                                std::uint32_t width,
+                                std::uint32_t height,
+                                std::uint32_t row_step,
+                                const std::uint8_t* reference,
+                                Backend backend = Backend::Auto);
+// Copies the rows sampled_plane_sad() compares into `reference`, which must
+// hold sampled_rows(height, row_step) * width bytes.
+void copy_sampled_rows(const std::uint8_t* plane,
+                       std::size_t stride,
+                       std::uint32_t width,
+                       std::uint32_t height,
+                       std::uint32_t row_step,
+                       std::uint8_t* reference);
+std::uint32_t sampled_rows(std::uint32_t height, std::uint32_t row_step);
+
+// Runs the same conversion split into row bands over a persistent worker pool.
+class Preprocessor {
+  public:
+    // 0 threads uses one per hardware thread.
+    explicit Preprocessor(std::size_t threads = 0, Backend backend = Backend::Auto);
+    ~Preprocessor();
+
+    Preprocessor(const Preprocessor&) = delete;
+    Preprocessor& operator=(const Preprocessor&) = delete;
+
+    void nv12_to_planar(const Nv12Image& image, const PreprocessParams& params, float* output);
+
+    Backend backend() const { return backend_; }
+    std::size_t threads() const { return workers_.size() + 1; }
+
+  private:
+    void worker_loop();
+    void run_bands();
+
+    Backend backend_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::function<void(std::size_t)> job_;
+    std::size_t bands_{0};
+    std::atomic<std::size_t> next_band_{0};
+    std::size_t pending_workers_{0};
+    std::uint64_t generation_{0};
+    bool stopping_{false};
+};
+
+}  // namespace gstreamer_worker::preprocess
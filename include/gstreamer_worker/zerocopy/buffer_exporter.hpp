@@ -6,15 +6,28 @@
 #include <gst/app/gstappsink.h>
 
 #include "gstreamer_worker/zerocopy/frame_meta.hpp"
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
 
 namespace gstreamer_worker::zerocopy {
 
 struct ExportPacket {
-    // File descriptor duplicated from the underlying DMA-BUF memory. The callback
-    // becomes the owner and must close it when done.
+    // File descriptor duplicated from the underlying DMA-BUF memory, or from
+    // other fd-backed memory (a memfd) when the buffer has no DMA-BUF. The
+    // callback becomes the owner and must close it when done.
     int dma_fd{-1};
+    // False when `dma_fd` is plain fd memory, which consumers mmap rather than
+    // import into a GPU API.
+    bool dmabuf{false};
+    // The exported buffer, borrowed for the callback. A consumer that keeps
+    // using the frame (through `dma_fd` or otherwise) after returning takes a
+    // reference and drops it when done: producers that recycle their buffers
+    // only rewrite one nobody else references.
+    GstBuffer* buffer{nullptr};
     GstCaps* caps{nullptr};
     FrameMetadata metadata{};
+    // Variable metadata sections, shared with the buffer rather than copied.
+    // Copy the handle to keep them past the callback.
+    FrameSections sections{};
 };
 
 class BufferExporter {
@@ -26,6 +39,7 @@ class BufferExporter {
     bool export_sample(GstSample* sample) const;
 
     static bool has_dmabuf(const GstBuffer* buffer);
+    // DMA-BUF memory first, then any other GstFdMemory; -1 when neither exists.
     static int acquire_dmabuf_fd(GstBuffer* buffer);
 
   private:
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+#include <gst/app/gstappsink.h>
+
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+
+namespace gstreamer_worker::zerocopy {
+
+// One mapped piece of an access unit. The parser may assemble an AU from
+// several memories (e.g. SPS/PPS prepended to an IDR); each is mapped in place.
+struct EncodedChunk {
+    const guint8* data{nullptr};
+    gsize size{0};
+};
+
+// A whole encoded access unit (byte-stream, AU aligned). Everything points into
+// the pipeline's buffer and is valid only during the callback; take a
+// reference on `buffer` to keep the data longer.
+struct EncodedPacket {
+    GstBuffer* buffer{nullptr};
+    GstCaps* caps{nullptr};
+    std::array<EncodedChunk, 16> chunks{};
+    std::size_t chunk_count{0};
+    gsize size{0};
+    bool keyframe{false};
+    GstClockTime pts{GST_CLOCK_TIME_NONE};
+    GstClockTime dts{GST_CLOCK_TIME_NONE};
+    FrameMetadata metadata{};
+    FrameSections sections{};
+
+    // The whole AU when it sits in a single memory, null otherwise.
+    const guint8* contiguous() const { return chunk_count == 1 ? chunks[0].data : nullptr; }
+};
+
+// Counterpart of BufferExporter for the encoded export appsink: maps each
+// memory of the sample's buffer read-only and hands the AU to the callback
+// without copying it.
+class EncodedExporter {
+  public:
+    using Callback = std::function<void(const EncodedPacket&)>;
+
+    explicit EncodedExporter(Callback callback);
+
+    bool export_sample(GstSample* sample) const;
+
+  private:
+    Callback callback_;
+};
+
+}  // namespace gstreamer_worker::zerocopy
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/zerocopy/buffer_exporter.hpp"
+
+namespace gstreamer_worker::zerocopy {
+
+struct FrameCollatorConfig {
+    std::size_t streams{0};
+    // Frames whose capture_ts lie within this window of the batch's earliest
+    // frame belong to the same batch.
+    GstClockTime tolerance{5 * GST_MSECOND};
+    // How long a batch waits for streams that have not delivered anything yet
+    // before it is released without them. Checked on every push() and poll();
+    // when all streams stall, only poll() releases the last batch in time.
+    std::chrono::milliseconds max_wait{50};
+    // Release incomplete batches (missing streams have dma_fd == -1); when
+    // false they are dropped instead.
+    bool deliver_partial{true};
+    // Frames held per stream while waiting; the oldest is dropped beyond it.
+    std::size_t max_pending{8};
+};
+
+struct CollatedBatch {
+    // Earliest capture_ts in the batch and the distance to the latest one.
+    GstClockTime capture_ts{GST_CLOCK_TIME_NONE};
+    GstClockTime spread{0};
+    // One entry per stream, in stream order. Missing streams have dma_fd == -1
+    // and no caps or buffer.
+    std::vector<ExportPacket> frames;
+    std::size_t present{0};
+
+    bool complete() const { return present == frames.size(); }
+};
+
+// Groups exported frames from N streams into batches by
+// FrameMetadata::capture_ts. push() is called from each stream's appsink
+// thread; a batch is emitted from whichever push completes it, or from
+// poll() once it has waited max_wait. The collator owns pushed fds until they
+// are delivered (the callback then owns them, as with BufferExporter) or
+// dropped (closed here).
+class FrameCollator {
+  public:
+    struct Stats {
+        guint64 batches{0};
+        guint64 complete{0};
+        guint64 partial{0};
+        guint64 dropped_late{0};
+        guint64 dropped_overflow{0};
+        guint64 dropped_partial{0};
+    };
+
+    // Runs on the pushing (or polling) thread with the collator locked; it
+    // must not call push(), poll() or flush().
+    using Callback = std::function<void(const CollatedBatch&)>;
+
+    FrameCollator(FrameCollatorConfig config, Callback callback);
+    ~FrameCollator();
+
+    FrameCollator(const FrameCollator&) = delete;
+    FrameCollator& operator=(const FrameCollator&) = delete;
+
+    // Takes ownership of `packet.dma_fd` and adds a reference to its caps and
+    // buffer; the buffer reference is dropped after the batch callback.
+    // Frames without a valid capture_ts, for an unknown stream, or older than
+    // the last released batch are dropped.
+    bool push(std::size_t stream, const ExportPacket& packet);
+
+    // Releases batches whose max_wait has passed. Call it from a timer at
+    // about max_wait so a batch goes out even when no stream pushes again.
+    void poll();
+
+    // Releases everything pending as (possibly partial) batches.
+    void flush();
+
+    // BufferExporter callback feeding `stream`.
+    BufferExporter::Callback input(std::size_t stream);
+
+    Stats stats() const;
+
+  private:
+    struct Pending {
+        ExportPacket packet;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    void collate(bool force);
+    void release(std::vector<ExportPacket>& frames, std::size_t present, GstClockTime first, GstClockTime last);
+    static void discard(ExportPacket& packet);
+
+    FrameCollatorConfig config_;
+    Callback callback_;
+    std::vector<std::deque<Pending>> pending_;
+    GstClockTime last_batch_ts_{GST_CLOCK_TIME_NONE};
+    Stats stats_{};
+    mutable std::mutex mutex_;
+};
+
+}  // namespace gstreamer_worker::zerocopy
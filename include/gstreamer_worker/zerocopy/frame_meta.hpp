@@ -6,21 +6,32 @@
 
 #include <gst/gst.h>
 
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+
 namespace gstreamer_worker::zerocopy {
 
 struct FrameMetadata {
     guint64 frame_id{0};
+    // Timestamps on the capture node's clock: the shared network/PTP clock when
+    // one is configured, the host monotonic clock otherwise.
     GstClockTime capture_ts{GST_CLOCK_TIME_NONE};
     GstClockTime encode_ts{GST_CLOCK_TIME_NONE};
+    // Estimated error of that clock against the shared timebase.
+    GstClockTime clock_error{GST_CLOCK_TIME_NONE};
     double exposure_ms{0.0};
     double gain{0.0};
     std::array<float, 3> imu_rpy{0.0F, 0.0F, 0.0F};
     std::array<char, 32> sensor_id{};
+    // Static-scene frames the motion gate dropped since the previous frame sent.
+    std::uint32_t skipped_frames{0};
 };
 
 struct FrameMeta {
     GstMeta meta;
     FrameMetadata payload;
+    // Variable sections from a MetaArena, one reference held by this meta.
+    // Read them through get_frame_sections().
+    detail::SectionBlock* sections;
 };
 
 FrameMetadata make_frame_metadata(guint64 frame_id,
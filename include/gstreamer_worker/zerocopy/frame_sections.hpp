@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include <gst/gst.h>
+
+namespace gstreamer_worker::zerocopy {
+
+// Layout version of a serialized section block. Bumped when the block or
+// section headers change; sections carry their own payload version.
+inline constexpr std::uint8_t kFrameSectionsVersion = 1;
+
+enum class SectionType : std::uint16_t {
+    // Array of DetectionBox.
+    DetectionBoxes = 1,
+    // Array of EncoderStatsRecord.
+    EncoderStats = 2,
+    // Opaque bytes from a sensor driver.
+    SensorBlob = 3,
+    // Application-defined types start here.
+    User = 0x8000,
+};
+
+// Normalized [0, 1] image coordinates.
+struct DetectionBox {
+    float x{0.0F};
+    float y{0.0F};
+    float width{0.0F};
+    float height{0.0F};
+    float score{0.0F};
+    std::uint32_t label{0};
+};
+
+struct EncoderStatsRecord {
+    std::uint32_t frame_bytes{0};
+    std::uint32_t qp{0};
+    std::uint32_t keyframe{0};
+    std::uint32_t slices{0};
+};
+
+// A section inside a block. `data` points into the block and stays valid as
+// long as the FrameSections it came from (or the buffer carrying it) lives.
+struct SectionView {
+    SectionType type{SectionType::User};
+    std::uint16_t version{0};
+    const std::byte* data{nullptr};
+    std::size_t size{0};
+
+    template <typename T>
+    std::span<const T> as_array() const {
+        static_assert(std::is_trivially_copyable_v<T>, "sections hold trivially copyable records");
+        return {reinterpret_cast<const T*>(data), size / sizeof(T)};
+    }
+};
+
+namespace detail {
+struct SectionBlock;
+struct ArenaPool;
+void retain(SectionBlock* block);
+void release(SectionBlock* block);
+}  // namespace detail
+
+// Read-only, refcounted handle on a frozen section block. Copying shares the
+// block; nothing is copied out of it.
+//
+// Blocks use host (little-endian) layout on the wire as well; both ends of
+// the RTP link are expected to share it.
+class FrameSections {
+  public:
+    class Iterator {
+      public:
+        using value_type = SectionView;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        Iterator(const std::byte* cursor, const std::byte* end) : cursor_(cursor), end_(end) {}
+
+        SectionView operator*() const;
+        Iterator& operator++();
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const Iterator& other) const { return cursor_ == other.cursor_; }
+
+      private:
+        const std::byte* cursor_{nullptr};
+        const std::byte* end_{nullptr};
+    };
+
+    FrameSections() = default;
+    // Adopts one reference on `block`.
+    explicit FrameSections(detail::SectionBlock* block) : block_(block) {}
+    FrameSections(const FrameSections& other);
+    FrameSections& operator=(const FrameSections& other);
+    FrameSections(FrameSections&& other) noexcept;
+    FrameSections& operator=(FrameSections&& other) noexcept;
+    ~FrameSections();
+
+    bool empty() const;
+    std::size_t count() const;
+    // Serialized form: the block header followed by every section.
+    std::span<const std::byte> bytes() const;
+
+    Iterator begin() const;
+    Iterator end() const;
+    // The `nth` section of `type`, if present.
+    std::optional<SectionView> find(SectionType type, std::size_t nth = 0) const;
+
+    detail::SectionBlock* block() const { return block_; }
+
+  private:
+    detail::SectionBlock* block_{nullptr};
+};
+
+// Builds one frame's sections into an arena block. finish() freezes the block;
+// a writer dropped before that returns its block to the arena.
+class FrameSectionWriter {
+  public:
+    FrameSectionWriter() = default;
+    FrameSectionWriter(FrameSectionWriter&& other) noexcept;
+    FrameSectionWriter& operator=(FrameSectionWriter&& other) noexcept;
+    FrameSectionWriter(const FrameSectionWriter&) = delete;
+    FrameSectionWriter& operator=(const FrameSectionWriter&) = delete;
+    ~FrameSectionWriter();
+
+    // Reserves `size` bytes for a new section and returns where to write them,
+    // so producers can fill it in place. Grows past the arena block size with
+    // a one-off allocation; returns nullptr only on an unusable writer.
+    void* reserve(SectionType type, std::uint16_t version, std::size_t size);
+    bool append(SectionType type, std::uint16_t version, const void* data, std::size_t size);
+
+    template <typename T>
+    bool append(SectionType type, std::uint16_t version, std::span<const T> records) {
+        static_assert(std::is_trivially_copyable_v<T>, "sections hold trivially copyable records");
+        return append(type, version, records.data(), records.size_bytes());
+    }
+
+    FrameSections finish();
+
+  private:
+    friend class MetaArena;
+    explicit FrameSectionWriter(detail::SectionBlock* block) : block_(block) {}
+
+    detail::SectionBlock* block_{nullptr};
+};
+
+// Per-pipeline pool of section blocks. A block goes back to the pool when the
+// last buffer (or FrameSections) referencing it is released, so steady-state
+// frames allocate nothing. The pool itself lives until the arena and every
+// outstanding block are gone, so buffers may outlive the arena.
+class MetaArena {
+  public:
+    struct Stats {
+        std::uint64_t acquired{0};
+        // Blocks handed out from the free list instead of allocated.
+        std::uint64_t reused{0};
+        // Blocks grown past block_size; allocated once, never pooled.
+        std::uint64_t oversize{0};
+        std::size_t free_blocks{0};
+    };
+
+    // Throws std::invalid_argument when block_size cannot hold a section.
+    explicit MetaArena(std::size_t block_size = 4096, std::size_t max_free_blocks = 256);
+    ~MetaArena();
+
+    MetaArena(const MetaArena&) = delete;
+    MetaArena& operator=(const MetaArena&) = delete;
+
+    FrameSectionWriter writer();
+    // Copies a serialized block (e.g. received over RTP) into a pooled block.
+    // Returns an empty FrameSections when the bytes are not a valid block.
+    FrameSections adopt(std::span<const std::byte> bytes);
+
+    Stats stats() const;
+
+  private:
+    detail::ArenaPool* pool_{nullptr};
+};
+
+// Attaches `sections` to the buffer's FrameMeta, adding a default one when the
+// buffer has none. The buffer must be writable.
+bool attach_frame_sections(GstBuffer* buffer, FrameSections sections);
+// Zero-copy view of the buffer's sections; empty when there are none.
+FrameSections get_frame_sections(const GstBuffer* buffer);
+
+}  // namespace gstreamer_worker::zerocopy
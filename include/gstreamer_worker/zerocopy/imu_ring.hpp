@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <gst/gst.h>
+
+namespace gstreamer_worker::zerocopy {
+
+struct ImuSample {
+    // Same timebase as FrameMetadata::capture_ts (gst_util_get_timestamp()).
+    GstClockTime timestamp{GST_CLOCK_TIME_NONE};
+    // Roll, pitch, yaw in radians.
+    std::array<float, 3> rpy{0.0F, 0.0F, 0.0F};
+};
+
+// Single-producer ring of IMU samples. The sensor thread pushes without ever
+// waiting; readers on streaming threads interpolate without locks. Every slot
+// is a seqlock stamped with the absolute sample index, so a reader detects a
+// slot that the producer overwrote while it was being read and retries or
+// gives up instead of blocking the producer.
+class ImuRing {
+  public:
+    struct Stats {
+        guint64 pushed{0};
+        guint64 interpolated{0};
+        guint64 held{0};
+        guint64 missed{0};
+    };
+
+    // `capacity` is rounded up to a power of two; the default keeps four
+    // seconds of a 1 kHz IMU. Samples newer than the latest one by less than
+    // `max_hold` reuse the latest orientation instead of failing.
+    explicit ImuRing(std::size_t capacity = 4096, GstClockTime max_hold = 5 * GST_MSECOND);
+
+    ImuRing(const ImuRing&) = delete;
+    ImuRing& operator=(const ImuRing&) = delete;
+
+    // Producer thread only. Timestamps must not decrease.
+    void push(const ImuSample& sample);
+
+    // Orientation at `timestamp`, interpolated between the neighbouring
+    // samples. Returns false when the ring does not cover it.
+    bool interpolate(GstClockTime timestamp, std::array<float, 3>& rpy) const;
+
+    Stats stats() const;
+
+  private:
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<std::uint64_t> timestamp{0};
+        std::array<std::atomic<float>, 3> rpy{};
+    };
+
+    bool read(std::uint64_t index, ImuSample& sample) const;
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t mask_{0};
+    GstClockTime max_hold_{0};
+    std::atomic<std::uint64_t> head_{0};
+
+    mutable std::atomic<guint64> interpolated_{0};
+    mutable std::atomic<guint64> held_{0};
+    mutable std::atomic<guint64> missed_{0};
+};
+
+}  // namespace gstreamer_worker::zerocopy
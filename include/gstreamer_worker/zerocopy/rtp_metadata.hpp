@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+
+namespace gstreamer_worker::zerocopy {
+
+// RFC 8285 one-byte header extension ids carrying FrameMetadata on the last
+// (marker) packet of every frame. Receivers that do not know them skip them.
+inline constexpr guint8 kRtpExtFrameId = 1;
+inline constexpr guint8 kRtpExtCaptureTs = 2;
+inline constexpr guint8 kRtpExtEncodeTs = 3;
+inline constexpr guint8 kRtpExtClockError = 4;
+inline constexpr guint8 kRtpExtExposureGain = 5;
+inline constexpr guint8 kRtpExtImu = 6;
+inline constexpr guint8 kRtpExtSensorId = 7;
+inline constexpr guint8 kRtpExtSkippedFrames = 9;
+// Serialized FrameSections split into 16-byte elements, repeated in order.
+inline constexpr guint8 kRtpExtSections = 8;
+// Larger section blocks stay local so the extension stays bounded.
+inline constexpr std::size_t kRtpSectionsBudget = 256;
+
+// Most the writer adds to a marker packet: the extension header, six 8-byte
+// elements, IMU, a 16-byte sensor id and the section budget in 16-byte
+// elements, each element with its one-byte header, padded to 32-bit words.
+// Payloaders must leave this much of the path MTU free.
+inline constexpr std::size_t kRtpMetadataHeadroom =
+    (4 + 6 * (1 + 8) + (1 + 12) + (1 + 16) + kRtpSectionsBudget / 16 * (1 + 16) + 3) / 4 * 4;
+
+// Writes `metadata` and, when they fit the budget, `sections` as header
+// extensions of one writable RTP packet. encode_ts is stamped from `clock`
+// (the host monotonic clock when null). False when the buffer is not RTP.
+bool write_rtp_metadata(GstBuffer* packet, FrameMetadata metadata, const FrameSections& sections,
+                        GstClock* clock = nullptr);
+// Reads them back; false when the packet carries no frame id. The serialized
+// section block, empty when none was sent, goes to `sections` unless null.
+bool read_rtp_metadata(GstBuffer* packet, FrameMetadata& metadata, std::vector<std::byte>* sections = nullptr);
+
+// Probes the payloader's src pad and writes the FrameMeta of each payloaded
+// frame into its marker packet, with its sections when they fit the budget.
+// encode_ts is stamped there from `clock` (the host monotonic clock when
+// null), i.e. when the encoded frame leaves.
+bool install_rtp_metadata_writer(GstElement* payloader, GstClock* clock = nullptr);
+
+// Probes the depayloader: metadata read from incoming packets is attached as
+// FrameMeta to the frame the depayloader emits for them. Sections are rebuilt
+// in `arena` (skipped when null), which must outlive the pipeline.
+bool install_rtp_metadata_reader(GstElement* depayloader, MetaArena* arena = nullptr);
+
+}  // namespace gstreamer_worker::zerocopy
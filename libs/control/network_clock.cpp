@@ -0,0 +1,174 @@
+#include "gstreamer_worker/control/network_clock.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <gst/net/net.h>
+
+namespace gstreamer_worker::control {
+namespace {
+
+std::uint32_t parse_number(std::string_view text, std::string_view what) {
+    try {
+        std::size_t consumed = 0;
+        const std::string value{text};
+        const unsigned long result = std::stoul(value, &consumed);
+        if (consumed != value.size()) {
+            throw std::invalid_argument("trailing characters");
+        }
+        return static_cast<std::uint32_t>(result);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid " + std::string{what} + " in clock spec: " + std::string{text});
+    }
+}
+
+}  // namespace
+
+NetworkClockConfig parse_clock_spec(std::string_view spec) {
+    NetworkClockConfig config;
+    const auto colon = spec.rfind(':');
+    const std::string_view head = spec.substr(0, colon);
+    const std::string_view tail = colon == std::string_view::npos ? std::string_view{} : spec.substr(colon + 1);
+    if (head.empty()) {
+        throw std::invalid_argument("--clock expects provide[:PORT], HOST[:PORT] or ptp[:DOMAIN]");
+    }
+    if (head == "provide") {
+        config.mode = NetworkClockConfig::Mode::Provide;
+    } else if (head == "ptp") {
+        config.mode = NetworkClockConfig::Mode::Ptp;
+        if (!tail.empty()) {
+            config.ptp_domain = parse_number(tail, "PTP domain");
+        }
+        return config;
+    } else {
+        config.mode = NetworkClockConfig::Mode::Follow;
+        config.address = std::string{head};
+    }
+    if (!tail.empty()) {
+        config.port = static_cast<std::uint16_t>(parse_number(tail, "port"));
+    }
+    return config;
+}
+
+NetworkClock::NetworkClock(NetworkClockConfig config) : config_(std::move(config)) {
+    switch (config_.mode) {
+        case NetworkClockConfig::Mode::Local:
+            clock_ = gst_system_clock_obtain();
+            error_.store(0);
+            break;
+        case NetworkClockConfig::Mode::Provide: {
+            clock_ = gst_system_clock_obtain();
+            GstNetTimeProvider* provider =
+                gst_net_time_provider_new(clock_, config_.address.c_str(), static_cast<gint>(config_.port));
+            if (!provider) {
+                gst_object_unref(clock_);
+                clock_ = nullptr;
+                throw std::runtime_error("Unable to provide the network clock on port " + std::to_string(config_.port));
+            }
+            provider_ = GST_OBJECT(provider);
+            error_.store(0);
+            break;
+        }
+        case NetworkClockConfig::Mode::Follow: {
+            clock_ = gst_net_client_clock_new("shared_clock", config_.address.c_str(),
+                                              static_cast<gint>(config_.port), 0);
+            if (!clock_) {
+                throw std::runtime_error("Unable to create a network client clock for " + config_.address);
+            }
+            // The client posts "gst-netclock-statistics" after every exchange.
+            stats_bus_ = gst_bus_new();
+            gst_bus_set_sync_handler(stats_bus_, &NetworkClock::on_client_stats, this, nullptr);
+            g_object_set(clock_, "bus", stats_bus_, nullptr);
+            break;
+        }
+        case NetworkClockConfig::Mode::Ptp:
+            if (!gst_ptp_is_initialized() && !gst_ptp_init(GST_PTP_CLOCK_ID_NONE, nullptr)) {
+                throw std::runtime_error("Unable to initialise PTP support");
+            }
+            ptp_stats_id_ = gst_ptp_statistics_callback_add(&NetworkClock::on_ptp_stats, this, nullptr);
+            clock_ = gst_ptp_clock_new("shared_clock", config_.ptp_domain);
+            if (!clock_) {
+                throw std::runtime_error("Unable to create a PTP clock for domain " +
+                                         std::to_string(config_.ptp_domain));
+            }
+            break;
+    }
+
+    if (config_.mode == NetworkClockConfig::Mode::Follow || config_.mode == NetworkClockConfig::Mode::Ptp) {
+        if (!gst_clock_wait_for_sync(clock_, config_.sync_timeout)) {
+            std::cerr << "Shared clock not synchronised yet; timestamps converge once it is\n";
+        }
+    }
+}
+
+NetworkClock::~NetworkClock() {
+    if (ptp_stats_id_ != 0) {
+        gst_ptp_statistics_callback_remove(ptp_stats_id_);
+    }
+    if (clock_ && stats_bus_) {
+        g_object_set(clock_, "bus", nullptr, nullptr);
+    }
+    if (stats_bus_) {
+        gst_bus_set_sync_handler(stats_bus_, nullptr, nullptr, nullptr);
+        gst_object_unref(stats_bus_);
+    }
+    if (provider_) {
+        gst_object_unref(provider_);
+    }
+    if (clock_) {
+        gst_object_unref(clock_);
+    }
+}
+
+void NetworkClock::apply(GstElement* pipeline) const {
+    if (pipeline && clock_ && GST_IS_PIPELINE(pipeline)) {
+        gst_pipeline_use_clock(GST_PIPELINE(pipeline), clock_);
+    }
+}
+
+std::uint16_t NetworkClock::port() const {
+    if (!provider_) {
+        return config_.port;
+    }
+    gint port = 0;
+    g_object_get(provider_, "port", &port, nullptr);
+    return static_cast<std::uint16_t>(port);
+}
+
+GstClockTime NetworkClock::now() const {
+    return clock_ ? gst_clock_get_time(clock_) : gst_util_get_timestamp();
+}
+
+bool NetworkClock::synced() const {
+    return clock_ && gst_clock_is_synced(clock_);
+}
+
+GstClockTime NetworkClock::error_estimate() const {
+    return error_.load(std::memory_order_relaxed);
+}
+
+GstBusSyncReply NetworkClock::on_client_stats(GstBus* /*bus*/, GstMessage* message, gpointer user_data) {
+    auto* self = static_cast<NetworkClock*>(user_data);
+    const GstStructure* stats = gst_message_get_structure(message);
+    GstClockTime rtt = GST_CLOCK_TIME_NONE;
+    if (self && stats && gst_structure_has_name(stats, "gst-netclock-statistics") &&
+        gst_structure_get_clock_time(stats, "rtt-average", &rtt) && GST_CLOCK_TIME_IS_VALID(rtt)) {
+        self->error_.store(rtt / 2, std::memory_order_relaxed);
+    }
+    return GST_BUS_DROP;
+}
+
+gboolean NetworkClock::on_ptp_stats(guint8 domain, const GstStructure* stats, gpointer user_data) {
+    auto* self = static_cast<NetworkClock*>(user_data);
+    GstClockTime delay = GST_CLOCK_TIME_NONE;
+    if (self && domain == self->config_.ptp_domain &&
+        gst_structure_has_name(stats, GST_PTP_STATISTICS_PATH_DELAY_MEASURED) &&
+        gst_structure_get_clock_time(stats, "mean-path-delay-avg", &delay)) {
+        self->error_.store(delay, std::memory_order_relaxed);
+    }
+    return TRUE;
+}
+
+}  // namespace gstreamer_worker::control
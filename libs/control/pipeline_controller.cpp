@@ -4,22 +4,55 @@
 #include <stdexcept>
 #include <utility>
 
+#if defined(G_OS_UNIX)
+#include <glib-unix.h>
+#endif
+
 namespace gstreamer_worker::control {
 
-PipelineController::PipelineController() {
-    loop_ = g_main_loop_new(nullptr, FALSE);
+PipelineController::PipelineController(bool own_context) {
+    if (own_context) {
+        context_ = g_main_context_new();
+    }
+    loop_ = g_main_loop_new(context_, FALSE);
 }
 
 PipelineController::~PipelineController() {
     stop();
+    remove_sync_handler();
+    if (loop_thread_.joinable()) {
+        request_stop();
+        loop_thread_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(commands_mutex_);
+        if (drain_source_) {
+            g_source_destroy(drain_source_);
+            g_source_unref(drain_source_);
+            drain_source_ = nullptr;
+        }
+        commands_.clear();
+    }
     if (pipeline_) {
         gst_object_unref(pipeline_);
         pipeline_ = nullptr;
     }
+    if (task_pool_) {
+        gst_object_unref(task_pool_);
+        task_pool_ = nullptr;
+    }
     if (loop_) {
         g_main_loop_unref(loop_);
         loop_ = nullptr;
     }
+    if (context_) {
+        g_main_context_unref(context_);
+        context_ = nullptr;
+    }
+}
+
+GMainContext* PipelineController::context() const {
+    return context_ ? context_ : g_main_context_default();
 }
 
 void PipelineController::set_pipeline(GstElement* pipeline) {
@@ -27,9 +60,11 @@ void PipelineController::set_pipeline(GstElement* pipeline) {
         throw std::invalid_argument("PipelineController requires a valid pipeline");
     }
     if (pipeline_) {
+        remove_sync_handler();
         gst_object_unref(pipeline_);
     }
     pipeline_ = GST_ELEMENT(gst_object_ref(pipeline));
+    install_sync_handler();
     ensure_watch();
 }
 
@@ -47,9 +82,10 @@ bool PipelineController::play() {
 }
 
 void PipelineController::stop() {
-    if (bus_watch_id_ != 0) {
-        g_source_remove(bus_watch_id_);
-        bus_watch_id_ = 0;
+    if (bus_watch_) {
+        g_source_destroy(bus_watch_);
+        g_source_unref(bus_watch_);
+        bus_watch_ = nullptr;
     }
     if (pipeline_) {
         gst_element_set_state(pipeline_, GST_STATE_NULL);
@@ -58,15 +94,94 @@ void PipelineController::stop() {
 
 void PipelineController::run() {
     if (!loop_) {
-        loop_ = g_main_loop_new(nullptr, FALSE);
+        loop_ = g_main_loop_new(context_, FALSE);
+    }
+    if (context_) {
+        g_main_context_push_thread_default(context_);
     }
     g_main_loop_run(loop_);
+    if (context_) {
+        g_main_context_pop_thread_default(context_);
+    }
+}
+
+void PipelineController::start() {
+    if (!context_) {
+        throw std::logic_error("PipelineController::start requires an owned context");
+    }
+    if (loop_thread_.joinable()) {
+        return;
+    }
+    loop_thread_ = std::thread([this] { run(); });
+}
+
+void PipelineController::join() {
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
 }
 
 void PipelineController::request_stop() {
-    if (loop_ && g_main_loop_is_running(loop_)) {
+    if (!loop_) {
+        return;
+    }
+    if (g_main_loop_is_running(loop_)) {
         g_main_loop_quit(loop_);
+        return;
+    }
+    // The loop may not have entered run() yet (e.g. right after start());
+    // queue the quit so it is not lost.
+    post([this] { g_main_loop_quit(loop_); });
+}
+
+void PipelineController::post(Command command) {
+    std::lock_guard<std::mutex> lock(commands_mutex_);
+    commands_.push_back(std::move(command));
+    if (drain_source_) {
+        return;
+    }
+    drain_source_ = g_idle_source_new();
+    g_source_set_callback(drain_source_, &PipelineController::drain_commands, this, nullptr);
+    g_source_attach(drain_source_, context_);
+}
+
+gboolean PipelineController::drain_commands(gpointer user_data) {
+    auto* self = static_cast<PipelineController*>(user_data);
+    std::deque<Command> pending;
+    {
+        std::lock_guard<std::mutex> lock(self->commands_mutex_);
+        pending.swap(self->commands_);
+        if (self->drain_source_) {
+            g_source_unref(self->drain_source_);
+            self->drain_source_ = nullptr;
+        }
+    }
+    for (auto& command : pending) {
+        command();
     }
+    return G_SOURCE_REMOVE;
+}
+
+guint PipelineController::attach_source(GSource* source, GSourceFunc callback, gpointer user_data) {
+    g_source_set_callback(source, callback, user_data, nullptr);
+    const guint id = g_source_attach(source, context_);
+    g_source_unref(source);
+    return id;
+}
+
+guint PipelineController::add_timeout(guint interval_ms, GSourceFunc callback, gpointer user_data) {
+    return attach_source(g_timeout_source_new(interval_ms), callback, user_data);
+}
+
+guint PipelineController::add_unix_signal(int signum, GSourceFunc callback, gpointer user_data) {
+#if defined(G_OS_UNIX)
+    return attach_source(g_unix_signal_source_new(signum), callback, user_data);
+#else
+    (void)signum;
+    (void)callback;
+    (void)user_data;
+    return 0;
+#endif
 }
 
 void PipelineController::set_bus_handler(BusHandler handler) {
@@ -74,12 +189,135 @@ void PipelineController::set_bus_handler(BusHandler handler) {
     ensure_watch();
 }
 
+void PipelineController::set_thread_policy(ThreadPolicy policy) {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    thread_policy_ = std::move(policy);
+}
+
+void PipelineController::set_task_pool(SharedTaskPool& pool, const std::string& pipeline_name) {
+    GstTaskPool* handle = pool.client(pipeline_name);
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    if (task_pool_) {
+        gst_object_unref(task_pool_);
+    }
+    task_pool_ = handle;
+}
+
+std::vector<PipelineController::ThreadUsage> PipelineController::thread_usage() {
+    std::vector<ThreadUsage> usage;
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    usage.reserve(threads_.size());
+    for (auto& [tid, record] : threads_) {
+        if (record.active) {
+            const double cpu = thread_cpu_seconds(tid);
+            if (cpu >= 0.0) {
+                record.cpu_seconds = cpu;
+            }
+        }
+        ThreadUsage entry;
+        entry.element = record.element;
+        entry.tid = tid;
+        entry.active = record.active;
+        entry.placed = record.placed;
+        entry.cpu_seconds = record.cpu_seconds;
+        const double wall = std::chrono::duration<double>(now - record.sampled_at).count();
+        if (wall > 0.0) {
+            entry.cpu_percent = 100.0 * (record.cpu_seconds - record.sampled_cpu) / wall;
+        }
+        record.sampled_cpu = record.cpu_seconds;
+        record.sampled_at = now;
+        usage.push_back(std::move(entry));
+    }
+    return usage;
+}
+
+void PipelineController::install_sync_handler() {
+    GstBus* bus = gst_element_get_bus(pipeline_);
+    gst_bus_set_sync_handler(bus, &PipelineController::sync_callback, this, nullptr);
+    gst_object_unref(bus);
+}
+
+void PipelineController::remove_sync_handler() {
+    if (!pipeline_) {
+        return;
+    }
+    GstBus* bus = gst_element_get_bus(pipeline_);
+    gst_bus_set_sync_handler(bus, nullptr, nullptr, nullptr);
+    gst_object_unref(bus);
+}
+
+// Runs on the thread that posted the message. STREAM_STATUS ENTER and LEAVE are
+// posted by the streaming thread itself, so it can be placed and measured here.
+GstBusSyncReply PipelineController::sync_callback(GstBus* /*bus*/, GstMessage* message, gpointer user_data) {
+    auto* self = static_cast<PipelineController*>(user_data);
+    if (self && message && GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS) {
+        self->handle_stream_status(message);
+    }
+    return GST_BUS_PASS;
+}
+
+void PipelineController::handle_stream_status(GstMessage* message) {
+    GstStreamStatusType type = GST_STREAM_STATUS_TYPE_CREATE;
+    GstElement* owner = nullptr;
+    gst_message_parse_stream_status(message, &type, &owner);
+    if (type == GST_STREAM_STATUS_TYPE_CREATE) {
+        std::lock_guard<std::mutex> lock(threads_mutex_);
+        const GValue* object = gst_message_get_stream_status_object(message);
+        if (task_pool_ && object && G_VALUE_HOLDS(object, GST_TYPE_TASK)) {
+            gst_task_set_pool(GST_TASK(g_value_get_object(object)), task_pool_);
+        }
+        return;
+    }
+    if (type != GST_STREAM_STATUS_TYPE_ENTER && type != GST_STREAM_STATUS_TYPE_LEAVE) {
+        return;
+    }
+
+    const int tid = current_thread_id();
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    auto& record = threads_[tid];
+    if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+        record.element = owner ? GST_OBJECT_NAME(owner) : "unknown";
+        record.active = true;
+        record.placed = false;
+        record.restore = false;
+        record.sampled_cpu = current_thread_cpu_seconds();
+        record.cpu_seconds = record.sampled_cpu;
+        record.sampled_at = std::chrono::steady_clock::now();
+        if (const ThreadRule* rule = thread_policy_.match(record.element)) {
+            // Pooled threads are reused by other elements; remember what to
+            // hand back on LEAVE.
+            record.previous = current_thread_placement();
+            record.restore = true;
+            std::string error;
+            record.placed = apply_thread_rule(*rule, &error);
+            if (!record.placed) {
+                std::cerr << "Thread policy for " << record.element << " (tid " << tid
+                          << ") not fully applied: " << error << '\n';
+            }
+        }
+        return;
+    }
+
+    record.cpu_seconds = current_thread_cpu_seconds();
+    record.active = false;
+    if (record.restore) {
+        apply_thread_rule(record.previous);
+        record.restore = false;
+    }
+}
+
 void PipelineController::ensure_watch() {
-    if (!pipeline_ || bus_watch_id_ != 0) {
+    if (!pipeline_ || bus_watch_) {
         return;
     }
+    // gst_bus_add_watch() would attach to the caller's thread-default context;
+    // the watch must dispatch on the controller's own.
     GstBus* bus = gst_element_get_bus(pipeline_);
-    bus_watch_id_ = gst_bus_add_watch(bus, &PipelineController::bus_callback, this);
+    bus_watch_ = gst_bus_create_watch(bus);
+    g_source_set_callback(bus_watch_, G_SOURCE_FUNC(&PipelineController::bus_callback), this,
+                          nullptr);
+    g_source_attach(bus_watch_, context_);
     gst_object_unref(bus);
 }
 
@@ -0,0 +1,239 @@
+#include "gstreamer_worker/control/shared_task_pool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace gstreamer_worker::control {
+
+struct SharedTaskPool::Job {
+    GstTaskPoolFunction function{nullptr};
+    gpointer user_data{nullptr};
+    std::size_t client{0};
+    bool pooled{false};
+    bool done{false};
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    std::thread overflow;
+};
+
+namespace {
+
+// GstTaskPool handle bound to one pipeline of a SharedTaskPool. prepare and
+// cleanup are no-ops: the shared workers outlive any single pipeline.
+struct GwSharedTaskPoolClient {
+    GstTaskPool parent;
+    SharedTaskPool* shared;
+    std::size_t client;
+};
+
+struct GwSharedTaskPoolClientClass {
+    GstTaskPoolClass parent_class;
+};
+
+G_DEFINE_TYPE(GwSharedTaskPoolClient, gw_shared_task_pool_client, GST_TYPE_TASK_POOL)
+
+GwSharedTaskPoolClient* as_client(GstTaskPool* pool) {
+    return reinterpret_cast<GwSharedTaskPoolClient*>(pool);
+}
+
+void client_prepare(GstTaskPool* /*pool*/, GError** /*error*/) {}
+
+void client_cleanup(GstTaskPool* /*pool*/) {}
+
+gpointer client_push(GstTaskPool* pool, GstTaskPoolFunction function, gpointer user_data, GError** error) {
+    auto* self = as_client(pool);
+    auto* job = self->shared->push(self->client, function, user_data);
+    if (!job) {
+        // GstTask pushes itself; its name says which element and pad it serves.
+        const gchar* name = GST_IS_TASK(user_data) ? GST_OBJECT_NAME(user_data) : nullptr;
+        const std::string task = name ? name : "<unnamed>";
+        std::cerr << "Shared task pool refused task " << task << ": overflow thread limit reached\n";
+        g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_THREAD, "Shared task pool has no thread left for task %s",
+                    task.c_str());
+    }
+    return job;
+}
+
+void client_join(GstTaskPool* pool, gpointer id) {
+    if (id) {
+        as_client(pool)->shared->join(static_cast<SharedTaskPool::Job*>(id));
+    }
+}
+
+void client_finalize(GObject* object) {
+    auto* self = reinterpret_cast<GwSharedTaskPoolClient*>(object);
+    if (self->shared) {
+        self->shared->release_client(self->client);
+    }
+    G_OBJECT_CLASS(gw_shared_task_pool_client_parent_class)->finalize(object);
+}
+
+void gw_shared_task_pool_client_class_init(GwSharedTaskPoolClientClass* klass) {
+    auto* pool_class = reinterpret_cast<GstTaskPoolClass*>(klass);
+    pool_class->prepare = client_prepare;
+    pool_class->cleanup = client_cleanup;
+    pool_class->push = client_push;
+    pool_class->join = client_join;
+    G_OBJECT_CLASS(klass)->finalize = client_finalize;
+}
+
+void gw_shared_task_pool_client_init(GwSharedTaskPoolClient* self) {
+    self->shared = nullptr;
+    self->client = 0;
+}
+
+}  // namespace
+
+SharedTaskPool::SharedTaskPool(std::size_t max_workers, std::size_t max_overflow)
+    : max_workers_(max_workers), max_overflow_(max_overflow) {
+    if (max_workers_ == 0) {
+        max_workers_ = 2 * std::max(1U, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(max_workers_);
+}
+
+SharedTaskPool::~SharedTaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+GstTaskPool* SharedTaskPool::client(const std::string& pipeline_name) {
+    auto* handle = static_cast<GwSharedTaskPoolClient*>(g_object_new(gw_shared_task_pool_client_get_type(), nullptr));
+    std::lock_guard<std::mutex> lock(mutex_);
+    handle->shared = this;
+    handle->client = next_client_++;
+    clients_[handle->client].stats.name = pipeline_name;
+    return GST_TASK_POOL(handle);
+}
+
+SharedTaskPool::Stats SharedTaskPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.max_workers = max_workers_;
+    stats.workers = workers_.size();
+    stats.idle_workers = idle_workers_;
+    stats.max_overflow = max_overflow_;
+    stats.overflow_threads = overflow_threads_;
+    stats.saturation_events = saturation_events_;
+    stats.rejected = rejected_;
+    for (const auto& [id, client] : clients_) {
+        stats.pipelines.push_back(client.stats);
+    }
+    return stats;
+}
+
+std::size_t SharedTaskPool::fair_share() const {
+    const auto alive = static_cast<std::size_t>(
+        std::count_if(clients_.begin(), clients_.end(), [](const auto& entry) { return entry.second.alive; }));
+    return std::max<std::size_t>(1, max_workers_ / std::max<std::size_t>(1, alive));
+}
+
+SharedTaskPool::Job* SharedTaskPool::push(std::size_t client, GstTaskPoolFunction function, gpointer user_data) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto& stats = clients_[client].stats;
+
+    bool pooled = false;
+    if (idle_workers_ > ready_.size()) {
+        // A parked worker is free: reuse it regardless of share.
+        pooled = true;
+    } else if (workers_.size() < max_workers_ && stats.pooled < fair_share()) {
+        pooled = true;
+        workers_.emplace_back([this] { worker_loop(); });
+    } else if (max_overflow_ > 0 && overflow_threads_ >= max_overflow_) {
+        ++stats.rejected;
+        ++rejected_;
+        return nullptr;
+    }
+
+    ++stats.started;
+    ++stats.active;
+    stats.peak_active = std::max(stats.peak_active, stats.active);
+
+    auto* job = new Job;
+    job->function = function;
+    job->user_data = user_data;
+    job->client = client;
+    job->pooled = pooled;
+
+    if (job->pooled) {
+        ++stats.pooled;
+        ready_.push_back(job);
+        lock.unlock();
+        ready_cv_.notify_one();
+        return job;
+    }
+
+    ++stats.overflowed;
+    ++saturation_events_;
+    ++overflow_threads_;
+    lock.unlock();
+    job->overflow = std::thread([this, job] { run_job(job); });
+    return job;
+}
+
+void SharedTaskPool::join(Job* job) {
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->done_cv.wait(lock, [job] { return job->done; });
+    }
+    if (job->overflow.joinable()) {
+        job->overflow.join();
+    }
+    delete job;
+}
+
+void SharedTaskPool::release_client(std::size_t client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = clients_.find(client);
+    if (found != clients_.end()) {
+        found->second.alive = false;
+    }
+}
+
+void SharedTaskPool::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        ++idle_workers_;
+        ready_cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+        --idle_workers_;
+        if (ready_.empty()) {
+            return;
+        }
+        Job* job = ready_.front();
+        ready_.pop_front();
+        lock.unlock();
+        run_job(job);
+        lock.lock();
+    }
+}
+
+void SharedTaskPool::run_job(Job* job) {
+    job->function(job->user_data);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& stats = clients_[job->client].stats;
+        --stats.active;
+        if (job->pooled) {
+            --stats.pooled;
+        } else {
+            --overflow_threads_;
+        }
+    }
+    // join() deletes the job as soon as it sees `done`, so the notify has to
+    // happen before the mutex is released.
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->done = true;
+    job->done_cv.notify_all();
+}
+
+}  // namespace gstreamer_worker::control
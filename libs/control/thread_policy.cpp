@@ -0,0 +1,248 @@
+#include "gstreamer_worker/control/thread_policy.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <glib.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace gstreamer_worker::control {
+namespace {
+
+int parse_int(std::string_view text, std::string_view what) {
+    try {
+        std::size_t consumed = 0;
+        const std::string value{text};
+        const int result = std::stoi(value, &consumed);
+        if (consumed != value.size()) {
+            throw std::invalid_argument("trailing characters");
+        }
+        return result;
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid " + std::string{what} + " in thread rule: " + std::string{text});
+    }
+}
+
+// "2-3,5" -> {2, 3, 5}; "*" -> {}.
+std::vector<int> parse_cpu_list(std::string_view text) {
+    std::vector<int> cpus;
+    if (text == "*" || text.empty()) {
+        return cpus;
+    }
+    std::size_t start = 0;
+    while (start <= text.size()) {
+        const auto comma = text.find(',', start);
+        const auto item = text.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start);
+        const auto dash = item.find('-');
+        if (dash == std::string_view::npos) {
+            cpus.push_back(parse_int(item, "CPU"));
+        } else {
+            const int first = parse_int(item.substr(0, dash), "CPU");
+            const int last = parse_int(item.substr(dash + 1), "CPU");
+            if (last < first) {
+                throw std::invalid_argument("Invalid CPU range in thread rule: " + std::string{item});
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return cpus;
+}
+
+}  // namespace
+
+const ThreadRule* ThreadPolicy::match(std::string_view element_name) const {
+    const std::string name{element_name};
+    for (const auto& rule : rules) {
+        if (g_pattern_match_simple(rule.element_pattern.c_str(), name.c_str())) {
+            return &rule;
+        }
+    }
+    return nullptr;
+}
+
+ThreadRule parse_thread_rule(std::string_view spec) {
+    const auto first = spec.find(':');
+    if (first == std::string_view::npos || first == 0) {
+        throw std::invalid_argument("--thread-rule expects PATTERN:CPUS[:fifo=PRIO|nice=N]");
+    }
+    ThreadRule rule;
+    rule.element_pattern = std::string{spec.substr(0, first)};
+
+    const auto second = spec.find(':', first + 1);
+    rule.cpus = parse_cpu_list(spec.substr(first + 1, second == std::string_view::npos ? std::string_view::npos
+                                                                                         : second - first - 1));
+    if (second != std::string_view::npos) {
+        const auto scheduling = spec.substr(second + 1);
+        if (scheduling.rfind("fifo=", 0) == 0) {
+            rule.realtime_priority = parse_int(scheduling.substr(5), "priority");
+            if (rule.realtime_priority < 1 || rule.realtime_priority > 99) {
+                throw std::invalid_argument("SCHED_FIFO priority must be within 1-99");
+            }
+        } else if (scheduling.rfind("nice=", 0) == 0) {
+            rule.nice = parse_int(scheduling.substr(5), "nice value");
+        } else {
+            throw std::invalid_argument("Unknown scheduling in thread rule: " + std::string{scheduling});
+        }
+    }
+    return rule;
+}
+
+#if defined(__linux__)
+
+bool apply_thread_rule(const ThreadRule& rule, std::string* error) {
+    std::ostringstream failures;
+    bool ok = true;
+
+    if (!rule.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : rule.cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (result != 0) {
+            failures << "affinity: " << std::strerror(result) << "; ";
+            ok = false;
+        }
+    }
+
+    if (rule.realtime_priority > 0) {
+        sched_param param{};
+        param.sched_priority = rule.realtime_priority;
+        const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result != 0) {
+            failures << "SCHED_FIFO: " << std::strerror(result) << "; ";
+            ok = false;
+        }
+    } else if (rule.nice) {
+        int policy = SCHED_OTHER;
+        sched_param param{};
+        if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy != SCHED_OTHER) {
+            param.sched_priority = 0;
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        }
+    }
+    if (rule.realtime_priority == 0 && rule.nice) {
+        // On Linux the nice value is per thread when addressed by tid.
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(current_thread_id()), *rule.nice) != 0) {
+            failures << "nice: " << std::strerror(errno) << "; ";
+            ok = false;
+        }
+    }
+
+    if (!ok && error) {
+        *error = failures.str();
+    }
+    return ok;
+}
+
+ThreadRule current_thread_placement() {
+    ThreadRule placement;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                placement.cpus.push_back(cpu);
+            }
+        }
+    }
+    int policy = SCHED_OTHER;
+    sched_param param{};
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy == SCHED_FIFO) {
+        placement.realtime_priority = param.sched_priority;
+    } else {
+        errno = 0;
+        const int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(current_thread_id()));
+        if (errno == 0) {
+            placement.nice = nice;
+        }
+    }
+    return placement;
+}
+
+int current_thread_id() {
+    return static_cast<int>(syscall(SYS_gettid));
+}
+
+double current_thread_cpu_seconds() {
+    timespec now{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+        return 0.0;
+    }
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+double thread_cpu_seconds(int tid) {
+    std::ifstream stat("/proc/self/task/" + std::to_string(tid) + "/stat");
+    std::string line;
+    if (!stat || !std::getline(stat, line)) {
+        return -1.0;
+    }
+    // The command name may contain spaces; fields resume after the last ')'.
+    const auto close = line.rfind(')');
+    if (close == std::string::npos) {
+        return -1.0;
+    }
+    std::istringstream fields(line.substr(close + 2));
+    std::string field;
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    // Fields 3..13 precede utime (14) and stime (15).
+    for (int index = 3; index <= 13 && fields >> field; ++index) {
+    }
+    if (!(fields >> utime >> stime)) {
+        return -1.0;
+    }
+    const long ticks = sysconf(_SC_CLK_TCK);
+    return static_cast<double>(utime + stime) / static_cast<double>(ticks > 0 ? ticks : 100);
+}
+
+#else
+
+bool apply_thread_rule(const ThreadRule& /*rule*/, std::string* error) {
+    if (error) {
+        *error = "thread placement is only supported on Linux";
+    }
+    return false;
+}
+
+ThreadRule current_thread_placement() {
+    return {};
+}
+
+int current_thread_id() {
+    return 0;
+}
+
+double current_thread_cpu_seconds() {
+    return 0.0;
+}
+
+double thread_cpu_seconds(int /*tid*/) {
+    return -1.0;
+}
+
+#endif
+
+}  // namespace gstreamer_worker::control
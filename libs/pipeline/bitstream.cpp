@@ -0,0 +1,386 @@
+#include "gstreamer_worker/pipeline/bitstream.hpp"
+
+#include <algorithm>
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+// Reads Exp-Golomb codes from a NAL payload, skipping emulation prevention bytes.
+class BitReader {
+  public:
+    BitReader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size) {}
+
+    bool read_bit(std::uint32_t& bit) {
+        if (bit_ == 0) {
+            if (pos_ >= size_) {
+                return false;
+            }
+            if (pos_ >= 2 && data_[pos_] == 0x03 && data_[pos_ - 1] == 0x00 && data_[pos_ - 2] == 0x00) {
+                if (++pos_ >= size_) {
+                    return false;
+                }
+            }
+            current_ = data_[pos_++];
+            bit_ = 8;
+        }
+        --bit_;
+        bit = (current_ >> bit_) & 1U;
+        return true;
+    }
+
+    bool read_byte(std::uint32_t& value) {
+        value = 0;
+        std::uint32_t bit = 0;
+        for (int index = 0; index < 8; ++index) {
+            if (!read_bit(bit)) {
+                return false;
+            }
+            value = (value << 1) | bit;
+        }
+        return true;
+    }
+
+    bool read_ue(std::uint32_t& value) {
+        std::uint32_t leading_zeros = 0;
+        std::uint32_t bit = 0;
+        while (read_bit(bit) && bit == 0) {
+            if (++leading_zeros > 31) {
+                return false;
+            }
+        }
+        if (bit == 0) {
+            return false;
+        }
+        std::uint32_t suffix = 0;
+        for (std::uint32_t index = 0; index < leading_zeros; ++index) {
+            if (!read_bit(bit)) {
+                return false;
+            }
+            suffix = (suffix << 1) | bit;
+        }
+        value = (1U << leading_zeros) - 1 + suffix;
+        return true;
+    }
+
+  private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_{0};
+    std::uint8_t current_{0};
+    std::uint32_t bit_{0};
+};
+
+// Returns the offset of the first byte after the next start code at or after
+// `from`, or `size` when there is none.
+std::size_t next_nal(const std::uint8_t* data, std::size_t size, std::size_t from) {
+    for (std::size_t index = from; index + 3 <= size; ++index) {
+        if (data[index] == 0x00 && data[index + 1] == 0x00 && data[index + 2] == 0x01) {
+            return index + 3;
+        }
+    }
+    return size;
+}
+
+FrameType merge_type(FrameType current, std::uint32_t slice_type) {
+    FrameType slice = FrameType::Unknown;
+    switch (slice_type % 5) {
+        case 0:
+        case 3:
+            slice = FrameType::P;
+            break;
+        case 1:
+            slice = FrameType::B;
+            break;
+        case 2:
+        case 4:
+            slice = FrameType::I;
+            break;
+        default:
+            break;
+    }
+    // A picture is as "heavy" as its most predicted slice: B > P > I.
+    if (current == FrameType::Unknown || static_cast<int>(slice) > static_cast<int>(current)) {
+        return slice;
+    }
+    return current;
+}
+
+// Whether an SEI NAL payload carries a recovery point message (payload type 6
+// in both H.264 and H.265), which intra-refresh encoders send at the start of
+// every refresh cycle.
+bool has_recovery_point(const std::uint8_t* data, std::size_t size) {
+    constexpr std::uint32_t kRecoveryPoint = 6;
+    BitReader reader(data, size);
+    std::uint32_t byte = 0;
+    while (true) {
+        std::uint32_t type = 0;
+        do {
+            if (!reader.read_byte(byte)) {
+                return false;
+            }
+            type += byte;
+        } while (byte == 0xFF);
+        if (type == kRecoveryPoint) {
+            return true;
+        }
+        if (type == 0x80) {
+            // rbsp_trailing_bits; no SEI payload type 128 is in use.
+            return false;
+        }
+        std::uint32_t payload = 0;
+        do {
+            if (!reader.read_byte(byte)) {
+                return false;
+            }
+            payload += byte;
+        } while (byte == 0xFF);
+        for (std::uint32_t index = 0; index < payload; ++index) {
+            if (!reader.read_byte(byte)) {
+                return false;
+            }
+        }
+    }
+}
+
+// Calls `visit(start, end)` for the payload of every NAL unit, delimited by
+// Annex B start codes or, with `length_size`, by big-endian length prefixes.
+template <typename Visitor>
+void for_each_nal(const std::uint8_t* data, std::size_t size, std::size_t length_size, Visitor&& visit) {
+    if (length_size > 0) {
+        std::size_t pos = 0;
+        while (pos + length_size <= size) {
+            std::size_t length = 0;
+            for (std::size_t index = 0; index < length_size; ++index) {
+                length = (length << 8) | data[pos + index];
+            }
+            const std::size_t start = pos + length_size;
+            const std::size_t end = std::min(size, start + length);
+            visit(start, end);
+            pos = end;
+        }
+        return;
+    }
+    std::size_t start = next_nal(data, size, 0);
+    while (start < size) {
+        const std::size_t next = next_nal(data, size, start);
+        // `next` points past the following start code; trim it and any zero
+        // bytes of a four-byte start code.
+        std::size_t end = next < size ? next - 3 : size;
+        while (end > start && data[end - 1] == 0x00) {
+            --end;
+        }
+        visit(start, end);
+        start = next;
+    }
+}
+
+// Reads an AV1 leb128 value; returns the number of bytes used, 0 on overrun.
+std::size_t read_leb128(const std::uint8_t* data, std::size_t size, std::uint64_t& value) {
+    value = 0;
+    for (std::size_t index = 0; index < 8 && index < size; ++index) {
+        value |= static_cast<std::uint64_t>(data[index] & 0x7FU) << (7 * index);
+        if ((data[index] & 0x80U) == 0) {
+            return index + 1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+AccessUnitInfo inspect_h264_access_unit(const std::uint8_t* data, std::size_t size, std::size_t nal_length_size) {
+    AccessUnitInfo info;
+    if (!data) {
+        return info;
+    }
+    for_each_nal(data, size, nal_length_size, [&](std::size_t start, std::size_t end) {
+        if (end <= start) {
+            return;
+        }
+        const std::uint8_t header = data[start];
+        const std::uint32_t nal_type = header & 0x1FU;
+        const std::uint32_t ref_idc = (header >> 5) & 0x03U;
+        if (nal_type == 6) {
+            info.recovery_point = info.recovery_point || has_recovery_point(data + start + 1, end - start - 1);
+        }
+        if (nal_type == 1 || nal_type == 5) {
+            ++info.slices;
+            info.idr = info.idr || nal_type == 5;
+            info.reference = info.reference || ref_idc != 0;
+            BitReader reader(data + start + 1, end - start - 1);
+            std::uint32_t first_mb = 0;
+            std::uint32_t slice_type = 0;
+            if (reader.read_ue(first_mb) && reader.read_ue(slice_type)) {
+                info.type = merge_type(info.type, slice_type);
+            }
+        }
+    });
+    return info;
+}
+
+AccessUnitInfo inspect_h265_access_unit(const std::uint8_t* data, std::size_t size, std::size_t nal_length_size) {
+    AccessUnitInfo info;
+    if (!data) {
+        return info;
+    }
+    for_each_nal(data, size, nal_length_size, [&](std::size_t start, std::size_t end) {
+        if (end < start + 2) {
+            return;
+        }
+        const std::uint32_t nal_type = (data[start] >> 1) & 0x3FU;
+        if (nal_type == 39) {
+            info.recovery_point = info.recovery_point || has_recovery_point(data + start + 2, end - start - 2);
+        }
+        if (nal_type > 31) {
+            return;
+        }
+        ++info.slices;
+        const bool irap = nal_type >= 16 && nal_type <= 23;
+        // BLA and IDR; a CRA in the middle of a stream keeps its RASL
+        // pictures, which only decode if the frames before it did.
+        info.idr = info.idr || (nal_type >= 16 && nal_type <= 20);
+        info.cra = info.cra || nal_type == 21;
+        info.leading = info.leading || (nal_type >= 6 && nal_type <= 9);
+        info.rasl = info.rasl || nal_type == 8 || nal_type == 9;
+        // Even types up to 14 are sub-layer non-reference pictures.
+        info.reference = info.reference || nal_type > 14 || (nal_type & 1U) != 0;
+
+        BitReader reader(data + start + 2, end - start - 2);
+        std::uint32_t first_slice = 0;
+        if (!reader.read_bit(first_slice) || first_slice == 0) {
+            // Later segments need the PPS to find slice_type; the first one
+            // describes the picture well enough.
+            return;
+        }
+        std::uint32_t skipped = 0;
+        std::uint32_t pps_id = 0;
+        std::uint32_t slice_type = 0;
+        // Assumes num_extra_slice_header_bits == 0, as every encoder we drive sets.
+        if ((!irap || reader.read_bit(skipped)) && reader.read_ue(pps_id) && reader.read_ue(slice_type)) {
+            // HEVC numbers B/P/I as 0/1/2; map onto the H.264 values.
+            constexpr std::uint32_t kAsH264[] = {1, 0, 2};
+            if (slice_type < 3) {
+                info.type = merge_type(info.type, kAsH264[slice_type]);
+            }
+        }
+    });
+    return info;
+}
+
+AccessUnitInfo inspect_av1_temporal_unit(const std::uint8_t* data, std::size_t size) {
+    constexpr std::uint32_t kObuFrameHeader = 3;
+    constexpr std::uint32_t kObuTileGroup = 4;
+    constexpr std::uint32_t kObuFrame = 6;
+
+    AccessUnitInfo info;
+    if (!data) {
+        return info;
+    }
+    std::size_t pos = 0;
+    while (pos < size) {
+        const std::uint8_t header = data[pos];
+        const std::uint32_t obu_type = (header >> 3) & 0x0FU;
+        const bool extension = (header & 0x04U) != 0;
+        const bool has_size = (header & 0x02U) != 0;
+        std::size_t payload = pos + 1 + (extension ? 1 : 0);
+        if (payload > size) {
+            break;
+        }
+        std::uint64_t obu_size = size - payload;
+        if (has_size) {
+            const std::size_t used = read_leb128(data + payload, size - payload, obu_size);
+            if (used == 0) {
+                break;
+            }
+            payload += used;
+        }
+        if (obu_size > size - payload) {
+            break;
+        }
+
+        if (obu_type == kObuFrame || obu_type == kObuTileGroup) {
+            ++info.slices;
+        }
+        if (obu_type == kObuFrame || obu_type == kObuFrameHeader) {
+            // Assumes reduced_still_picture_header == 0, which only still
+            // images use.
+            BitReader reader(data + payload, static_cast<std::size_t>(obu_size));
+            std::uint32_t show_existing = 0;
+            std::uint32_t high = 0;
+            std::uint32_t low = 0;
+            if (reader.read_bit(show_existing) && show_existing == 0 && reader.read_bit(high) &&
+                reader.read_bit(low)) {
+                const std::uint32_t frame_type = (high << 1) | low;
+                // KEY_FRAME resets every reference; INTRA_ONLY does not.
+                info.idr = info.idr || frame_type == 0;
+                // KEY/INTRA_ONLY are intra, INTER/SWITCH predicted (H.264 I=2, P=0).
+                constexpr std::uint32_t kAsH264[] = {2, 0, 2, 0};
+                info.type = merge_type(info.type, kAsH264[frame_type]);
+                // refresh_frame_flags sits behind sequence header fields, so
+                // every coded frame is treated as a reference.
+                info.reference = true;
+            }
+        }
+        pos = payload + static_cast<std::size_t>(obu_size);
+    }
+    return info;
+}
+
+std::vector<std::size_t> access_unit_offsets(VideoCodec codec, const std::uint8_t* data, std::size_t size) {
+    std::vector<std::size_t> offsets;
+    if (!data || codec == VideoCodec::AV1) {
+        return offsets;
+    }
+    // An access unit ends before the first non-VCL NAL that may only lead one
+    // (AUD, parameter sets, prefix SEI) or the first slice of the next picture.
+    bool vcl_seen = false;
+    std::size_t previous_end = 0;
+    for_each_nal(data, size, 0, [&](std::size_t start, std::size_t end) {
+        if (end <= start) {
+            return;
+        }
+        if (offsets.empty()) {
+            offsets.push_back(0);
+        }
+        bool vcl = false;
+        bool leads = false;
+        if (codec == VideoCodec::H265) {
+            const std::uint32_t nal_type = (data[start] >> 1) & 0x3FU;
+            vcl = nal_type <= 31;
+            // first_slice_segment_in_pic_flag follows the two-byte header.
+            leads = vcl ? end - start > 2 && (data[start + 2] & 0x80U) != 0
+                        : (nal_type >= 32 && nal_type <= 35) || nal_type == 39 ||
+                              (nal_type >= 41 && nal_type <= 44) || (nal_type >= 48 && nal_type <= 55);
+        } else {
+            const std::uint32_t nal_type = data[start] & 0x1FU;
+            vcl = nal_type >= 1 && nal_type <= 5;
+            // first_mb_in_slice == 0 is a single set bit.
+            leads = vcl ? end - start > 1 && (data[start + 1] & 0x80U) != 0
+                        : (nal_type >= 6 && nal_type <= 9) || (nal_type >= 14 && nal_type <= 18);
+        }
+        if (leads && vcl_seen) {
+            offsets.push_back(previous_end);
+            vcl_seen = false;
+        }
+        vcl_seen = vcl_seen || vcl;
+        previous_end = end;
+    });
+    return offsets;
+}
+
+AccessUnitInfo inspect_access_unit(VideoCodec codec,
+                                   const std::uint8_t* data,
+                                   std::size_t size,
+                                   std::size_t nal_length_size) {
+    switch (codec) {
+        case VideoCodec::H265:
+            return inspect_h265_access_unit(data, size, nal_length_size);
+        case VideoCodec::AV1:
+            return inspect_av1_temporal_unit(data, size);
+        case VideoCodec::H264:
+        default:
+            return inspect_h264_access_unit(data, size, nal_length_size);
+    }
+}
+
+}  // namespace gstreamer_worker::pipeline
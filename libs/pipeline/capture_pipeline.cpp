@@ -4,12 +4,23 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include "gstreamer_worker/pipeline/codec.hpp"
 #include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/pre_event_recorder.hpp"
+#include "gstreamer_worker/zerocopy/rtp_metadata.hpp"
 
 namespace gstreamer_worker::pipeline {
 namespace {
 
+constexpr const char* kRecorderTee = "recorder_tee";
+constexpr const char* kLayerTee = "layer_tee";
+// Streaming threads are owned by queues, so these names are what thread
+// policies match for the per-layer encoders and the network senders.
+constexpr const char* kEncoderQueue = "encoder_queue";
+constexpr const char* kNetworkQueue = "network_queue";
+
 std::string quote(std::string_view text) {
     if (text.find_first_of(" \"") == std::string_view::npos) {
         return std::string{text};
@@ -26,36 +37,156 @@ std::string quote(std::string_view text) {
     return result;
 }
 
-void append_encoder(std::ostringstream& stream, const CapturePipelineConfig& config) {
+std::vector<EncodingLayer> effective_layers(const CapturePipelineConfig& config) {
+    if (config.layers.empty()) {
+        return {EncodingLayer{config.width, config.height, config.bitrate, config.network.port, 0}};
+    }
+    std::vector<EncodingLayer> layers = config.layers;
+    for (std::size_t index = 0; index < layers.size(); ++index) {
+        auto& layer = layers[index];
+        layer.width = layer.width ? layer.width : config.width;
+        layer.height = layer.height ? layer.height : config.height;
+        layer.bitrate = layer.bitrate ? layer.bitrate : config.bitrate;
+        if (layer.port == 0) {
+            layer.port = static_cast<std::uint16_t>(config.network.port + 2 * index);
+        }
+    }
+    return layers;
+}
+
+bool negotiated_source(const CapturePipelineConfig& config) {
+    return !config.use_test_pattern && !config.source_format.media.empty();
+}
+
+// Pins the camera to the probed mode and adds only the stages that mode needs.
+void append_negotiated_source(std::ostringstream& stream, const CapturePipelineConfig& config) {
+    const SourceFormat& source = config.source_format;
+    stream << " ! " << source.media;
+    if (!source.format.empty()) {
+        stream << ",format=" << source.format;
+    }
+    stream << ",width=" << config.width << ",height=" << config.height << ",framerate=" << config.framerate
+           << "/1";
+    if (!source.decoder.empty()) {
+        stream << " ! " << source.decoder;
+    }
+    if (!source.converter.empty()) {
+        stream << " ! " << source.converter;
+    }
+}
+
+bool qos_active(const CapturePipelineConfig& config) {
+    return config.qos.enabled && config.layers.empty();
+}
+
+std::string layer_suffix(std::size_t index) {
+    return index == 0 ? std::string{} : "_" + std::to_string(index);
+}
+
+EncoderSettings encoder_settings(const CapturePipelineConfig& config, const EncodingLayer& layer) {
+    EncoderSettings settings;
+    settings.factory = config.encoder;
+    settings.bitrate = layer.bitrate;
+    settings.width = layer.width;
+    settings.height = layer.height;
+    settings.framerate = config.framerate;
+    settings.low_latency = config.low_latency;
+    return settings;
+}
+
+void append_encoder(std::ostringstream& stream,
+                    const CapturePipelineConfig& config,
+                    const EncodingLayer& layer,
+                    std::size_t index) {
+    const bool scaled = layer.width != config.width || layer.height != config.height;
     if (config.use_nvenc) {
-        stream << " ! nvvidconv name=nvconv";
+        stream << " ! nvvidconv name=nvconv" << layer_suffix(index);
         if (config.use_zero_copy) {
             stream << " nvbuf-memory-type=3";
         }
-        stream << " ! video/x-raw(memory:NVMM),format=NV12";
-        stream << " ! nvv4l2h264enc control-rate=1 bitrate=" << config.bitrate
-               << " iframeinterval=15 insert-sps-pps=true EnableTwopassCBR=false "
-                  "OutputIniCtrl=0";
+        if (qos_active(config)) {
+            // nvvidconv scales in hardware, so the QoS caps sit on its output.
+            stream << " ! capsfilter name=" << kQosCapsName << " caps=\""
+                   << quality_step_caps(config, {config.width, config.height, config.framerate}) << "\"";
+        } else {
+            stream << " ! video/x-raw(memory:NVMM),format=NV12";
+            if (scaled) {
+                stream << ",width=" << layer.width << ",height=" << layer.height;
+            }
+        }
+        EncoderSettings settings = encoder_settings(config, layer);
+        settings.keyframe_interval = 15;
+        stream << " ! " << nvidia_encoder(config.codec, settings, kEncoderName + layer_suffix(index));
     } else {
-        stream << " ! x264enc tune=zerolatency speed-preset=superfast bitrate=" << config.bitrate / 1000
-               << " key-int-max=30 sliced-threads=true bframes=0";
+        if (scaled) {
+            stream << " ! videoscale ! video/x-raw,width=" << layer.width << ",height=" << layer.height;
+        }
+        stream << " ! "
+               << software_encoder(config.codec, encoder_settings(config, layer), kEncoderName + layer_suffix(index));
     }
 }
 
-void append_transport(std::ostringstream& stream, const CapturePipelineConfig& config) {
-    stream << " ! h264parse disable-passthrough=true config-interval=1";
-    stream << " ! rtph264pay pt=96 config-interval=1";
+void append_transport(std::ostringstream& stream,
+                      const CapturePipelineConfig& config,
+                      const EncodingLayer& layer,
+                      std::size_t index,
+                      bool record) {
+    const CodecElements& codec = codec_elements(config.codec);
+    stream << " ! " << codec.parser << " name=" << kEncodedParserName << layer_suffix(index)
+           << " disable-passthrough=true";
+    if (codec.parameter_sets) {
+        stream << " config-interval=1";
+    }
+    if (record) {
+        stream << " ! tee name=" << kRecorderTee;
+    }
+    // The metadata writer appends its header extensions to the marker packet
+    // after the payloader has filled it.
+    stream << " ! " << codec.payloader << " name=" << kPayloaderName << layer_suffix(index) << " pt=96"
+           << " mtu=" << config.mtu - zerocopy::kRtpMetadataHeadroom;
+    if (codec.parameter_sets) {
+        stream << " config-interval=1";
+    }
+    if (layer.ssrc != 0) {
+        stream << " ssrc=" << layer.ssrc;
+    }
     if (config.enable_fec) {
         stream << " ! rtpulpfecenc percentage=" << config.fec_percentage;
     }
-    stream << " ! queue max-size-time=0 max-size-buffers=4";
+    stream << " ! queue name=" << kNetworkQueue << layer_suffix(index) << " max-size-time=0 max-size-buffers=4";
+    if (config.redundancy.enabled) {
+        // One element sends each packet to both paths back to back, so neither
+        // path trails the other by a queue.
+        const int offset = static_cast<int>(config.redundancy.secondary.port) - config.network.port;
+        std::ostringstream clients;
+        clients << config.network.host << ":" << layer.port << "," << config.redundancy.secondary.host << ":"
+                << layer.port + offset;
+        stream << " ! multiudpsink clients=" << quote(clients.str()) << " sync=false async=false";
+        return;
+    }
     stream << " ! udpsink host=" << quote(config.network.host)
-           << " port=" << config.network.port << " sync=false async=false";
+           << " port=" << layer.port << " sync=false async=false";
 }
 
 }  // namespace
 
+std::string quality_step_caps(const CapturePipelineConfig& config, const QualityStep& step) {
+    std::ostringstream stream;
+    if (config.use_nvenc) {
+        stream << "video/x-raw(memory:NVMM),format=NV12";
+    } else {
+        stream << "video/x-raw";
+    }
+    stream << ",width=" << step.width << ",height=" << step.height << ",framerate=" << step.framerate << "/1";
+    return stream.str();
+}
+
 std::string build_capture_launch(const CapturePipelineConfig& config) {
+    // Leaves at least a few hundred bytes of payload per packet.
+    if (config.mtu < 2 * zerocopy::kRtpMetadataHeadroom) {
+        throw std::invalid_argument("Capture MTU " + std::to_string(config.mtu) +
+                                    " leaves no room next to the RTP metadata extensions");
+    }
     std::ostringstream stream;
     const char* desired_format = config.use_nvenc ? "NV12" : "I420";
 
@@ -68,17 +199,51 @@ std::string build_capture_launch(const CapturePipelineConfig& config) {
         if (config.use_zero_copy) {
             stream << " io-mode=dmabuf";
         }
-        if (!config.use_nvenc) {
+        if (negotiated_source(config)) {
+            append_negotiated_source(stream, config);
+        } else if (!config.use_nvenc) {
             stream << " ! videoconvert";
         }
     }
-    stream << " ! video/x-raw,format=" << desired_format << ",width=" << config.width
+    stream << " ! video/x-raw";
+    if (!negotiated_source(config)) {
+        stream << ",format=" << desired_format;
+    }
+    stream << ",width=" << config.width
            << ",height=" << config.height
            << ",framerate=" << config.framerate << "/1";
-    stream << " ! queue max-size-buffers=" << config.queue_size << " leaky=downstream";
+    if (config.motion_gate.enabled) {
+        // Ahead of every conversion and queue so a skipped frame costs nothing.
+        stream << " ! identity name=" << kMotionGateName << " silent=true";
+    }
+    if (qos_active(config)) {
+        stream << " ! videorate drop-only=true";
+        if (!config.use_nvenc) {
+            stream << " ! videoscale ! capsfilter name=" << kQosCapsName << " caps=\""
+                   << quality_step_caps(config, {config.width, config.height, config.framerate}) << "\"";
+        }
+    }
+    stream << " ! queue name=" << kSourceQueueName << " max-size-buffers=" << config.queue_size
+           << " leaky=downstream";
 
-    append_encoder(stream, config);
-    append_transport(stream, config);
+    const auto layers = effective_layers(config);
+    if (config.layers.empty()) {
+        append_encoder(stream, config, layers.front(), 0);
+        append_transport(stream, config, layers.front(), 0, config.recorder.enabled);
+    } else {
+        // Every layer encodes the same converted frame; only the scale differs.
+        stream << " ! tee name=" << kLayerTee;
+        for (std::size_t index = 0; index < layers.size(); ++index) {
+            stream << " " << kLayerTee << ". ! queue name=" << kEncoderQueue << layer_suffix(index)
+                   << " max-size-buffers=" << config.queue_size
+                   << " leaky=downstream";
+            append_encoder(stream, config, layers[index], index);
+            append_transport(stream, config, layers[index], index, index == 0 && config.recorder.enabled);
+        }
+    }
+    if (config.recorder.enabled) {
+        stream << " " << recorder_branch_launch(config.recorder, kRecorderTee, config.codec);
+    }
     return stream.str();
 }
 
@@ -0,0 +1,220 @@
+#include "gstreamer_worker/pipeline/capture_qos.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include "gstreamer_worker/pipeline/capture_pipeline.hpp"
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+constexpr double kEwmaAlpha = 0.1;
+
+std::vector<QualityStep> build_ladder(const CapturePipelineConfig& config) {
+    std::vector<QualityStep> ladder{{config.width, config.height, config.framerate}};
+    if (!config.qos.ladder.empty()) {
+        ladder.insert(ladder.end(), config.qos.ladder.begin(), config.qos.ladder.end());
+        return ladder;
+    }
+    const std::uint32_t reduced_rate = std::max<std::uint32_t>(config.framerate / 2, 1);
+    ladder.push_back({config.width, config.height, reduced_rate});
+    // Keep dimensions even for 4:2:0 formats.
+    ladder.push_back({(config.width / 2) & ~1U, (config.height / 2) & ~1U, reduced_rate});
+    return ladder;
+}
+
+double pixel_rate(const QualityStep& step) {
+    return static_cast<double>(step.width) * step.height * std::max<std::uint32_t>(step.framerate, 1);
+}
+
+// Everything apply_step needs, copied when the step changes: the call runs
+// later on GStreamer's thread pool and may outlive the controller.
+struct StepRequest {
+    std::string caps;
+    std::size_t step;
+    QualityStep quality;
+};
+
+}  // namespace
+
+CaptureQosController::CaptureQosController(const CapturePipelineConfig& config)
+    : config_(config), ladder_(build_ladder(config)) {}
+
+CaptureQosController::~CaptureQosController() {
+    detach();
+}
+
+bool CaptureQosController::attach(GstElement* pipeline) {
+    if (!pipeline) {
+        return false;
+    }
+    detach();
+
+    capsfilter_ = gst_bin_get_by_name(GST_BIN(pipeline), kQosCapsName);
+    queue_ = gst_bin_get_by_name(GST_BIN(pipeline), kSourceQueueName);
+    GstElement* encoder = gst_bin_get_by_name(GST_BIN(pipeline), kEncoderName);
+    if (encoder) {
+        encoder_sink_ = gst_element_get_static_pad(encoder, "sink");
+        encoder_src_ = gst_element_get_static_pad(encoder, "src");
+        gst_object_unref(encoder);
+    }
+    if (!capsfilter_ || !queue_ || !encoder_sink_ || !encoder_src_) {
+        detach();
+        return false;
+    }
+
+    sink_probe_id_ = gst_pad_add_probe(
+        encoder_sink_, GST_PAD_PROBE_TYPE_BUFFER, &CaptureQosController::encoder_sink_probe, this, nullptr);
+    src_probe_id_ = gst_pad_add_probe(
+        encoder_src_, GST_PAD_PROBE_TYPE_BUFFER, &CaptureQosController::encoder_src_probe, this, nullptr);
+    return true;
+}
+
+void CaptureQosController::detach() {
+    if (encoder_sink_) {
+        if (sink_probe_id_ != 0) {
+            gst_pad_remove_probe(encoder_sink_, sink_probe_id_);
+            sink_probe_id_ = 0;
+        }
+        gst_object_unref(encoder_sink_);
+        encoder_sink_ = nullptr;
+    }
+    if (encoder_src_) {
+        if (src_probe_id_ != 0) {
+            gst_pad_remove_probe(encoder_src_, src_probe_id_);
+            src_probe_id_ = 0;
+        }
+        gst_object_unref(encoder_src_);
+        encoder_src_ = nullptr;
+    }
+    if (queue_) {
+        gst_object_unref(queue_);
+        queue_ = nullptr;
+    }
+    if (capsfilter_) {
+        gst_object_unref(capsfilter_);
+        capsfilter_ = nullptr;
+    }
+}
+
+CaptureQosController::Stats CaptureQosController::stats() const {
+    Stats stats;
+    stats.step = step_.load(std::memory_order_relaxed);
+    stats.current = ladder_[stats.step];
+    stats.encode_ms = encode_ms_.load(std::memory_order_relaxed);
+    stats.queue_level = queue_level_.load(std::memory_order_relaxed);
+    stats.downgrades = downgrades_.load(std::memory_order_relaxed);
+    stats.upgrades = upgrades_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+GstPadProbeReturn CaptureQosController::encoder_sink_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* self = static_cast<CaptureQosController*>(user_data);
+    GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+    if (!self || !buffer) {
+        return GST_PAD_PROBE_OK;
+    }
+    std::lock_guard<std::mutex> lock(self->pending_mutex_);
+    self->pending_[self->pending_next_] = {GST_BUFFER_PTS(buffer), gst_util_get_timestamp()};
+    self->pending_next_ = (self->pending_next_ + 1) % self->pending_.size();
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn CaptureQosController::encoder_src_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* self = static_cast<CaptureQosController*>(user_data);
+    GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+    if (!self || !buffer) {
+        return GST_PAD_PROBE_OK;
+    }
+    self->on_encoded(GST_BUFFER_PTS(buffer));
+    return GST_PAD_PROBE_OK;
+}
+
+void CaptureQosController::on_encoded(GstClockTime pts) {
+    const GstClockTime now = gst_util_get_timestamp();
+    GstClockTime arrival = GST_CLOCK_TIME_NONE;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        for (auto& frame : pending_) {
+            if (frame.pts == pts && GST_CLOCK_TIME_IS_VALID(pts)) {
+                arrival = frame.arrival;
+                frame.pts = GST_CLOCK_TIME_NONE;
+                break;
+            }
+        }
+    }
+    if (!GST_CLOCK_TIME_IS_VALID(arrival)) {
+        return;
+    }
+
+    const double encode_ns = static_cast<double>(now - arrival);
+    encode_ewma_ns_ = encode_ewma_ns_ == 0.0 ? encode_ns : encode_ewma_ns_ + kEwmaAlpha * (encode_ns - encode_ewma_ns_);
+    encode_ms_.store(encode_ewma_ns_ / 1e6, std::memory_order_relaxed);
+
+    guint level = 0;
+    g_object_get(queue_, "current-level-buffers", &level, nullptr);
+    queue_level_.store(level, std::memory_order_relaxed);
+
+    const std::size_t step = step_.load(std::memory_order_relaxed);
+    const QualityStep& current = ladder_[step];
+    const double budget_ns = 1e9 / std::max<std::uint32_t>(current.framerate, 1);
+    const bool queue_backlog = config_.queue_size > 1 && level + 1 >= config_.queue_size;
+    const bool over = encode_ewma_ns_ > config_.qos.overload_ratio * budget_ns || queue_backlog;
+
+    bool under = false;
+    if (step > 0 && level == 0) {
+        // Predict the cost of the next step up from the pixel rate ratio.
+        const QualityStep& previous = ladder_[step - 1];
+        const double predicted_ns = encode_ewma_ns_ * (static_cast<double>(previous.width) * previous.height) /
+                                    (static_cast<double>(current.width) * current.height);
+        const double previous_budget_ns = 1e9 / std::max<std::uint32_t>(previous.framerate, 1);
+        under = predicted_ns < config_.qos.recover_ratio * previous_budget_ns &&
+                pixel_rate(previous) > pixel_rate(current);
+    }
+
+    over_budget_ = over ? over_budget_ + 1 : 0;
+    under_budget_ = under ? under_budget_ + 1 : 0;
+
+    if (over_budget_ >= config_.qos.downgrade_frames && step + 1 < ladder_.size()) {
+        downgrades_.fetch_add(1, std::memory_order_relaxed);
+        change_step(step + 1);
+    } else if (under_budget_ >= config_.qos.upgrade_frames && step > 0) {
+        upgrades_.fetch_add(1, std::memory_order_relaxed);
+        change_step(step - 1);
+    }
+}
+
+void CaptureQosController::change_step(std::size_t step) {
+    step_.store(step, std::memory_order_relaxed);
+    over_budget_ = 0;
+    under_budget_ = 0;
+    encode_ewma_ns_ = 0.0;
+
+    // Renegotiate off the streaming thread; the capsfilter pushes a reconfigure
+    // upstream and videorate/videoscale adapt without restarting the source.
+    auto* request = new StepRequest{quality_step_caps(config_, ladder_[step]), step, ladder_[step]};
+    gst_element_call_async(capsfilter_,
+                           &CaptureQosController::apply_step,
+                           request,
+                           [](gpointer ptr) { delete static_cast<StepRequest*>(ptr); });
+}
+
+void CaptureQosController::apply_step(GstElement* capsfilter, gpointer user_data) {
+    auto* request = static_cast<StepRequest*>(user_data);
+    GstCaps* caps = gst_caps_from_string(request->caps.c_str());
+    g_object_set(capsfilter, "caps", caps, nullptr);
+    gst_caps_unref(caps);
+
+    const QualityStep& quality = request->quality;
+    gst_element_post_message(capsfilter,
+                             gst_message_new_element(GST_OBJECT(capsfilter),
+                                                     gst_structure_new("capture-qos",
+                                                                       "step", G_TYPE_UINT,
+                                                                       static_cast<guint>(request->step),
+                                                                       "width", G_TYPE_UINT, quality.width,
+                                                                       "height", G_TYPE_UINT, quality.height,
+                                                                       "framerate", G_TYPE_UINT, quality.framerate,
+                                                                       nullptr)));
+}
+
+}  // namespace gstreamer_worker::pipeline
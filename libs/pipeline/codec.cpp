@@ -0,0 +1,256 @@
+#include "gstreamer_worker/pipeline/codec.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+constexpr CodecElements kH264{"h264",
+                              "video/x-h264,stream-format=byte-stream,alignment=au",
+                              "H264",
+                              "h264parse",
+                              "rtph264pay",
+                              "rtph264depay",
+                              "nvv4l2h264enc",
+                              true};
+constexpr CodecElements kH265{"h265",
+                              "video/x-h265,stream-format=byte-stream,alignment=au",
+                              "H265",
+                              "h265parse",
+                              "rtph265pay",
+                              "rtph265depay",
+                              "nvv4l2h265enc",
+                              true};
+constexpr CodecElements kAv1{"av1",
+                             "video/x-av1,stream-format=obu-stream,alignment=tu",
+                             "AV1",
+                             "av1parse",
+                             "rtpav1pay",
+                             "rtpav1depay",
+                             "nvv4l2av1enc",
+                             false};
+
+// In order of preference: SVT-AV1 keeps up in real time where libaom needs
+// its fastest presets, and dav1d decodes several times faster than libaom.
+constexpr const char* kH264Encoders[] = {"x264enc"};
+constexpr const char* kH265Encoders[] = {"x265enc"};
+constexpr const char* kAv1Encoders[] = {"svtav1enc", "av1enc"};
+constexpr const char* kH264Decoders[] = {"avdec_h264"};
+constexpr const char* kH265Decoders[] = {"avdec_h265"};
+constexpr const char* kAv1Decoders[] = {"dav1ddec", "av1dec"};
+
+template <std::size_t N>
+const char* preferred(const char* const (&candidates)[N]) {
+    return candidates[0];
+}
+
+template <std::size_t N>
+const char* first_installed(const char* const (&candidates)[N]) {
+    if (N == 1 || !gst_is_initialized()) {
+        return candidates[0];
+    }
+    for (const char* name : candidates) {
+        GstElementFactory* factory = gst_element_factory_find(name);
+        if (factory) {
+            gst_object_unref(factory);
+            return name;
+        }
+    }
+    return candidates[0];
+}
+
+// Intra-refresh streams still need an IDR now and then on NVENC, whose
+// interval properties have no "never".
+constexpr std::uint32_t kIntraRefreshIdrSeconds = 600;
+
+std::uint32_t vbv_milliseconds(const EncoderSettings& settings) {
+    const double ms = settings.low_latency.vbv_frames * 1000.0 / std::max(settings.framerate, 1U);
+    return std::max(1U, static_cast<std::uint32_t>(ms + 0.5));
+}
+
+}  // namespace
+
+const CodecElements& codec_elements(VideoCodec codec) {
+    switch (codec) {
+        case VideoCodec::H265:
+            return kH265;
+        case VideoCodec::AV1:
+            return kAv1;
+        case VideoCodec::H264:
+        default:
+            return kH264;
+    }
+}
+
+VideoCodec parse_codec(std::string_view name) {
+    if (name == "h264") {
+        return VideoCodec::H264;
+    }
+    if (name == "h265" || name == "hevc") {
+        return VideoCodec::H265;
+    }
+    if (name == "av1") {
+        return VideoCodec::AV1;
+    }
+    throw std::invalid_argument("Unknown codec: " + std::string{name} + " (expected h264, h265 or av1)");
+}
+
+const char* codec_name(VideoCodec codec) {
+    return codec_elements(codec).name;
+}
+
+std::optional<VideoCodec> codec_from_caps(const GstCaps* caps) {
+    if (!caps || gst_caps_is_empty(caps)) {
+        return std::nullopt;
+    }
+    const GstStructure* structure = gst_caps_get_structure(caps, 0);
+    if (gst_structure_has_name(structure, "video/x-h264")) {
+        return VideoCodec::H264;
+    }
+    if (gst_structure_has_name(structure, "video/x-h265")) {
+        return VideoCodec::H265;
+    }
+    if (gst_structure_has_name(structure, "video/x-av1")) {
+        return VideoCodec::AV1;
+    }
+    return std::nullopt;
+}
+
+const char* software_encoder_factory(VideoCodec codec) {
+    switch (codec) {
+        case VideoCodec::H265:
+            return preferred(kH265Encoders);
+        case VideoCodec::AV1:
+            return preferred(kAv1Encoders);
+        case VideoCodec::H264:
+        default:
+            return preferred(kH264Encoders);
+    }
+}
+
+const char* software_decoder_factory(VideoCodec codec) {
+    switch (codec) {
+        case VideoCodec::H265:
+            return preferred(kH265Decoders);
+        case VideoCodec::AV1:
+            return preferred(kAv1Decoders);
+        case VideoCodec::H264:
+        default:
+            return preferred(kH264Decoders);
+    }
+}
+
+const char* installed_software_encoder(VideoCodec codec) {
+    switch (codec) {
+        case VideoCodec::H265:
+            return first_installed(kH265Encoders);
+        case VideoCodec::AV1:
+            return first_installed(kAv1Encoders);
+        case VideoCodec::H264:
+        default:
+            return first_installed(kH264Encoders);
+    }
+}
+
+const char* installed_software_decoder(VideoCodec codec) {
+    switch (codec) {
+        case VideoCodec::H265:
+            return first_installed(kH265Decoders);
+        case VideoCodec::AV1:
+            return first_installed(kAv1Decoders);
+        case VideoCodec::H264:
+        default:
+            return first_installed(kH264Decoders);
+    }
+}
+
+std::string software_encoder(VideoCodec codec, const EncoderSettings& settings, std::string_view name) {
+    const std::string factory = settings.factory.empty() ? software_encoder_factory(codec) : settings.factory;
+    const LowLatencyEncoderConfig& low_latency = settings.low_latency;
+    std::ostringstream stream;
+    stream << factory;
+    if (!name.empty()) {
+        stream << " name=" << name;
+    }
+    // Every encoder here takes kbit/s; VBV sizes are in milliseconds unless noted.
+    const std::uint32_t kbps = settings.bitrate / 1000;
+    const std::uint32_t vbv_ms = vbv_milliseconds(settings);
+    if (factory == "x264enc") {
+        stream << " tune=zerolatency speed-preset=superfast bitrate=" << kbps;
+        if (low_latency.enabled) {
+            // With intra-refresh, key-int-max is the refresh cycle and no
+            // periodic IDR is sent.
+            stream << " intra-refresh=true key-int-max=" << low_latency.refresh_frames
+                   << " vbv-buf-capacity=" << vbv_ms << " option-string=slices=" << low_latency.slices;
+        } else {
+            stream << " key-int-max=" << settings.keyframe_interval;
+        }
+        stream << " sliced-threads=true bframes=0";
+    } else if (factory == "x265enc") {
+        stream << " tune=zerolatency speed-preset=superfast bitrate=" << kbps;
+        if (low_latency.enabled) {
+            // x265 takes the VBV in kbit.
+            stream << " key-int-max=" << low_latency.refresh_frames << " option-string=intra-refresh=1:vbv-maxrate="
+                   << kbps << ":vbv-bufsize=" << std::max<std::uint64_t>(1, std::uint64_t{kbps} * vbv_ms / 1000)
+                   << ":slices=" << low_latency.slices;
+        } else {
+            stream << " key-int-max=" << settings.keyframe_interval;
+        }
+    } else if (factory == "svtav1enc") {
+        stream << " preset=10 target-bitrate=" << kbps << " intra-period-length=" << settings.keyframe_interval;
+        if (low_latency.enabled) {
+            stream << " maximum-buffer-size=" << vbv_ms;
+        }
+    } else if (factory == "av1enc") {
+        stream << " usage-profile=realtime cpu-used=8 end-usage=cbr lag-in-frames=0 target-bitrate=" << kbps
+               << " keyframe-max-dist=" << settings.keyframe_interval;
+        if (low_latency.enabled) {
+            stream << " buf-sz=" << vbv_ms << " buf-initial-sz=" << vbv_ms << " buf-optimal-sz=" << vbv_ms;
+        }
+    }
+    return stream.str();
+}
+
+std::string nvidia_encoder(VideoCodec codec, const EncoderSettings& settings, std::string_view name) {
+    const CodecElements& elements = codec_elements(codec);
+    const LowLatencyEncoderConfig& low_latency = settings.low_latency;
+    std::ostringstream stream;
+    stream << elements.nvidia_encoder;
+    if (!name.empty()) {
+        stream << " name=" << name;
+    }
+    stream << " control-rate=1 bitrate=" << settings.bitrate;
+    if (low_latency.enabled && elements.parameter_sets) {
+        // IDRs only at start; intra refresh repairs the picture every cycle.
+        stream << " iframeinterval=" << kIntraRefreshIdrSeconds * std::max(settings.framerate, 1U)
+               << " idrinterval=" << kIntraRefreshIdrSeconds * std::max(settings.framerate, 1U)
+               << " SliceIntraRefreshInterval=" << low_latency.refresh_frames;
+        // vbv-size is in bits.
+        stream << " vbv-size="
+               << static_cast<std::uint64_t>(settings.bitrate * low_latency.vbv_frames /
+                                             std::max(settings.framerate, 1U));
+        const std::uint32_t block = codec == VideoCodec::H265 ? 32 : 16;
+        const std::uint32_t blocks =
+            ((settings.width + block - 1) / block) * ((settings.height + block - 1) / block);
+        const std::uint32_t slices = std::max(low_latency.slices, 1U);
+        stream << " slice-header-spacing=" << (blocks + slices - 1) / slices << " bit-packetization=0";
+    } else {
+        stream << " iframeinterval=" << settings.keyframe_interval;
+    }
+    if (elements.parameter_sets) {
+        stream << " insert-sps-pps=true EnableTwopassCBR=false OutputIniCtrl=0";
+    }
+    return stream.str();
+}
+
+std::string software_decoder(VideoCodec codec, std::string_view factory_name) {
+    const std::string factory{factory_name.empty() ? software_decoder_factory(codec) : factory_name};
+    if (factory.rfind("avdec_", 0) == 0) {
+        return factory + " skip-frame=0";
+    }
+    return factory;
+}
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,307 @@
+#include "gstreamer_worker/pipeline/encoded_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <sstream>
+
+#include "gstreamer_worker/pipeline/bitstream.hpp"
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+constexpr gint64 kShortWindowUs = 100'000;
+constexpr gint64 kLongWindowUs = 1'000'000;
+
+void store_max(std::atomic<guint64>& target, guint64 value) {
+    guint64 current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// lengthSizeMinusOne sits in byte 4 of avcC and byte 21 of hvcC.
+std::size_t nal_length_size(const GstCaps* caps) {
+    if (!caps || gst_caps_is_empty(caps)) {
+        return 0;
+    }
+    const GstStructure* structure = gst_caps_get_structure(caps, 0);
+    const gchar* format = gst_structure_get_string(structure, "stream-format");
+    if (!format || g_strcmp0(format, "byte-stream") == 0 || g_strcmp0(format, "obu-stream") == 0) {
+        return 0;
+    }
+    std::size_t offset = 0;
+    if (g_strcmp0(format, "avc") == 0 || g_strcmp0(format, "avc3") == 0) {
+        offset = 4;
+    } else if (g_strcmp0(format, "hvc1") == 0 || g_strcmp0(format, "hev1") == 0) {
+        offset = 21;
+    } else {
+        return 0;
+    }
+    std::size_t size = 4;
+    const GValue* value = gst_structure_get_value(structure, "codec_data");
+    GstBuffer* codec_data = value ? gst_value_get_buffer(value) : nullptr;
+    GstMapInfo map;
+    if (codec_data && gst_buffer_map(codec_data, &map, GST_MAP_READ)) {
+        if (map.size > offset) {
+            size = (map.data[offset] & 0x03U) + 1;
+        }
+        gst_buffer_unmap(codec_data, &map);
+    }
+    return size;
+}
+
+}  // namespace
+
+void Log2Histogram::add(guint64 value) {
+    const std::size_t bucket = static_cast<std::size_t>(std::bit_width(value));
+    buckets_[std::min(bucket, kBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    store_max(max_, value);
+}
+
+Log2Histogram::Snapshot Log2Histogram::snapshot() const {
+    Snapshot snapshot;
+    for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        snapshot.buckets[bucket] = buckets_[bucket].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+double Log2Histogram::Snapshot::mean() const {
+    return count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+}
+
+guint64 Log2Histogram::Snapshot::quantile(double q) const {
+    guint64 total = 0;
+    for (guint64 bucket : buckets) {
+        total += bucket;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<guint64>(std::clamp(q, 0.0, 1.0) * static_cast<double>(total - 1)) + 1;
+    guint64 seen = 0;
+    for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            const guint64 upper = bucket == 0 ? 0 : (guint64{1} << (bucket)) - 1;
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+void SlidingBitrate::add(gint64 now_us, guint64 bytes) {
+    const gint64 index = now_us / kBinUs;
+    Bin& bin = bins_[static_cast<std::size_t>(index) % kBins];
+    gint64 seen = bin.index.load(std::memory_order_acquire);
+    // The first writer of a new bin period clears what the ring left in it.
+    if (seen != index && bin.index.compare_exchange_strong(seen, index, std::memory_order_acq_rel)) {
+        bin.bytes.store(0, std::memory_order_relaxed);
+    }
+    bin.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+double SlidingBitrate::bitrate(gint64 now_us, gint64 window_us) const {
+    const gint64 bins = std::clamp<gint64>(window_us / kBinUs, 1, static_cast<gint64>(kBins) - 1);
+    const gint64 newest = now_us / kBinUs;
+    guint64 bytes = 0;
+    for (gint64 index = newest - bins + 1; index <= newest; ++index) {
+        const Bin& bin = bins_[static_cast<std::size_t>(index) % kBins];
+        if (bin.index.load(std::memory_order_acquire) == index) {
+            bytes += bin.bytes.load(std::memory_order_relaxed);
+        }
+    }
+    return static_cast<double>(bytes) * 8.0 * 1e6 / static_cast<double>(bins * kBinUs);
+}
+
+EncodedStats::~EncodedStats() {
+    detach();
+}
+
+bool EncodedStats::attach(GstElement* element, VideoCodec codec, GstClock* clock) {
+    if (!element) {
+        return false;
+    }
+    detach();
+    pad_ = gst_element_get_static_pad(element, "src");
+    if (!pad_) {
+        return false;
+    }
+    auto* context = new ProbeContext{this, codec, clock ? static_cast<GstClock*>(gst_object_ref(clock)) : nullptr};
+    // Caps seen before the probe was added still decide the NAL framing.
+    GstCaps* caps = gst_pad_get_current_caps(pad_);
+    if (caps) {
+        context->nal_length_size.store(nal_length_size(caps), std::memory_order_relaxed);
+        gst_caps_unref(caps);
+    }
+    probe_id_ = gst_pad_add_probe(
+        pad_,
+        static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+        &EncodedStats::probe,
+        context,
+        [](gpointer ptr) {
+            auto* context = static_cast<ProbeContext*>(ptr);
+            if (context->clock) {
+                gst_object_unref(context->clock);
+            }
+            delete context;
+        });
+    return true;
+}
+
+void EncodedStats::detach() {
+    if (pad_) {
+        if (probe_id_ != 0) {
+            gst_pad_remove_probe(pad_, probe_id_);
+            probe_id_ = 0;
+        }
+        gst_object_unref(pad_);
+        pad_ = nullptr;
+    }
+}
+
+GstPadProbeReturn EncodedStats::probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* context = static_cast<ProbeContext*>(user_data);
+    if (!context) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        if (GstBuffer* buffer = gst_pad_probe_info_get_buffer(info)) {
+            context->self->record(*context, buffer);
+        }
+    } else if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent* event = gst_pad_probe_info_get_event(info);
+        if (event && GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+            GstCaps* caps = nullptr;
+            gst_event_parse_caps(event, &caps);
+            context->nal_length_size.store(nal_length_size(caps), std::memory_order_relaxed);
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void EncodedStats::record(ProbeContext& context, GstBuffer* buffer) {
+    const gint64 now_us = g_get_monotonic_time();
+    GstMapInfo map;
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        return;
+    }
+    const AccessUnitInfo au = inspect_access_unit(context.codec, map.data, map.size,
+                                                  context.nal_length_size.load(std::memory_order_relaxed));
+    const guint64 size = map.size;
+    gst_buffer_unmap(buffer, &map);
+
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(size, std::memory_order_relaxed);
+    frame_bytes_.add(size);
+    if (au.idr) {
+        idr_.fetch_add(1, std::memory_order_relaxed);
+        keyframe_bytes_.add(size);
+    } else {
+        switch (au.type) {
+            case FrameType::I:
+                i_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case FrameType::P:
+                p_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case FrameType::B:
+                b_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case FrameType::Unknown:
+            default:
+                unknown_.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+    }
+    slices_[std::min<std::size_t>(au.slices, kSliceBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+
+    if (const auto* meta = zerocopy::get_frame_meta(buffer)) {
+        const GstClockTime capture_ts = meta->payload.capture_ts;
+        GstClockTime encode_ts = meta->payload.encode_ts;
+        if (!GST_CLOCK_TIME_IS_VALID(encode_ts)) {
+            encode_ts = context.clock ? gst_clock_get_time(context.clock) : gst_util_get_timestamp();
+        }
+        if (GST_CLOCK_TIME_IS_VALID(capture_ts) && encode_ts >= capture_ts) {
+            encode_us_.add((encode_ts - capture_ts) / GST_USECOND);
+        }
+    }
+
+    bitrate_.add(now_us, size);
+    store_max(peak_100ms_, static_cast<guint64>(bitrate_.bitrate(now_us, kShortWindowUs)));
+    store_max(peak_1s_, static_cast<guint64>(bitrate_.bitrate(now_us, kLongWindowUs)));
+    gint64 expected = 0;
+    first_us_.compare_exchange_strong(expected, now_us, std::memory_order_relaxed);
+    last_us_.store(now_us, std::memory_order_relaxed);
+}
+
+EncodedStats::Snapshot EncodedStats::snapshot() const {
+    Snapshot stats;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.types.idr = idr_.load(std::memory_order_relaxed);
+    stats.types.i = i_.load(std::memory_order_relaxed);
+    stats.types.p = p_.load(std::memory_order_relaxed);
+    stats.types.b = b_.load(std::memory_order_relaxed);
+    stats.types.unknown = unknown_.load(std::memory_order_relaxed);
+    stats.frame_bytes = frame_bytes_.snapshot();
+    stats.keyframe_bytes = keyframe_bytes_.snapshot();
+    stats.encode_us = encode_us_.snapshot();
+    for (std::size_t bucket = 0; bucket < kSliceBuckets; ++bucket) {
+        stats.slices[bucket] = slices_[bucket].load(std::memory_order_relaxed);
+    }
+    const gint64 now_us = g_get_monotonic_time();
+    stats.bitrate_100ms = bitrate_.bitrate(now_us, kShortWindowUs);
+    stats.bitrate_1s = bitrate_.bitrate(now_us, kLongWindowUs);
+    stats.peak_bitrate_100ms = static_cast<double>(peak_100ms_.load(std::memory_order_relaxed));
+    stats.peak_bitrate_1s = static_cast<double>(peak_1s_.load(std::memory_order_relaxed));
+    const gint64 first = first_us_.load(std::memory_order_relaxed);
+    const gint64 last = last_us_.load(std::memory_order_relaxed);
+    if (last > first) {
+        stats.mean_bitrate =
+            static_cast<double>(bytes_.load(std::memory_order_relaxed)) * 8.0 * 1e6 / static_cast<double>(last - first);
+    }
+    return stats;
+}
+
+std::string format_encoded_stats(const EncodedStats::Snapshot& stats) {
+    std::ostringstream out;
+    out << "Encoded frames: " << stats.frames << " (" << stats.types.idr << " IDR, " << stats.types.i << " I, "
+        << stats.types.p << " P, " << stats.types.b << " B";
+    if (stats.types.unknown > 0) {
+        out << ", " << stats.types.unknown << " unparsed";
+    }
+    out << ")\n";
+    const auto& sizes = stats.frame_bytes;
+    out << "  size: mean " << static_cast<guint64>(sizes.mean()) << " B, p50 <= " << sizes.quantile(0.5)
+        << " B, p99 <= " << sizes.quantile(0.99) << " B, max " << sizes.max << " B\n";
+    if (stats.keyframe_bytes.count > 0) {
+        out << "  keyframes: mean " << static_cast<guint64>(stats.keyframe_bytes.mean()) << " B, max "
+            << stats.keyframe_bytes.max << " B\n";
+    }
+    out << "  slices:";
+    for (std::size_t bucket = 1; bucket < stats.slices.size(); ++bucket) {
+        if (stats.slices[bucket] > 0) {
+            out << " " << bucket << (bucket + 1 == stats.slices.size() ? "+" : "") << "=" << stats.slices[bucket];
+        }
+    }
+    out << "\n";
+    if (stats.encode_us.count > 0) {
+        out << "  encode: mean " << stats.encode_us.mean() / 1000.0 << " ms, p99 <= "
+            << static_cast<double>(stats.encode_us.quantile(0.99)) / 1000.0 << " ms, max "
+            << static_cast<double>(stats.encode_us.max) / 1000.0 << " ms\n";
+    }
+    // Peak over the short window against the mean is the burst headroom the
+    // link (and FEC on top of it) has to carry.
+    out << "  bitrate: mean " << stats.mean_bitrate / 1000.0 << " kbit/s, now " << stats.bitrate_100ms / 1000.0
+        << " (100 ms) / " << stats.bitrate_1s / 1000.0 << " (1 s) kbit/s, peak "
+        << stats.peak_bitrate_100ms / 1000.0 << " (100 ms) / " << stats.peak_bitrate_1s / 1000.0
+        << " (1 s) kbit/s";
+    return out.str();
+}
+
+}  // namespace gstreamer_worker::pipeline
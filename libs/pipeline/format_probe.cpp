@@ -0,0 +1,363 @@
+#include "gstreamer_worker/pipeline/format_probe.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/codec.hpp"
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+// Relative costs per pixel. Hardware stages are nearly free for the CPU; a
+// software colour conversion is the unit, and software JPEG decoding is the
+// most expensive path.
+constexpr double kHardwareConvertCost = 0.05;
+constexpr double kHardwareJpegCost = 0.1;
+constexpr double kSoftwareConvertCost = 1.0;
+constexpr double kSoftwareJpegCost = 2.5;
+
+constexpr const char* kHardwareJpegDecoders[] = {"nvjpegdec", "v4l2jpegdec", "vaapijpegdec"};
+
+// 4:2:0 layouts, in order of preference. Software encoders also take 4:2:2 and
+// 4:4:4 input, but would then encode High 4:2:2/4:4:4 profiles that the
+// viewers' decoders (and most others) cannot play, so every other raw format
+// is converted first.
+constexpr const char* kEncodeFormats[] = {"I420", "NV12"};
+
+bool is_encode_format(const std::string& format) {
+    return std::any_of(std::begin(kEncodeFormats), std::end(kEncodeFormats),
+                       [&format](const char* name) { return format == name; });
+}
+
+std::string mode_caps(const SourceFormat& source, const CapturePipelineConfig& config) {
+    std::ostringstream stream;
+    stream << source.media;
+    if (!source.format.empty()) {
+        stream << ",format=" << source.format;
+    }
+    stream << ",width=" << config.width << ",height=" << config.height << ",framerate=" << config.framerate
+           << "/1";
+    return stream.str();
+}
+
+std::vector<std::string> structure_formats(const GstStructure* structure) {
+    std::vector<std::string> formats;
+    const GValue* value = gst_structure_get_value(structure, "format");
+    if (!value) {
+        return formats;
+    }
+    if (G_VALUE_HOLDS_STRING(value)) {
+        formats.emplace_back(g_value_get_string(value));
+    } else if (GST_VALUE_HOLDS_LIST(value)) {
+        for (guint index = 0; index < gst_value_list_get_size(value); ++index) {
+            const GValue* item = gst_value_list_get_value(value, index);
+            if (G_VALUE_HOLDS_STRING(item)) {
+                formats.emplace_back(g_value_get_string(item));
+            }
+        }
+    }
+    return formats;
+}
+
+bool factory_exists(const char* name) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) {
+        return false;
+    }
+    gst_object_unref(factory);
+    return true;
+}
+
+bool factory_accepts(const char* name, const std::string& caps_string) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) {
+        return false;
+    }
+    GstCaps* caps = gst_caps_from_string(caps_string.c_str());
+    const bool accepted = caps && gst_element_factory_can_sink_any_caps(factory, caps);
+    if (caps) {
+        gst_caps_unref(caps);
+    }
+    gst_object_unref(factory);
+    return accepted;
+}
+
+// The element that receives camera frames in system memory: nvvidconv on NVENC
+// builds (hardware conversion), the encoder itself otherwise.
+const char* raw_sink_element(const CapturePipelineConfig& config) {
+    if (config.use_nvenc) {
+        return "nvvidconv";
+    }
+    return config.encoder.empty() ? software_encoder_factory(config.codec) : config.encoder.c_str();
+}
+
+// True when the only raw format `name` can produce is `format`, so its output
+// needs no conversion to be pinned to it.
+bool factory_only_outputs(const char* name, const std::string& format) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) {
+        return false;
+    }
+    GstCaps* wanted = gst_caps_from_string(("video/x-raw,format=" + format).c_str());
+    bool only = false;
+    for (const GList* item = gst_element_factory_get_static_pad_templates(factory); item; item = item->next) {
+        auto* pad_template = static_cast<GstStaticPadTemplate*>(item->data);
+        if (pad_template->direction != GST_PAD_SRC) {
+            continue;
+        }
+        GstCaps* caps = gst_static_pad_template_get_caps(pad_template);
+        only = wanted && gst_caps_is_subset(caps, wanted);
+        gst_caps_unref(caps);
+        break;
+    }
+    if (wanted) {
+        gst_caps_unref(wanted);
+    }
+    gst_object_unref(factory);
+    return only;
+}
+
+// The first 4:2:0 layout `sink` accepts; empty when it takes neither.
+std::string encode_format(const char* sink) {
+    for (const char* format : kEncodeFormats) {
+        if (factory_accepts(sink, std::string{"video/x-raw,format="} + format)) {
+            return format;
+        }
+    }
+    return {};
+}
+
+// Pins the output to `format` when set, so videoconvert cannot pick a 4:2:2
+// or 4:4:4 layout the encoder also accepts.
+std::string software_converter(const std::string& format) {
+    const unsigned threads = std::clamp(std::thread::hardware_concurrency(), 1U, 4U);
+    std::string converter = "videoconvert n-threads=" + std::to_string(threads);
+    if (!format.empty()) {
+        converter += " ! video/x-raw,format=" + format;
+    }
+    return converter;
+}
+
+std::string cache_key(const CapturePipelineConfig& config) {
+    std::ostringstream stream;
+    stream << config.device << '|' << config.width << 'x' << config.height << '@' << config.framerate << '|'
+           << (config.use_nvenc ? "nvenc" : raw_sink_element(config));
+    return stream.str();
+}
+
+std::string describe(const SourceFormat& source) {
+    std::string text = source.format.empty() ? source.media : source.format;
+    if (!source.decoder.empty()) {
+        text += " via " + source.decoder;
+    }
+    if (!source.converter.empty()) {
+        text += " + " + source.converter;
+    }
+    return text;
+}
+
+std::mutex& cache_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::map<std::string, SourceFormat>& memory_cache() {
+    static std::map<std::string, SourceFormat> cache;
+    return cache;
+}
+
+std::optional<SourceFormat> load_cached(const std::string& cache_path, const std::string& key) {
+    if (cache_path.empty()) {
+        return std::nullopt;
+    }
+    GKeyFile* file = g_key_file_new();
+    std::optional<SourceFormat> result;
+    if (g_key_file_load_from_file(file, cache_path.c_str(), G_KEY_FILE_NONE, nullptr) &&
+        g_key_file_has_group(file, key.c_str())) {
+        SourceFormat source;
+        auto read = [&](const char* name, std::string& target) {
+            gchar* value = g_key_file_get_string(file, key.c_str(), name, nullptr);
+            if (value) {
+                target = value;
+                g_free(value);
+            }
+        };
+        read("media", source.media);
+        read("format", source.format);
+        read("decoder", source.decoder);
+        read("converter", source.converter);
+        if (!source.media.empty()) {
+            result = source;
+        }
+    }
+    g_key_file_free(file);
+    return result;
+}
+
+void store_cached(const std::string& cache_path, const std::string& key, const SourceFormat& source) {
+    if (cache_path.empty()) {
+        return;
+    }
+    GKeyFile* file = g_key_file_new();
+    g_key_file_load_from_file(file, cache_path.c_str(), G_KEY_FILE_NONE, nullptr);
+    g_key_file_set_string(file, key.c_str(), "media", source.media.c_str());
+    g_key_file_set_string(file, key.c_str(), "format", source.format.c_str());
+    g_key_file_set_string(file, key.c_str(), "decoder", source.decoder.c_str());
+    g_key_file_set_string(file, key.c_str(), "converter", source.converter.c_str());
+    GError* error = nullptr;
+    if (!g_key_file_save_to_file(file, cache_path.c_str(), &error)) {
+        g_printerr("Unable to write format cache %s: %s\n", cache_path.c_str(), error ? error->message : "unknown");
+        if (error) {
+            g_error_free(error);
+        }
+    }
+    g_key_file_free(file);
+}
+
+}  // namespace
+
+std::vector<SourceFormat> probe_camera_formats(const CapturePipelineConfig& config) {
+    std::vector<SourceFormat> formats;
+    GstElement* source = gst_element_factory_make("v4l2src", nullptr);
+    if (!source) {
+        return formats;
+    }
+    g_object_set(source, "device", config.device.c_str(), nullptr);
+    if (gst_element_set_state(source, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+        gst_element_set_state(source, GST_STATE_NULL);
+        gst_object_unref(source);
+        return formats;
+    }
+
+    GstPad* pad = gst_element_get_static_pad(source, "src");
+    GstCaps* device_caps = pad ? gst_pad_query_caps(pad, nullptr) : nullptr;
+    if (device_caps) {
+        for (guint index = 0; index < gst_caps_get_size(device_caps); ++index) {
+            const GstStructure* structure = gst_caps_get_structure(device_caps, index);
+            std::vector<std::string> raw_formats;
+            SourceFormat candidate;
+            candidate.media = gst_structure_get_name(structure);
+            if (candidate.media == "video/x-raw") {
+                raw_formats = structure_formats(structure);
+            } else if (candidate.media == "image/jpeg") {
+                raw_formats.emplace_back();
+            }
+            for (const auto& format : raw_formats) {
+                candidate.format = format;
+                const bool known = std::any_of(formats.begin(), formats.end(), [&](const SourceFormat& other) {
+                    return other.media == candidate.media && other.format == candidate.format;
+                });
+                if (known) {
+                    continue;
+                }
+                GstCaps* mode = gst_caps_from_string(mode_caps(candidate, config).c_str());
+                if (mode && gst_caps_can_intersect(mode, device_caps)) {
+                    formats.push_back(candidate);
+                }
+                if (mode) {
+                    gst_caps_unref(mode);
+                }
+            }
+        }
+        gst_caps_unref(device_caps);
+    }
+    if (pad) {
+        gst_object_unref(pad);
+    }
+    gst_element_set_state(source, GST_STATE_NULL);
+    gst_object_unref(source);
+    return formats;
+}
+
+std::vector<FormatCandidate> rank_source_formats(const std::vector<SourceFormat>& camera,
+                                                 const CapturePipelineConfig& config) {
+    const char* sink = raw_sink_element(config);
+    const double direct_cost = config.use_nvenc ? kHardwareConvertCost : 0.0;
+    const std::string target = encode_format(sink);
+    std::vector<FormatCandidate> candidates;
+
+    for (const auto& source : camera) {
+        FormatCandidate candidate;
+        candidate.source = source;
+        if (source.media == "image/jpeg") {
+            const char* decoder = "jpegdec";
+            candidate.cost = kSoftwareJpegCost;
+            for (const char* hardware : kHardwareJpegDecoders) {
+                if (factory_exists(hardware)) {
+                    decoder = hardware;
+                    candidate.cost = kHardwareJpegCost;
+                    break;
+                }
+            }
+            if (!factory_exists(decoder)) {
+                continue;
+            }
+            candidate.source.decoder = decoder;
+            // Most UVC cameras send 4:2:2 MJPEG, which decodes to Y42B or YUY2,
+            // so the decoded frames are pinned to the encoder's layout too.
+            if (!target.empty() && factory_only_outputs(decoder, target)) {
+                candidate.source.converter = "video/x-raw,format=" + target;
+            } else {
+                candidate.source.converter = software_converter(target);
+                candidate.cost += kSoftwareConvertCost;
+            }
+            candidate.cost += direct_cost;
+        } else if ((config.use_nvenc || is_encode_format(source.format)) &&
+                   factory_accepts(sink, "video/x-raw,format=" + source.format)) {
+            // nvvidconv turns any format it accepts into NV12 in hardware.
+            candidate.cost = direct_cost;
+        } else {
+            candidate.source.converter = software_converter(target);
+            candidate.cost = kSoftwareConvertCost + direct_cost;
+        }
+        candidates.push_back(candidate);
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const FormatCandidate& a, const FormatCandidate& b) {
+        return a.cost < b.cost;
+    });
+    return candidates;
+}
+
+std::optional<SourceFormat> negotiate_source_format(const CapturePipelineConfig& config,
+                                                    const std::string& cache_path) {
+    if (config.use_test_pattern) {
+        return std::nullopt;
+    }
+    const std::string key = cache_key(config);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex());
+        auto found = memory_cache().find(key);
+        if (found != memory_cache().end()) {
+            return found->second;
+        }
+        if (auto cached = load_cached(cache_path, key)) {
+            g_print("Source format for %s (cached): %s\n", config.device.c_str(), describe(*cached).c_str());
+            memory_cache()[key] = *cached;
+            return cached;
+        }
+    }
+
+    const auto candidates = rank_source_formats(probe_camera_formats(config), config);
+    if (candidates.empty()) {
+        g_printerr("Source format probe for %s found no mode for %ux%u@%u\n", config.device.c_str(), config.width,
+                   config.height, config.framerate);
+        return std::nullopt;
+    }
+
+    const FormatCandidate& best = candidates.front();
+    g_print("Source format for %s: %s (cost %.2f, %zu candidates)\n", config.device.c_str(),
+            describe(best.source).c_str(), best.cost, candidates.size());
+
+    std::lock_guard<std::mutex> lock(cache_mutex());
+    memory_cache()[key] = best.source;
+    store_cached(cache_path, key, best.source);
+    return best.source;
+}
+
+}  // namespace gstreamer_worker::pipeline
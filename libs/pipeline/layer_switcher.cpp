@@ -0,0 +1,95 @@
+#include "gstreamer_worker/pipeline/layer_switcher.hpp"
+
+#include <string>
+
+namespace gstreamer_worker::pipeline {
+
+LayerSwitcher::~LayerSwitcher() {
+    detach();
+}
+
+bool LayerSwitcher::attach(GstElement* pipeline, const ViewerPipelineConfig& config) {
+    if (!pipeline || config.layer_ports.empty()) {
+        return false;
+    }
+    detach();
+
+    selector_ = gst_bin_get_by_name(GST_BIN(pipeline), kLayerSelectorName);
+    if (!selector_) {
+        return false;
+    }
+    for (std::size_t index = 0; index < config.layer_ports.size(); ++index) {
+        const std::string name = "sink_" + std::to_string(index);
+        GstPad* pad = gst_element_get_static_pad(selector_, name.c_str());
+        if (!pad) {
+            detach();
+            return false;
+        }
+        pads_.push_back(pad);
+        probe_ids_.push_back(gst_pad_add_probe(pad,
+                                               GST_PAD_PROBE_TYPE_BUFFER,
+                                               &LayerSwitcher::keyframe_probe,
+                                               new ProbeContext{this, index},
+                                               [](gpointer ptr) {
+                                                   delete static_cast<ProbeContext*>(ptr);
+                                               }));
+    }
+
+    const std::size_t initial = config.initial_layer < pads_.size() ? config.initial_layer : 0;
+    g_object_set(selector_, "active-pad", pads_[initial], nullptr);
+    active_.store(initial, std::memory_order_relaxed);
+    return true;
+}
+
+void LayerSwitcher::detach() {
+    for (std::size_t index = 0; index < pads_.size(); ++index) {
+        if (index < probe_ids_.size() && probe_ids_[index] != 0) {
+            gst_pad_remove_probe(pads_[index], probe_ids_[index]);
+        }
+        gst_object_unref(pads_[index]);
+    }
+    pads_.clear();
+    probe_ids_.clear();
+    pending_.store(-1, std::memory_order_relaxed);
+    if (selector_) {
+        gst_object_unref(selector_);
+        selector_ = nullptr;
+    }
+}
+
+void LayerSwitcher::request_layer(std::size_t index) {
+    if (index >= pads_.size()) {
+        return;
+    }
+    if (index == active_.load(std::memory_order_relaxed)) {
+        pending_.store(-1, std::memory_order_relaxed);
+        return;
+    }
+    pending_.store(static_cast<long>(index), std::memory_order_release);
+}
+
+GstPadProbeReturn LayerSwitcher::keyframe_probe(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    auto* context = static_cast<ProbeContext*>(user_data);
+    if (!context || !(info->type & GST_PAD_PROBE_TYPE_BUFFER)) {
+        return GST_PAD_PROBE_OK;
+    }
+    LayerSwitcher* self = context->self;
+    if (self->pending_.load(std::memory_order_acquire) != static_cast<long>(context->index)) {
+        return GST_PAD_PROBE_OK;
+    }
+    GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+    if (!buffer || GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    // Switch before the selector sees this IDR so it is the first buffer the
+    // decoder receives from the new layer.
+    long expected = static_cast<long>(context->index);
+    if (self->pending_.compare_exchange_strong(expected, -1, std::memory_order_acq_rel)) {
+        g_object_set(self->selector_, "active-pad", pad, nullptr);
+        self->active_.store(context->index, std::memory_order_relaxed);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+}  // namespace gstreamer_worker::pipeline
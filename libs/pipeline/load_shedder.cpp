@@ -0,0 +1,117 @@
+#include "gstreamer_worker/pipeline/load_shedder.hpp"
+
+#include "gstreamer_worker/pipeline/bitstream.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+LoadShedder::~LoadShedder() {
+    detach();
+}
+
+bool LoadShedder::attach(GstElement* pipeline, const LoadSheddingConfig& config, VideoCodec codec) {
+    if (!pipeline) {
+        return false;
+    }
+    detach();
+    config_ = config;
+    codec_ = codec;
+
+    queue_ = gst_bin_get_by_name(GST_BIN(pipeline), kDecodeQueueName);
+    if (!queue_) {
+        return false;
+    }
+    sink_pad_ = gst_element_get_static_pad(queue_, "sink");
+    if (!sink_pad_) {
+        detach();
+        return false;
+    }
+    buffer_probe_id_ =
+        gst_pad_add_probe(sink_pad_, GST_PAD_PROBE_TYPE_BUFFER, &LoadShedder::buffer_probe, this, nullptr);
+    return true;
+}
+
+void LoadShedder::detach() {
+    if (sink_pad_) {
+        if (buffer_probe_id_ != 0) {
+            gst_pad_remove_probe(sink_pad_, buffer_probe_id_);
+            buffer_probe_id_ = 0;
+        }
+        gst_object_unref(sink_pad_);
+        sink_pad_ = nullptr;
+    }
+    if (queue_) {
+        gst_object_unref(queue_);
+        queue_ = nullptr;
+    }
+    skipping_gop_ = false;
+}
+
+LoadShedder::Stats LoadShedder::stats() const {
+    Stats stats;
+    stats.passed = passed_.load(std::memory_order_relaxed);
+    stats.shed_non_reference = shed_non_reference_.load(std::memory_order_relaxed);
+    stats.shed_gop_frames = shed_gop_frames_.load(std::memory_order_relaxed);
+    stats.gop_skips = gop_skips_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+GstPadProbeReturn LoadShedder::buffer_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* self = static_cast<LoadShedder*>(user_data);
+    if (!self || !(info->type & GST_PAD_PROBE_TYPE_BUFFER)) {
+        return GST_PAD_PROBE_OK;
+    }
+    GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+    if (!buffer) {
+        return GST_PAD_PROBE_OK;
+    }
+    return self->on_buffer(buffer);
+}
+
+GstPadProbeReturn LoadShedder::on_buffer(GstBuffer* buffer) {
+    GstMapInfo map;
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        return GST_PAD_PROBE_OK;
+    }
+    const AccessUnitInfo au = inspect_access_unit(codec_, map.data, map.size);
+    gst_buffer_unmap(buffer, &map);
+
+    if (au.slices == 0) {
+        // Parameter sets or SEI on their own; the decoder always needs them.
+        return GST_PAD_PROBE_OK;
+    }
+    if (au.idr || au.recovery_point || au.cra) {
+        // Intra-refresh streams have no IDRs to wait for; the recovery point
+        // starts a refresh cycle that repairs what was skipped.
+        skipping_rasl_ = skipping_gop_ && au.cra;
+        skipping_gop_ = false;
+        passed_.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_OK;
+    }
+    // Leading pictures directly follow their CRA in decode order, RASL and
+    // RADL possibly interleaved; the first trailing picture ends them.
+    skipping_rasl_ = skipping_rasl_ && au.leading;
+    if (skipping_gop_ || (skipping_rasl_ && au.rasl)) {
+        shed_gop_frames_.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_DROP;
+    }
+
+    guint level = 0;
+    g_object_get(queue_, "current-level-buffers", &level, nullptr);
+
+    if (level >= config_.gop_level && au.reference) {
+        // Dropping a reference frame invalidates the rest of the GOP, so
+        // everything up to the next IDR goes with it.
+        skipping_gop_ = true;
+        gop_skips_.fetch_add(1, std::memory_order_relaxed);
+        shed_gop_frames_.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_DROP;
+    }
+    if (!au.reference && level >= config_.non_reference_level) {
+        shed_non_reference_.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_DROP;
+    }
+    passed_.fetch_add(1, std::memory_order_relaxed);
+    return GST_PAD_PROBE_OK;
+}
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,457 @@
+#include "gstreamer_worker/pipeline/mosaic_compositor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <gst/allocators/gstfdmemory.h>
+#include <gst/app/gstappsink.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "gstreamer_worker/preprocess/nv12_preprocess.hpp"
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+// Limited-range black for tiles that have not received a frame yet.
+constexpr std::uint8_t kBlackLuma = 16;
+constexpr std::uint8_t kNeutralChroma = 128;
+
+// Scales the decoded NV12 or I420 frame in `sample` into `target`; false when
+// the sample is not mappable in either layout.
+bool scale_into(GstSample* sample, const preprocess::Nv12Target& target) {
+    GstCaps* caps = gst_sample_get_caps(sample);
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstVideoInfo info;
+    if (!caps || !buffer || !gst_video_info_from_caps(&info, caps)) {
+        return false;
+    }
+    const GstVideoFormat format = GST_VIDEO_INFO_FORMAT(&info);
+    if (format != GST_VIDEO_FORMAT_NV12 && format != GST_VIDEO_FORMAT_I420) {
+        return false;
+    }
+    GstVideoFrame frame;
+    if (!gst_video_frame_map(&frame, &info, buffer, GST_MAP_READ)) {
+        return false;
+    }
+    preprocess::Nv12Image image;
+    image.y = static_cast<const std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0));
+    image.uv = static_cast<const std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 1));
+    image.y_stride = static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0));
+    image.uv_stride = static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 1));
+    if (format == GST_VIDEO_FORMAT_I420) {
+        image.v = static_cast<const std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 2));
+        image.v_stride = static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 2));
+    }
+    image.width = static_cast<std::uint32_t>(GST_VIDEO_INFO_WIDTH(&info));
+    image.height = static_cast<std::uint32_t>(GST_VIDEO_INFO_HEIGHT(&info));
+    bool ok = true;
+    try {
+        preprocess::nv12_scale(image, target);
+    } catch (const std::exception& ex) {
+        std::cerr << "Mosaic scale failed: " << ex.what() << '\n';
+        ok = false;
+    }
+    gst_video_frame_unmap(&frame);
+    return ok;
+}
+
+}  // namespace
+
+std::string mosaic_sink_name(std::size_t index) {
+    return std::string{kMosaicSinkName} + (index == 0 ? std::string{} : "_" + std::to_string(index));
+}
+
+std::vector<MosaicTile> mosaic_layout(const MosaicConfig& config) {
+    const auto count = static_cast<std::uint32_t>(config.ports.size());
+    if (count == 0) {
+        throw std::invalid_argument("Mosaic needs at least one port");
+    }
+    std::uint32_t columns = config.columns;
+    if (columns == 0) {
+        while (columns * columns < count) {
+            ++columns;
+        }
+    }
+    const std::uint32_t rows = (count + columns - 1) / columns;
+    // Even sizes keep every tile on whole chroma sites.
+    const std::uint32_t tile_width = (config.width / columns) & ~1U;
+    const std::uint32_t tile_height = (config.height / rows) & ~1U;
+    if (config.width % 2 != 0 || config.height % 2 != 0) {
+        throw std::invalid_argument("Mosaic width and height must be even");
+    }
+    if (tile_width < 2 || tile_height < 2) {
+        throw std::invalid_argument("Mosaic is too small for " + std::to_string(count) + " tiles");
+    }
+    std::vector<MosaicTile> tiles;
+    tiles.reserve(count);
+    for (std::uint32_t index = 0; index < count; ++index) {
+        tiles.push_back(MosaicTile{(index % columns) * tile_width, (index / columns) * tile_height, tile_width,
+                                   tile_height});
+    }
+    return tiles;
+}
+
+MosaicCompositor::~MosaicCompositor() {
+    detach();
+}
+
+bool MosaicCompositor::attach(GstElement* pipeline,
+                              const MosaicConfig& config,
+                              const zerocopy::BufferExporter* exporter) {
+    if (!pipeline || !config.enabled || !exporter) {
+        return false;
+    }
+    detach();
+
+    std::vector<MosaicTile> layout;
+    try {
+        layout = mosaic_layout(config);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << '\n';
+        return false;
+    }
+
+    framerate_ = std::max(config.framerate, 1U);
+    stale_us_ = static_cast<gint64>(config.stale_ms) * 1000;
+    gst_video_info_set_format(&info_, GST_VIDEO_FORMAT_NV12, config.width, config.height);
+    GST_VIDEO_INFO_FPS_N(&info_) = static_cast<gint>(framerate_);
+    GST_VIDEO_INFO_FPS_D(&info_) = 1;
+    caps_ = gst_video_info_to_caps(&info_);
+#if defined(__linux__)
+    allocator_ = gst_fd_allocator_new();
+#endif
+
+    for (std::size_t index = 0; index < layout.size(); ++index) {
+        auto tile = std::make_unique<Tile>();
+        tile->rect = layout[index];
+        tile->port = config.ports[index];
+        if (index < config.decimation.size() && config.decimation[index] > 0) {
+            tile->decimation = config.decimation[index];
+        }
+        tile->sink = gst_bin_get_by_name(GST_BIN(pipeline), mosaic_sink_name(index).c_str());
+        tiles_.push_back(std::move(tile));
+        if (!tiles_.back()->sink) {
+            std::cerr << "Unable to find mosaic sink " << mosaic_sink_name(index) << '\n';
+            detach();
+            return false;
+        }
+    }
+    for (std::size_t index = 0; index < kInitialOutputFrames; ++index) {
+        if (!add_output()) {
+            detach();
+            return false;
+        }
+    }
+    exported_generations_.assign(tiles_.size(), 0);
+
+    exporter_ = exporter;
+    for (const auto& tile : tiles_) {
+        tile->handler = g_signal_connect(tile->sink, "new-sample", G_CALLBACK(on_new_sample), tile.get());
+    }
+    return true;
+}
+
+GstBuffer* MosaicCompositor::allocate_output() const {
+    const gsize size = GST_VIDEO_INFO_SIZE(&info_);
+    GstBuffer* buffer = nullptr;
+#if defined(__linux__)
+    // A memfd gives the exported frame an fd that any process can mmap.
+    if (allocator_) {
+        const int fd = memfd_create("mosaic", MFD_CLOEXEC);
+        GstMemory* memory = nullptr;
+        if (fd >= 0 && ftruncate(fd, static_cast<off_t>(size)) == 0) {
+            memory = gst_fd_allocator_alloc(allocator_, fd, size, GST_FD_MEMORY_FLAG_KEEP_MAPPED);
+        }
+        if (memory) {
+            buffer = gst_buffer_new();
+            gst_buffer_append_memory(buffer, memory);
+        } else if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+    if (!buffer) {
+        // Exported without an fd; consumers map the sample instead.
+        buffer = gst_buffer_new_allocate(nullptr, size, nullptr);
+    }
+    if (!buffer) {
+        return nullptr;
+    }
+    gst_buffer_add_video_meta_full(buffer, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_FORMAT_NV12,
+                                   GST_VIDEO_INFO_WIDTH(&info_), GST_VIDEO_INFO_HEIGHT(&info_), 2, info_.offset,
+                                   info_.stride);
+    GstMapInfo map;
+    if (gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
+        const std::size_t chroma = GST_VIDEO_INFO_PLANE_OFFSET(&info_, 1);
+        std::memset(map.data, kBlackLuma, chroma);
+        std::memset(map.data + chroma, kNeutralChroma, map.size - chroma);
+        gst_buffer_unmap(buffer, &map);
+    }
+    return buffer;
+}
+
+bool MosaicCompositor::add_output() {
+    Output output;
+    output.buffer = allocate_output();
+    if (!output.buffer) {
+        return false;
+    }
+    output.generations.assign(tiles_.size(), 0);
+    outputs_.push_back(std::move(output));
+    output_frames_.store(outputs_.size(), std::memory_order_relaxed);
+    return true;
+}
+
+// The frame exported longest ago among those no consumer references any more;
+// it only needs the tiles that changed since then. A new frame when all are
+// held, or nullptr at the bound.
+MosaicCompositor::Output* MosaicCompositor::acquire_output() {
+    Output* oldest = nullptr;
+    for (Output& output : outputs_) {
+        if (!gst_buffer_is_writable(output.buffer) || !gst_buffer_is_all_memory_writable(output.buffer)) {
+            continue;
+        }
+        if (!oldest || output.exported < oldest->exported) {
+            oldest = &output;
+        }
+    }
+    if (oldest || outputs_.size() >= kMaxOutputFrames || !add_output()) {
+        return oldest;
+    }
+    return &outputs_.back();
+}
+
+GstFlowReturn MosaicCompositor::on_new_sample(GstAppSink* sink, gpointer user_data) {
+    auto* tile = static_cast<Tile*>(user_data);
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) {
+        return GST_FLOW_ERROR;
+    }
+    const guint64 index = tile->received.fetch_add(1, std::memory_order_relaxed);
+    if (index % tile->decimation != 0) {
+        tile->decimated.fetch_add(1, std::memory_order_relaxed);
+        gst_sample_unref(sample);
+        return GST_FLOW_OK;
+    }
+    // Only a reference is kept; the composer scales from the decoder's buffer.
+    tile->last_us.store(g_get_monotonic_time(), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(tile->mutex);
+        std::swap(tile->latest, sample);
+        ++tile->generation;
+    }
+    if (sample) {
+        gst_sample_unref(sample);
+    }
+    return GST_FLOW_OK;
+}
+
+bool MosaicCompositor::start() {
+    if (tiles_.empty() || thread_.joinable()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void MosaicCompositor::update_staleness(gint64 now) {
+    for (std::size_t index = 0; index < tiles_.size(); ++index) {
+        Tile& tile = *tiles_[index];
+        const gint64 last = tile.last_us.load(std::memory_order_relaxed);
+        const bool stale = last == 0 || now - last > stale_us_;
+        if (stale == tile.stale.exchange(stale, std::memory_order_relaxed) || last == 0) {
+            continue;
+        }
+        if (stale) {
+            tile.stalls.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "Mosaic tile " << index << " (port " << tile.port << ") stale: no frame for "
+                      << (now - last) / 1000 << " ms\n";
+        } else {
+            std::cerr << "Mosaic tile " << index << " (port " << tile.port << ") live again\n";
+        }
+    }
+}
+
+void MosaicCompositor::compose(Output& output) {
+    GstMapInfo map;
+    if (!gst_buffer_map(output.buffer, &map, GST_MAP_WRITE)) {
+        return;
+    }
+    const std::size_t offsets[2] = {GST_VIDEO_INFO_PLANE_OFFSET(&info_, 0), GST_VIDEO_INFO_PLANE_OFFSET(&info_, 1)};
+    const std::size_t strides[2] = {static_cast<std::size_t>(GST_VIDEO_INFO_PLANE_STRIDE(&info_, 0)),
+                                    static_cast<std::size_t>(GST_VIDEO_INFO_PLANE_STRIDE(&info_, 1))};
+    const auto width = static_cast<std::uint32_t>(GST_VIDEO_INFO_WIDTH(&info_));
+    const auto height = static_cast<std::uint32_t>(GST_VIDEO_INFO_HEIGHT(&info_));
+    for (std::size_t index = 0; index < tiles_.size(); ++index) {
+        Tile& tile = *tiles_[index];
+        GstSample* sample = nullptr;
+        guint64 generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(tile.mutex);
+            generation = tile.generation;
+            if (generation != output.generations[index] && tile.latest) {
+                sample = gst_sample_ref(tile.latest);
+            }
+        }
+        if (!sample) {
+            continue;
+        }
+        const preprocess::Rect rect{tile.rect.x, tile.rect.y, tile.rect.width, tile.rect.height};
+        if (scale_into(sample, preprocess::nv12_region(map.data, width, height, offsets, strides, rect))) {
+            output.generations[index] = generation;
+            tile.scaled.fetch_add(1, std::memory_order_relaxed);
+        }
+        gst_sample_unref(sample);
+    }
+    gst_buffer_unmap(output.buffer, &map);
+}
+
+void MosaicCompositor::run() {
+    const auto start = std::chrono::steady_clock::now();
+    for (guint64 tick = 0;; ++tick) {
+        const auto due = start + std::chrono::nanoseconds(gst_util_uint64_scale(tick, GST_SECOND, framerate_));
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (wake_.wait_until(lock, due, [this] { return stopping_; })) {
+                break;
+            }
+        }
+        const gint64 began_us = g_get_monotonic_time();
+        update_staleness(began_us);
+
+        bool changed = false;
+        for (std::size_t index = 0; index < tiles_.size() && !changed; ++index) {
+            std::lock_guard<std::mutex> lock(tiles_[index]->mutex);
+            changed = tiles_[index]->generation != exported_generations_[index];
+        }
+        if (!changed) {
+            frames_unchanged_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        Output* free_output = acquire_output();
+        if (!free_output) {
+            // Retried next tick; the changed tiles stay pending.
+            frames_held_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        Output& output = *free_output;
+        compose(output);
+        GST_BUFFER_PTS(output.buffer) = gst_util_uint64_scale(tick, GST_SECOND, framerate_);
+        GST_BUFFER_DURATION(output.buffer) = gst_util_uint64_scale(1, GST_SECOND, framerate_);
+        GstSample* sample = gst_sample_new(output.buffer, caps_, nullptr, nullptr);
+        exporter_->export_sample(sample);
+        gst_sample_unref(sample);
+        output.exported = ++exports_;
+        exported_generations_ = output.generations;
+        frames_exported_.fetch_add(1, std::memory_order_relaxed);
+        compose_us_.fetch_add(g_get_monotonic_time() - began_us, std::memory_order_relaxed);
+
+        // Skip ticks missed while composing rather than bursting to catch up.
+        const auto behind = std::chrono::steady_clock::now() - start;
+        tick = std::max<guint64>(
+            tick, gst_util_uint64_scale(std::chrono::duration_cast<std::chrono::nanoseconds>(behind).count(),
+                                        framerate_, GST_SECOND));
+    }
+}
+
+void MosaicCompositor::detach() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    for (const auto& tile : tiles_) {
+        if (tile->sink) {
+            if (tile->handler != 0) {
+                g_signal_handler_disconnect(tile->sink, tile->handler);
+            }
+            gst_object_unref(tile->sink);
+        }
+        if (tile->latest) {
+            gst_sample_unref(tile->latest);
+        }
+    }
+    tiles_.clear();
+    // Consumers still holding a frame keep its buffer (and memfd) alive.
+    for (Output& output : outputs_) {
+        gst_buffer_unref(output.buffer);
+    }
+    outputs_.clear();
+    exports_ = 0;
+    exported_generations_.clear();
+    if (caps_) {
+        gst_caps_unref(caps_);
+        caps_ = nullptr;
+    }
+    if (allocator_) {
+        gst_object_unref(allocator_);
+        allocator_ = nullptr;
+    }
+    exporter_ = nullptr;
+}
+
+MosaicCompositor::Stats MosaicCompositor::stats() const {
+    Stats stats;
+    stats.frames_exported = frames_exported_.load(std::memory_order_relaxed);
+    stats.frames_unchanged = frames_unchanged_.load(std::memory_order_relaxed);
+    stats.frames_held = frames_held_.load(std::memory_order_relaxed);
+    stats.output_frames = output_frames_.load(std::memory_order_relaxed);
+    if (stats.frames_exported > 0) {
+        stats.mean_compose_ms = static_cast<double>(compose_us_.load(std::memory_order_relaxed)) /
+                                static_cast<double>(stats.frames_exported) / 1000.0;
+    }
+    const gint64 now = g_get_monotonic_time();
+    for (const auto& tile : tiles_) {
+        TileStats entry;
+        entry.port = tile->port;
+        entry.decimation = tile->decimation;
+        entry.received = tile->received.load(std::memory_order_relaxed);
+        entry.decimated = tile->decimated.load(std::memory_order_relaxed);
+        entry.scaled = tile->scaled.load(std::memory_order_relaxed);
+        entry.stalls = tile->stalls.load(std::memory_order_relaxed);
+        const gint64 last = tile->last_us.load(std::memory_order_relaxed);
+        if (last != 0) {
+            entry.age_ms = static_cast<double>(now - last) / 1000.0;
+        }
+        entry.stale = last == 0 || now - last > stale_us_;
+        stats.tiles.push_back(entry);
+    }
+    return stats;
+}
+
+std::string format_mosaic_stats(const MosaicCompositor::Stats& stats) {
+    std::ostringstream out;
+    out << "Mosaic frames: " << stats.frames_exported << " exported, " << stats.frames_unchanged
+        << " unchanged ticks skipped, " << stats.frames_held << " ticks skipped with all " << stats.output_frames
+        << " output frames held, compose mean " << stats.mean_compose_ms << " ms";
+    for (std::size_t index = 0; index < stats.tiles.size(); ++index) {
+        const auto& tile = stats.tiles[index];
+        out << "\n  tile " << index << " (port " << tile.port << "): received " << tile.received << ", decimated "
+            << tile.decimated << " (1 in " << tile.decimation << "), scaled " << tile.scaled << ", ";
+        if (tile.age_ms < 0.0) {
+            out << "no frame yet";
+        } else {
+            out << "newest " << tile.age_ms << " ms ago";
+        }
+        out << (tile.stale ? " STALE" : "") << ", stalls " << tile.stalls;
+    }
+    return out.str();
+}
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,175 @@
+#include "gstreamer_worker/pipeline/motion_gate.hpp"
+
+#include <algorithm>
+
+#include "gstreamer_worker/pipeline/capture_pipeline.hpp"
+#include "gstreamer_worker/preprocess/nv12_preprocess.hpp"
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+
+namespace gstreamer_worker::pipeline {
+
+MotionGate::~MotionGate() {
+    detach();
+}
+
+bool MotionGate::attach(GstElement* pipeline, const MotionGateConfig& config) {
+    if (!pipeline) {
+        return false;
+    }
+    detach();
+    config_ = config;
+    config_.row_step = std::max<std::uint32_t>(config_.row_step, 1);
+
+    gate_ = gst_bin_get_by_name(GST_BIN(pipeline), kMotionGateName);
+    if (!gate_) {
+        return false;
+    }
+    sink_pad_ = gst_element_get_static_pad(gate_, "sink");
+    if (!sink_pad_) {
+        detach();
+        return false;
+    }
+    probe_id_ = gst_pad_add_probe(sink_pad_,
+                                  static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                                               GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                                  &MotionGate::probe,
+                                  this,
+                                  nullptr);
+    return true;
+}
+
+void MotionGate::detach() {
+    if (sink_pad_) {
+        if (probe_id_ != 0) {
+            gst_pad_remove_probe(sink_pad_, probe_id_);
+            probe_id_ = 0;
+        }
+        gst_object_unref(sink_pad_);
+        sink_pad_ = nullptr;
+    }
+    if (gate_) {
+        gst_object_unref(gate_);
+        gate_ = nullptr;
+    }
+    have_info_ = false;
+    have_reference_ = false;
+    last_sent_ = GST_CLOCK_TIME_NONE;
+    hold_ = 0;
+    pending_skips_ = 0;
+}
+
+MotionGate::Stats MotionGate::stats() const {
+    Stats stats;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    stats.sent = sent_.load(std::memory_order_relaxed);
+    stats.skipped = skipped_.load(std::memory_order_relaxed);
+    stats.keepalives = keepalives_.load(std::memory_order_relaxed);
+    stats.motion = motion_.load(std::memory_order_relaxed);
+    stats.last_difference = last_difference_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+GstPadProbeReturn MotionGate::probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* self = static_cast<MotionGate*>(user_data);
+    if (!self) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent* event = gst_pad_probe_info_get_event(info);
+        if (event && GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+            GstCaps* caps = nullptr;
+            gst_event_parse_caps(event, &caps);
+            self->have_info_ = caps && gst_video_info_from_caps(&self->info_, caps);
+            // A new format invalidates the reference.
+            self->have_reference_ = false;
+        }
+        return GST_PAD_PROBE_OK;
+    }
+    GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+    return buffer ? self->on_buffer(info, buffer) : GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn MotionGate::on_buffer(GstPadProbeInfo* info, GstBuffer* buffer) {
+    frames_.fetch_add(1, std::memory_order_relaxed);
+
+    GstVideoFrame frame;
+    if (!have_info_ || !gst_video_frame_map(&frame, &info_, buffer, GST_MAP_READ)) {
+        // Nothing to compare against; never hold back a frame we cannot read.
+        sent_.fetch_add(1, std::memory_order_relaxed);
+        record_skips(info, buffer);
+        return GST_PAD_PROBE_OK;
+    }
+
+    const auto* plane = static_cast<const std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0));
+    const std::size_t stride = static_cast<std::size_t>(GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0));
+    // Bytes, so packed formats (YUY2) compare their interleaved samples too.
+    const auto row_bytes =
+        static_cast<std::uint32_t>(GST_VIDEO_FRAME_COMP_WIDTH(&frame, 0) * GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, 0));
+    const auto height = static_cast<std::uint32_t>(GST_VIDEO_FRAME_COMP_HEIGHT(&frame, 0));
+    const std::size_t sampled = static_cast<std::size_t>(preprocess::sampled_rows(height, config_.row_step)) * row_bytes;
+
+    double difference = 0.0;
+    bool send = true;
+    if (have_reference_ && reference_.size() == sampled && sampled > 0) {
+        const std::uint64_t sad =
+            preprocess::sampled_plane_sad(plane, stride, row_bytes, height, config_.row_step, reference_.data());
+        difference = static_cast<double>(sad) / static_cast<double>(sampled);
+        last_difference_.store(difference, std::memory_order_relaxed);
+        send = should_send(difference, GST_BUFFER_PTS(buffer));
+    }
+    if (send) {
+        // Compare against the last frame sent, not the last one seen, so a
+        // slow pan accumulates until it crosses the threshold.
+        reference_.resize(sampled);
+        preprocess::copy_sampled_rows(plane, stride, row_bytes, height, config_.row_step, reference_.data());
+        have_reference_ = true;
+    }
+    gst_video_frame_unmap(&frame);
+
+    if (!send) {
+        ++pending_skips_;
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_DROP;
+    }
+    last_sent_ = GST_BUFFER_PTS(buffer);
+    sent_.fetch_add(1, std::memory_order_relaxed);
+    record_skips(info, buffer);
+    return GST_PAD_PROBE_OK;
+}
+
+bool MotionGate::should_send(double difference, GstClockTime timestamp) {
+    if (difference >= config_.threshold) {
+        motion_.fetch_add(1, std::memory_order_relaxed);
+        hold_ = config_.hold_frames;
+        return true;
+    }
+    if (hold_ > 0) {
+        --hold_;
+        return true;
+    }
+    const GstClockTime keepalive = static_cast<GstClockTime>(config_.keepalive_ms) * GST_MSECOND;
+    if (!GST_CLOCK_TIME_IS_VALID(timestamp) || !GST_CLOCK_TIME_IS_VALID(last_sent_) ||
+        timestamp >= last_sent_ + keepalive) {
+        keepalives_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void MotionGate::record_skips(GstPadProbeInfo* info, GstBuffer* buffer) {
+    if (pending_skips_ == 0 || !zerocopy::get_frame_meta(buffer)) {
+        pending_skips_ = 0;
+        return;
+    }
+    // The source's buffer normally reaches the gate unshared, so this does
+    // not copy the frame.
+    if (!gst_buffer_is_writable(buffer)) {
+        buffer = gst_buffer_make_writable(buffer);
+        GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    }
+    auto* meta = const_cast<zerocopy::FrameMeta*>(zerocopy::get_frame_meta(buffer));
+    meta->payload.skipped_frames = pending_skips_;
+    pending_skips_ = 0;
+}
+
+}  // namespace gstreamer_worker::pipeline
@@ -0,0 +1,191 @@
+#include "gstreamer_worker/pipeline/path_merger.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+// A sequence number seen again within this window is a duplicate. It must stay
+// well below the time the 16-bit sequence space takes to wrap (about 6 s at
+// 10k packets/s) and above the worst skew between the paths.
+constexpr std::int64_t kDuplicateWindowUs = 1'000'000;
+constexpr std::size_t kSequenceSlots = 65536;
+
+std::string chain_suffix(std::size_t index) {
+    return index == 0 ? std::string{} : "_" + std::to_string(index);
+}
+
+}  // namespace
+
+PathMerger::Chain::Chain() : slots(kSequenceSlots) {}
+
+PathMerger::~PathMerger() {
+    detach();
+}
+
+bool PathMerger::attach(GstElement* pipeline, const ViewerPipelineConfig& config) {
+    if (!pipeline || !config.redundancy.enabled) {
+        return false;
+    }
+    detach();
+    chains_.clear();
+
+    const std::size_t chains = config.mosaic.enabled ? config.mosaic.ports.size()
+                                                      : std::max<std::size_t>(1, config.layer_ports.size());
+    for (std::size_t index = 0; index < chains; ++index) {
+        chains_.push_back(std::make_unique<Chain>());
+        Chain* chain = chains_.back().get();
+        const char* names[] = {kPrimarySourceName, kSecondarySourceName};
+        for (std::size_t path = 0; path < 2; ++path) {
+            const std::string name = names[path] + chain_suffix(index);
+            GstElement* source = gst_bin_get_by_name(GST_BIN(pipeline), name.c_str());
+            GstPad* pad = source ? gst_element_get_static_pad(source, "src") : nullptr;
+            if (source) {
+                gst_object_unref(source);
+            }
+            if (!pad) {
+                detach();
+                return false;
+            }
+            pads_.push_back(pad);
+            probe_ids_.push_back(gst_pad_add_probe(
+                pad,
+                static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                &PathMerger::path_probe,
+                new ProbeContext{chain, path},
+                [](gpointer ptr) { delete static_cast<ProbeContext*>(ptr); }));
+        }
+    }
+    return true;
+}
+
+void PathMerger::detach() {
+    for (std::size_t index = 0; index < pads_.size(); ++index) {
+        if (index < probe_ids_.size() && probe_ids_[index] != 0) {
+            gst_pad_remove_probe(pads_[index], probe_ids_[index]);
+        }
+        gst_object_unref(pads_[index]);
+    }
+    pads_.clear();
+    probe_ids_.clear();
+    // Chains stay until the next attach so stats() still reports after detach.
+}
+
+PathMerger::Stats PathMerger::stats() const {
+    Stats stats;
+    guint64 skewed = 0;
+    std::int64_t skew_sum_us = 0;
+    std::int64_t max_skew_us = 0;
+    for (const auto& chain : chains_) {
+        stats.forwarded += chain->forwarded.load(std::memory_order_relaxed);
+        stats.duplicates += chain->duplicates.load(std::memory_order_relaxed);
+        for (std::size_t path = 0; path < 2; ++path) {
+            const Path& source = chain->paths[path];
+            const guint64 received = source.received.load(std::memory_order_relaxed);
+            const std::int64_t expected = source.expected.load(std::memory_order_relaxed);
+            stats.paths[path].received += received;
+            stats.paths[path].first += source.first.load(std::memory_order_relaxed);
+            if (expected > static_cast<std::int64_t>(received)) {
+                stats.paths[path].lost += static_cast<guint64>(expected) - received;
+            }
+        }
+        skewed += chain->skewed.load(std::memory_order_relaxed);
+        skew_sum_us += chain->skew_sum_us.load(std::memory_order_relaxed);
+        max_skew_us = std::max(max_skew_us, chain->max_skew_us.load(std::memory_order_relaxed));
+    }
+    if (skewed > 0) {
+        stats.mean_skew_ms = static_cast<double>(skew_sum_us) / static_cast<double>(skewed) / 1000.0;
+    }
+    stats.max_skew_ms = static_cast<double>(max_skew_us) / 1000.0;
+    return stats;
+}
+
+GstPadProbeReturn PathMerger::path_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* context = static_cast<ProbeContext*>(user_data);
+    if (!context) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+        if (!buffer || admit(*context->chain, context->path, buffer)) {
+            return GST_PAD_PROBE_OK;
+        }
+        return GST_PAD_PROBE_DROP;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = gst_pad_probe_info_get_buffer_list(info);
+        if (!list) {
+            return GST_PAD_PROBE_OK;
+        }
+        list = gst_buffer_list_make_writable(list);
+        GST_PAD_PROBE_INFO_DATA(info) = list;
+        for (guint index = 0; index < gst_buffer_list_length(list);) {
+            if (admit(*context->chain, context->path, gst_buffer_list_get(list, index))) {
+                ++index;
+            } else {
+                gst_buffer_list_remove(list, index, 1);
+            }
+        }
+        return gst_buffer_list_length(list) > 0 ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+bool PathMerger::admit(Chain& chain, std::size_t path, GstBuffer* buffer) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    if (!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp)) {
+        // Not RTP; nothing to merge on.
+        return true;
+    }
+    const guint16 seq = gst_rtp_buffer_get_seq(&rtp);
+    gst_rtp_buffer_unmap(&rtp);
+    const std::int64_t now_us = g_get_monotonic_time();
+
+    // Per-path loss: extend the sequence number against this path's highest.
+    Path& source = chain.paths[path];
+    if (source.highest < 0) {
+        // Start one cycle up so packets reordered before the first stay positive.
+        source.base = source.highest = seq + static_cast<std::int64_t>(kSequenceSlots);
+    } else {
+        const auto delta = static_cast<std::int16_t>(seq - static_cast<guint16>(source.highest));
+        const std::int64_t extended = source.highest + delta;
+        source.highest = std::max(source.highest, extended);
+        source.base = std::min(source.base, extended);
+    }
+    source.received.fetch_add(1, std::memory_order_relaxed);
+    source.expected.store(source.highest - source.base + 1, std::memory_order_relaxed);
+
+    std::atomic<std::uint64_t>& slot = chain.slots[seq];
+    const std::uint64_t mine = (static_cast<std::uint64_t>(now_us) << 1) | path;
+    std::uint64_t seen = slot.load(std::memory_order_acquire);
+    while (true) {
+        const auto seen_us = static_cast<std::int64_t>(seen >> 1);
+        if (seen != 0 && now_us - seen_us < kDuplicateWindowUs) {
+            chain.duplicates.fetch_add(1, std::memory_order_relaxed);
+            if ((seen & 1U) != path) {
+                // Secondary minus primary arrival.
+                const std::int64_t skew = path == 1 ? now_us - seen_us : seen_us - now_us;
+                chain.skewed.fetch_add(1, std::memory_order_relaxed);
+                chain.skew_sum_us.fetch_add(skew, std::memory_order_relaxed);
+                std::int64_t max = chain.max_skew_us.load(std::memory_order_relaxed);
+                const std::int64_t magnitude = std::abs(skew);
+                while (magnitude > max &&
+                       !chain.max_skew_us.compare_exchange_weak(max, magnitude, std::memory_order_relaxed)) {
+                }
+            }
+            return false;
+        }
+        // Losing the exchange means the other path stored this packet first.
+        if (slot.compare_exchange_weak(seen, mine, std::memory_order_acq_rel)) {
+            chain.forwarded.fetch_add(1, std::memory_order_relaxed);
+            source.first.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+}  // namespace gstreamer_worker::pipeline
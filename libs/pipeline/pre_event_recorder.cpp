@@ -0,0 +1,384 @@
+#include "gstreamer_worker/pipeline/pre_event_recorder.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <gst/app/gstappsrc.h>
+
+#include "gstreamer_worker/pipeline/codec.hpp"
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+std::string quote(std::string_view text) {
+    if (text.find_first_of(" \"") == std::string_view::npos) {
+        return std::string{text};
+    }
+    std::string result = "\"";
+    for (char ch : text) {
+        if (ch == '\"' || ch == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(ch);
+    }
+    result.push_back('\"');
+    return result;
+}
+
+const char* container_muxer(RecordingContainer container) {
+    switch (container) {
+        case RecordingContainer::FragmentedMp4:
+            return "mp4mux fragment-duration=1000";
+        case RecordingContainer::MpegTs:
+        default:
+            return "mpegtsmux";
+    }
+}
+
+const char* container_extension(RecordingContainer container) {
+    return container == RecordingContainer::FragmentedMp4 ? "mp4" : "ts";
+}
+
+GstClockTime rebase(GstClockTime ts, GstClockTime base) {
+    if (!GST_CLOCK_TIME_IS_VALID(ts) || !GST_CLOCK_TIME_IS_VALID(base)) {
+        return ts;
+    }
+    return ts >= base ? ts - base : 0;
+}
+
+}  // namespace
+
+std::string recorder_branch_launch(const PreEventRecorderConfig& config,
+                                   std::string_view tee_name,
+                                   VideoCodec codec) {
+    std::ostringstream stream;
+    stream << tee_name << ". ! queue max-size-buffers=0 max-size-bytes=0 max-size-time=1000000000"
+           << " leaky=downstream";
+    stream << " ! " << codec_elements(codec).caps;
+    stream << " ! appsink name=" << config.appsink_name
+           << " emit-signals=true sync=false async=false drop=false max-buffers=0";
+    return stream.str();
+}
+
+PreEventRecorder::PreEventRecorder(PreEventRecorderConfig config)
+    : config_(std::move(config)),
+      ring_(config_.ring_bytes),
+      slots_(config_.max_access_units) {
+    if (ring_.empty() || slots_.empty()) {
+        throw std::invalid_argument("PreEventRecorder requires a non-empty ring");
+    }
+}
+
+PreEventRecorder::~PreEventRecorder() {
+    detach();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    if (caps_) {
+        gst_caps_unref(caps_);
+        caps_ = nullptr;
+    }
+}
+
+bool PreEventRecorder::attach(GstElement* pipeline) {
+    if (!pipeline) {
+        return false;
+    }
+    detach();
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), config_.appsink_name.c_str());
+    if (!sink) {
+        return false;
+    }
+    gst_app_sink_set_emit_signals(GST_APP_SINK(sink), TRUE);
+    sink_ = sink;
+    signal_id_ = g_signal_connect(sink_, "new-sample", G_CALLBACK(&PreEventRecorder::on_new_sample), this);
+    return true;
+}
+
+void PreEventRecorder::detach() {
+    if (!sink_) {
+        return;
+    }
+    if (signal_id_ != 0) {
+        g_signal_handler_disconnect(sink_, signal_id_);
+        signal_id_ = 0;
+    }
+    gst_object_unref(sink_);
+    sink_ = nullptr;
+}
+
+GstFlowReturn PreEventRecorder::on_new_sample(GstAppSink* sink, gpointer user_data) {
+    auto* self = static_cast<PreEventRecorder*>(user_data);
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) {
+        return GST_FLOW_ERROR;
+    }
+    if (self) {
+        self->push(gst_sample_get_buffer(sample), gst_sample_get_caps(sample));
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+const PreEventRecorder::Slot& PreEventRecorder::slot_at(std::size_t index) const {
+    return slots_[(head_ + index) % slots_.size()];
+}
+
+void PreEventRecorder::evict_oldest() {
+    if (count_ == 0) {
+        return;
+    }
+    bytes_ -= slots_[head_].size;
+    head_ = (head_ + 1) % slots_.size();
+    --count_;
+}
+
+void PreEventRecorder::evict_to_keyframe() {
+    while (count_ > 0 && !slot_at(0).keyframe) {
+        evict_oldest();
+    }
+}
+
+void PreEventRecorder::evict_expired(GstClockTime now) {
+    const GstClockTime window = static_cast<GstClockTime>(config_.pre_event_seconds) * GST_SECOND;
+    // Drop whole GOPs while the following GOP alone still covers the window.
+    while (count_ > 1) {
+        std::size_t next_keyframe = 1;
+        while (next_keyframe < count_ && !slot_at(next_keyframe).keyframe) {
+            ++next_keyframe;
+        }
+        if (next_keyframe == count_ || now - slot_at(next_keyframe).arrival < window) {
+            return;
+        }
+        for (std::size_t index = 0; index < next_keyframe; ++index) {
+            evict_oldest();
+        }
+    }
+}
+
+bool PreEventRecorder::push(GstBuffer* buffer, GstCaps* caps) {
+    if (!buffer) {
+        return false;
+    }
+    const gsize size = gst_buffer_get_size(buffer);
+    const bool keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    const GstClockTime now = gst_util_get_timestamp();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (caps && caps != caps_ && (!caps_ || !gst_caps_is_equal(caps, caps_))) {
+        gst_caps_replace(&caps_, caps);
+    }
+    if (size == 0 || size > ring_.size()) {
+        ++oversized_;
+        return false;
+    }
+
+    std::size_t offset = 0;
+    if (count_ > 0) {
+        const Slot& newest = slot_at(count_ - 1);
+        offset = newest.offset + newest.size;
+        if (offset + size > ring_.size()) {
+            // Units past the newest one are the oldest; the write jumping back
+            // to the start leaves them behind, so they go before anything at
+            // the start is considered.
+            const std::size_t tail = offset;
+            while (count_ > 0 && slot_at(0).offset >= tail) {
+                evict_oldest();
+            }
+            offset = 0;
+        }
+    }
+
+    // Units are laid out in arrival order with at most one wrap, so past the
+    // tail the ones in the way of the write are always the oldest.
+    if (count_ == slots_.size()) {
+        evict_oldest();
+    }
+    while (count_ > 0) {
+        const Slot& oldest = slot_at(0);
+        if (oldest.offset >= offset + size || offset >= oldest.offset + oldest.size) {
+            break;
+        }
+        evict_oldest();
+    }
+    evict_to_keyframe();
+    if (count_ == 0 && !keyframe) {
+        return true;
+    }
+
+    gst_buffer_extract(buffer, 0, ring_.data() + offset, size);
+    Slot& slot = slots_[(head_ + count_) % slots_.size()];
+    slot.offset = offset;
+    slot.size = size;
+    slot.pts = GST_BUFFER_PTS(buffer);
+    slot.dts = GST_BUFFER_DTS(buffer);
+    slot.duration = GST_BUFFER_DURATION(buffer);
+    slot.arrival = now;
+    slot.keyframe = keyframe;
+    ++count_;
+    bytes_ += size;
+    ++stored_;
+
+    evict_expired(now);
+    return true;
+}
+
+bool PreEventRecorder::take_snapshot(Snapshot& snapshot) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == 0) {
+        return false;
+    }
+    snapshot.data.resize(bytes_);
+    snapshot.slots.resize(count_);
+    std::size_t offset = 0;
+    for (std::size_t index = 0; index < count_; ++index) {
+        Slot slot = slot_at(index);
+        std::copy_n(ring_.data() + slot.offset, slot.size, snapshot.data.data() + offset);
+        slot.offset = offset;
+        offset += slot.size;
+        snapshot.slots[index] = slot;
+    }
+    if (caps_) {
+        snapshot.caps = gst_caps_ref(caps_);
+    }
+    return true;
+}
+
+bool PreEventRecorder::write_snapshot(Snapshot& snapshot, const std::string& path) {
+    // Units keep the caps they were recorded with; those name the codec.
+    const CodecElements& codec = codec_elements(codec_from_caps(snapshot.caps).value_or(VideoCodec::H264));
+    std::ostringstream description;
+    description << "appsrc name=recorder_src format=time is-live=false ! " << codec.parser << " ! "
+                << container_muxer(config_.container) << " ! filesink location=" << quote(path);
+
+    GError* error = nullptr;
+    GstElement* writer = gst_parse_launch(description.str().c_str(), &error);
+    if (!writer) {
+        std::cerr << "Recorder pipeline error: " << (error ? error->message : "unknown") << '\n';
+        if (error) {
+            g_error_free(error);
+        }
+        return false;
+    }
+
+    GstElement* source = gst_bin_get_by_name(GST_BIN(writer), "recorder_src");
+    GstCaps* caps = snapshot.caps ? gst_caps_ref(snapshot.caps) : gst_caps_from_string(codec.caps);
+    gst_app_src_set_caps(GST_APP_SRC(source), caps);
+    gst_caps_unref(caps);
+
+    bool ok = gst_element_set_state(writer, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+    const Slot& first = snapshot.slots.front();
+    const GstClockTime base = GST_CLOCK_TIME_IS_VALID(first.dts) ? first.dts : first.pts;
+    for (const Slot& slot : snapshot.slots) {
+        if (!ok) {
+            break;
+        }
+        // The snapshot outlives the writer pipeline, so units are wrapped in place.
+        GstBuffer* buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+                                                        snapshot.data.data() + slot.offset,
+                                                        slot.size,
+                                                        0,
+                                                        slot.size,
+                                                        nullptr,
+                                                        nullptr);
+        GST_BUFFER_PTS(buffer) = rebase(slot.pts, base);
+        GST_BUFFER_DTS(buffer) = rebase(slot.dts, base);
+        GST_BUFFER_DURATION(buffer) = slot.duration;
+        if (!slot.keyframe) {
+            GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        }
+        ok = gst_app_src_push_buffer(GST_APP_SRC(source), buffer) == GST_FLOW_OK;
+    }
+    gst_app_src_end_of_stream(GST_APP_SRC(source));
+
+    if (ok) {
+        GstBus* bus = gst_element_get_bus(writer);
+        GstMessage* message = gst_bus_timed_pop_filtered(
+            bus, GST_CLOCK_TIME_NONE, static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (message && GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+            GError* err = nullptr;
+            gst_message_parse_error(message, &err, nullptr);
+            std::cerr << "Recorder write error: " << (err ? err->message : "unknown") << '\n';
+            if (err) {
+                g_error_free(err);
+            }
+            ok = false;
+        }
+        if (message) {
+            gst_message_unref(message);
+        }
+        gst_object_unref(bus);
+    }
+
+    gst_element_set_state(writer, GST_STATE_NULL);
+    gst_object_unref(source);
+    gst_object_unref(writer);
+    if (snapshot.caps) {
+        gst_caps_unref(snapshot.caps);
+        snapshot.caps = nullptr;
+    }
+
+    if (ok) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++saved_segments_;
+    }
+    return ok;
+}
+
+bool PreEventRecorder::save(const std::string& path) {
+    Snapshot snapshot;
+    if (!take_snapshot(snapshot)) {
+        return false;
+    }
+    return write_snapshot(snapshot, path);
+}
+
+std::string PreEventRecorder::next_segment_path(std::string_view label) const {
+    GDateTime* now = g_date_time_new_now_local();
+    gchar* stamp = g_date_time_format(now, "%Y%m%d-%H%M%S");
+    const std::string name = std::string(label.empty() ? "pre-event" : label) + "-" + stamp + "." +
+                             container_extension(config_.container);
+    g_free(stamp);
+    g_date_time_unref(now);
+
+    gchar* path = g_build_filename(config_.output_directory.c_str(), name.c_str(), nullptr);
+    std::string result = path;
+    g_free(path);
+    return result;
+}
+
+std::string PreEventRecorder::trigger(std::string_view label) {
+    Snapshot snapshot;
+    if (!take_snapshot(snapshot)) {
+        return {};
+    }
+    std::string path = next_segment_path(label);
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    writer_ = std::thread([this, path, snapshot = std::move(snapshot)]() mutable {
+        if (!write_snapshot(snapshot, path)) {
+            std::cerr << "Failed to write pre-event segment " << path << '\n';
+        }
+    });
+    return path;
+}
+
+PreEventRecorder::Stats PreEventRecorder::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.access_units = count_;
+    stats.bytes = bytes_;
+    if (count_ > 1) {
+        stats.span = slot_at(count_ - 1).arrival - slot_at(0).arrival;
+    }
+    stats.stored = stored_;
+    stats.oversized = oversized_;
+    stats.saved_segments = saved_segments_;
+    return stats;
+}
+
+}  // namespace gstreamer_worker::pipeline
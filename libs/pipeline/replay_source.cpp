@@ -0,0 +1,299 @@
+#include "gstreamer_worker/pipeline/replay_source.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <gst/app/gstappsrc.h>
+
+#include "gstreamer_worker/pipeline/bitstream.hpp"
+
+namespace gstreamer_worker::pipeline {
+namespace {
+
+// rtpdump (rtptools): a text line starting with this magic, a 16-byte binary
+// header, then records of {u16 length, u16 rtp length, u32 offset ms} with
+// `length` counting the 8-byte record header.
+constexpr char kRtpDumpMagic[] = "#!rtpplay1.0 ";
+constexpr std::size_t kRtpDumpHeaderSize = 16;
+constexpr std::size_t kRtpDumpRecordSize = 8;
+constexpr std::size_t kRtpHeaderSize = 12;
+// Every codec here uses the 90 kHz video RTP clock.
+constexpr guint64 kRtpClockRate = 90000;
+
+std::uint32_t read_be16(const std::uint8_t* data) {
+    return (static_cast<std::uint32_t>(data[0]) << 8) | data[1];
+}
+
+std::uint32_t read_be32(const std::uint8_t* data) {
+    return (read_be16(data) << 16) | read_be16(data + 2);
+}
+
+gint64 now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+ReplayFormat resolve_replay_format(const ReplayConfig& config) {
+    if (config.format != ReplayFormat::Auto) {
+        return config.format;
+    }
+    std::ifstream file(config.path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Unable to open replay file " + config.path);
+    }
+    char magic[sizeof(kRtpDumpMagic) - 1] = {};
+    file.read(magic, sizeof(magic));
+    if (file.gcount() == static_cast<std::streamsize>(sizeof(magic)) &&
+        std::memcmp(magic, kRtpDumpMagic, sizeof(magic)) == 0) {
+        return ReplayFormat::RtpDump;
+    }
+    return ReplayFormat::ElementaryStream;
+}
+
+std::vector<ReplayPacket> split_rtpdump(const std::uint8_t* data, std::size_t size, const ReplayConfig& config) {
+    std::vector<ReplayPacket> packets;
+    const auto* line_end = data ? static_cast<const std::uint8_t*>(std::memchr(data, '\n', size)) : nullptr;
+    if (!line_end) {
+        return packets;
+    }
+    std::size_t pos = static_cast<std::size_t>(line_end - data) + 1 + kRtpDumpHeaderSize;
+    // Unwrapped RTP time of each packet relative to the first. Packets
+    // reordered ahead of the first frame land below zero, so PTS are rebased
+    // on the minimum once every packet is read.
+    std::vector<std::int64_t> rtp_times;
+    std::int64_t rtp_time = 0;
+    std::uint32_t last_timestamp = 0;
+    bool first = true;
+    while (pos + kRtpDumpRecordSize <= size) {
+        const std::size_t length = read_be16(data + pos);
+        const std::size_t rtp_length = read_be16(data + pos + 2);
+        const std::uint32_t offset_ms = read_be32(data + pos + 4);
+        if (length < kRtpDumpRecordSize || pos + length > size) {
+            break;
+        }
+        const std::size_t payload = pos + kRtpDumpRecordSize;
+        // Records may be truncated captures; a zero RTP length marks RTCP.
+        const std::size_t packet_size = std::min(rtp_length, length - kRtpDumpRecordSize);
+        pos += length;
+        if (packet_size < kRtpHeaderSize || (data[payload] >> 6) != 2) {
+            continue;
+        }
+        const std::uint32_t timestamp = read_be32(data + payload + 4);
+        if (first) {
+            last_timestamp = timestamp;
+            first = false;
+        }
+        // Unwrap against the previous packet; reordered frames step back.
+        rtp_time += static_cast<std::int32_t>(timestamp - last_timestamp);
+        last_timestamp = timestamp;
+
+        ReplayPacket packet;
+        packet.offset = payload;
+        packet.size = packet_size;
+        packet.due = config.original_timing ? offset_ms * GST_MSECOND : 0;
+        packet.frame_end = (data[payload + 1] & 0x80U) != 0;
+        if (!packets.empty() && !packets.back().frame_end && rtp_times.back() != rtp_time) {
+            // Marker lost in the capture; the timestamp change ends the frame.
+            packets.back().frame_end = true;
+        }
+        packets.push_back(packet);
+        rtp_times.push_back(rtp_time);
+    }
+    if (!packets.empty()) {
+        packets.back().frame_end = true;
+        const std::int64_t origin = *std::min_element(rtp_times.begin(), rtp_times.end());
+        for (std::size_t index = 0; index < packets.size(); ++index) {
+            ReplayPacket& packet = packets[index];
+            packet.pts = gst_util_uint64_scale(static_cast<guint64>(rtp_times[index] - origin), GST_SECOND,
+                                               kRtpClockRate);
+            if (!config.original_timing) {
+                packet.due = packet.pts;
+            }
+        }
+    }
+    return packets;
+}
+
+std::vector<ReplayPacket> split_elementary(const std::uint8_t* data,
+                                           std::size_t size,
+                                           const ViewerPipelineConfig& config) {
+    if (config.codec == VideoCodec::AV1) {
+        throw std::runtime_error("AV1 has no Annex B elementary stream; replay it from an rtpdump file");
+    }
+    const std::vector<std::size_t> offsets = access_unit_offsets(config.codec, data, size);
+    const std::uint32_t framerate = std::max(config.replay.framerate, 1U);
+    std::vector<ReplayPacket> packets;
+    packets.reserve(offsets.size());
+    for (std::size_t index = 0; index < offsets.size(); ++index) {
+        const std::size_t end = index + 1 < offsets.size() ? offsets[index + 1] : size;
+        ReplayPacket packet;
+        packet.offset = offsets[index];
+        packet.size = end - offsets[index];
+        packet.pts = gst_util_uint64_scale(index, GST_SECOND, framerate);
+        packet.due = packet.pts;
+        packet.frame_end = true;
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+ReplaySource::~ReplaySource() {
+    detach();
+}
+
+bool ReplaySource::attach(GstElement* pipeline, const ViewerPipelineConfig& config) {
+    if (!pipeline || !config.replay.enabled) {
+        return false;
+    }
+    detach();
+
+    GError* error = nullptr;
+    file_ = g_mapped_file_new(config.replay.path.c_str(), FALSE, &error);
+    if (!file_) {
+        std::cerr << "Unable to map " << config.replay.path << ": " << (error ? error->message : "unknown")
+                  << '\n';
+        if (error) {
+            g_error_free(error);
+        }
+        return false;
+    }
+    const auto* data = reinterpret_cast<const std::uint8_t*>(g_mapped_file_get_contents(file_));
+    const std::size_t size = g_mapped_file_get_length(file_);
+
+    try {
+        packets_ = resolve_replay_format(config.replay) == ReplayFormat::RtpDump
+                       ? split_rtpdump(data, size, config.replay)
+                       : split_elementary(data, size, config);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << '\n';
+    }
+    if (packets_.empty()) {
+        std::cerr << "No packets to replay in " << config.replay.path << '\n';
+        detach();
+        return false;
+    }
+
+    source_ = gst_bin_get_by_name(GST_BIN(pipeline), kReplaySourceName);
+    if (!source_) {
+        detach();
+        return false;
+    }
+    speed_ = config.replay.speed;
+    return true;
+}
+
+bool ReplaySource::start() {
+    if (!source_ || thread_.joinable()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void ReplaySource::run() {
+    const auto start = std::chrono::steady_clock::now();
+    first_push_us_.store(now_us(), std::memory_order_relaxed);
+    bool ok = true;
+    for (const ReplayPacket& packet : packets_) {
+        if (speed_ > 0.0) {
+            const auto due = start + std::chrono::nanoseconds(static_cast<std::int64_t>(packet.due / speed_));
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (wake_.wait_until(lock, due, [this] { return stopping_; })) {
+                ok = false;
+                break;
+            }
+        }
+        // The buffer keeps the mapping alive until downstream releases it.
+        GstBuffer* buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+                                                        g_mapped_file_get_contents(file_) + packet.offset,
+                                                        packet.size,
+                                                        0,
+                                                        packet.size,
+                                                        g_mapped_file_ref(file_),
+                                                        reinterpret_cast<GDestroyNotify>(g_mapped_file_unref));
+        GST_BUFFER_PTS(buffer) = packet.pts;
+        const gint64 pushed_us = now_us();
+        // With block=true this waits for the decoder in unthrottled replay.
+        if (gst_app_src_push_buffer(GST_APP_SRC(source_), buffer) != GST_FLOW_OK) {
+            ok = false;
+            break;
+        }
+        packets_pushed_.fetch_add(1, std::memory_order_relaxed);
+        bytes_pushed_.fetch_add(packet.size, std::memory_order_relaxed);
+        if (packet.frame_end) {
+            PushRecord& record = pushes_[next_push_.fetch_add(1, std::memory_order_relaxed) % kPushRecords];
+            record.pushed_us.store(pushed_us, std::memory_order_relaxed);
+            record.pts.store(packet.pts, std::memory_order_release);
+            frames_pushed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (ok) {
+        gst_app_src_end_of_stream(GST_APP_SRC(source_));
+    }
+}
+
+void ReplaySource::detach() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (source_) {
+        gst_object_unref(source_);
+        source_ = nullptr;
+    }
+    packets_.clear();
+    if (file_) {
+        g_mapped_file_unref(file_);
+        file_ = nullptr;
+    }
+}
+
+double ReplaySource::frame_exported(GstClockTime pts) {
+    const gint64 exported_us = now_us();
+    frames_exported_.fetch_add(1, std::memory_order_relaxed);
+    last_export_us_.store(exported_us, std::memory_order_relaxed);
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) {
+        return -1.0;
+    }
+    // Frames leave roughly in push order, so search back from the newest.
+    const std::size_t newest = next_push_.load(std::memory_order_acquire);
+    for (std::size_t age = 1; age <= std::min(newest, kPushRecords); ++age) {
+        const PushRecord& record = pushes_[(newest - age) % kPushRecords];
+        if (record.pts.load(std::memory_order_acquire) == pts) {
+            return static_cast<double>(exported_us - record.pushed_us.load(std::memory_order_relaxed)) / 1000.0;
+        }
+    }
+    return -1.0;
+}
+
+ReplaySource::Stats ReplaySource::stats() const {
+    Stats stats;
+    stats.frames_pushed = frames_pushed_.load(std::memory_order_relaxed);
+    stats.packets_pushed = packets_pushed_.load(std::memory_order_relaxed);
+    stats.bytes_pushed = bytes_pushed_.load(std::memory_order_relaxed);
+    stats.frames_exported = frames_exported_.load(std::memory_order_relaxed);
+    const gint64 first = first_push_us_.load(std::memory_order_relaxed);
+    const gint64 last = last_export_us_.load(std::memory_order_relaxed);
+    if (first != 0 && last > first) {
+        stats.elapsed_seconds = static_cast<double>(last - first) / 1e6;
+        stats.decode_fps = static_cast<double>(stats.frames_exported) / stats.elapsed_seconds;
+    }
+    return stats;
+}
+
+}  // namespace gstreamer_worker::pipeline
@@ -1,15 +1,28 @@
 #include "gstreamer_worker/pipeline/viewer_pipeline.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 
+#include "gstreamer_worker/pipeline/codec.hpp"
 #include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/layer_switcher.hpp"
+#include "gstreamer_worker/pipeline/load_shedder.hpp"
+#include "gstreamer_worker/pipeline/mosaic_compositor.hpp"
+#include "gstreamer_worker/pipeline/path_merger.hpp"
+#include "gstreamer_worker/pipeline/pre_event_recorder.hpp"
+#include "gstreamer_worker/pipeline/replay_source.hpp"
 
 namespace gstreamer_worker::pipeline {
 namespace {
 
+// Parsed access units fan out here to the recorder and encoded export branches.
+constexpr const char* kEncodedTee = "encoded_tee";
+constexpr const char* kEncodedQueue = "encoded_queue";
+
 std::string quote(std::string_view text) {
     if (text.find_first_of(" \"") == std::string_view::npos) {
         return std::string{text};
@@ -25,39 +38,190 @@ std::string quote(std::string_view text) {
     return result;
 }
 
-std::string decoder_branch(const ViewerPipelineConfig& config) {
+bool encoded_tee(const ViewerPipelineConfig& config) {
+    return config.recorder.enabled || config.encoded_export.enabled;
+}
+
+// Leaky, so a stalled consumer loses access units instead of holding up the
+// decoder behind the tee.
+void append_encoded_export_branch(std::ostringstream& stream, const EncodedExportConfig& config, VideoCodec codec) {
+    stream << " " << kEncodedTee << ". ! queue name=" << kEncodedQueue << " max-size-buffers=" << config.max_buffers
+           << " max-size-bytes=0 max-size-time=0 leaky=downstream";
+    stream << " ! " << codec_elements(codec).caps;
+    stream << " ! appsink name=" << config.appsink_name << " emit-signals=true sync=false async=false drop=true"
+           << " max-buffers=" << config.max_buffers;
+}
+
+std::string layer_suffix(std::size_t index) {
+    return index == 0 ? std::string{} : "_" + std::to_string(index);
+}
+
+// `index` tells apart the decoders of mosaic tiles.
+std::string decoder_branch(const ViewerPipelineConfig& config, std::size_t index = 0) {
     switch (config.backend) {
         case DecoderBackend::Nvidia:
             return "nvv4l2decoder enable-max-performance=1 enable-low-latency=1 ! nvvidconv";
         case DecoderBackend::Software:
-            return "avdec_h264 skip-frame=0 ! videoconvert";
+            return software_decoder(config.codec, config.decoder) + " ! videoconvert";
         case DecoderBackend::Auto:
         default:
-            return "decodebin name=decoder";
+            return "decodebin name=decoder" + layer_suffix(index);
     }
 }
 
+void append_receive_chain(std::ostringstream& stream,
+                          const ViewerPipelineConfig& config,
+                          std::uint16_t port,
+                          std::size_t index) {
+    const std::string caps = std::string{"application/x-rtp,media=video,clock-rate=90000,encoding-name="} +
+                             codec_elements(config.codec).encoding_name + ",payload=96";
+    if (config.redundancy.enabled) {
+        // Both paths meet in a funnel; PathMerger drops the later copy of each
+        // packet on the udpsrc pads, so the jitterbuffer sees one stream. Each
+        // udpsrc has its own stream-id, so the funnel keeps the first sticky
+        // events instead of resending stream-start (a decoder drain) whenever
+        // the winning path changes.
+        const std::string merge = std::string{kPathMergeName} + layer_suffix(index);
+        const auto offset = static_cast<int>(config.redundancy.secondary.port) - config.listen.port;
+        stream << "udpsrc name=" << kPrimarySourceName << layer_suffix(index)
+               << " address=" << quote(config.listen.host) << " port=" << port << " caps=\"" << caps << "\""
+               << " ! " << merge << ".";
+        stream << " udpsrc name=" << kSecondarySourceName << layer_suffix(index)
+               << " address=" << quote(config.redundancy.secondary.host) << " port=" << port + offset
+               << " caps=\"" << caps << "\"" << " ! " << merge << ".";
+        stream << " funnel name=" << merge << " forward-sticky-events=false";
+    } else {
+        stream << "udpsrc address=" << quote(config.listen.host) << " port=" << port << " caps=\"" << caps << "\"";
+    }
+
+    stream << " ! queue max-size-buffers=32";
+    stream << " ! rtpjitterbuffer latency=" << config.latency_ms << " do-lost=true";
+    if (config.drop_on_latency) {
+        stream << " drop-on-latency=true";
+    }
+    stream << " ! " << codec_elements(config.codec).depayloader << " name=" << kDepayloaderName
+           << layer_suffix(index);
+}
+
+// Recorded input in place of the network; packets arrive in order and
+// complete, so the jitterbuffer is left out.
+void append_replay_source(std::ostringstream& stream, const ViewerPipelineConfig& config) {
+    const CodecElements& codec = codec_elements(config.codec);
+    const ReplayFormat format = resolve_replay_format(config.replay);
+    if (format == ReplayFormat::ElementaryStream && !codec.parameter_sets) {
+        throw std::invalid_argument("Elementary stream replay needs H.264 or H.265; record AV1 as rtpdump");
+    }
+    stream << "appsrc name=" << kReplaySourceName << " format=time is-live=false block=true max-bytes=4194304";
+    if (format == ReplayFormat::RtpDump) {
+        stream << " caps=\"application/x-rtp,media=video,clock-rate=90000,encoding-name=" << codec.encoding_name
+               << ",payload=96\"";
+        stream << " ! " << codec.depayloader << " name=" << kDepayloaderName;
+    } else {
+        stream << " caps=\"" << codec.caps << "\"";
+    }
+}
+
+// One receive chain and decoder per tile, each ending in system-memory NV12 or
+// I420 that MosaicCompositor maps and scales on the CPU. Software decoders
+// feed the appsink directly: a videoconvert here would make a full-size copy
+// of every frame, including the ones the tile then decimates.
+std::string build_mosaic_launch(const ViewerPipelineConfig& config) {
+    if (config.replay.enabled || !config.layer_ports.empty()) {
+        throw std::invalid_argument("Mosaic mode receives one stream per port; drop replay and layer ports");
+    }
+    if (config.load_shedding.enabled || encoded_tee(config)) {
+        throw std::invalid_argument("Mosaic mode does not support load shedding, recording or encoded export");
+    }
+    // Validates the port list and tile sizes.
+    mosaic_layout(config.mosaic);
+    const CodecElements& codec = codec_elements(config.codec);
+    std::ostringstream stream;
+    for (std::size_t index = 0; index < config.mosaic.ports.size(); ++index) {
+        if (index > 0) {
+            stream << " ";
+        }
+        append_receive_chain(stream, config, config.mosaic.ports[index], index);
+        stream << " ! " << codec.parser;
+        if (config.backend == DecoderBackend::Software) {
+            stream << " ! " << software_decoder(config.codec, config.decoder);
+        } else {
+            stream << " ! " << decoder_branch(config, index);
+        }
+        // The composer takes the newest frame when it ticks; older ones are dropped.
+        stream << " ! queue max-size-buffers=2 leaky=downstream";
+        stream << " ! video/x-raw,format={NV12,I420}";
+        stream << " ! appsink name=" << mosaic_sink_name(index) << " drop=true max-buffers=1 emit-signals=true"
+               << " sync=false";
+    }
+    return stream.str();
+}
+
 }  // namespace
 
+std::uint32_t matched_jitter_latency_ms(std::uint32_t framerate, double vbv_frames) {
+    // A frame can arrive up to one VBV drain after its first packet; one more
+    // frame interval covers network jitter.
+    const double frame_ms = 1000.0 / std::max(framerate, 1U);
+    return static_cast<std::uint32_t>(std::ceil((vbv_frames + 1.0) * frame_ms));
+}
+
 std::string build_viewer_launch(const ViewerPipelineConfig& config) {
+    if (config.mosaic.enabled) {
+        return build_mosaic_launch(config);
+    }
+    const CodecElements& codec = codec_elements(config.codec);
     std::ostringstream stream;
-    stream << "udpsrc address=" << quote(config.listen.host)
-           << " port=" << config.listen.port
-           << " caps=\"application/x-rtp,media=video,encoding-name=H264,payload=96\"";
-
-    stream << " ! queue max-size-buffers=32";
-    stream << " ! rtpjitterbuffer latency=" << config.latency_ms << " do-lost=true";
-    stream << " ! rtph264depay";
-    stream << " ! h264parse";
+    if (config.replay.enabled) {
+        if (!config.layer_ports.empty()) {
+            throw std::invalid_argument("Replay feeds a single stream; drop the layer ports");
+        }
+        append_replay_source(stream, config);
+        stream << " ! " << codec.parser;
+    } else if (config.layer_ports.empty()) {
+        append_receive_chain(stream, config, config.listen.port, 0);
+        stream << " ! " << codec.parser;
+    } else {
+        // Each simulcast layer is depayloaded on its own; the selector forwards
+        // one of them and LayerSwitcher moves it on an IDR.
+        stream << "input-selector name=" << kLayerSelectorName << " sync-streams=false";
+    }
+    if (encoded_tee(config)) {
+        stream << " ! tee name=" << kEncodedTee;
+    }
+    if (config.load_shedding.enabled) {
+        stream << " ! " << codec.caps;
+        stream << " ! queue name=" << kDecodeQueueName << " max-size-buffers=" << config.load_shedding.queue_buffers
+               << " max-size-bytes=0 max-size-time=0";
+    }
     stream << " ! " << decoder_branch(config);
-    stream << " ! queue max-size-buffers=4 leaky=downstream";
+    // Replay measures decode throughput, so no decoded frame may be dropped.
+    stream << " ! queue max-size-buffers=4";
+    if (!config.replay.enabled) {
+        stream << " leaky=downstream";
+    }
     if (config.request_zero_copy && config.backend == DecoderBackend::Nvidia) {
         stream << " ! video/x-raw(memory:NVMM),format=NV12";
     } else {
         stream << " ! video/x-raw,format=NV12";
     }
-    stream << " ! appsink name=" << config.appsink_name
-           << " drop=true max-buffers=1 emit-signals=true sync=false";
+    stream << " ! appsink name=" << config.appsink_name << " drop=" << (config.replay.enabled ? "false" : "true")
+           << " max-buffers=1 emit-signals=true sync=false";
+    for (std::size_t index = 0; index < config.layer_ports.size(); ++index) {
+        stream << " ";
+        append_receive_chain(stream, config, config.layer_ports[index], index);
+        stream << " ! " << codec.parser;
+        if (codec.parameter_sets) {
+            // Layers join mid-stream; repeat parameter sets with every IDR.
+            stream << " config-interval=-1";
+        }
+        stream << " ! " << kLayerSelectorName << ".sink_" << index;
+    }
+    if (config.recorder.enabled) {
+        stream << " " << recorder_branch_launch(config.recorder, kEncodedTee, config.codec);
+    }
+    if (config.encoded_export.enabled) {
+        append_encoded_export_branch(stream, config.encoded_export, config.codec);
+    }
     return stream.str();
 }
 
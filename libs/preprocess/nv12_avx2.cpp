@@ -0,0 +1,125 @@
+// Built with -mavx2 -mfma; only called after a runtime CPU check.
+#include <immintrin.h>
+
+#include "nv12_kernels.hpp"
+
+namespace gstreamer_worker::preprocess::detail {
+namespace {
+
+void blend_rows_avx2(const std::uint8_t* top, const std::uint8_t* bottom, float fraction, float* out,
+                     std::size_t count) {
+    const __m256 weight = _mm256_set1_ps(fraction);
+    std::size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        const __m256 a = _mm256_cvtepi32_ps(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(top + x))));
+        const __m256 b = _mm256_cvtepi32_ps(
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bottom + x))));
+        _mm256_storeu_ps(out + x, _mm256_fmadd_ps(weight, _mm256_sub_ps(b, a), a));
+    }
+    blend_rows(top, bottom, fraction, out, x, count);
+}
+
+__m256 lerp_gather(const float* row, __m256i index0, __m256i index1, __m256 fraction) {
+    const __m256 a = _mm256_i32gather_ps(row, index0, 4);
+    const __m256 b = _mm256_i32gather_ps(row, index1, 4);
+    return _mm256_fmadd_ps(fraction, _mm256_sub_ps(b, a), a);
+}
+
+void resample_pixels_avx2(const float* row, const std::int32_t* index0, const std::int32_t* index1,
+                          const float* fraction, std::uint8_t* out, std::size_t count) {
+    const __m256 half = _mm256_set1_ps(0.5F);
+    std::size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        const __m256 value = lerp_gather(row, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index0 + x)),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index1 + x)),
+                                         _mm256_loadu_ps(fraction + x));
+        // Truncate after adding 0.5 like the scalar path, then narrow 32 -> 8 bits.
+        const __m256i whole = _mm256_cvttps_epi32(_mm256_add_ps(value, half));
+        const __m128i words =
+            _mm_packus_epi32(_mm256_castsi256_si128(whole), _mm256_extracti128_si256(whole, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(words, words));
+    }
+    resample_pixels(row, index0, index1, fraction, out, x, count);
+}
+
+__m256 clamp_255(__m256 value) {
+    return _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255.0F));
+}
+
+}  // namespace
+
+void convert_rows_avx2(const Plan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch) {
+    prepare_scratch(plan, scratch);
+    const __m256 ky = _mm256_set1_ps(plan.ky);
+    const __m256 y_offset = _mm256_set1_ps(plan.y_offset);
+    const __m256 bias = _mm256_set1_ps(128.0F);
+    const __m256 kr_v = _mm256_set1_ps(plan.kr_v);
+    const __m256 kg_u = _mm256_set1_ps(plan.kg_u);
+    const __m256 kg_v = _mm256_set1_ps(plan.kg_v);
+    const __m256 kb_u = _mm256_set1_ps(plan.kb_u);
+    __m256 mean[3];
+    __m256 scale[3];
+    for (std::size_t component = 0; component < 3; ++component) {
+        mean[component] = _mm256_set1_ps(plan.mean[component]);
+        scale[component] = _mm256_set1_ps(plan.scale[component]);
+    }
+    const __m256i one = _mm256_set1_epi32(1);
+
+    for (std::uint32_t out_y = row_begin; out_y < row_end; ++out_y) {
+        const RowSources rows = row_sources(plan, out_y);
+        blend_rows_avx2(rows.luma_top, rows.luma_bottom, rows.luma_fraction, scratch.luma.data(), luma_span(plan));
+        blend_rows_avx2(rows.chroma_top, rows.chroma_bottom, rows.chroma_fraction, scratch.chroma.data(),
+                        chroma_span(plan));
+
+        const float* luma = scratch.luma.data();
+        const float* chroma = scratch.chroma.data();
+        const std::size_t row_offset = static_cast<std::size_t>(out_y) * plan.out_width;
+        std::uint32_t x = 0;
+        for (; x + 8 <= plan.out_width; x += 8) {
+            const __m256i lx0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plan.luma_x0.data() + x));
+            const __m256i lx1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plan.luma_x1.data() + x));
+            const __m256i cx0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plan.chroma_x0.data() + x));
+            const __m256i cx1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plan.chroma_x1.data() + x));
+            const __m256 lfx = _mm256_loadu_ps(plan.luma_fx.data() + x);
+            const __m256 cfx = _mm256_loadu_ps(plan.chroma_fx.data() + x);
+
+            const __m256 sample = lerp_gather(luma, lx0, lx1, lfx);
+            const __m256 u = _mm256_sub_ps(lerp_gather(chroma, cx0, cx1, cfx), bias);
+            const __m256 v = _mm256_sub_ps(
+                lerp_gather(chroma, _mm256_add_epi32(cx0, one), _mm256_add_epi32(cx1, one), cfx), bias);
+
+            const __m256 y = _mm256_mul_ps(ky, _mm256_sub_ps(sample, y_offset));
+            const __m256 rgb[3] = {
+                clamp_255(_mm256_fmadd_ps(kr_v, v, y)),
+                clamp_255(_mm256_fnmadd_ps(kg_v, v, _mm256_fnmadd_ps(kg_u, u, y))),
+                clamp_255(_mm256_fmadd_ps(kb_u, u, y)),
+            };
+            for (std::size_t component = 0; component < 3; ++component) {
+                _mm256_storeu_ps(plan.planes[component] + row_offset + x,
+                                 _mm256_mul_ps(_mm256_sub_ps(rgb[component], mean[component]), scale[component]));
+            }
+        }
+        convert_pixels(plan, scratch, row_offset, x, plan.out_width);
+    }
+}
+
+void scale_rows_avx2(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch) {
+    scale_rows(plan, row_begin, row_end, scratch, blend_rows_avx2, resample_pixels_avx2);
+}
+
+std::uint64_t row_sad_avx2(const std::uint8_t* a, const std::uint8_t* b, std::size_t count) {
+    // vpsadbw sums 8 byte differences into each 64-bit lane.
+    __m256i sum = _mm256_setzero_si256();
+    std::size_t x = 0;
+    for (; x + 32 <= count; x += 32) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + x));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + x));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+    }
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + row_sad(a, b, x, count);
+}
+
+}  // namespace gstreamer_worker::preprocess::detail
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gstreamer_worker/preprocess/nv12_preprocess.hpp"
+
+namespace gstreamer_worker::preprocess::detail {
+
+// Bilinear source position for one output coordinate: sample between index0
+// and index1 with weight `fraction` on index1. Pixel centres are aligned.
+struct Tap {
+    std::int32_t index0{0};
+    std::int32_t index1{0};
+    float fraction{0.0F};
+};
+
+inline Tap make_tap(std::uint32_t out, std::uint32_t out_size, float origin, float extent, std::int32_t limit) {
+    float position = origin + (static_cast<float>(out) + 0.5F) * extent / static_cast<float>(out_size) - 0.5F;
+    position = std::clamp(position, 0.0F, static_cast<float>(limit - 1));
+    Tap tap;
+    tap.index0 = static_cast<std::int32_t>(position);
+    tap.index1 = std::min(tap.index0 + 1, limit - 1);
+    tap.fraction = position - static_cast<float>(tap.index0);
+    return tap;
+}
+
+// Everything a kernel needs, computed once per frame and shared by all bands.
+// Column taps are stored as separate arrays so SIMD kernels can load them as
+// gather indices.
+struct Plan {
+    const Nv12Image* image{nullptr};
+    std::uint32_t out_width{0};
+    std::uint32_t out_height{0};
+    std::size_t plane_size{0};
+
+    float crop_y{0.0F};
+    float crop_height{0.0F};
+
+    // Luma taps index the blended luma row (relative to luma_begin); chroma
+    // taps index the blended interleaved UV row (relative to 2 * chroma_begin)
+    // and point at U, with V one element later.
+    std::vector<std::int32_t> luma_x0;
+    std::vector<std::int32_t> luma_x1;
+    std::vector<float> luma_fx;
+    std::vector<std::int32_t> chroma_x0;
+    std::vector<std::int32_t> chroma_x1;
+    std::vector<float> chroma_fx;
+    std::int32_t luma_begin{0};
+    std::int32_t luma_end{0};
+    std::int32_t chroma_begin{0};
+    std::int32_t chroma_end{0};
+
+    // R = Y' + kr_v*V', G = Y' - kg_u*U' - kg_v*V', B = Y' + kb_u*U' with
+    // Y' = ky*(Y - y_offset) and U'/V' = C - 128 (range scale folded in).
+    float ky{1.0F};
+    float y_offset{0.0F};
+    float kr_v{0.0F};
+    float kg_u{0.0F};
+    float kg_v{0.0F};
+    float kb_u{0.0F};
+
+    // Normalization and destination planes indexed by R, G, B.
+    float mean[3]{};
+    float scale[3]{};
+    float* planes[3]{};
+};
+
+Plan make_plan(const Nv12Image& image, const PreprocessParams& params, float* output);
+
+inline Tap luma_row(const Plan& plan, std::uint32_t out_y) {
+    return make_tap(out_y, plan.out_height, plan.crop_y, plan.crop_height,
+                    static_cast<std::int32_t>(plan.image->height));
+}
+
+inline Tap chroma_row(const Plan& plan, std::uint32_t out_y) {
+    // Chroma sites sit at half resolution; map the luma-space position.
+    return make_tap(out_y, plan.out_height, plan.crop_y * 0.5F, plan.crop_height * 0.5F,
+                    static_cast<std::int32_t>((plan.image->height + 1) / 2));
+}
+
+// Vertically blended luma and interleaved chroma for the current output row.
+// Padded so SIMD loads past the last used element stay inside the allocation.
+struct Scratch {
+    std::vector<float> luma;
+    std::vector<float> chroma;
+};
+
+inline constexpr std::size_t kScratchPadding = 16;
+
+inline void blend_rows(const std::uint8_t* top, const std::uint8_t* bottom, float fraction, float* out,
+                       std::size_t begin, std::size_t end) {
+    for (std::size_t x = begin; x < end; ++x) {
+        const float a = top[x];
+        out[x] = a + fraction * (static_cast<float>(bottom[x]) - a);
+    }
+}
+
+// Converts output pixels [begin, end) of row `row_offset` from blended scratch rows.
+inline void convert_pixels(const Plan& plan, const Scratch& scratch, std::size_t row_offset, std::uint32_t begin,
+                           std::uint32_t end) {
+    const float* luma = scratch.luma.data();
+    const float* chroma = scratch.chroma.data();
+    for (std::uint32_t x = begin; x < end; ++x) {
+        const float y0 = luma[plan.luma_x0[x]];
+        const float sample = y0 + plan.luma_fx[x] * (luma[plan.luma_x1[x]] - y0);
+        const float u0 = chroma[plan.chroma_x0[x]];
+        const float v0 = chroma[plan.chroma_x0[x] + 1];
+        const float u = u0 + plan.chroma_fx[x] * (chroma[plan.chroma_x1[x]] - u0) - 128.0F;
+        const float v = v0 + plan.chroma_fx[x] * (chroma[plan.chroma_x1[x] + 1] - v0) - 128.0F;
+
+        const float y = plan.ky * (sample - plan.y_offset);
+        const float rgb[3] = {
+            std::clamp(y + plan.kr_v * v, 0.0F, 255.0F),
+            std::clamp(y - plan.kg_u * u - plan.kg_v * v, 0.0F, 255.0F),
+            std::clamp(y + plan.kb_u * u, 0.0F, 255.0F),
+        };
+        for (std::size_t component = 0; component < 3; ++component) {
+            plan.planes[component][row_offset + x] = (rgb[component] - plan.mean[component]) * plan.scale[component];
+        }
+    }
+}
+
+// Source rows for output row `out_y`, offset to the first blended column.
+struct RowSources {
+    const std::uint8_t* luma_top;
+    const std::uint8_t* luma_bottom;
+    float luma_fraction;
+    const std::uint8_t* chroma_top;
+    const std::uint8_t* chroma_bottom;
+    float chroma_fraction;
+};
+
+inline RowSources row_sources(const Plan& plan, std::uint32_t out_y) {
+    const Nv12Image& image = *plan.image;
+    const Tap ly = luma_row(plan, out_y);
+    const Tap cy = chroma_row(plan, out_y);
+    const std::size_t luma_shift = static_cast<std::size_t>(plan.luma_begin);
+    const std::size_t chroma_shift = 2 * static_cast<std::size_t>(plan.chroma_begin);
+    return RowSources{
+        image.y + static_cast<std::size_t>(ly.index0) * image.y_stride + luma_shift,
+        image.y + static_cast<std::size_t>(ly.index1) * image.y_stride + luma_shift,
+        ly.fraction,
+        image.uv + static_cast<std::size_t>(cy.index0) * image.uv_stride + chroma_shift,
+        image.uv + static_cast<std::size_t>(cy.index1) * image.uv_stride + chroma_shift,
+        cy.fraction,
+    };
+}
+
+inline std::size_t luma_span(const Plan& plan) {
+    return static_cast<std::size_t>(plan.luma_end - plan.luma_begin);
+}
+
+inline std::size_t chroma_span(const Plan& plan) {
+    return 2 * static_cast<std::size_t>(plan.chroma_end - plan.chroma_begin);
+}
+
+inline void prepare_scratch(const Plan& plan, Scratch& scratch) {
+    scratch.luma.resize(luma_span(plan) + kScratchPadding);
+    scratch.chroma.resize(chroma_span(plan) + kScratchPadding);
+}
+
+inline std::uint64_t row_sad(const std::uint8_t* a, const std::uint8_t* b, std::size_t begin, std::size_t end) {
+    std::uint64_t sum = 0;
+    for (std::size_t x = begin; x < end; ++x) {
+        sum += static_cast<std::uint64_t>(a[x] > b[x] ? a[x] - b[x] : b[x] - a[x]);
+    }
+    return sum;
+}
+
+// Taps for an NV12 (or I420) to NV12 resize of a whole frame. Chroma taps are
+// per element of the interleaved output UV row, so U and V of one site share a
+// position and one kernel resamples both planes.
+struct ScalePlan {
+    const Nv12Image* image{nullptr};
+    const Nv12Target* target{nullptr};
+
+    // Relative to the first blended column, as in Plan.
+    std::vector<std::int32_t> luma_x0;
+    std::vector<std::int32_t> luma_x1;
+    std::vector<float> luma_fx;
+    std::vector<std::int32_t> chroma_x0;
+    std::vector<std::int32_t> chroma_x1;
+    std::vector<float> chroma_fx;
+    std::int32_t luma_begin{0};
+    std::int32_t luma_end{0};
+    std::int32_t chroma_begin{0};
+    std::int32_t chroma_end{0};
+};
+
+ScalePlan make_scale_plan(const Nv12Image& image, const Nv12Target& target);
+
+// Horizontal pass: outputs [begin, end) from a vertically blended row. Taps are
+// convex, so the result already lies in 0..255.
+inline void resample_pixels(const float* row, const std::int32_t* index0, const std::int32_t* index1,
+                            const float* fraction, std::uint8_t* out, std::size_t begin, std::size_t end) {
+    for (std::size_t x = begin; x < end; ++x) {
+        const float a = row[index0[x]];
+        out[x] = static_cast<std::uint8_t>(a + fraction[x] * (row[index1[x]] - a) + 0.5F);
+    }
+}
+
+using BlendKernel = void (*)(const std::uint8_t*, const std::uint8_t*, float, float*, std::size_t);
+using ResampleKernel = void (*)(const float*, const std::int32_t*, const std::int32_t*, const float*,
+                                std::uint8_t*, std::size_t);
+
+// Luma rows [row_begin, row_end) and the chroma rows starting in them, so
+// bands split on any row cover each chroma row once.
+inline void scale_rows(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch,
+                       BlendKernel blend, ResampleKernel resample) {
+    const Nv12Image& image = *plan.image;
+    const Nv12Target& target = *plan.target;
+    const auto luma_shift = static_cast<std::size_t>(plan.luma_begin);
+    const auto chroma_shift = static_cast<std::size_t>(plan.chroma_begin);
+    const auto luma_count = static_cast<std::size_t>(plan.luma_end - plan.luma_begin);
+    const auto chroma_count = static_cast<std::size_t>(plan.chroma_end - plan.chroma_begin);
+    scratch.luma.resize(luma_count + kScratchPadding);
+    scratch.chroma.resize(chroma_count + kScratchPadding);
+
+    const auto luma_limit = static_cast<std::int32_t>(image.height);
+    for (std::uint32_t out_y = row_begin; out_y < row_end; ++out_y) {
+        const Tap tap = make_tap(out_y, target.height, 0.0F, static_cast<float>(image.height), luma_limit);
+        blend(image.y + static_cast<std::size_t>(tap.index0) * image.y_stride + luma_shift,
+              image.y + static_cast<std::size_t>(tap.index1) * image.y_stride + luma_shift, tap.fraction,
+              scratch.luma.data(), luma_count);
+        resample(scratch.luma.data(), plan.luma_x0.data(), plan.luma_x1.data(), plan.luma_fx.data(),
+                 target.y + static_cast<std::size_t>(out_y) * target.y_stride, target.width);
+    }
+
+    const auto chroma_limit = static_cast<std::int32_t>((image.height + 1) / 2);
+    for (std::uint32_t out_y = (row_begin + 1) / 2; out_y < (row_end + 1) / 2; ++out_y) {
+        const Tap tap = make_tap(out_y, target.height / 2, 0.0F, static_cast<float>(image.height) * 0.5F,
+                                 chroma_limit);
+        if (image.v) {
+            // I420: U and V rows blend into the two halves of the scratch row.
+            const std::size_t sites = chroma_count / 2;
+            const std::size_t site_shift = chroma_shift / 2;
+            blend(image.uv + static_cast<std::size_t>(tap.index0) * image.uv_stride + site_shift,
+                  image.uv + static_cast<std::size_t>(tap.index1) * image.uv_stride + site_shift, tap.fraction,
+                  scratch.chroma.data(), sites);
+            blend(image.v + static_cast<std::size_t>(tap.index0) * image.v_stride + site_shift,
+                  image.v + static_cast<std::size_t>(tap.index1) * image.v_stride + site_shift, tap.fraction,
+                  scratch.chroma.data() + sites, sites);
+        } else {
+            blend(image.uv + static_cast<std::size_t>(tap.index0) * image.uv_stride + chroma_shift,
+                  image.uv + static_cast<std::size_t>(tap.index1) * image.uv_stride + chroma_shift, tap.fraction,
+                  scratch.chroma.data(), chroma_count);
+        }
+        resample(scratch.chroma.data(), plan.chroma_x0.data(), plan.chroma_x1.data(), plan.chroma_fx.data(),
+                 target.uv + static_cast<std::size_t>(out_y) * target.uv_stride, target.width);
+    }
+}
+
+void convert_rows_scalar(const Plan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch);
+void scale_rows_scalar(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch);
+#if defined(GSTREAMER_WORKER_PREPROCESS_AVX2)
+void convert_rows_avx2(const Plan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch);
+void scale_rows_avx2(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch);
+std::uint64_t row_sad_avx2(const std::uint8_t* a, const std::uint8_t* b, std::size_t count);
+#endif
+#if defined(GSTREAMER_WORKER_PREPROCESS_NEON)
+void convert_rows_neon(const Plan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch);
+void scale_rows_neon(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch);
+std::uint64_t row_sad_neon(const std::uint8_t* a, const std::uint8_t* b, std::size_t count);
+#endif
+
+}  // namespace gstreamer_worker::preprocess::detail
@@ -0,0 +1,121 @@
+#include <arm_neon.h>
+
+#include "nv12_kernels.hpp"
+
+namespace gstreamer_worker::preprocess::detail {
+namespace {
+
+void blend_rows_neon(const std::uint8_t* top, const std::uint8_t* bottom, float fraction, float* out,
+                     std::size_t count) {
+    const float32x4_t weight = vdupq_n_f32(fraction);
+    std::size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        const uint16x8_t a16 = vmovl_u8(vld1_u8(top + x));
+        const uint16x8_t b16 = vmovl_u8(vld1_u8(bottom + x));
+        const float32x4_t a_low = vcvtq_f32_u32(vmovl_u16(vget_low_u16(a16)));
+        const float32x4_t a_high = vcvtq_f32_u32(vmovl_u16(vget_high_u16(a16)));
+        const float32x4_t b_low = vcvtq_f32_u32(vmovl_u16(vget_low_u16(b16)));
+        const float32x4_t b_high = vcvtq_f32_u32(vmovl_u16(vget_high_u16(b16)));
+        vst1q_f32(out + x, vfmaq_f32(a_low, weight, vsubq_f32(b_low, a_low)));
+        vst1q_f32(out + x + 4, vfmaq_f32(a_high, weight, vsubq_f32(b_high, a_high)));
+    }
+    blend_rows(top, bottom, fraction, out, x, count);
+}
+
+// NEON has no gather; collect the four taps into lanes, then blend in vector form.
+float32x4_t lerp_taps(const float* row, const std::int32_t* index0, const std::int32_t* index1,
+                      const float* fraction, std::int32_t lane_offset) {
+    float a[4];
+    float b[4];
+    for (int lane = 0; lane < 4; ++lane) {
+        a[lane] = row[index0[lane] + lane_offset];
+        b[lane] = row[index1[lane] + lane_offset];
+    }
+    const float32x4_t va = vld1q_f32(a);
+    return vfmaq_f32(va, vld1q_f32(fraction), vsubq_f32(vld1q_f32(b), va));
+}
+
+void resample_pixels_neon(const float* row, const std::int32_t* index0, const std::int32_t* index1,
+                          const float* fraction, std::uint8_t* out, std::size_t count) {
+    const float32x4_t half = vdupq_n_f32(0.5F);
+    std::size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        // Truncate after adding 0.5 like the scalar path, then narrow 32 -> 8 bits.
+        const uint32x4_t low =
+            vcvtq_u32_f32(vaddq_f32(lerp_taps(row, index0 + x, index1 + x, fraction + x, 0), half));
+        const uint32x4_t high =
+            vcvtq_u32_f32(vaddq_f32(lerp_taps(row, index0 + x + 4, index1 + x + 4, fraction + x + 4, 0), half));
+        vst1_u8(out + x, vqmovn_u16(vcombine_u16(vqmovn_u32(low), vqmovn_u32(high))));
+    }
+    resample_pixels(row, index0, index1, fraction, out, x, count);
+}
+
+float32x4_t clamp_255(float32x4_t value) {
+    return vminq_f32(vmaxq_f32(value, vdupq_n_f32(0.0F)), vdupq_n_f32(255.0F));
+}
+
+}  // namespace
+
+void convert_rows_neon(const Plan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch) {
+    prepare_scratch(plan, scratch);
+    const float32x4_t ky = vdupq_n_f32(plan.ky);
+    const float32x4_t y_offset = vdupq_n_f32(plan.y_offset);
+    const float32x4_t bias = vdupq_n_f32(128.0F);
+
+    for (std::uint32_t out_y = row_begin; out_y < row_end; ++out_y) {
+        const RowSources rows = row_sources(plan, out_y);
+        blend_rows_neon(rows.luma_top, rows.luma_bottom, rows.luma_fraction, scratch.luma.data(), luma_span(plan));
+        blend_rows_neon(rows.chroma_top, rows.chroma_bottom, rows.chroma_fraction, scratch.chroma.data(),
+                        chroma_span(plan));
+
+        const float* luma = scratch.luma.data();
+        const float* chroma = scratch.chroma.data();
+        const std::size_t row_offset = static_cast<std::size_t>(out_y) * plan.out_width;
+        std::uint32_t x = 0;
+        for (; x + 4 <= plan.out_width; x += 4) {
+            const float32x4_t sample =
+                lerp_taps(luma, plan.luma_x0.data() + x, plan.luma_x1.data() + x, plan.luma_fx.data() + x, 0);
+            const float32x4_t u = vsubq_f32(
+                lerp_taps(chroma, plan.chroma_x0.data() + x, plan.chroma_x1.data() + x, plan.chroma_fx.data() + x, 0),
+                bias);
+            const float32x4_t v = vsubq_f32(
+                lerp_taps(chroma, plan.chroma_x0.data() + x, plan.chroma_x1.data() + x, plan.chroma_fx.data() + x, 1),
+                bias);
+
+            const float32x4_t y = vmulq_f32(ky, vsubq_f32(sample, y_offset));
+            const float32x4_t rgb[3] = {
+                clamp_255(vfmaq_n_f32(y, v, plan.kr_v)),
+                clamp_255(vfmsq_f32(vfmsq_f32(y, u, vdupq_n_f32(plan.kg_u)), v, vdupq_n_f32(plan.kg_v))),
+                clamp_255(vfmaq_n_f32(y, u, plan.kb_u)),
+            };
+            for (std::size_t component = 0; component < 3; ++component) {
+                const float32x4_t normalized =
+                    vmulq_n_f32(vsubq_f32(rgb[component], vdupq_n_f32(plan.mean[component])), plan.scale[component]);
+                vst1q_f32(plan.planes[component] + row_offset + x, normalized);
+            }
+        }
+        convert_pixels(plan, scratch, row_offset, x, plan.out_width);
+    }
+}
+
+void scale_rows_neon(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch) {
+    scale_rows(plan, row_begin, row_end, scratch, blend_rows_neon, resample_pixels_neon);
+}
+
+std::uint64_t row_sad_neon(const std::uint8_t* a, const std::uint8_t* b, std::size_t count) {
+    // 16-bit pairwise accumulators hold 128 steps of 2 x 255 before they are
+    // widened into the 32-bit ones.
+    uint32x4_t wide = vdupq_n_u32(0);
+    std::size_t x = 0;
+    while (x + 16 <= count) {
+        uint16x8_t narrow = vdupq_n_u16(0);
+        const std::size_t stop = std::min(count & ~std::size_t{15}, x + 16 * 128);
+        for (; x < stop; x += 16) {
+            narrow = vpadalq_u8(narrow, vabdq_u8(vld1q_u8(a + x), vld1q_u8(b + x)));
+        }
+        wide = vpadalq_u16(wide, narrow);
+    }
+    return vaddlvq_u32(wide) + row_sad(a, b, x, count);
+}
+
+}  // namespace gstreamer_worker::preprocess::detail
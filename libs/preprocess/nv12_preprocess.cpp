@@ -0,0 +1,467 @@
+#include "gstreamer_worker/preprocess/nv12_preprocess.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "nv12_kernels.hpp"
+
+namespace gstreamer_worker::preprocess {
+namespace detail {
+
+Plan make_plan(const Nv12Image& image, const PreprocessParams& params, float* output) {
+    if (!image.y || !image.uv || image.width == 0 || image.height == 0) {
+        throw std::invalid_argument("NV12 preprocessing requires a mapped frame");
+    }
+    if (image.v) {
+        throw std::invalid_argument("NV12 preprocessing takes semi-planar NV12 only");
+    }
+    if (params.output_width == 0 || params.output_height == 0 || !output) {
+        throw std::invalid_argument("NV12 preprocessing requires an output size and buffer");
+    }
+    Rect crop = params.crop;
+    if (crop.width == 0 || crop.height == 0) {
+        crop = Rect{0, 0, image.width, image.height};
+    }
+    if (crop.x + crop.width > image.width || crop.y + crop.height > image.height) {
+        throw std::invalid_argument("Crop rectangle lies outside the frame");
+    }
+
+    Plan plan;
+    plan.image = &image;
+    plan.out_width = params.output_width;
+    plan.out_height = params.output_height;
+    plan.plane_size = static_cast<std::size_t>(params.output_width) * params.output_height;
+    plan.crop_y = static_cast<float>(crop.y);
+    plan.crop_height = static_cast<float>(crop.height);
+
+    const auto crop_x = static_cast<float>(crop.x);
+    const auto crop_width = static_cast<float>(crop.width);
+    const auto luma_limit = static_cast<std::int32_t>(image.width);
+    const auto chroma_limit = static_cast<std::int32_t>((image.width + 1) / 2);
+    std::vector<Tap> luma(plan.out_width);
+    std::vector<Tap> chroma(plan.out_width);
+    plan.luma_begin = luma_limit;
+    plan.chroma_begin = chroma_limit;
+    for (std::uint32_t x = 0; x < plan.out_width; ++x) {
+        luma[x] = make_tap(x, plan.out_width, crop_x, crop_width, luma_limit);
+        chroma[x] = make_tap(x, plan.out_width, crop_x * 0.5F, crop_width * 0.5F, chroma_limit);
+        plan.luma_begin = std::min(plan.luma_begin, luma[x].index0);
+        plan.luma_end = std::max(plan.luma_end, luma[x].index1 + 1);
+        plan.chroma_begin = std::min(plan.chroma_begin, chroma[x].index0);
+        plan.chroma_end = std::max(plan.chroma_end, chroma[x].index1 + 1);
+    }
+    plan.luma_x0.reserve(plan.out_width);
+    plan.luma_x1.reserve(plan.out_width);
+    plan.luma_fx.reserve(plan.out_width);
+    plan.chroma_x0.reserve(plan.out_width);
+    plan.chroma_x1.reserve(plan.out_width);
+    plan.chroma_fx.reserve(plan.out_width);
+    for (std::uint32_t x = 0; x < plan.out_width; ++x) {
+        plan.luma_x0.push_back(luma[x].index0 - plan.luma_begin);
+        plan.luma_x1.push_back(luma[x].index1 - plan.luma_begin);
+        plan.luma_fx.push_back(luma[x].fraction);
+        plan.chroma_x0.push_back(2 * (chroma[x].index0 - plan.chroma_begin));
+        plan.chroma_x1.push_back(2 * (chroma[x].index1 - plan.chroma_begin));
+        plan.chroma_fx.push_back(chroma[x].fraction);
+    }
+
+    float kc = 1.0F;
+    if (!params.full_range) {
+        plan.ky = 255.0F / 219.0F;
+        plan.y_offset = 16.0F;
+        kc = 255.0F / 224.0F;
+    }
+    if (params.matrix == ColorMatrix::Bt709) {
+        plan.kr_v = 1.5748F * kc;
+        plan.kg_u = 0.187324F * kc;
+        plan.kg_v = 0.468124F * kc;
+        plan.kb_u = 1.8556F * kc;
+    } else {
+        plan.kr_v = 1.402F * kc;
+        plan.kg_u = 0.344136F * kc;
+        plan.kg_v = 0.714136F * kc;
+        plan.kb_u = 1.772F * kc;
+    }
+
+    // Output channel holding R, G and B respectively.
+    const std::size_t channel[3] = {params.order == ChannelOrder::Rgb ? 0U : 2U, 1U,
+                                    params.order == ChannelOrder::Rgb ? 2U : 0U};
+    for (std::size_t component = 0; component < 3; ++component) {
+        plan.mean[component] = params.mean[channel[component]];
+        plan.scale[component] = params.scale[channel[component]];
+        plan.planes[component] = output + channel[component] * plan.plane_size;
+    }
+    return plan;
+}
+
+void convert_rows_scalar(const Plan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch) {
+    prepare_scratch(plan, scratch);
+    for (std::uint32_t out_y = row_begin; out_y < row_end; ++out_y) {
+        const RowSources rows = row_sources(plan, out_y);
+        blend_rows(rows.luma_top, rows.luma_bottom, rows.luma_fraction, scratch.luma.data(), 0, luma_span(plan));
+        blend_rows(rows.chroma_top, rows.chroma_bottom, rows.chroma_fraction, scratch.chroma.data(), 0,
+                   chroma_span(plan));
+        convert_pixels(plan, scratch, static_cast<std::size_t>(out_y) * plan.out_width, 0, plan.out_width);
+    }
+}
+
+ScalePlan make_scale_plan(const Nv12Image& image, const Nv12Target& target) {
+    if (!image.y || !image.uv || image.width == 0 || image.height == 0 || (image.v && image.v_stride == 0)) {
+        throw std::invalid_argument("NV12 scaling requires a mapped frame");
+    }
+    if (!target.y || !target.uv || target.width == 0 || target.height == 0) {
+        throw std::invalid_argument("NV12 scaling requires a target region");
+    }
+    if (target.width % 2 != 0 || target.height % 2 != 0) {
+        throw std::invalid_argument("NV12 scaling target must have an even size");
+    }
+
+    ScalePlan plan;
+    plan.image = &image;
+    plan.target = &target;
+    const auto luma_limit = static_cast<std::int32_t>(image.width);
+    const auto chroma_limit = static_cast<std::int32_t>((image.width + 1) / 2);
+    const std::uint32_t chroma_width = target.width / 2;
+    std::vector<Tap> luma(target.width);
+    std::vector<Tap> chroma(chroma_width);
+    plan.luma_begin = luma_limit;
+    plan.chroma_begin = chroma_limit;
+    for (std::uint32_t x = 0; x < target.width; ++x) {
+        luma[x] = make_tap(x, target.width, 0.0F, static_cast<float>(image.width), luma_limit);
+        plan.luma_begin = std::min(plan.luma_begin, luma[x].index0);
+        plan.luma_end = std::max(plan.luma_end, luma[x].index1 + 1);
+    }
+    for (std::uint32_t x = 0; x < chroma_width; ++x) {
+        chroma[x] = make_tap(x, chroma_width, 0.0F, static_cast<float>(image.width) * 0.5F, chroma_limit);
+        plan.chroma_begin = std::min(plan.chroma_begin, chroma[x].index0);
+        plan.chroma_end = std::max(plan.chroma_end, chroma[x].index1 + 1);
+    }
+    plan.luma_x0.reserve(target.width);
+    plan.luma_x1.reserve(target.width);
+    plan.luma_fx.reserve(target.width);
+    for (const Tap& tap : luma) {
+        plan.luma_x0.push_back(tap.index0 - plan.luma_begin);
+        plan.luma_x1.push_back(tap.index1 - plan.luma_begin);
+        plan.luma_fx.push_back(tap.fraction);
+    }
+    plan.chroma_x0.reserve(target.width);
+    plan.chroma_x1.reserve(target.width);
+    plan.chroma_fx.reserve(target.width);
+    // A planar source is blended into the scratch row as all U, then all V;
+    // the taps pick from both halves so the output is interleaved either way.
+    const std::int32_t sites = plan.chroma_end - plan.chroma_begin;
+    for (const Tap& tap : chroma) {
+        for (std::int32_t component = 0; component < 2; ++component) {
+            if (image.v) {
+                plan.chroma_x0.push_back(component * sites + tap.index0 - plan.chroma_begin);
+                plan.chroma_x1.push_back(component * sites + tap.index1 - plan.chroma_begin);
+            } else {
+                plan.chroma_x0.push_back(2 * (tap.index0 - plan.chroma_begin) + component);
+                plan.chroma_x1.push_back(2 * (tap.index1 - plan.chroma_begin) + component);
+            }
+            plan.chroma_fx.push_back(tap.fraction);
+        }
+    }
+    // Chroma elements (two per site) from here on.
+    plan.chroma_begin *= 2;
+    plan.chroma_end *= 2;
+    return plan;
+}
+
+void scale_rows_scalar(const ScalePlan& plan, std::uint32_t row_begin, std::uint32_t row_end, Scratch& scratch) {
+    scale_rows(
+        plan, row_begin, row_end, scratch,
+        [](const std::uint8_t* top, const std::uint8_t* bottom, float fraction, float* out, std::size_t count) {
+            blend_rows(top, bottom, fraction, out, 0, count);
+        },
+        [](const float* row, const std::int32_t* index0, const std::int32_t* index1, const float* fraction,
+           std::uint8_t* out, std::size_t count) { resample_pixels(row, index0, index1, fraction, out, 0, count); });
+}
+
+}  // namespace detail
+
+namespace {
+
+using RowKernel = void (*)(const detail::Plan&, std::uint32_t, std::uint32_t, detail::Scratch&);
+
+bool cpu_has_avx2() {
+#if defined(GSTREAMER_WORKER_PREPROCESS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+bool available(Backend backend) {
+    switch (backend) {
+        case Backend::Avx2:
+            return cpu_has_avx2();
+        case Backend::Neon:
+#if defined(GSTREAMER_WORKER_PREPROCESS_NEON)
+            return true;
+#else
+            return false;
+#endif
+        case Backend::Scalar:
+        case Backend::Auto:
+        default:
+            return true;
+    }
+}
+
+Backend resolve(Backend backend) {
+    if (backend == Backend::Auto) {
+        return best_backend();
+    }
+    if (!available(backend)) {
+        throw std::invalid_argument(std::string("Preprocessing backend not available: ") + backend_name(backend));
+    }
+    return backend;
+}
+
+RowKernel kernel_for(Backend backend) {
+    switch (backend) {
+#if defined(GSTREAMER_WORKER_PREPROCESS_AVX2)
+        case Backend::Avx2:
+            return detail::convert_rows_avx2;
+#endif
+#if defined(GSTREAMER_WORKER_PREPROCESS_NEON)
+        case Backend::Neon:
+            return detail::convert_rows_neon;
+#endif
+        default:
+            return detail::convert_rows_scalar;
+    }
+}
+
+using ScaleKernel = void (*)(const detail::ScalePlan&, std::uint32_t, std::uint32_t, detail::Scratch&);
+
+ScaleKernel scale_kernel_for(Backend backend) {
+    switch (backend) {
+#if defined(GSTREAMER_WORKER_PREPROCESS_AVX2)
+        case Backend::Avx2:
+            return detail::scale_rows_avx2;
+#endif
+#if defined(GSTREAMER_WORKER_PREPROCESS_NEON)
+        case Backend::Neon:
+            return detail::scale_rows_neon;
+#endif
+        default:
+            return detail::scale_rows_scalar;
+    }
+}
+
+using SadKernel = std::uint64_t (*)(const std::uint8_t*, const std::uint8_t*, std::size_t);
+
+std::uint64_t row_sad_scalar(const std::uint8_t* a, const std::uint8_t* b, std::size_t count) {
+    return detail::row_sad(a, b, 0, count);
+}
+
+SadKernel sad_kernel_for(Backend backend) {
+    switch (backend) {
+#if defined(GSTREAMER_WORKER_PREPROCESS_AVX2)
+        case Backend::Avx2:
+            return detail::row_sad_avx2;
+#endif
+#if defined(GSTREAMER_WORKER_PREPROCESS_NEON)
+        case Backend::Neon:
+            return detail::row_sad_neon;
+#endif
+        default:
+            return row_sad_scalar;
+    }
+}
+
+detail::Scratch& thread_scratch() {
+    thread_local detail::Scratch scratch;
+    return scratch;
+}
+
+}  // namespace
+
+Nv12Image nv12_view(const void* base,
+                    std::uint32_t width,
+                    std::uint32_t height,
+                    const std::size_t offsets[2],
+                    const std::size_t strides[2]) {
+    const auto* bytes = static_cast<const std::uint8_t*>(base);
+    Nv12Image image;
+    image.y = bytes + offsets[0];
+    image.uv = bytes + offsets[1];
+    image.y_stride = strides[0];
+    image.uv_stride = strides[1];
+    image.width = width;
+    image.height = height;
+    return image;
+}
+
+Nv12Target nv12_region(void* base,
+                       std::uint32_t width,
+                       std::uint32_t height,
+                       const std::size_t offsets[2],
+                       const std::size_t strides[2],
+                       const Rect& rect) {
+    if (rect.x + rect.width > width || rect.y + rect.height > height) {
+        throw std::invalid_argument("NV12 region lies outside the frame");
+    }
+    if ((rect.x | rect.y | rect.width | rect.height) % 2 != 0) {
+        throw std::invalid_argument("NV12 region must have an even position and size");
+    }
+    auto* bytes = static_cast<std::uint8_t*>(base);
+    Nv12Target target;
+    target.y = bytes + offsets[0] + rect.y * strides[0] + rect.x;
+    target.uv = bytes + offsets[1] + (rect.y / 2) * strides[1] + rect.x;
+    target.y_stride = strides[0];
+    target.uv_stride = strides[1];
+    target.width = rect.width;
+    target.height = rect.height;
+    return target;
+}
+
+Backend best_backend() {
+#if defined(GSTREAMER_WORKER_PREPROCESS_NEON)
+    return Backend::Neon;
+#else
+    return cpu_has_avx2() ? Backend::Avx2 : Backend::Scalar;
+#endif
+}
+
+const char* backend_name(Backend backend) {
+    switch (backend) {
+        case Backend::Scalar:
+            return "scalar";
+        case Backend::Avx2:
+            return "avx2";
+        case Backend::Neon:
+            return "neon";
+        case Backend::Auto:
+        default:
+            return "auto";
+    }
+}
+
+void nv12_to_planar(const Nv12Image& image, const PreprocessParams& params, float* output, Backend backend) {
+    const detail::Plan plan = detail::make_plan(image, params, output);
+    kernel_for(resolve(backend))(plan, 0, plan.out_height, thread_scratch());
+}
+
+void nv12_scale(const Nv12Image& image, const Nv12Target& target, Backend backend) {
+    const detail::ScalePlan plan = detail::make_scale_plan(image, target);
+    scale_kernel_for(resolve(backend))(plan, 0, target.height, thread_scratch());
+}
+
+std::uint32_t sampled_rows(std::uint32_t height, std::uint32_t row_step) {
+    row_step = std::max<std::uint32_t>(row_step, 1);
+    return (height + row_step - 1) / row_step;
+}
+
+std::uint64_t sampled_plane_sad(const std::uint8_t* plane,
+                                std::size_t stride,
+                                std::uint32_t width,
+                                std::uint32_t height,
+                                std::uint32_t row_step,
+                                const std::uint8_t* reference,
+                                Backend backend) {
+    const SadKernel kernel = sad_kernel_for(resolve(backend));
+    row_step = std::max<std::uint32_t>(row_step, 1);
+    std::uint64_t sum = 0;
+    for (std::uint32_t y = 0; y < height; y += row_step) {
+        sum += kernel(plane + static_cast<std::size_t>(y) * stride, reference, width);
+        reference += width;
+    }
+    return sum;
+}
+
+void copy_sampled_rows(const std::uint8_t* plane,
+                       std::size_t stride,
+                       std::uint32_t width,
+                       std::uint32_t height,
+                       std::uint32_t row_step,
+                       std::uint8_t* reference) {
+    row_step = std::max<std::uint32_t>(row_step, 1);
+    for (std::uint32_t y = 0; y < height; y += row_step) {
+        std::memcpy(reference, plane + static_cast<std::size_t>(y) * stride, width);
+        reference += width;
+    }
+}
+
+Preprocessor::Preprocessor(std::size_t threads, Backend backend) : backend_(resolve(backend)) {
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    // The calling thread takes a share of the bands too.
+    workers_.reserve(threads - 1);
+    for (std::size_t index = 1; index < threads; ++index) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+Preprocessor::~Preprocessor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void Preprocessor::nv12_to_planar(const Nv12Image& image, const PreprocessParams& params, float* output) {
+    const detail::Plan plan = detail::make_plan(image, params, output);
+    const RowKernel kernel = kernel_for(backend_);
+    // A few bands per thread evens out uneven scheduling without splitting
+    // rows so finely that the blend setup dominates.
+    const std::size_t bands = std::min<std::size_t>(plan.out_height, threads() * 4);
+    const std::size_t rows_per_band = (plan.out_height + bands - 1) / bands;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = [&](std::size_t band) {
+        const auto begin = static_cast<std::uint32_t>(band * rows_per_band);
+        const auto end = static_cast<std::uint32_t>(std::min<std::size_t>(plan.out_height, begin + rows_per_band));
+        if (begin < end) {
+            kernel(plan, begin, end, thread_scratch());
+        }
+    };
+    bands_ = bands;
+    next_band_.store(0, std::memory_order_relaxed);
+    pending_workers_ = workers_.size();
+    ++generation_;
+    lock.unlock();
+    work_cv_.notify_all();
+
+    run_bands();
+
+    lock.lock();
+    done_cv_.wait(lock, [this] { return pending_workers_ == 0; });
+    job_ = nullptr;
+}
+
+void Preprocessor::run_bands() {
+    for (std::size_t band = next_band_.fetch_add(1, std::memory_order_relaxed); band < bands_;
+         band = next_band_.fetch_add(1, std::memory_order_relaxed)) {
+        job_(band);
+    }
+}
+
+void Preprocessor::worker_loop() {
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+        run_bands();
+        lock.lock();
+        if (--pending_workers_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+}  // namespace gstreamer_worker::preprocess
@@ -3,6 +3,7 @@
 #include <stdexcept>
 
 #include <gst/allocators/gstdmabuf.h>
+#include <gst/allocators/gstfdmemory.h>
 
 #if defined(G_OS_UNIX)
 #include <unistd.h>
@@ -12,7 +13,7 @@
 
 namespace gstreamer_worker::zerocopy {
 namespace {
-GstMemory* find_dmabuf_memory(GstBuffer* buffer) {
+GstMemory* find_memory(GstBuffer* buffer, gboolean (*matches)(GstMemory*)) {
     if (!buffer) {
         return nullptr;
     }
@@ -20,13 +21,23 @@ GstMemory* find_dmabuf_memory(GstBuffer* buffer) {
     guint memories = gst_buffer_n_memory(buffer);
     for (guint index = 0; index < memories; ++index) {
         GstMemory* memory = gst_buffer_peek_memory(buffer, index);
-        if (memory && gst_is_dmabuf_memory(memory)) {
+        if (memory && matches(memory)) {
             return memory;
         }
     }
     return nullptr;
 }
 
+GstMemory* find_dmabuf_memory(GstBuffer* buffer) {
+    return find_memory(buffer, gst_is_dmabuf_memory);
+}
+
+// DMA-BUF allocators derive from the fd allocator, so this also finds them;
+// callers try find_dmabuf_memory first.
+GstMemory* find_fd_memory(GstBuffer* buffer) {
+    return find_memory(buffer, gst_is_fd_memory);
+}
+
 }  // namespace
 
 BufferExporter::BufferExporter(Callback callback) : callback_(std::move(callback)) {
@@ -46,9 +57,11 @@ bool BufferExporter::export_sample(GstSample* sample) const {
     }
 
     ExportPacket packet;
+    packet.buffer = buffer;
 
     if (const auto* meta = get_frame_meta(buffer)) {
         packet.metadata = meta->payload;
+        packet.sections = get_frame_sections(buffer);
     }
 
     GstCaps* caps = gst_sample_get_caps(sample);
@@ -57,6 +70,7 @@ bool BufferExporter::export_sample(GstSample* sample) const {
     }
 
     packet.dma_fd = acquire_dmabuf_fd(buffer);
+    packet.dmabuf = packet.dma_fd >= 0 && has_dmabuf(buffer);
 
     callback_(packet);
 
@@ -85,10 +99,13 @@ bool BufferExporter::has_dmabuf(const GstBuffer* buffer) {
 int BufferExporter::acquire_dmabuf_fd(GstBuffer* buffer) {
 #if defined(G_OS_UNIX)
     GstMemory* memory = find_dmabuf_memory(buffer);
+    if (!memory) {
+        memory = find_fd_memory(buffer);
+    }
     if (!memory) {
         return -1;
     }
-    int fd = gst_dmabuf_memory_get_fd(memory);
+    int fd = gst_fd_memory_get_fd(memory);
     if (fd < 0) {
         return -1;
     }
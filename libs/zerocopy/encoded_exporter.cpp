@@ -0,0 +1,64 @@
+#include "gstreamer_worker/zerocopy/encoded_exporter.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace gstreamer_worker::zerocopy {
+
+EncodedExporter::EncodedExporter(Callback callback) : callback_(std::move(callback)) {
+    if (!callback_) {
+        throw std::invalid_argument("EncodedExporter requires a callback");
+    }
+}
+
+bool EncodedExporter::export_sample(GstSample* sample) const {
+    if (!sample) {
+        return false;
+    }
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    if (!buffer) {
+        return false;
+    }
+
+    EncodedPacket packet;
+    packet.buffer = buffer;
+    packet.caps = gst_sample_get_caps(sample);
+    packet.keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    packet.pts = GST_BUFFER_PTS(buffer);
+    packet.dts = GST_BUFFER_DTS(buffer);
+    if (const auto* meta = get_frame_meta(buffer)) {
+        packet.metadata = meta->payload;
+        packet.sections = get_frame_sections(buffer);
+    }
+
+    // gst_buffer_map() would merge several memories into a new allocation;
+    // mapping them one by one never copies.
+    std::array<GstMapInfo, 16> maps{};
+    const guint memories = gst_buffer_n_memory(buffer);
+    if (memories > maps.size()) {
+        return false;
+    }
+    bool mapped = true;
+    for (guint index = 0; index < memories; ++index) {
+        GstMemory* memory = gst_buffer_peek_memory(buffer, index);
+        if (!gst_memory_map(memory, &maps[index], GST_MAP_READ)) {
+            mapped = false;
+            break;
+        }
+        packet.chunks[index] = EncodedChunk{maps[index].data, maps[index].size};
+        packet.size += maps[index].size;
+        ++packet.chunk_count;
+    }
+
+    if (mapped) {
+        callback_(packet);
+    }
+
+    for (std::size_t index = 0; index < packet.chunk_count; ++index) {
+        gst_memory_unmap(gst_buffer_peek_memory(buffer, static_cast<guint>(index)), &maps[index]);
+    }
+    return mapped;
+}
+
+}  // namespace gstreamer_worker::zerocopy
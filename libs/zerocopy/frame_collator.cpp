@@ -0,0 +1,191 @@
+#include "gstreamer_worker/zerocopy/frame_collator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#if defined(G_OS_UNIX)
+#include <unistd.h>
+#endif
+
+namespace gstreamer_worker::zerocopy {
+
+FrameCollator::FrameCollator(FrameCollatorConfig config, Callback callback)
+    : config_(config), callback_(std::move(callback)), pending_(config.streams) {
+    if (config_.streams == 0) {
+        throw std::invalid_argument("FrameCollator requires at least one stream");
+    }
+    if (!callback_) {
+        throw std::invalid_argument("FrameCollator requires a callback");
+    }
+    if (config_.max_pending == 0) {
+        config_.max_pending = 1;
+    }
+}
+
+FrameCollator::~FrameCollator() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& queue : pending_) {
+        for (auto& entry : queue) {
+            discard(entry.packet);
+        }
+        queue.clear();
+    }
+}
+
+bool FrameCollator::push(std::size_t stream, const ExportPacket& packet) {
+    ExportPacket owned = packet;
+    if (owned.caps) {
+        gst_caps_ref(owned.caps);
+    }
+    if (owned.buffer) {
+        gst_buffer_ref(owned.buffer);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const GstClockTime ts = owned.metadata.capture_ts;
+    if (stream >= pending_.size() || !GST_CLOCK_TIME_IS_VALID(ts)) {
+        discard(owned);
+        return false;
+    }
+    // Anything that would have belonged to an already released batch is late.
+    if (GST_CLOCK_TIME_IS_VALID(last_batch_ts_) && ts <= last_batch_ts_ + config_.tolerance) {
+        ++stats_.dropped_late;
+        discard(owned);
+        return false;
+    }
+
+    auto& queue = pending_[stream];
+    if (queue.size() >= config_.max_pending) {
+        ++stats_.dropped_overflow;
+        discard(queue.front().packet);
+        queue.pop_front();
+    }
+    queue.push_back(Pending{owned, std::chrono::steady_clock::now()});
+    collate(false);
+    return true;
+}
+
+void FrameCollator::poll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    collate(false);
+}
+
+void FrameCollator::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    collate(true);
+}
+
+BufferExporter::Callback FrameCollator::input(std::size_t stream) {
+    return [this, stream](const ExportPacket& packet) { push(stream, packet); };
+}
+
+FrameCollator::Stats FrameCollator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// Repeatedly forms a batch around the earliest pending frame. Streams whose
+// head is beyond the tolerance window skipped that instant and are missing for
+// certain; streams with nothing pending might still deliver, so the batch waits
+// for them until max_wait has passed since its oldest frame arrived.
+void FrameCollator::collate(bool force) {
+    const auto now = std::chrono::steady_clock::now();
+    while (true) {
+        GstClockTime first = GST_CLOCK_TIME_NONE;
+        for (const auto& queue : pending_) {
+            if (!queue.empty() && (!GST_CLOCK_TIME_IS_VALID(first) || queue.front().packet.metadata.capture_ts < first)) {
+                first = queue.front().packet.metadata.capture_ts;
+            }
+        }
+        if (!GST_CLOCK_TIME_IS_VALID(first)) {
+            return;
+        }
+
+        const GstClockTime window_end = first + config_.tolerance;
+        std::size_t present = 0;
+        bool awaiting = false;
+        auto oldest_arrival = now;
+        for (const auto& queue : pending_) {
+            if (queue.empty()) {
+                awaiting = true;
+            } else if (queue.front().packet.metadata.capture_ts <= window_end) {
+                ++present;
+                oldest_arrival = std::min(oldest_arrival, queue.front().arrival);
+            }
+        }
+        if (present < pending_.size() && awaiting && !force && now - oldest_arrival < config_.max_wait) {
+            return;
+        }
+
+        std::vector<ExportPacket> frames(pending_.size());
+        GstClockTime last = first;
+        for (std::size_t stream = 0; stream < pending_.size(); ++stream) {
+            auto& queue = pending_[stream];
+            if (!queue.empty() && queue.front().packet.metadata.capture_ts <= window_end) {
+                frames[stream] = queue.front().packet;
+                last = std::max(last, frames[stream].metadata.capture_ts);
+                queue.pop_front();
+            }
+        }
+        last_batch_ts_ = first;
+        release(frames, present, first, last);
+    }
+}
+
+void FrameCollator::release(std::vector<ExportPacket>& frames,
+                            std::size_t present,
+                            GstClockTime first,
+                            GstClockTime last) {
+    const bool complete = present == frames.size();
+    if (!complete && !config_.deliver_partial) {
+        ++stats_.dropped_partial;
+        for (auto& frame : frames) {
+            discard(frame);
+        }
+        return;
+    }
+
+    CollatedBatch batch;
+    batch.capture_ts = first;
+    batch.spread = last - first;
+    batch.frames = std::move(frames);
+    batch.present = present;
+    ++stats_.batches;
+    ++(complete ? stats_.complete : stats_.partial);
+
+    callback_(batch);
+
+    // The callback owns the fds; only the caps and buffer references are ours
+    // to drop.
+    for (auto& frame : batch.frames) {
+        if (frame.caps) {
+            gst_caps_unref(frame.caps);
+            frame.caps = nullptr;
+        }
+        if (frame.buffer) {
+            gst_buffer_unref(frame.buffer);
+            frame.buffer = nullptr;
+        }
+    }
+}
+
+void FrameCollator::discard(ExportPacket& packet) {
+#if defined(G_OS_UNIX)
+    if (packet.dma_fd >= 0) {
+        close(packet.dma_fd);
+    }
+#endif
+    packet.dma_fd = -1;
+    if (packet.caps) {
+        gst_caps_unref(packet.caps);
+        packet.caps = nullptr;
+    }
+    if (packet.buffer) {
+        gst_buffer_unref(packet.buffer);
+        packet.buffer = nullptr;
+    }
+    packet.sections = {};
+}
+
+}  // namespace gstreamer_worker::zerocopy
@@ -9,10 +9,16 @@ namespace {
 gboolean frame_meta_init(GstMeta* meta, gpointer /*params*/, GstBuffer* /*buffer*/) {
     auto* frame_meta = reinterpret_cast<FrameMeta*>(meta);
     frame_meta->payload = {};
+    frame_meta->sections = nullptr;
     return TRUE;
 }
 
-void frame_meta_free(GstMeta* /*meta*/, GstBuffer* /*buffer*/) {}
+void frame_meta_free(GstMeta* meta, GstBuffer* /*buffer*/) {
+    auto* frame_meta = reinterpret_cast<FrameMeta*>(meta);
+    // Hands the block back to its arena once no other buffer shares it.
+    detail::release(frame_meta->sections);
+    frame_meta->sections = nullptr;
+}
 
 gboolean frame_meta_transform(GstBuffer* dest,
                               GstMeta* meta,
@@ -20,7 +26,13 @@ gboolean frame_meta_transform(GstBuffer* dest,
                               GQuark /*type*/,
                               gpointer /*data*/) {
     auto* frame_meta = reinterpret_cast<FrameMeta*>(meta);
-    add_frame_meta(dest, frame_meta->payload);
+    FrameMeta* copy = add_frame_meta(dest, frame_meta->payload);
+    if (!copy) {
+        return FALSE;
+    }
+    // Sections are frozen once attached, so the copy shares the block.
+    detail::retain(frame_meta->sections);
+    copy->sections = frame_meta->sections;
     return TRUE;
 }
 
@@ -55,7 +67,9 @@ GType frame_meta_api_type() {
             return existing_type;
         }
         
-        static const gchar* tags[] = {"gstreamer-worker-frame-meta", nullptr};
+        // No tags: encoders, parsers and (de)payloaders only carry metas that
+        // are not tied to a media property, and this one describes the frame.
+        static const gchar* tags[] = {nullptr};
         GType type = gst_meta_api_type_register("GStreamerWorkerFrameMetaAPI", tags);
         if (type == 0) {
             g_critical("Failed to register GStreamerWorkerFrameMetaAPI type");
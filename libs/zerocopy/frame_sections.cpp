@@ -0,0 +1,406 @@
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+
+namespace gstreamer_worker::zerocopy {
+namespace detail {
+
+// Block memory: this header, then `capacity` bytes holding the serialized
+// sections (BlockHeader followed by SectionHeader + payload records).
+struct SectionBlock {
+    // Null for oversize blocks, which are freed instead of pooled.
+    ArenaPool* pool{nullptr};
+    std::atomic<std::uint32_t> refs{1};
+    std::uint32_t capacity{0};
+    std::uint32_t used{0};
+
+    std::byte* data() { return reinterpret_cast<std::byte*>(this) + kDataOffset; }
+    const std::byte* data() const { return reinterpret_cast<const std::byte*>(this) + kDataOffset; }
+
+    static constexpr std::size_t kDataOffset = 32;
+};
+
+static_assert(sizeof(SectionBlock) <= SectionBlock::kDataOffset);
+
+struct ArenaPool {
+    std::atomic<std::uint32_t> refs{1};
+    std::size_t block_size{0};
+    std::size_t max_free{0};
+    std::mutex mutex;
+    std::vector<SectionBlock*> free;
+    std::atomic<std::uint64_t> acquired{0};
+    std::atomic<std::uint64_t> reused{0};
+    std::atomic<std::uint64_t> oversize{0};
+};
+
+}  // namespace detail
+
+namespace {
+
+using detail::ArenaPool;
+using detail::SectionBlock;
+
+constexpr std::uint16_t kBlockMagic = 0x5346;  // "FS"
+
+struct BlockHeader {
+    std::uint16_t magic{kBlockMagic};
+    std::uint8_t version{kFrameSectionsVersion};
+    std::uint8_t reserved{0};
+    // Serialized length, this header included.
+    std::uint32_t length{0};
+};
+
+struct SectionHeader {
+    std::uint16_t type{0};
+    std::uint16_t version{0};
+    std::uint32_t size{0};
+};
+
+static_assert(sizeof(BlockHeader) == 8 && sizeof(SectionHeader) == 8);
+
+constexpr std::size_t align8(std::size_t size) {
+    return (size + 7) & ~std::size_t{7};
+}
+
+SectionBlock* allocate_block(std::size_t capacity, ArenaPool* pool) {
+    void* memory = ::operator new(SectionBlock::kDataOffset + capacity);
+    auto* block = new (memory) SectionBlock{};
+    block->pool = pool;
+    block->capacity = static_cast<std::uint32_t>(capacity);
+    return block;
+}
+
+void destroy_block(SectionBlock* block) {
+    block->~SectionBlock();
+    ::operator delete(block);
+}
+
+void start_block(SectionBlock* block) {
+    const BlockHeader header{};
+    std::memcpy(block->data(), &header, sizeof(header));
+    block->used = sizeof(BlockHeader);
+}
+
+void seal_block(SectionBlock* block) {
+    BlockHeader header{};
+    header.length = block->used;
+    std::memcpy(block->data(), &header, sizeof(header));
+}
+
+void pool_unref(ArenaPool* pool) {
+    if (pool->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    for (SectionBlock* block : pool->free) {
+        destroy_block(block);
+    }
+    delete pool;
+}
+
+SectionBlock* acquire_block(ArenaPool* pool) {
+    SectionBlock* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (!pool->free.empty()) {
+            block = pool->free.back();
+            pool->free.pop_back();
+        }
+    }
+    pool->acquired.fetch_add(1, std::memory_order_relaxed);
+    if (block) {
+        pool->reused.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        block = allocate_block(pool->block_size, pool);
+    }
+    // Every block out of the free list keeps the pool alive.
+    pool->refs.fetch_add(1, std::memory_order_relaxed);
+    block->refs.store(1, std::memory_order_relaxed);
+    start_block(block);
+    return block;
+}
+
+void recycle_block(SectionBlock* block) {
+    ArenaPool* pool = block->pool;
+    if (!pool) {
+        destroy_block(block);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (pool->free.size() < pool->max_free) {
+            pool->free.push_back(block);
+            block = nullptr;
+        }
+    }
+    if (block) {
+        destroy_block(block);
+    }
+    pool_unref(pool);
+}
+
+// Walks a serialized block and checks every section stays inside it.
+bool valid_block(std::span<const std::byte> bytes) {
+    if (bytes.size() < sizeof(BlockHeader)) {
+        return false;
+    }
+    BlockHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kBlockMagic || header.version != kFrameSectionsVersion || header.length != bytes.size()) {
+        return false;
+    }
+    std::size_t offset = sizeof(BlockHeader);
+    while (offset < bytes.size()) {
+        if (bytes.size() - offset < sizeof(SectionHeader)) {
+            return false;
+        }
+        SectionHeader section;
+        std::memcpy(&section, bytes.data() + offset, sizeof(section));
+        const std::size_t step = sizeof(SectionHeader) + align8(section.size);
+        if (step > bytes.size() - offset) {
+            return false;
+        }
+        offset += step;
+    }
+    return offset == bytes.size();
+}
+
+}  // namespace
+
+namespace detail {
+
+void retain(SectionBlock* block) {
+    if (block) {
+        block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void release(SectionBlock* block) {
+    if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        recycle_block(block);
+    }
+}
+
+}  // namespace detail
+
+SectionView FrameSections::Iterator::operator*() const {
+    SectionHeader header;
+    std::memcpy(&header, cursor_, sizeof(header));
+    return SectionView{static_cast<SectionType>(header.type), header.version, cursor_ + sizeof(SectionHeader),
+                       header.size};
+}
+
+FrameSections::Iterator& FrameSections::Iterator::operator++() {
+    SectionHeader header;
+    std::memcpy(&header, cursor_, sizeof(header));
+    cursor_ = std::min(end_, cursor_ + sizeof(SectionHeader) + align8(header.size));
+    return *this;
+}
+
+FrameSections::FrameSections(const FrameSections& other) : block_(other.block_) {
+    detail::retain(block_);
+}
+
+FrameSections& FrameSections::operator=(const FrameSections& other) {
+    if (this != &other) {
+        detail::retain(other.block_);
+        detail::release(block_);
+        block_ = other.block_;
+    }
+    return *this;
+}
+
+FrameSections::FrameSections(FrameSections&& other) noexcept : block_(std::exchange(other.block_, nullptr)) {}
+
+FrameSections& FrameSections::operator=(FrameSections&& other) noexcept {
+    if (this != &other) {
+        detail::release(block_);
+        block_ = std::exchange(other.block_, nullptr);
+    }
+    return *this;
+}
+
+FrameSections::~FrameSections() {
+    detail::release(block_);
+}
+
+bool FrameSections::empty() const {
+    return !block_ || block_->used <= sizeof(BlockHeader);
+}
+
+std::size_t FrameSections::count() const {
+    return static_cast<std::size_t>(std::distance(begin(), end()));
+}
+
+std::span<const std::byte> FrameSections::bytes() const {
+    if (!block_) {
+        return {};
+    }
+    return {block_->data(), block_->used};
+}
+
+FrameSections::Iterator FrameSections::begin() const {
+    if (!block_) {
+        return {};
+    }
+    const std::byte* end = block_->data() + block_->used;
+    return Iterator{block_->data() + sizeof(BlockHeader), end};
+}
+
+FrameSections::Iterator FrameSections::end() const {
+    if (!block_) {
+        return {};
+    }
+    const std::byte* end = block_->data() + block_->used;
+    return Iterator{end, end};
+}
+
+std::optional<SectionView> FrameSections::find(SectionType type, std::size_t nth) const {
+    for (const SectionView section : *this) {
+        if (section.type == type && nth-- == 0) {
+            return section;
+        }
+    }
+    return std::nullopt;
+}
+
+FrameSectionWriter::FrameSectionWriter(FrameSectionWriter&& other) noexcept
+    : block_(std::exchange(other.block_, nullptr)) {}
+
+FrameSectionWriter& FrameSectionWriter::operator=(FrameSectionWriter&& other) noexcept {
+    if (this != &other) {
+        detail::release(block_);
+        block_ = std::exchange(other.block_, nullptr);
+    }
+    return *this;
+}
+
+FrameSectionWriter::~FrameSectionWriter() {
+    detail::release(block_);
+}
+
+void* FrameSectionWriter::reserve(SectionType type, std::uint16_t version, std::size_t size) {
+    if (!block_ || size > UINT32_MAX) {
+        return nullptr;
+    }
+    const std::size_t needed = sizeof(SectionHeader) + align8(size);
+    if (block_->used + needed > block_->capacity) {
+        // Rare large frames get a one-off block; the pooled one goes back.
+        const std::size_t capacity = std::max<std::size_t>(2 * block_->capacity, block_->used + needed);
+        SectionBlock* grown = allocate_block(capacity, nullptr);
+        std::memcpy(grown->data(), block_->data(), block_->used);
+        grown->used = block_->used;
+        if (block_->pool) {
+            block_->pool->oversize.fetch_add(1, std::memory_order_relaxed);
+        }
+        detail::release(block_);
+        block_ = grown;
+    }
+
+    std::byte* cursor = block_->data() + block_->used;
+    const SectionHeader header{static_cast<std::uint16_t>(type), version, static_cast<std::uint32_t>(size)};
+    std::memcpy(cursor, &header, sizeof(header));
+    std::byte* payload = cursor + sizeof(SectionHeader);
+    std::memset(payload + size, 0, align8(size) - size);
+    block_->used += static_cast<std::uint32_t>(needed);
+    return payload;
+}
+
+bool FrameSectionWriter::append(SectionType type, std::uint16_t version, const void* data, std::size_t size) {
+    void* payload = reserve(type, version, size);
+    if (!payload) {
+        return false;
+    }
+    if (size > 0) {
+        std::memcpy(payload, data, size);
+    }
+    return true;
+}
+
+FrameSections FrameSectionWriter::finish() {
+    if (!block_) {
+        return {};
+    }
+    seal_block(block_);
+    return FrameSections{std::exchange(block_, nullptr)};
+}
+
+MetaArena::MetaArena(std::size_t block_size, std::size_t max_free_blocks) {
+    if (block_size < sizeof(BlockHeader) + sizeof(SectionHeader) || block_size > UINT32_MAX) {
+        throw std::invalid_argument("MetaArena block size must hold at least one section header");
+    }
+    pool_ = new ArenaPool{};
+    pool_->block_size = block_size;
+    pool_->max_free = max_free_blocks;
+}
+
+MetaArena::~MetaArena() {
+    pool_unref(pool_);
+}
+
+FrameSectionWriter MetaArena::writer() {
+    return FrameSectionWriter{acquire_block(pool_)};
+}
+
+FrameSections MetaArena::adopt(std::span<const std::byte> bytes) {
+    if (!valid_block(bytes)) {
+        return {};
+    }
+    SectionBlock* block = bytes.size() <= pool_->block_size ? acquire_block(pool_) : nullptr;
+    if (!block) {
+        pool_->oversize.fetch_add(1, std::memory_order_relaxed);
+        block = allocate_block(bytes.size(), nullptr);
+    }
+    std::memcpy(block->data(), bytes.data(), bytes.size());
+    block->used = static_cast<std::uint32_t>(bytes.size());
+    return FrameSections{block};
+}
+
+MetaArena::Stats MetaArena::stats() const {
+    Stats stats;
+    stats.acquired = pool_->acquired.load(std::memory_order_relaxed);
+    stats.reused = pool_->reused.load(std::memory_order_relaxed);
+    stats.oversize = pool_->oversize.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(pool_->mutex);
+    stats.free_blocks = pool_->free.size();
+    return stats;
+}
+
+bool attach_frame_sections(GstBuffer* buffer, FrameSections sections) {
+    if (!buffer) {
+        return false;
+    }
+    auto* meta = const_cast<FrameMeta*>(get_frame_meta(buffer));
+    if (!meta) {
+        meta = add_frame_meta(buffer, FrameMetadata{});
+        if (!meta) {
+            return false;
+        }
+    }
+    detail::release(meta->sections);
+    meta->sections = nullptr;
+    if (!sections.empty()) {
+        meta->sections = sections.block();
+        detail::retain(meta->sections);
+    }
+    return true;
+}
+
+FrameSections get_frame_sections(const GstBuffer* buffer) {
+    const FrameMeta* meta = get_frame_meta(buffer);
+    if (!meta || !meta->sections) {
+        return {};
+    }
+    detail::retain(meta->sections);
+    return FrameSections{meta->sections};
+}
+
+}  // namespace gstreamer_worker::zerocopy
@@ -0,0 +1,123 @@
+#include "gstreamer_worker/zerocopy/imu_ring.hpp"
+
+namespace gstreamer_worker::zerocopy {
+namespace {
+
+constexpr float kPi = 3.14159265358979323846F;
+
+// Shortest-path blend so yaw crossing +-pi does not spin through zero.
+float blend_angle(float from, float to, float weight) {
+    float delta = to - from;
+    if (delta > kPi) {
+        delta -= 2.0F * kPi;
+    } else if (delta < -kPi) {
+        delta += 2.0F * kPi;
+    }
+    float result = from + weight * delta;
+    if (result > kPi) {
+        result -= 2.0F * kPi;
+    } else if (result < -kPi) {
+        result += 2.0F * kPi;
+    }
+    return result;
+}
+
+std::size_t round_up_pow2(std::size_t value) {
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}  // namespace
+
+ImuRing::ImuRing(std::size_t capacity, GstClockTime max_hold)
+    : slots_(new Slot[round_up_pow2(capacity < 2 ? 2 : capacity)]),
+      mask_(round_up_pow2(capacity < 2 ? 2 : capacity) - 1),
+      max_hold_(max_hold) {}
+
+void ImuRing::push(const ImuSample& sample) {
+    const std::uint64_t index = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[index & mask_];
+    // Odd while the slot is being written; 2 * index + 2 once it holds `index`.
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timestamp.store(sample.timestamp, std::memory_order_relaxed);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        slot.rpy[axis].store(sample.rpy[axis], std::memory_order_relaxed);
+    }
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+}
+
+bool ImuRing::read(std::uint64_t index, ImuSample& sample) const {
+    const Slot& slot = slots_[index & mask_];
+    const std::uint64_t expected = 2 * index + 2;
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+    sample.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        sample.rpy[axis] = slot.rpy[axis].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+}
+
+bool ImuRing::interpolate(GstClockTime timestamp, std::array<float, 3>& rpy) const {
+    const std::uint64_t head = head_.load(std::memory_order_acquire);
+    if (head == 0 || !GST_CLOCK_TIME_IS_VALID(timestamp)) {
+        missed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ImuSample later;
+    if (!read(head - 1, later)) {
+        missed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (timestamp >= later.timestamp) {
+        if (timestamp - later.timestamp > max_hold_) {
+            missed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        rpy = later.rpy;
+        held_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Frames are stamped within milliseconds of the newest sample, so walking
+    // back from the head finds the bracket in a handful of reads.
+    const std::uint64_t oldest = head > mask_ + 1 ? head - (mask_ + 1) : 0;
+    for (std::uint64_t index = head - 1; index > oldest; --index) {
+        ImuSample earlier;
+        if (!read(index - 1, earlier)) {
+            break;
+        }
+        if (earlier.timestamp <= timestamp) {
+            const GstClockTime span = later.timestamp - earlier.timestamp;
+            const float weight =
+                span == 0 ? 0.0F : static_cast<float>(timestamp - earlier.timestamp) / static_cast<float>(span);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                rpy[axis] = blend_angle(earlier.rpy[axis], later.rpy[axis], weight);
+            }
+            interpolated_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        later = earlier;
+    }
+    missed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+ImuRing::Stats ImuRing::stats() const {
+    Stats stats;
+    stats.pushed = head_.load(std::memory_order_relaxed);
+    stats.interpolated = interpolated_.load(std::memory_order_relaxed);
+    stats.held = held_.load(std::memory_order_relaxed);
+    stats.missed = missed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace gstreamer_worker::zerocopy
@@ -0,0 +1,317 @@
+#include "gstreamer_worker/zerocopy/rtp_metadata.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+
+namespace gstreamer_worker::zerocopy {
+namespace {
+
+void put_u64(guint8* out, guint64 value) {
+    for (int index = 7; index >= 0; --index) {
+        out[index] = static_cast<guint8>(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+guint64 get_u64(const guint8* in) {
+    guint64 value = 0;
+    for (int index = 0; index < 8; ++index) {
+        value = (value << 8) | in[index];
+    }
+    return value;
+}
+
+void put_f32(guint8* out, float value) {
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int index = 3; index >= 0; --index) {
+        out[index] = static_cast<guint8>(bits & 0xFF);
+        bits >>= 8;
+    }
+}
+
+float get_f32(const guint8* in) {
+    std::uint32_t bits = 0;
+    for (int index = 0; index < 4; ++index) {
+        bits = (bits << 8) | in[index];
+    }
+    float value = 0.0F;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool add_u64(GstRTPBuffer* rtp, guint8 id, guint64 value) {
+    guint8 data[8];
+    put_u64(data, value);
+    return gst_rtp_buffer_add_extension_onebyte_header(rtp, id, data, sizeof(data));
+}
+
+bool is_marker_packet(GstBuffer* buffer) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    if (!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp)) {
+        return false;
+    }
+    const bool marker = gst_rtp_buffer_get_marker(&rtp);
+    gst_rtp_buffer_unmap(&rtp);
+    return marker;
+}
+
+bool read_u64(GstRTPBuffer* rtp, guint8 id, guint64& value) {
+    gpointer data = nullptr;
+    guint size = 0;
+    if (!gst_rtp_buffer_get_extension_onebyte_header(rtp, id, 0, &data, &size) || size != 8) {
+        return false;
+    }
+    value = get_u64(static_cast<const guint8*>(data));
+    return true;
+}
+
+}  // namespace
+
+bool write_rtp_metadata(GstBuffer* packet, FrameMetadata metadata, const FrameSections& sections, GstClock* clock) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    if (!gst_rtp_buffer_map(packet, GST_MAP_READWRITE, &rtp)) {
+        return false;
+    }
+    metadata.encode_ts = clock ? gst_clock_get_time(clock) : gst_util_get_timestamp();
+
+    add_u64(&rtp, kRtpExtFrameId, metadata.frame_id);
+    add_u64(&rtp, kRtpExtCaptureTs, metadata.capture_ts);
+    add_u64(&rtp, kRtpExtEncodeTs, metadata.encode_ts);
+    add_u64(&rtp, kRtpExtClockError, metadata.clock_error);
+    if (metadata.skipped_frames > 0) {
+        add_u64(&rtp, kRtpExtSkippedFrames, metadata.skipped_frames);
+    }
+
+    guint8 exposure_gain[8];
+    put_f32(exposure_gain, static_cast<float>(metadata.exposure_ms));
+    put_f32(exposure_gain + 4, static_cast<float>(metadata.gain));
+    gst_rtp_buffer_add_extension_onebyte_header(&rtp, kRtpExtExposureGain, exposure_gain, sizeof(exposure_gain));
+
+    guint8 imu[12];
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        put_f32(imu + 4 * axis, metadata.imu_rpy[axis]);
+    }
+    gst_rtp_buffer_add_extension_onebyte_header(&rtp, kRtpExtImu, imu, sizeof(imu));
+
+    // One-byte elements hold at most 16 bytes.
+    const std::size_t sensor_length =
+        std::min<std::size_t>(16, strnlen(metadata.sensor_id.data(), metadata.sensor_id.size()));
+    if (sensor_length > 0) {
+        gst_rtp_buffer_add_extension_onebyte_header(&rtp, kRtpExtSensorId, metadata.sensor_id.data(),
+                                                    static_cast<guint>(sensor_length));
+    }
+
+    const auto bytes = sections.bytes();
+    if (!sections.empty() && bytes.size() <= kRtpSectionsBudget) {
+        for (std::size_t offset = 0; offset < bytes.size(); offset += 16) {
+            const std::size_t chunk = std::min<std::size_t>(16, bytes.size() - offset);
+            gst_rtp_buffer_add_extension_onebyte_header(&rtp, kRtpExtSections, bytes.data() + offset,
+                                                        static_cast<guint>(chunk));
+        }
+    }
+    gst_rtp_buffer_unmap(&rtp);
+    return true;
+}
+
+bool read_rtp_metadata(GstBuffer* packet, FrameMetadata& metadata, std::vector<std::byte>* sections) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    if (!gst_rtp_buffer_map(packet, GST_MAP_READ, &rtp)) {
+        return false;
+    }
+    guint64 frame_id = 0;
+    if (!read_u64(&rtp, kRtpExtFrameId, frame_id)) {
+        gst_rtp_buffer_unmap(&rtp);
+        return false;
+    }
+    metadata = FrameMetadata{};
+    metadata.frame_id = frame_id;
+    read_u64(&rtp, kRtpExtCaptureTs, metadata.capture_ts);
+    read_u64(&rtp, kRtpExtEncodeTs, metadata.encode_ts);
+    read_u64(&rtp, kRtpExtClockError, metadata.clock_error);
+    guint64 skipped = 0;
+    if (read_u64(&rtp, kRtpExtSkippedFrames, skipped)) {
+        metadata.skipped_frames = static_cast<std::uint32_t>(skipped);
+    }
+
+    gpointer data = nullptr;
+    guint size = 0;
+    if (gst_rtp_buffer_get_extension_onebyte_header(&rtp, kRtpExtExposureGain, 0, &data, &size) && size == 8) {
+        metadata.exposure_ms = get_f32(static_cast<const guint8*>(data));
+        metadata.gain = get_f32(static_cast<const guint8*>(data) + 4);
+    }
+    if (gst_rtp_buffer_get_extension_onebyte_header(&rtp, kRtpExtImu, 0, &data, &size) && size == 12) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            metadata.imu_rpy[axis] = get_f32(static_cast<const guint8*>(data) + 4 * axis);
+        }
+    }
+    if (gst_rtp_buffer_get_extension_onebyte_header(&rtp, kRtpExtSensorId, 0, &data, &size) && size > 0) {
+        std::memcpy(metadata.sensor_id.data(), data, std::min<std::size_t>(size, metadata.sensor_id.size() - 1));
+    }
+    if (sections) {
+        sections->clear();
+        for (guint nth = 0;
+             gst_rtp_buffer_get_extension_onebyte_header(&rtp, kRtpExtSections, nth, &data, &size); ++nth) {
+            const auto* chunk = static_cast<const std::byte*>(data);
+            sections->insert(sections->end(), chunk, chunk + size);
+        }
+    }
+    gst_rtp_buffer_unmap(&rtp);
+    return true;
+}
+
+namespace {
+
+GstPadProbeReturn writer_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* clock = static_cast<GstClock*>(user_data);
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+        const FrameMeta* meta = get_frame_meta(buffer);
+        if (!meta || !is_marker_packet(buffer)) {
+            return GST_PAD_PROBE_OK;
+        }
+        const FrameMetadata metadata = meta->payload;
+        const FrameSections sections = get_frame_sections(buffer);
+        buffer = gst_buffer_make_writable(buffer);
+        write_rtp_metadata(buffer, metadata, sections, clock);
+        GST_PAD_PROBE_INFO_DATA(info) = buffer;
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = gst_pad_probe_info_get_buffer_list(info);
+        // Fragmented frames arrive as one list; the marker packet is last.
+        for (guint index = gst_buffer_list_length(list); index-- > 0;) {
+            GstBuffer* buffer = gst_buffer_list_get(list, index);
+            const FrameMeta* meta = get_frame_meta(buffer);
+            if (!meta || !is_marker_packet(buffer)) {
+                continue;
+            }
+            const FrameMetadata metadata = meta->payload;
+            const FrameSections sections = get_frame_sections(buffer);
+            list = gst_buffer_list_make_writable(list);
+            write_rtp_metadata(gst_buffer_list_get_writable(list, index), metadata, sections, clock);
+            GST_PAD_PROBE_INFO_DATA(info) = list;
+            break;
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// Metadata read from the current frame's packets, attached when the
+// depayloader pushes the frame. Both probes run on the same streaming thread.
+struct ReaderState {
+    MetaArena* arena{nullptr};
+    FrameMetadata metadata{};
+    std::vector<std::byte> section_bytes;
+    FrameSections sections{};
+    bool pending{false};
+};
+
+void read_packet(ReaderState* state, GstBuffer* buffer) {
+    if (!read_rtp_metadata(buffer, state->metadata, state->arena ? &state->section_bytes : nullptr)) {
+        return;
+    }
+    state->sections = state->section_bytes.empty() ? FrameSections{} : state->arena->adopt(state->section_bytes);
+    state->pending = true;
+}
+
+GstPadProbeReturn reader_sink_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* state = static_cast<ReaderState*>(user_data);
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        read_packet(state, gst_pad_probe_info_get_buffer(info));
+    } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = gst_pad_probe_info_get_buffer_list(info);
+        for (guint index = 0; index < gst_buffer_list_length(list); ++index) {
+            read_packet(state, gst_buffer_list_get(list, index));
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn reader_src_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* state = static_cast<ReaderState*>(user_data);
+    if (!state->pending || !(info->type & GST_PAD_PROBE_TYPE_BUFFER)) {
+        return GST_PAD_PROBE_OK;
+    }
+    GstBuffer* buffer = gst_pad_probe_info_get_buffer(info);
+    if (!get_frame_meta(buffer)) {
+        buffer = gst_buffer_make_writable(buffer);
+        add_frame_meta(buffer, state->metadata);
+        attach_frame_sections(buffer, std::move(state->sections));
+        GST_PAD_PROBE_INFO_DATA(info) = buffer;
+    }
+    state->sections = {};
+    state->pending = false;
+    return GST_PAD_PROBE_OK;
+}
+
+}  // namespace
+
+bool install_rtp_metadata_writer(GstElement* payloader, GstClock* clock) {
+    if (!payloader) {
+        return false;
+    }
+    GstPad* pad = gst_element_get_static_pad(payloader, "src");
+    if (!pad) {
+        return false;
+    }
+    if (clock) {
+        gst_object_ref(clock);
+    }
+    gst_pad_add_probe(pad,
+                      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                      writer_probe,
+                      clock,
+                      [](gpointer ptr) {
+                          if (ptr) {
+                              gst_object_unref(ptr);
+                          }
+                      });
+    gst_object_unref(pad);
+    return true;
+}
+
+bool install_rtp_metadata_reader(GstElement* depayloader, MetaArena* arena) {
+    if (!depayloader) {
+        return false;
+    }
+    GstPad* sink = gst_element_get_static_pad(depayloader, "sink");
+    GstPad* src = gst_element_get_static_pad(depayloader, "src");
+    if (!sink || !src) {
+        if (sink) {
+            gst_object_unref(sink);
+        }
+        if (src) {
+            gst_object_unref(src);
+        }
+        return false;
+    }
+    // The src probe owns the state; the sink probe is removed together with
+    // the element, so it never outlives it.
+    auto* state = new ReaderState{};
+    state->arena = arena;
+    gst_pad_add_probe(sink,
+                      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                      reader_sink_probe,
+                      state,
+                      nullptr);
+    gst_pad_add_probe(src,
+                      GST_PAD_PROBE_TYPE_BUFFER,
+                      reader_src_probe,
+                      state,
+                      [](gpointer ptr) { delete static_cast<ReaderState*>(ptr); });
+    gst_object_unref(sink);
+    gst_object_unref(src);
+    return true;
+}
+
+}  // namespace gstreamer_worker::zerocopy
@@ -0,0 +1,351 @@
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gstreamer_worker/pipeline/bitstream.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+// Builds an RBSP bit by bit, as an encoder writes slice headers.
+class BitWriter {
+  public:
+    void bit(std::uint32_t value) {
+        if (used_ == 0) {
+            bytes_.push_back(0);
+        }
+        bytes_.back() |= static_cast<std::uint8_t>((value & 1U) << (7 - used_));
+        used_ = (used_ + 1) % 8;
+    }
+
+    void bits(std::uint32_t value, int count) {
+        for (int index = count - 1; index >= 0; --index) {
+            bit(value >> index);
+        }
+    }
+
+    void ue(std::uint32_t value) {
+        const std::uint64_t coded = std::uint64_t{value} + 1;
+        int length = 0;
+        while ((coded >> length) > 1) {
+            ++length;
+        }
+        bits(0, length);
+        for (int index = length; index >= 0; --index) {
+            bit(static_cast<std::uint32_t>(coded >> index));
+        }
+    }
+
+    // rbsp_trailing_bits: a stop bit, then zeros up to the byte boundary.
+    Bytes finish() {
+        bit(1);
+        used_ = 0;
+        return bytes_;
+    }
+
+  private:
+    Bytes bytes_;
+    int used_{0};
+};
+
+// Inserts emulation prevention bytes and prepends the NAL header.
+Bytes nal(const Bytes& header, const Bytes& rbsp) {
+    Bytes out(header);
+    int zeros = 0;
+    for (const std::uint8_t byte : rbsp) {
+        if (zeros >= 2 && byte <= 0x03) {
+            out.push_back(0x03);
+            zeros = 0;
+        }
+        out.push_back(byte);
+        zeros = byte == 0x00 ? zeros + 1 : 0;
+    }
+    return out;
+}
+
+Bytes annex_b(std::initializer_list<Bytes> nals) {
+    Bytes out;
+    bool first = true;
+    for (const auto& unit : nals) {
+        // Four-byte start code on the first NAL of the unit, three after.
+        if (first) {
+            out.push_back(0x00);
+        }
+        out.insert(out.end(), {0x00, 0x00, 0x01});
+        out.insert(out.end(), unit.begin(), unit.end());
+        first = false;
+    }
+    return out;
+}
+
+Bytes length_prefixed(std::initializer_list<Bytes> nals, std::size_t length_size) {
+    Bytes out;
+    for (const auto& unit : nals) {
+        for (std::size_t index = length_size; index-- > 0;) {
+            out.push_back(static_cast<std::uint8_t>(unit.size() >> (8 * index)));
+        }
+        out.insert(out.end(), unit.begin(), unit.end());
+    }
+    return out;
+}
+
+Bytes concat(std::initializer_list<Bytes> parts) {
+    Bytes out;
+    for (const auto& part : parts) {
+        out.insert(out.end(), part.begin(), part.end());
+    }
+    return out;
+}
+
+// H.264 slice header up to slice_type; 2/7 is I, 0/5 is P, 1/6 is B.
+Bytes h264_slice(std::uint32_t first_mb, std::uint32_t slice_type) {
+    BitWriter writer;
+    writer.ue(first_mb);
+    writer.ue(slice_type);
+    writer.ue(0);  // pic_parameter_set_id
+    return writer.finish();
+}
+
+// H.265 slice segment header up to slice_type (0 B, 1 P, 2 I).
+Bytes h265_slice(bool irap, std::uint32_t slice_type) {
+    BitWriter writer;
+    writer.bit(1);  // first_slice_segment_in_pic_flag
+    if (irap) {
+        writer.bit(0);  // no_output_of_prior_pics_flag
+    }
+    writer.ue(0);  // slice_pic_parameter_set_id
+    writer.ue(slice_type);
+    return writer.finish();
+}
+
+Bytes h265_header(std::uint32_t type) {
+    return {static_cast<std::uint8_t>(type << 1), 0x01};
+}
+
+// An SEI message of `type` carrying `payload`, as bytes before escaping.
+Bytes sei_message(std::uint8_t type, const Bytes& payload) {
+    Bytes out{type, static_cast<std::uint8_t>(payload.size())};
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+Bytes av1_obu(std::uint32_t type, const Bytes& payload, bool extension = false) {
+    Bytes out{static_cast<std::uint8_t>((type << 3) | (extension ? 0x04U : 0U) | 0x02U)};
+    if (extension) {
+        out.push_back(0x00);
+    }
+    out.push_back(static_cast<std::uint8_t>(payload.size()));
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+// show_existing_frame = 0 and the two frame_type bits (0 KEY, 1 INTER, 2
+// INTRA_ONLY, 3 SWITCH).
+Bytes av1_frame_header(std::uint32_t frame_type) {
+    return {static_cast<std::uint8_t>(frame_type << 5), 0x00};
+}
+
+pipeline::AccessUnitInfo inspect(pipeline::VideoCodec codec, const Bytes& data, std::size_t length_size = 0) {
+    return pipeline::inspect_access_unit(codec, data.data(), data.size(), length_size);
+}
+
+// Every prefix of `data` must parse without reading past it; the ASan build
+// catches overruns.
+void inspect_prefixes(pipeline::VideoCodec codec, const Bytes& data, std::size_t length_size = 0) {
+    for (std::size_t size = 0; size <= data.size(); ++size) {
+        const Bytes prefix(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(size));
+        pipeline::inspect_access_unit(codec, prefix.data(), prefix.size(), length_size);
+        pipeline::access_unit_offsets(codec, prefix.data(), prefix.size());
+    }
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+    using pipeline::FrameType;
+    using pipeline::VideoCodec;
+
+    // H.264
+    const Bytes sps = nal({0x67}, {0x42, 0xC0, 0x1F, 0x8C});
+    const Bytes pps = nal({0x68}, {0xCE, 0x3C, 0x80});
+    const Bytes idr_slice = nal({0x65}, h264_slice(0, 7));
+    const Bytes idr = annex_b({sps, pps, idr_slice});
+    {
+        const auto info = inspect(VideoCodec::H264, idr);
+        ok &= check(info.idr && info.reference && info.type == FrameType::I && info.slices == 1,
+                    "H.264 IDR with parameter sets");
+        ok &= check(!info.recovery_point && !info.cra, "H.264 IDR has no recovery point");
+    }
+    {
+        // nal_ref_idc 0: a disposable P frame.
+        const auto info = inspect(VideoCodec::H264, annex_b({nal({0x01}, h264_slice(0, 5))}));
+        ok &= check(!info.idr && !info.reference && info.type == FrameType::P && info.slices == 1,
+                    "H.264 non-reference P frame");
+    }
+    {
+        // A picture is as predicted as its most predicted slice.
+        const auto info =
+            inspect(VideoCodec::H264, annex_b({nal({0x41}, h264_slice(0, 7)), nal({0x01}, h264_slice(40, 6))}));
+        ok &= check(info.reference && info.type == FrameType::B && info.slices == 2, "H.264 I and B slices give B");
+    }
+    {
+        // Recovery point after a picture-timing message, with the user data
+        // before it escaped: its 00 00 01 becomes 00 00 03 01 on the wire.
+        const Bytes messages = concat({sei_message(5, {0x00, 0x00, 0x01, 0x7F}), sei_message(1, {0x12, 0x34}),
+                                       sei_message(6, {0x84}), Bytes{0x80}});
+        const Bytes sei = nal({0x06}, messages);
+        ok &= check(sei.size() == messages.size() + 2, "SEI escaped once");
+        const auto info = inspect(VideoCodec::H264, annex_b({sei, nal({0x41}, h264_slice(0, 5))}));
+        ok &= check(info.recovery_point && !info.idr && info.type == FrameType::P, "H.264 recovery point SEI");
+
+        const auto none = inspect(VideoCodec::H264, annex_b({nal({0x06}, concat({sei_message(5, {0x01}), Bytes{0x80}})),
+                                                             nal({0x41}, h264_slice(0, 5))}));
+        ok &= check(!none.recovery_point, "SEI without a recovery point");
+    }
+    {
+        // first_mb_in_slice with 23 leading zero bits puts 00 00 01 and
+        // 00 00 00 into the header, so both need emulation prevention.
+        const Bytes slice = nal({0x65}, h264_slice((1U << 23) - 1, 7));
+        ok &= check(slice.size() > 4 && slice[1] == 0x00 && slice[2] == 0x00 && slice[3] == 0x03,
+                    "slice header escaped");
+        const auto info = inspect(VideoCodec::H264, annex_b({slice}));
+        ok &= check(info.idr && info.type == FrameType::I, "slice type read past emulation prevention bytes");
+    }
+    {
+        // avc stream format with four- and two-byte lengths.
+        const auto four = inspect(VideoCodec::H264, length_prefixed({sps, pps, idr_slice}, 4), 4);
+        ok &= check(four.idr && four.type == FrameType::I && four.slices == 1, "four-byte length prefixes");
+        const auto two = inspect(VideoCodec::H264, length_prefixed({nal({0x01}, h264_slice(0, 5))}, 2), 2);
+        ok &= check(!two.reference && two.type == FrameType::P && two.slices == 1, "two-byte length prefixes");
+        // A length running past the buffer is clamped to it.
+        Bytes cut = length_prefixed({idr_slice}, 4);
+        cut[3] = 0xFF;
+        const auto clamped = inspect(VideoCodec::H264, cut, 4);
+        ok &= check(clamped.idr && clamped.slices == 1, "overlong length clamped");
+    }
+    {
+        // Picture boundaries: a slice with first_mb_in_slice != 0 continues
+        // the picture, parameter sets and SEI start the next one.
+        const Bytes p0 = nal({0x41}, h264_slice(0, 5));
+        const Bytes p1 = nal({0x41}, h264_slice(60, 5));
+        const Bytes aud = nal({0x09}, {0xF0});
+        const Bytes first = annex_b({sps, pps, idr_slice});
+        const Bytes second = annex_b({p0, p1});
+        const Bytes third = annex_b({aud, p0});
+        const Bytes stream = concat({first, second, third});
+        const auto offsets = pipeline::access_unit_offsets(VideoCodec::H264, stream.data(), stream.size());
+        ok &= check(offsets.size() == 3 && offsets[0] == 0 && offsets[1] == first.size() &&
+                        offsets[2] == first.size() + second.size(),
+                    "H.264 access unit offsets");
+    }
+    {
+        const Bytes empty;
+        ok &= check(inspect(VideoCodec::H264, empty).slices == 0, "empty input");
+        ok &= check(pipeline::inspect_access_unit(VideoCodec::H264, nullptr, 16).slices == 0, "null input");
+        ok &= check(pipeline::access_unit_offsets(VideoCodec::H264, empty.data(), 0).empty(), "no offsets");
+        // Cut right after the NAL header: still a slice, but of unknown type.
+        const auto header_only = inspect(VideoCodec::H264, annex_b({Bytes{0x65}}));
+        ok &= check(header_only.idr && header_only.slices == 1 && header_only.type == FrameType::Unknown,
+                    "truncated slice header");
+        inspect_prefixes(VideoCodec::H264, concat({idr, annex_b({nal({0x06}, sei_message(6, {0x84}))})}));
+        inspect_prefixes(VideoCodec::H264, length_prefixed({sps, pps, idr_slice}, 4), 4);
+    }
+
+    // H.265
+    const Bytes vps = nal(h265_header(32), {0x0C, 0x01, 0xFF, 0xFF});
+    const Bytes hevc_sps = nal(h265_header(33), {0x01, 0x01, 0x60});
+    const Bytes hevc_pps = nal(h265_header(34), {0xC1, 0x72});
+    const Bytes hevc_idr = annex_b({vps, hevc_sps, hevc_pps, nal(h265_header(19), h265_slice(true, 2))});
+    {
+        const auto info = inspect(VideoCodec::H265, hevc_idr);
+        ok &= check(info.idr && !info.cra && info.reference && info.type == FrameType::I && info.slices == 1,
+                    "H.265 IDR");
+        const auto bla = inspect(VideoCodec::H265, annex_b({nal(h265_header(16), h265_slice(true, 2))}));
+        ok &= check(bla.idr && !bla.cra, "BLA counts as IDR");
+    }
+    {
+        // A CRA is not an IDR: its RASL pictures reference frames before it.
+        const auto cra = inspect(VideoCodec::H265, annex_b({nal(h265_header(21), h265_slice(true, 2))}));
+        ok &= check(!cra.idr && cra.cra && cra.reference && cra.type == FrameType::I, "H.265 CRA");
+        const auto rasl = inspect(VideoCodec::H265, annex_b({nal(h265_header(8), h265_slice(false, 0))}));
+        ok &= check(rasl.rasl && rasl.leading && !rasl.reference && rasl.type == FrameType::B, "RASL_N");
+        const auto radl = inspect(VideoCodec::H265, annex_b({nal(h265_header(7), h265_slice(false, 1))}));
+        ok &= check(!radl.rasl && radl.leading && radl.reference, "RADL_R");
+    }
+    {
+        const auto trail_r = inspect(VideoCodec::H265, annex_b({nal(h265_header(1), h265_slice(false, 1))}));
+        ok &= check(trail_r.reference && !trail_r.leading && trail_r.type == FrameType::P, "H.265 TRAIL_R P");
+        const auto trail_n = inspect(VideoCodec::H265, annex_b({nal(h265_header(0), h265_slice(false, 0))}));
+        ok &= check(!trail_n.reference && trail_n.type == FrameType::B, "H.265 non-reference TRAIL_N");
+    }
+    {
+        const Bytes sei = nal(h265_header(39), concat({sei_message(5, {0x00, 0x00, 0x02}), sei_message(6, {0x84}),
+                                                        Bytes{0x80}}));
+        const auto info = inspect(VideoCodec::H265, annex_b({sei, nal(h265_header(1), h265_slice(false, 1))}));
+        ok &= check(info.recovery_point && !info.idr && info.slices == 1, "H.265 recovery point SEI");
+    }
+    {
+        const Bytes slices = length_prefixed({vps, hevc_sps, hevc_pps, nal(h265_header(19), h265_slice(true, 2))}, 4);
+        const auto info = inspect(VideoCodec::H265, slices, 4);
+        ok &= check(info.idr && info.type == FrameType::I && info.slices == 1, "hvc1 length prefixes");
+    }
+    {
+        const Bytes trail = annex_b({nal(h265_header(1), h265_slice(false, 1))});
+        const Bytes stream = concat({hevc_idr, trail, trail});
+        const auto offsets = pipeline::access_unit_offsets(VideoCodec::H265, stream.data(), stream.size());
+        ok &= check(offsets.size() == 3 && offsets[1] == hevc_idr.size() &&
+                        offsets[2] == hevc_idr.size() + trail.size(),
+                    "H.265 access unit offsets");
+        inspect_prefixes(VideoCodec::H265, stream);
+        inspect_prefixes(VideoCodec::H265, length_prefixed({vps, nal(h265_header(21), h265_slice(true, 2))}, 4), 4);
+    }
+
+    // AV1
+    const Bytes temporal_delimiter = av1_obu(2, {});
+    const Bytes sequence_header = av1_obu(1, {0x00, 0x00, 0x00, 0x0A});
+    {
+        const auto key = inspect(VideoCodec::AV1,
+                                 concat({temporal_delimiter, sequence_header, av1_obu(6, av1_frame_header(0))}));
+        ok &= check(key.idr && key.reference && key.type == FrameType::I && key.slices == 1, "AV1 key frame");
+        const auto inter = inspect(VideoCodec::AV1, concat({temporal_delimiter, av1_obu(6, av1_frame_header(1))}));
+        ok &= check(!inter.idr && inter.reference && inter.type == FrameType::P, "AV1 inter frame");
+        const auto intra_only = inspect(VideoCodec::AV1, concat({temporal_delimiter, av1_obu(6, av1_frame_header(2))}));
+        ok &= check(!intra_only.idr && intra_only.type == FrameType::I, "AV1 intra-only frame is not a key frame");
+    }
+    {
+        // A frame header OBU followed by two tile groups, with extension headers.
+        const auto info = inspect(VideoCodec::AV1, concat({temporal_delimiter, av1_obu(3, av1_frame_header(1), true),
+                                                           av1_obu(4, {0x11, 0x22}, true), av1_obu(4, {0x33}, true)}));
+        ok &= check(info.slices == 2 && info.type == FrameType::P, "AV1 frame header and tile groups");
+        const auto shown = inspect(VideoCodec::AV1, concat({temporal_delimiter, av1_obu(3, {0x80})}));
+        ok &= check(shown.slices == 0 && !shown.reference && shown.type == FrameType::Unknown,
+                    "AV1 show_existing_frame");
+    }
+    {
+        // An OBU size running past the buffer stops the walk.
+        Bytes cut = concat({temporal_delimiter, av1_obu(6, av1_frame_header(0))});
+        cut[3] = 0x40;
+        const auto info = inspect(VideoCodec::AV1, cut);
+        ok &= check(info.slices == 0 && !info.idr, "truncated OBU ignored");
+        const Bytes unit = concat({temporal_delimiter, sequence_header, av1_obu(6, av1_frame_header(0))});
+        ok &= check(pipeline::access_unit_offsets(VideoCodec::AV1, unit.data(), unit.size()).empty(),
+                    "AV1 has no Annex B offsets");
+        inspect_prefixes(VideoCodec::AV1, unit);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -1,9 +1,39 @@
+#include <initializer_list>
 #include <iostream>
 #include <string>
 
 #include "gstreamer_worker/pipeline/capture_pipeline.hpp"
 #include "gstreamer_worker/pipeline/viewer_pipeline.hpp"
 
+namespace {
+
+// Every fragment a variant promises must be in its launch line, and none of
+// the ones it must have left out.
+bool check(const std::string& variant,
+           const std::string& line,
+           std::initializer_list<const char*> present,
+           std::initializer_list<const char*> absent = {}) {
+    bool ok = !line.empty();
+    if (!ok) {
+        std::cerr << "FAILED: " << variant << ": empty launch line\n";
+    }
+    for (const char* fragment : present) {
+        if (line.find(fragment) == std::string::npos) {
+            std::cerr << "FAILED: " << variant << ": missing '" << fragment << "'\n";
+            ok = false;
+        }
+    }
+    for (const char* fragment : absent) {
+        if (line.find(fragment) != std::string::npos) {
+            std::cerr << "FAILED: " << variant << ": unexpected '" << fragment << "'\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+}  // namespace
+
 int main(int argc, char** argv) {
     gstreamer_worker::pipeline::CapturePipelineConfig capture;
     capture.device = "/dev/video-test";
@@ -16,12 +46,98 @@ int main(int argc, char** argv) {
     viewer.request_zero_copy = false;
     viewer.appsink_name = "test_sink";
 
+    auto simulcast_capture = capture;
+    simulcast_capture.layers = {{0, 0, 0, 5000, 0x1000}, {640, 360, 500'000, 5002, 0x1001}};
+    simulcast_capture.source_format = {"image/jpeg", "", "jpegdec", "videoconvert n-threads=4"};
+    auto simulcast_viewer = viewer;
+    simulcast_viewer.layer_ports = {5000, 5002};
+    simulcast_viewer.load_shedding.enabled = true;
+    simulcast_viewer.encoded_export.enabled = true;
+
+    auto hevc_capture = capture;
+    hevc_capture.codec = gstreamer_worker::pipeline::VideoCodec::H265;
+    hevc_capture.low_latency.enabled = true;
+    hevc_capture.redundancy.enabled = true;
+    auto recorder_capture = capture;
+    recorder_capture.recorder.enabled = true;
+    auto qos_capture = capture;
+    qos_capture.qos.enabled = true;
+    auto motion_gate_capture = capture;
+    motion_gate_capture.motion_gate.enabled = true;
+    auto av1_viewer = simulcast_viewer;
+    av1_viewer.codec = gstreamer_worker::pipeline::VideoCodec::AV1;
+    av1_viewer.drop_on_latency = true;
+    av1_viewer.redundancy.enabled = true;
+    auto replay_viewer = viewer;
+    replay_viewer.codec = gstreamer_worker::pipeline::VideoCodec::H265;
+    replay_viewer.replay.enabled = true;
+    replay_viewer.replay.path = "/dev/null";
+    replay_viewer.replay.format = gstreamer_worker::pipeline::ReplayFormat::RtpDump;
+    replay_viewer.load_shedding.enabled = true;
+    auto mosaic_viewer = viewer;
+    mosaic_viewer.mosaic.enabled = true;
+    mosaic_viewer.mosaic.ports = {5000, 5002, 5004};
+    mosaic_viewer.mosaic.decimation = {1, 2};
+
     const auto capture_line = gstreamer_worker::pipeline::build_capture_launch(capture);
     const auto viewer_line = gstreamer_worker::pipeline::build_viewer_launch(viewer);
+    const auto simulcast_capture_line = gstreamer_worker::pipeline::build_capture_launch(simulcast_capture);
+    const auto simulcast_viewer_line = gstreamer_worker::pipeline::build_viewer_launch(simulcast_viewer);
+    const auto hevc_capture_line = gstreamer_worker::pipeline::build_capture_launch(hevc_capture);
+    const auto recorder_capture_line = gstreamer_worker::pipeline::build_capture_launch(recorder_capture);
+    const auto qos_capture_line = gstreamer_worker::pipeline::build_capture_launch(qos_capture);
+    const auto motion_gate_capture_line = gstreamer_worker::pipeline::build_capture_launch(motion_gate_capture);
+    const auto av1_viewer_line = gstreamer_worker::pipeline::build_viewer_launch(av1_viewer);
+    const auto replay_viewer_line = gstreamer_worker::pipeline::build_viewer_launch(replay_viewer);
+    const auto mosaic_viewer_line = gstreamer_worker::pipeline::build_viewer_launch(mosaic_viewer);
 
     if (argc > 1 && std::string(argv[1]) == "--print") {
         std::cout << "Capture: " << capture_line << "\nViewer:  " << viewer_line << "\n";
+        std::cout << "Simulcast capture: " << simulcast_capture_line
+                  << "\nSimulcast viewer:  " << simulcast_viewer_line << "\n";
+        std::cout << "HEVC capture: " << hevc_capture_line << "\nAV1 viewer:   " << av1_viewer_line << "\n";
+        std::cout << "Recorder capture: " << recorder_capture_line << "\n";
+        std::cout << "QoS capture: " << qos_capture_line << "\n";
+        std::cout << "Motion gate capture: " << motion_gate_capture_line << "\n";
+        std::cout << "Replay viewer: " << replay_viewer_line << "\n";
+        std::cout << "Mosaic viewer: " << mosaic_viewer_line << "\n";
     }
 
-    return (capture_line.empty() || viewer_line.empty()) ? 1 : 0;
+    bool ok = true;
+    ok &= check("capture", capture_line,
+                {"v4l2src name=source device=/dev/video-test", "x264enc name=encoder", "rtph264pay name=payloader",
+                 "rtpulpfecenc percentage=10", "udpsink host=127.0.0.1 port=5000"});
+    ok &= check("viewer", viewer_line,
+                {"udpsrc address=0.0.0.0 port=5000", "rtpjitterbuffer", "rtph264depay name=depayloader",
+                 "avdec_h264", "appsink name=test_sink"});
+    ok &= check("simulcast capture", simulcast_capture_line,
+                {"jpegdec ! videoconvert n-threads=4", "tee name=layer_tee", "ssrc=4096", "encoder_1",
+                 "videoscale ! video/x-raw,width=640,height=360", "rtph264pay name=payloader_1", "ssrc=4097",
+                 "port=5002"});
+    ok &= check("simulcast viewer", simulcast_viewer_line,
+                {"input-selector name=layer_select", "depayloader_1", "layer_select.sink_1",
+                 "queue name=decode_queue", "appsink name=encoded_sink"});
+    ok &= check("HEVC capture", hevc_capture_line,
+                {"x265enc name=encoder", "intra-refresh=1", "h265parse", "rtph265pay name=payloader",
+                 "multiudpsink clients=127.0.0.1:5000,127.0.0.1:5100"},
+                {"udpsink host="});
+    ok &= check("AV1 viewer", av1_viewer_line,
+                {"udpsrc name=rtp_source address", "udpsrc name=rtp_source_redundant address=0.0.0.0 port=5100",
+                 "funnel name=path_merge forward-sticky-events=false", "rtp_source_redundant_1",
+                 "port=5102", "funnel name=path_merge_1", "drop-on-latency=true", "rtpav1depay name=depayloader",
+                 "av1parse", "dav1ddec", "video/x-av1,stream-format=obu-stream,alignment=tu"});
+    ok &= check("recorder capture", recorder_capture_line,
+                {"tee name=recorder_tee", "recorder_tee. ! queue", "appsink name=recorder_sink"});
+    ok &= check("QoS capture", qos_capture_line,
+                {"videorate drop-only=true ! videoscale ! capsfilter name=qos_caps"});
+    ok &= check("motion gate capture", motion_gate_capture_line, {"identity name=motion_gate"});
+    ok &= check("replay viewer", replay_viewer_line,
+                {"appsrc name=replay_source", "encoding-name=H265", "rtph265depay name=depayloader",
+                 "queue name=decode_queue", "appsink name=test_sink drop=false"},
+                {"udpsrc", "rtpjitterbuffer"});
+    ok &= check("mosaic viewer", mosaic_viewer_line,
+                {"port=5004", "depayloader_2", "appsink name=mosaic_sink ", "appsink name=mosaic_sink_2",
+                 "video/x-raw,format={NV12,I420}"},
+                {"videoconvert"});
+    return ok ? 0 : 1;
 }
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/codec.hpp"
+#include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/format_probe.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+
+namespace {
+
+constexpr int kSkip = 77;
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+bool installed(const char* name) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) {
+        return false;
+    }
+    gst_object_unref(factory);
+    return true;
+}
+
+// Runs a 4:2:2 JPEG through the ranked decoder and converter into the encoder
+// and returns the format the encoder negotiated; empty on failure.
+std::string encoder_input_format(const pipeline::SourceFormat& source, const std::string& encoder) {
+    const std::string description =
+        "videotestsrc num-buffers=1 ! video/x-raw,format=Y42B,width=64,height=64 ! jpegenc ! " + source.decoder +
+        " ! " + source.converter + " ! " + encoder + " name=encoder ! fakesink";
+    GError* error = nullptr;
+    GstElement* launch = gst_parse_launch(description.c_str(), &error);
+    if (!launch) {
+        std::cerr << "Unable to build " << description << ": " << (error ? error->message : "unknown") << "\n";
+        g_clear_error(&error);
+        return {};
+    }
+    g_clear_error(&error);
+
+    std::string format;
+    gst_element_set_state(launch, GST_STATE_PAUSED);
+    if (gst_element_get_state(launch, nullptr, nullptr, 10 * GST_SECOND) != GST_STATE_CHANGE_FAILURE) {
+        GstElement* encoder_element = gst_bin_get_by_name(GST_BIN(launch), "encoder");
+        GstPad* pad = encoder_element ? gst_element_get_static_pad(encoder_element, "sink") : nullptr;
+        GstCaps* caps = pad ? gst_pad_get_current_caps(pad) : nullptr;
+        if (caps) {
+            const gchar* name = gst_structure_get_string(gst_caps_get_structure(caps, 0), "format");
+            format = name ? name : "";
+            gst_caps_unref(caps);
+        }
+        if (pad) {
+            gst_object_unref(pad);
+        }
+        if (encoder_element) {
+            gst_object_unref(encoder_element);
+        }
+    }
+    gst_element_set_state(launch, GST_STATE_NULL);
+    gst_object_unref(launch);
+    return format;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+
+    pipeline::CapturePipelineConfig config;
+    config.use_nvenc = false;
+    config.encoder = pipeline::installed_software_encoder(config.codec);
+    if (!installed(config.encoder.c_str()) || !installed("jpegdec")) {
+        std::cerr << "SKIP: needs a software encoder and jpegdec\n";
+        return kSkip;
+    }
+    bool ok = true;
+
+    pipeline::SourceFormat jpeg;
+    jpeg.media = "image/jpeg";
+    pipeline::SourceFormat yuy2;
+    yuy2.media = "video/x-raw";
+    yuy2.format = "YUY2";
+    pipeline::SourceFormat i420;
+    i420.media = "video/x-raw";
+    i420.format = "I420";
+
+    const auto candidates = pipeline::rank_source_formats({jpeg, yuy2, i420}, config);
+    ok &= check(candidates.size() == 3, "every camera format ranked");
+    ok &= check(!candidates.empty() && candidates.front().source.format == "I420" &&
+                    candidates.front().source.converter.empty() && candidates.front().cost == 0.0,
+                "4:2:0 taken directly");
+
+    for (const auto& candidate : candidates) {
+        const auto& source = candidate.source;
+        if (source.format == "YUY2") {
+            ok &= check(source.converter.find("format=I420") != std::string::npos ||
+                            source.converter.find("format=NV12") != std::string::npos,
+                        "YUY2 converted to 4:2:0 (" + source.converter + ")");
+        } else if (source.media == "image/jpeg") {
+            ok &= check(source.decoder.size() > 0, "JPEG decoder chosen");
+            ok &= check(source.converter.find("video/x-raw,format=") != std::string::npos,
+                        "decoded JPEG pinned to a format (" + source.converter + ")");
+
+            // A 4:2:2 camera: jpegdec emits Y42B, which must not reach the encoder.
+            if (installed("videotestsrc") && installed("jpegenc")) {
+                const std::string format = encoder_input_format(source, config.encoder);
+                ok &= check(format == "I420" || format == "NV12",
+                            "4:2:2 JPEG reaches the encoder as 4:2:0 (got '" + format + "')");
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/gst.h>
+
+#if defined(G_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "gstreamer_worker/zerocopy/frame_collator.hpp"
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+
+namespace zerocopy = gstreamer_worker::zerocopy;
+
+namespace {
+
+constexpr int kSkip = 77;
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+#if defined(G_OS_UNIX)
+
+int open_fd() {
+    return open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+bool is_closed(int fd) {
+    return fcntl(fd, F_GETFD) == -1 && errno == EBADF;
+}
+
+zerocopy::ExportPacket make_packet(GstClockTime capture_ts, int fd = -1) {
+    zerocopy::ExportPacket packet;
+    packet.dma_fd = fd;
+    packet.metadata = zerocopy::make_frame_metadata(0, capture_ts, "cam");
+    return packet;
+}
+
+// Keeps the batches it is handed and closes their fds, as a consumer would.
+struct Batches {
+    std::vector<zerocopy::CollatedBatch> received;
+
+    zerocopy::FrameCollator::Callback callback() {
+        return [this](const zerocopy::CollatedBatch& batch) {
+            received.push_back(batch);
+            for (const auto& frame : batch.frames) {
+                if (frame.dma_fd >= 0) {
+                    close(frame.dma_fd);
+                }
+            }
+        };
+    }
+};
+
+zerocopy::FrameCollatorConfig make_config(std::size_t streams) {
+    zerocopy::FrameCollatorConfig config;
+    config.streams = streams;
+    config.tolerance = 5 * GST_MSECOND;
+    // Long enough that only the timeout case below ever reaches it.
+    config.max_wait = std::chrono::seconds(10);
+    return config;
+}
+
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+#if !defined(G_OS_UNIX)
+    std::cerr << "SKIP: fd ownership needs a POSIX platform\n";
+    return kSkip;
+#else
+    bool ok = true;
+
+    // One frame per stream inside the window is a complete batch, delivered
+    // by the push that completes it.
+    {
+        Batches batches;
+        zerocopy::FrameCollator collator(make_config(3), batches.callback());
+        collator.push(0, make_packet(100 * GST_MSECOND));
+        collator.push(2, make_packet(103 * GST_MSECOND));
+        ok &= check(batches.received.empty(), "batch waits for the missing stream");
+        collator.push(1, make_packet(101 * GST_MSECOND));
+        ok &= check(batches.received.size() == 1, "complete batch released on the last push");
+        if (!batches.received.empty()) {
+            const auto& batch = batches.received.front();
+            ok &= check(batch.complete() && batch.present == 3 && batch.frames.size() == 3, "batch is complete");
+            ok &= check(batch.capture_ts == 100 * GST_MSECOND && batch.spread == 3 * GST_MSECOND,
+                        "earliest capture_ts and spread");
+            ok &= check(batch.frames[2].metadata.capture_ts == 103 * GST_MSECOND, "frames in stream order");
+        }
+    }
+
+    // A stream whose head is past the window skipped that instant, so the
+    // batch goes out at once without it.
+    {
+        Batches batches;
+        zerocopy::FrameCollator collator(make_config(2), batches.callback());
+        const int fd = open_fd();
+        collator.push(0, make_packet(100 * GST_MSECOND, fd));
+        collator.push(1, make_packet(133 * GST_MSECOND));
+        ok &= check(batches.received.size() == 1, "partial batch released immediately");
+        if (!batches.received.empty()) {
+            const auto& batch = batches.received.front();
+            ok &= check(!batch.complete() && batch.present == 1, "one stream present");
+            ok &= check(batch.frames[0].dma_fd == fd && batch.frames[1].dma_fd == -1, "missing stream has no fd");
+        }
+        const auto stats = collator.stats();
+        ok &= check(stats.batches == 1 && stats.partial == 1 && stats.complete == 0, "partial counted");
+    }
+
+    // A stream that delivered nothing is waited for until max_wait, checked on
+    // the next push; flush releases whatever is left.
+    {
+        Batches batches;
+        auto config = make_config(2);
+        config.max_wait = std::chrono::milliseconds(20);
+        zerocopy::FrameCollator collator(config, batches.callback());
+        collator.push(0, make_packet(100 * GST_MSECOND));
+        ok &= check(batches.received.empty(), "batch waits before max_wait");
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        collator.push(0, make_packet(133 * GST_MSECOND));
+        ok &= check(batches.received.size() == 1 && batches.received[0].capture_ts == 100 * GST_MSECOND,
+                    "batch released after max_wait");
+        collator.flush();
+        ok &= check(batches.received.size() == 2 && batches.received[1].capture_ts == 133 * GST_MSECOND &&
+                        batches.received[1].present == 1,
+                    "flush releases the rest");
+    }
+
+    // When every stream stalls, poll() is what bounds the wait.
+    {
+        Batches batches;
+        auto config = make_config(2);
+        config.max_wait = std::chrono::milliseconds(20);
+        zerocopy::FrameCollator collator(config, batches.callback());
+        collator.push(0, make_packet(100 * GST_MSECOND));
+        collator.poll();
+        ok &= check(batches.received.empty(), "poll keeps a batch before max_wait");
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        collator.poll();
+        ok &= check(batches.received.size() == 1 && batches.received[0].present == 1,
+                    "poll releases a stalled batch after max_wait");
+    }
+
+    // Frames at or inside the window of a released batch are late and closed.
+    {
+        Batches batches;
+        zerocopy::FrameCollator collator(make_config(2), batches.callback());
+        collator.push(0, make_packet(100 * GST_MSECOND));
+        collator.push(1, make_packet(100 * GST_MSECOND));
+        const int fd = open_fd();
+        ok &= check(!collator.push(1, make_packet(104 * GST_MSECOND, fd)), "late frame rejected");
+        ok &= check(is_closed(fd), "late frame fd closed");
+        const int unknown = open_fd();
+        ok &= check(!collator.push(2, make_packet(200 * GST_MSECOND, unknown)) && is_closed(unknown),
+                    "unknown stream rejected and closed");
+        const int untimed = open_fd();
+        ok &= check(!collator.push(0, make_packet(GST_CLOCK_TIME_NONE, untimed)) && is_closed(untimed),
+                    "frame without capture_ts rejected and closed");
+        ok &= check(collator.stats().dropped_late == 1, "late drop counted");
+    }
+
+    // Beyond max_pending the oldest frame of that stream is closed.
+    {
+        Batches batches;
+        auto config = make_config(2);
+        config.max_pending = 2;
+        zerocopy::FrameCollator collator(config, batches.callback());
+        const int first = open_fd();
+        collator.push(0, make_packet(100 * GST_MSECOND, first));
+        collator.push(0, make_packet(110 * GST_MSECOND, open_fd()));
+        collator.push(0, make_packet(120 * GST_MSECOND, open_fd()));
+        ok &= check(is_closed(first), "overflowed frame fd closed");
+        ok &= check(collator.stats().dropped_overflow == 1, "overflow counted");
+        collator.flush();
+        ok &= check(batches.received.size() == 2 && batches.received[0].capture_ts == 110 * GST_MSECOND,
+                    "remaining frames flushed in order");
+    }
+
+    // Without deliver_partial an incomplete batch is dropped and its fds
+    // closed.
+    {
+        Batches batches;
+        auto config = make_config(2);
+        config.deliver_partial = false;
+        zerocopy::FrameCollator collator(config, batches.callback());
+        const int fd = open_fd();
+        collator.push(0, make_packet(100 * GST_MSECOND, fd));
+        collator.flush();
+        ok &= check(batches.received.empty() && is_closed(fd), "partial batch dropped and closed");
+        ok &= check(collator.stats().dropped_partial == 1, "dropped partial counted");
+    }
+
+    // Frames still pending when the collator goes away are closed with it.
+    {
+        Batches batches;
+        const int fd = open_fd();
+        {
+            zerocopy::FrameCollator collator(make_config(2), batches.callback());
+            collator.push(0, make_packet(100 * GST_MSECOND, fd));
+            ok &= check(!is_closed(fd), "pending fd kept open");
+        }
+        ok &= check(batches.received.empty() && is_closed(fd), "destructor closes pending fds");
+    }
+
+    // The buffer is referenced while pending and released after the callback,
+    // so the producer cannot recycle it under a waiting batch.
+    {
+        Batches batches;
+        zerocopy::FrameCollator collator(make_config(2), batches.callback());
+        GstBuffer* buffer = gst_buffer_new();
+        auto packet = make_packet(100 * GST_MSECOND);
+        packet.buffer = buffer;
+        collator.push(0, packet);
+        ok &= check(GST_MINI_OBJECT_REFCOUNT_VALUE(buffer) == 2, "pending frame holds the buffer");
+        collator.push(1, make_packet(101 * GST_MSECOND));
+        ok &= check(batches.received.size() == 1 && batches.received[0].frames[0].buffer == buffer,
+                    "callback sees the buffer");
+        ok &= check(GST_MINI_OBJECT_REFCOUNT_VALUE(buffer) == 1, "buffer released after the callback");
+        gst_buffer_unref(buffer);
+    }
+
+    return ok ? 0 : 1;
+#endif
+}
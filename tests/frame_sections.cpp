@@ -0,0 +1,161 @@
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+
+namespace zerocopy = gstreamer_worker::zerocopy;
+
+namespace {
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+zerocopy::FrameSections make_sections(zerocopy::MetaArena& arena, std::size_t boxes) {
+    std::vector<zerocopy::DetectionBox> records(boxes);
+    for (std::size_t index = 0; index < boxes; ++index) {
+        records[index].score = 0.5F;
+        records[index].label = static_cast<std::uint32_t>(index);
+    }
+    auto writer = arena.writer();
+    writer.append(zerocopy::SectionType::DetectionBoxes, 1, std::span<const zerocopy::DetectionBox>(records));
+    return writer.finish();
+}
+
+bool has_boxes(const zerocopy::FrameSections& sections, std::size_t boxes) {
+    const auto section = sections.find(zerocopy::SectionType::DetectionBoxes);
+    if (!section) {
+        return false;
+    }
+    const auto records = section->as_array<zerocopy::DetectionBox>();
+    return records.size() == boxes && (boxes == 0 || records.back().label == boxes - 1);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    bool ok = true;
+
+    // A released block goes back to the free list and the next writer takes
+    // it; the free list never grows past max_free_blocks.
+    {
+        zerocopy::MetaArena arena(512, 2);
+        make_sections(arena, 4);
+        auto stats = arena.stats();
+        ok &= check(stats.acquired == 1 && stats.reused == 0 && stats.free_blocks == 1, "first block pooled");
+
+        const auto sections = make_sections(arena, 4);
+        stats = arena.stats();
+        ok &= check(stats.acquired == 2 && stats.reused == 1 && stats.free_blocks == 0, "block reused");
+        ok &= check(has_boxes(sections, 4) && sections.count() == 1, "reused block holds the new sections");
+
+        {
+            std::vector<zerocopy::FrameSections> held;
+            for (int index = 0; index < 4; ++index) {
+                held.push_back(make_sections(arena, 1));
+            }
+        }
+        ok &= check(arena.stats().free_blocks == 2, "free list capped at max_free_blocks");
+
+        // Copies share the block instead of taking another from the pool.
+        const zerocopy::FrameSections copy = sections;
+        ok &= check(copy.block() == sections.block() && arena.stats().free_blocks == 2, "copies share the block");
+    }
+
+    // Sections past block_size move to a one-off block that is freed instead
+    // of pooled; the pooled block they started in goes back.
+    {
+        zerocopy::MetaArena arena(128, 4);
+        auto writer = arena.writer();
+        const std::array<std::uint8_t, 3> blob{1, 2, 3};
+        writer.append(zerocopy::SectionType::SensorBlob, 2, std::span<const std::uint8_t>(blob));
+        const std::vector<zerocopy::DetectionBox> boxes(16);
+        ok &= check(writer.append(zerocopy::SectionType::DetectionBoxes, 1,
+                                  std::span<const zerocopy::DetectionBox>(boxes)),
+                    "append past block_size");
+        auto stats = arena.stats();
+        ok &= check(stats.oversize == 1 && stats.free_blocks == 1, "oversize counted, pooled block returned");
+
+        auto sections = writer.finish();
+        const auto sensor = sections.find(zerocopy::SectionType::SensorBlob);
+        ok &= check(sensor && sensor->version == 2 && sensor->size == 3 &&
+                        sensor->as_array<std::uint8_t>()[2] == 3,
+                    "sections before the growth kept");
+        ok &= check(sections.count() == 2 && sections.bytes().size() > 128, "grown block holds both sections");
+
+        const std::vector<std::byte> bytes(sections.bytes().begin(), sections.bytes().end());
+        sections = {};
+        ok &= check(arena.stats().free_blocks == 1, "oversize block not pooled");
+
+        const auto adopted = arena.adopt(bytes);
+        stats = arena.stats();
+        ok &= check(stats.oversize == 2 && adopted.count() == 2, "oversize adopt");
+        ok &= check(arena.adopt(std::span<const std::byte>(bytes).first(bytes.size() - 8)).empty(),
+                    "truncated block rejected");
+        ok &= check(arena.adopt(make_sections(arena, 2).bytes()).count() == 1, "pooled adopt");
+    }
+
+    // The meta holds a reference; a buffer copy transforms the meta and
+    // shares the block, which returns only when both buffers are gone.
+    {
+        zerocopy::MetaArena arena(512, 4);
+        GstBuffer* buffer = gst_buffer_new();
+        zerocopy::add_frame_meta(buffer, zerocopy::make_frame_metadata(9, 1000, "cam0"));
+        ok &= check(zerocopy::attach_frame_sections(buffer, make_sections(arena, 3)), "attach");
+        ok &= check(arena.stats().free_blocks == 0, "attached block held by the meta");
+        ok &= check(zerocopy::get_frame_meta(buffer)->payload.frame_id == 9, "attach keeps the metadata");
+
+        GstBuffer* copy = gst_buffer_copy(buffer);
+        const auto* meta = zerocopy::get_frame_meta(copy);
+        ok &= check(meta && meta->payload.frame_id == 9, "metadata copied");
+        ok &= check(meta && meta->sections == zerocopy::get_frame_meta(buffer)->sections, "copy shares the block");
+        gst_buffer_unref(buffer);
+        ok &= check(arena.stats().free_blocks == 0, "copy keeps the block");
+        ok &= check(has_boxes(zerocopy::get_frame_sections(copy), 3), "sections read through the copy");
+
+        // Attaching again replaces and releases the old block.
+        ok &= check(zerocopy::attach_frame_sections(copy, make_sections(arena, 1)), "reattach");
+        ok &= check(arena.stats().free_blocks == 1 && has_boxes(zerocopy::get_frame_sections(copy), 1),
+                    "old block released on reattach");
+        gst_buffer_unref(copy);
+        ok &= check(arena.stats().free_blocks == 2, "blocks returned after the last buffer");
+
+        GstBuffer* plain = gst_buffer_new();
+        ok &= check(zerocopy::get_frame_sections(plain).empty(), "no sections without meta");
+        ok &= check(zerocopy::attach_frame_sections(plain, make_sections(arena, 1)) &&
+                        zerocopy::get_frame_meta(plain) != nullptr,
+                    "attach adds a meta");
+        gst_buffer_unref(plain);
+    }
+
+    // Buffers may outlive the arena: the pool stays until the last block goes.
+    {
+        auto arena = std::make_unique<zerocopy::MetaArena>(512, 4);
+        GstBuffer* buffer = gst_buffer_new();
+        zerocopy::attach_frame_sections(buffer, make_sections(*arena, 5));
+        auto sections = make_sections(*arena, 2);
+        arena.reset();
+        ok &= check(has_boxes(zerocopy::get_frame_sections(buffer), 5), "buffer readable after the arena");
+        ok &= check(has_boxes(sections, 2), "sections readable after the arena");
+        GstBuffer* copy = gst_buffer_copy(buffer);
+        gst_buffer_unref(buffer);
+        sections = {};
+        ok &= check(has_boxes(zerocopy::get_frame_sections(copy), 5), "copy readable after the arena");
+        gst_buffer_unref(copy);
+    }
+
+    ok &= check(!zerocopy::attach_frame_sections(nullptr, {}), "null buffer rejected");
+
+    return ok ? 0 : 1;
+}
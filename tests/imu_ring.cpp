@@ -0,0 +1,113 @@
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "gstreamer_worker/zerocopy/imu_ring.hpp"
+
+using gstreamer_worker::zerocopy::ImuRing;
+using gstreamer_worker::zerocopy::ImuSample;
+
+namespace {
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+bool near(float value, float expected) {
+    return std::fabs(value - expected) < 1e-4F;
+}
+
+ImuSample make_sample(GstClockTime timestamp, float roll, float pitch, float yaw) {
+    ImuSample sample;
+    sample.timestamp = timestamp;
+    sample.rpy = {roll, pitch, yaw};
+    return sample;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+    std::array<float, 3> rpy{};
+
+    // A ring of four keeps the newest four samples; older timestamps miss.
+    {
+        ImuRing ring(3);
+        for (int index = 1; index <= 10; ++index) {
+            const float value = 0.1F * static_cast<float>(index);
+            ring.push(make_sample(static_cast<GstClockTime>(index) * GST_MSECOND, value, -value, value));
+        }
+        ok &= check(ring.interpolate(9500 * GST_USECOND, rpy) && near(rpy[0], 0.95F) && near(rpy[1], -0.95F),
+                    "interpolates between the newest samples");
+        ok &= check(ring.interpolate(7500 * GST_USECOND, rpy) && near(rpy[2], 0.75F),
+                    "interpolates at the oldest retained sample");
+        ok &= check(!ring.interpolate(6500 * GST_USECOND, rpy), "overwritten samples miss");
+        ok &= check(ring.interpolate(7 * GST_MSECOND, rpy) && near(rpy[0], 0.7F), "exact sample time");
+        const auto stats = ring.stats();
+        ok &= check(stats.pushed == 10 && stats.interpolated == 3 && stats.missed == 1, "stats after wrap");
+    }
+
+    // Angles blend the short way across +-pi instead of through zero.
+    {
+        ImuRing ring(8);
+        ring.push(make_sample(1 * GST_MSECOND, 0.0F, 0.0F, 3.0F));
+        ring.push(make_sample(2 * GST_MSECOND, 0.0F, 0.0F, -3.0F));
+        ok &= check(ring.interpolate(1500 * GST_USECOND, rpy) && std::fabs(rpy[2]) > 3.1F,
+                    "yaw crosses pi (" + std::to_string(rpy[2]) + ")");
+        ok &= check(ring.interpolate(1250 * GST_USECOND, rpy) && rpy[2] > 3.0F, "quarter way stays positive");
+        ok &= check(ring.interpolate(1750 * GST_USECOND, rpy) && rpy[2] < -3.0F, "three quarters wraps negative");
+    }
+
+    // Frames slightly newer than the last sample hold it, up to max_hold.
+    {
+        ImuRing ring(8, 5 * GST_MSECOND);
+        ok &= check(!ring.interpolate(GST_MSECOND, rpy), "empty ring misses");
+        ring.push(make_sample(10 * GST_MSECOND, 0.5F, 0.25F, -0.5F));
+        ok &= check(ring.interpolate(14 * GST_MSECOND, rpy) && near(rpy[1], 0.25F), "held within max_hold");
+        ok &= check(ring.interpolate(15 * GST_MSECOND, rpy), "held at max_hold");
+        ok &= check(!ring.interpolate(16 * GST_MSECOND, rpy), "missed past max_hold");
+        ok &= check(!ring.interpolate(5 * GST_MSECOND, rpy), "missed before the first sample");
+        ok &= check(!ring.interpolate(GST_CLOCK_TIME_NONE, rpy), "invalid timestamp misses");
+        const auto stats = ring.stats();
+        ok &= check(stats.held == 2 && stats.missed == 4, "hold stats");
+    }
+
+    // A writer lapping a small ring while a reader interpolates next to the
+    // head. Every sample has equal axes, so a torn read shows unequal ones.
+    {
+        ImuRing ring(16);
+        constexpr int kSamples = 500000;
+        std::atomic<bool> done{false};
+        std::thread writer([&ring, &done] {
+            for (int index = 1; index <= kSamples; ++index) {
+                const float value = static_cast<float>(index % 1000) * 0.001F;
+                ring.push(make_sample(static_cast<GstClockTime>(index) * GST_USECOND, value, value, value));
+            }
+            done.store(true);
+        });
+        guint64 reads = 0;
+        guint64 torn = 0;
+        while (!done.load()) {
+            const guint64 head = ring.stats().pushed;
+            if (head < 4) {
+                continue;
+            }
+            std::array<float, 3> sample{};
+            if (ring.interpolate((head - 2) * GST_USECOND + 500, sample)) {
+                ++reads;
+                torn += sample[0] != sample[1] || sample[1] != sample[2];
+            }
+        }
+        writer.join();
+        ok &= check(torn == 0, std::to_string(torn) + " torn samples");
+        ok &= check(reads > 0, "reader interpolated while the writer ran");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/mosaic_compositor.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+
+namespace {
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+pipeline::MosaicConfig make_config(std::size_t ports, std::uint32_t width, std::uint32_t height,
+                                   std::uint32_t columns = 0) {
+    pipeline::MosaicConfig config;
+    config.enabled = true;
+    for (std::size_t index = 0; index < ports; ++index) {
+        config.ports.push_back(static_cast<std::uint16_t>(5000 + 2 * index));
+    }
+    config.width = width;
+    config.height = height;
+    config.columns = columns;
+    return config;
+}
+
+bool throws(const pipeline::MosaicConfig& config) {
+    try {
+        pipeline::mosaic_layout(config);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+bool same(const pipeline::MosaicTile& tile, std::uint32_t x, std::uint32_t y, std::uint32_t width,
+          std::uint32_t height) {
+    return tile.x == x && tile.y == y && tile.width == width && tile.height == height;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+
+    // The default grid is the smallest square holding every port, filled row
+    // by row.
+    {
+        const auto tiles = pipeline::mosaic_layout(make_config(4, 1920, 1080));
+        ok &= check(tiles.size() == 4, "four tiles");
+        ok &= check(same(tiles[0], 0, 0, 960, 540) && same(tiles[1], 960, 0, 960, 540) &&
+                        same(tiles[2], 0, 540, 960, 540) && same(tiles[3], 960, 540, 960, 540),
+                    "2x2 grid");
+    }
+    {
+        const auto tiles = pipeline::mosaic_layout(make_config(3, 1920, 1080));
+        ok &= check(tiles.size() == 3 && same(tiles[2], 0, 540, 960, 540), "three ports on a 2x2 grid");
+    }
+    {
+        const auto tiles = pipeline::mosaic_layout(make_config(5, 1920, 1080));
+        ok &= check(same(tiles[2], 1280, 0, 640, 540) && same(tiles[3], 0, 540, 640, 540), "five ports on 3x2");
+    }
+
+    // Explicit columns decide the row count.
+    {
+        const auto tiles = pipeline::mosaic_layout(make_config(5, 1920, 1080, 5));
+        ok &= check(same(tiles[4], 1536, 0, 384, 1080), "one row of five");
+        const auto columns = pipeline::mosaic_layout(make_config(3, 1920, 1080, 1));
+        ok &= check(same(columns[2], 0, 720, 1920, 360), "one column of three");
+    }
+
+    // Tiles are rounded down to even sizes so chroma sites line up.
+    {
+        const auto tiles = pipeline::mosaic_layout(make_config(9, 1000, 1000));
+        bool even = true;
+        for (const auto& tile : tiles) {
+            even &= tile.x % 2 == 0 && tile.y % 2 == 0 && tile.width == 332 && tile.height == 332;
+        }
+        ok &= check(even, "even 332x332 tiles on 1000x1000");
+        ok &= check(same(tiles[8], 664, 664, 332, 332), "last tile inside the frame");
+    }
+
+    ok &= check(throws(make_config(0, 1920, 1080)), "no ports rejected");
+    ok &= check(throws(make_config(2, 1921, 1080)), "odd width rejected");
+    ok &= check(throws(make_config(2, 1920, 1081)), "odd height rejected");
+    ok &= check(throws(make_config(4, 6, 1080, 4)), "tiles narrower than 2 rejected");
+    ok &= check(throws(make_config(4, 1920, 2, 1)), "tiles shorter than 2 rejected");
+    ok &= check(!throws(make_config(4, 8, 2, 4)), "2x2 tiles accepted");
+
+    return ok ? 0 : 1;
+}
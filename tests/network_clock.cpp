@@ -0,0 +1,79 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/control/network_clock.hpp"
+
+using gstreamer_worker::control::NetworkClock;
+using gstreamer_worker::control::NetworkClockConfig;
+
+namespace {
+
+constexpr int kSkip = 77;
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+GstClockTimeDiff distance(GstClockTime a, GstClockTime b) {
+    const GstClockTimeDiff diff = GST_CLOCK_DIFF(a, b);
+    return diff < 0 ? -diff : diff;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    bool ok = true;
+
+    // Provider and follower in one process over loopback, the way a capture
+    // node and a viewer share a timebase.
+    NetworkClockConfig provide;
+    provide.mode = NetworkClockConfig::Mode::Provide;
+    provide.address = "127.0.0.1";
+    provide.port = 0;
+    std::unique_ptr<NetworkClock> provider;
+    try {
+        provider = std::make_unique<NetworkClock>(provide);
+    } catch (const std::runtime_error& error) {
+        std::cerr << "SKIP: " << error.what() << "\n";
+        return kSkip;
+    }
+    ok &= check(provider->port() != 0, "provider bound a port");
+    ok &= check(provider->error_estimate() == 0, "provider error is 0");
+
+    NetworkClockConfig follow;
+    follow.mode = NetworkClockConfig::Mode::Follow;
+    follow.address = "127.0.0.1";
+    follow.port = provider->port();
+    follow.sync_timeout = 10 * GST_SECOND;
+    NetworkClock follower(follow);
+    ok &= check(follower.synced(), "follower synced");
+
+    // Statistics arrive after each exchange, shortly after the first sync.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!GST_CLOCK_TIME_IS_VALID(follower.error_estimate()) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    const GstClockTime error = follower.error_estimate();
+    ok &= check(GST_CLOCK_TIME_IS_VALID(error) && error < 5 * GST_MSECOND, "error estimate below 5 ms");
+
+    // Bracket the follower reading between two provider readings.
+    const GstClockTime before = provider->now();
+    const GstClockTime shared = follower.now();
+    const GstClockTime after = provider->now();
+    const GstClockTime midpoint = before + (after - before) / 2;
+    ok &= check(distance(shared, midpoint) < static_cast<GstClockTimeDiff>(5 * GST_MSECOND),
+                "follower within 5 ms of the provider (" + std::to_string(GST_CLOCK_DIFF(midpoint, shared)) +
+                    " ns)");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/path_merger.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+
+namespace {
+
+constexpr int kSkip = 77;
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+bool installed(const char* name) {
+    GstElementFactory* factory = gst_element_factory_find(name);
+    if (!factory) {
+        return false;
+    }
+    gst_object_unref(factory);
+    return true;
+}
+
+// A bare RTP header: version 2, payload type 96, no payload.
+GstBuffer* rtp_packet(std::uint16_t seq) {
+    const guint8 header[12] = {0x80, 96, static_cast<guint8>(seq >> 8), static_cast<guint8>(seq & 0xFF),
+                               0x00, 0x00, 0x00, 0x00, 0x12, 0x34, 0x56, 0x78};
+    GstBuffer* buffer = gst_buffer_new_allocate(nullptr, sizeof(header), nullptr);
+    gst_buffer_fill(buffer, 0, header, sizeof(header));
+    return buffer;
+}
+
+void record_buffer(GstBuffer* buffer, std::vector<std::uint16_t>& forwarded) {
+    guint8 seq[2] = {0, 0};
+    gst_buffer_extract(buffer, 2, seq, sizeof(seq));
+    forwarded.push_back(static_cast<std::uint16_t>((seq[0] << 8) | seq[1]));
+}
+
+// Sequence numbers that made it past the merge, in arrival order.
+GstPadProbeReturn record_seq(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    auto* forwarded = static_cast<std::vector<std::uint16_t>*>(user_data);
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        record_buffer(gst_pad_probe_info_get_buffer(info), *forwarded);
+    } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = gst_pad_probe_info_get_buffer_list(info);
+        for (guint index = 0; index < gst_buffer_list_length(list); ++index) {
+            record_buffer(gst_buffer_list_get(list, index), *forwarded);
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// Stands in for the two udpsrc elements of a redundant receive chain; the
+// test pushes into their src pads, where PathMerger probes.
+class Paths {
+  public:
+    Paths() {
+        const std::string description = std::string("identity name=") + pipeline::kPrimarySourceName +
+                                        " ! funnel name=merge forward-sticky-events=false ! fakesink name=sink "
+                                        "async=false sync=false identity name=" +
+                                        pipeline::kSecondarySourceName + " ! merge.";
+        GError* error = nullptr;
+        launch_ = gst_parse_launch(description.c_str(), &error);
+        g_clear_error(&error);
+        if (!launch_) {
+            return;
+        }
+        const char* names[] = {pipeline::kPrimarySourceName, pipeline::kSecondarySourceName};
+        for (std::size_t path = 0; path < 2; ++path) {
+            GstElement* source = gst_bin_get_by_name(GST_BIN(launch_), names[path]);
+            pads_[path] = gst_element_get_static_pad(source, "src");
+            gst_object_unref(source);
+        }
+        GstElement* sink = gst_bin_get_by_name(GST_BIN(launch_), "sink");
+        GstPad* sink_pad = gst_element_get_static_pad(sink, "sink");
+        gst_pad_add_probe(sink_pad,
+                          static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                          record_seq, &forwarded, nullptr);
+        gst_object_unref(sink_pad);
+        gst_object_unref(sink);
+    }
+
+    ~Paths() {
+        for (GstPad* pad : pads_) {
+            if (pad) {
+                gst_object_unref(pad);
+            }
+        }
+        if (launch_) {
+            gst_element_set_state(launch_, GST_STATE_NULL);
+            gst_object_unref(launch_);
+        }
+    }
+
+    Paths(const Paths&) = delete;
+    Paths& operator=(const Paths&) = delete;
+
+    GstElement* pipeline() const { return launch_; }
+
+    bool start() {
+        if (gst_element_set_state(launch_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+            return false;
+        }
+        GstSegment segment;
+        gst_segment_init(&segment, GST_FORMAT_TIME);
+        for (std::size_t path = 0; path < 2; ++path) {
+            const std::string stream_id = "path-" + std::to_string(path);
+            gst_pad_push_event(pads_[path], gst_event_new_stream_start(stream_id.c_str()));
+            gst_pad_push_event(pads_[path], gst_event_new_caps(gst_caps_new_empty_simple("application/x-rtp")));
+            gst_pad_push_event(pads_[path], gst_event_new_segment(&segment));
+        }
+        return true;
+    }
+
+    void push(std::size_t path, std::uint16_t seq) { gst_pad_push(pads_[path], rtp_packet(seq)); }
+
+    void push_list(std::size_t path, std::initializer_list<std::uint16_t> seqs) {
+        GstBufferList* list = gst_buffer_list_new();
+        for (const std::uint16_t seq : seqs) {
+            gst_buffer_list_add(list, rtp_packet(seq));
+        }
+        gst_pad_push_list(pads_[path], list);
+    }
+
+    std::vector<std::uint16_t> forwarded;
+
+  private:
+    GstElement* launch_{nullptr};
+    GstPad* pads_[2] = {nullptr, nullptr};
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    if (!installed("identity") || !installed("funnel") || !installed("fakesink")) {
+        std::cerr << "SKIP: needs the core elements\n";
+        return kSkip;
+    }
+    bool ok = true;
+
+    Paths paths;
+    pipeline::ViewerPipelineConfig config;
+    config.redundancy.enabled = true;
+    pipeline::PathMerger merger;
+    if (!check(paths.pipeline() && merger.attach(paths.pipeline(), config) && paths.start(), "merger attached")) {
+        return 1;
+    }
+
+    // Sixteen packets across the sequence wrap. The primary path loses 65533
+    // and 4 and delivers 1 after 2; the secondary path is complete and trails
+    // the primary by one packet.
+    std::vector<std::uint16_t> sequence;
+    for (std::uint32_t seq = 65530; seq < 65536 + 10; ++seq) {
+        sequence.push_back(static_cast<std::uint16_t>(seq));
+    }
+    for (const std::uint16_t seq : sequence) {
+        if (seq != 65533 && seq != 4 && seq != 1) {
+            paths.push(0, seq);
+        }
+        if (seq == 2) {
+            paths.push(0, 1);
+        }
+        paths.push(1, seq);
+    }
+
+    auto stats = merger.stats();
+    // Packets the primary path lost come from the secondary one; 1 arrived
+    // on the secondary before the primary's late copy.
+    ok &= check(paths.forwarded == sequence, "one copy of every packet, in sequence order");
+    ok &= check(stats.forwarded == 16 && stats.duplicates == 14, "forwarded and duplicate counts");
+    ok &= check(stats.paths[0].received == 14 && stats.paths[0].lost == 2, "primary loss across the wrap");
+    ok &= check(stats.paths[1].received == 16 && stats.paths[1].lost == 0, "secondary complete");
+    ok &= check(stats.paths[0].first == 13 && stats.paths[1].first == 3, "first copies per path");
+
+    // A repeat inside the window is a duplicate, whichever path sends it,
+    // also inside a buffer list.
+    paths.push(0, 5);
+    paths.push_list(1, {7, 10});
+    stats = merger.stats();
+    ok &= check(paths.forwarded.size() == 17 && paths.forwarded.back() == 10, "list keeps only the new packet");
+    ok &= check(stats.forwarded == 17 && stats.duplicates == 16, "repeats inside the window dropped");
+
+    // Past the window the sequence number is free again, as after a wrap.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    paths.push(0, 5);
+    stats = merger.stats();
+    ok &= check(paths.forwarded.size() == 18 && paths.forwarded.back() == 5 && stats.forwarded == 18,
+                "repeat outside the window forwarded");
+
+    merger.detach();
+    paths.push(1, 5);
+    ok &= check(paths.forwarded.size() == 19 && merger.stats().forwarded == 18, "detach removes the probes");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/pre_event_recorder.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+
+namespace {
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+bool push(pipeline::PreEventRecorder& recorder, gsize size, bool keyframe) {
+    GstBuffer* buffer = gst_buffer_new_allocate(nullptr, size, nullptr);
+    if (size > 0) {
+        gst_buffer_memset(buffer, 0, static_cast<guint8>(size), size);
+    }
+    if (!keyframe) {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+    const bool stored = recorder.push(buffer);
+    gst_buffer_unref(buffer);
+    return stored;
+}
+
+bool expect(const pipeline::PreEventRecorder& recorder,
+            std::size_t units,
+            std::size_t bytes,
+            const std::string& what) {
+    const auto stats = recorder.stats();
+    bool ok = check(stats.access_units == units, what + ": " + std::to_string(stats.access_units) + " units");
+    ok &= check(stats.bytes == bytes, what + ": " + std::to_string(stats.bytes) + " bytes");
+    return ok;
+}
+
+pipeline::PreEventRecorderConfig ring_config(std::size_t ring_bytes, std::size_t max_access_units) {
+    pipeline::PreEventRecorderConfig config;
+    // Long enough that no GOP ages out while the test runs.
+    config.pre_event_seconds = 3600;
+    config.ring_bytes = ring_bytes;
+    config.max_access_units = max_access_units;
+    return config;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    bool ok = true;
+
+    // A wrapping write drops the units left past the previous write end before
+    // the ones it overlaps at the start of the ring.
+    {
+        pipeline::PreEventRecorder recorder(ring_config(100, 16));
+        push(recorder, 90, true);   // [0,90)
+        push(recorder, 5, true);    // [90,95)
+        push(recorder, 30, true);   // wraps to [0,30), evicting [0,90)
+        push(recorder, 30, true);   // [30,60)
+        push(recorder, 28, false);  // [60,88)
+        ok &= expect(recorder, 4, 93, "before wrap");
+
+        // Lands on [0,20): [90,95) is the tail and [0,30) is overwritten.
+        ok &= check(push(recorder, 20, true), "wrapping keyframe stored");
+        ok &= expect(recorder, 3, 78, "wrap with tail");
+
+        // Overwriting the keyframe at [30,60) trims its delta at [60,88) too.
+        push(recorder, 15, false);  // [20,35)
+        ok &= expect(recorder, 2, 35, "keyframe trimming");
+    }
+
+    // Delta units are only kept behind a keyframe.
+    {
+        pipeline::PreEventRecorder recorder(ring_config(100, 16));
+        ok &= check(push(recorder, 10, false), "leading delta accepted");
+        ok &= expect(recorder, 0, 0, "leading delta dropped");
+        push(recorder, 40, true);   // [0,40)
+        push(recorder, 40, false);  // [40,80)
+        // Wraps onto the keyframe, leaving only an undecodable delta.
+        ok &= check(push(recorder, 30, false), "orphaned delta accepted");
+        ok &= expect(recorder, 0, 0, "orphaned deltas dropped");
+    }
+
+    // Units larger than the ring are refused without touching its contents.
+    {
+        pipeline::PreEventRecorder recorder(ring_config(100, 16));
+        push(recorder, 60, true);
+        ok &= check(!push(recorder, 101, true), "oversized unit refused");
+        ok &= check(!push(recorder, 0, true), "empty unit refused");
+        ok &= expect(recorder, 1, 60, "oversized units");
+        ok &= check(recorder.stats().oversized == 2, "oversized counted");
+
+        ok &= check(push(recorder, 100, true), "ring-sized unit stored");
+        ok &= expect(recorder, 1, 100, "ring-sized unit");
+    }
+
+    // The slot table bounds the unit count independently of the byte ring.
+    {
+        pipeline::PreEventRecorder recorder(ring_config(100, 4));
+        push(recorder, 10, true);
+        for (int index = 0; index < 3; ++index) {
+            push(recorder, 10, false);
+        }
+        push(recorder, 10, true);
+        ok &= expect(recorder, 1, 10, "slot limit");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gstreamer_worker/preprocess/nv12_preprocess.hpp"
+
+namespace preprocess = gstreamer_worker::preprocess;
+
+namespace {
+
+struct Frame {
+    std::vector<std::uint8_t> data;
+    preprocess::Nv12Image image;
+};
+
+// Random NV12 frame with padded strides and a gap between the planes, the way
+// mapped hardware buffers are laid out.
+Frame make_frame(std::uint32_t width, std::uint32_t height, std::mt19937& rng) {
+    const std::size_t strides[2] = {width + 64, width + 64};
+    const std::size_t offsets[2] = {0, strides[0] * height + 4096};
+    Frame frame;
+    frame.data.resize(offsets[1] + strides[1] * ((height + 1) / 2));
+    std::uniform_int_distribution<int> value(0, 255);
+    for (auto& byte : frame.data) {
+        byte = static_cast<std::uint8_t>(value(rng));
+    }
+    frame.image = preprocess::nv12_view(frame.data.data(), width, height, offsets, strides);
+    return frame;
+}
+
+float max_difference(const std::vector<float>& a, const std::vector<float>& b) {
+    float worst = 0.0F;
+    for (std::size_t index = 0; index < a.size(); ++index) {
+        worst = std::max(worst, std::fabs(a[index] - b[index]));
+    }
+    return worst;
+}
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng(1234);
+    bool ok = true;
+
+    // Limited-range white and black must land on the ends of the output range.
+    {
+        std::vector<std::uint8_t> data(4 * 4 + 2 * 4, 128);
+        std::fill(data.begin(), data.begin() + 16, 235);
+        const std::size_t offsets[2] = {0, 16};
+        const std::size_t strides[2] = {4, 4};
+        const auto image = preprocess::nv12_view(data.data(), 4, 4, offsets, strides);
+        preprocess::PreprocessParams params;
+        params.output_width = 2;
+        params.output_height = 2;
+        std::vector<float> out(3 * 4);
+        preprocess::nv12_to_planar(image, params, out.data(), preprocess::Backend::Scalar);
+        for (float value : out) {
+            ok &= check(std::fabs(value - 1.0F) < 1e-4F, "limited-range white converts to 1.0");
+        }
+    }
+
+    const auto backend = preprocess::best_backend();
+    std::cout << "SIMD backend: " << preprocess::backend_name(backend) << "\n";
+    preprocess::Preprocessor pool(4);
+
+    struct Case {
+        std::uint32_t width;
+        std::uint32_t height;
+        preprocess::Rect crop;
+        std::uint32_t out_width;
+        std::uint32_t out_height;
+        preprocess::ChannelOrder order;
+        preprocess::ColorMatrix matrix;
+    };
+    const Case cases[] = {
+        {1920, 1080, {}, 640, 640, preprocess::ChannelOrder::Rgb, preprocess::ColorMatrix::Bt601},
+        {1280, 720, {100, 50, 801, 499}, 224, 224, preprocess::ChannelOrder::Bgr, preprocess::ColorMatrix::Bt709},
+        {641, 361, {}, 1283, 723, preprocess::ChannelOrder::Rgb, preprocess::ColorMatrix::Bt709},
+        {64, 48, {3, 5, 17, 9}, 13, 7, preprocess::ChannelOrder::Bgr, preprocess::ColorMatrix::Bt601},
+    };
+
+    for (const auto& test : cases) {
+        const Frame frame = make_frame(test.width, test.height, rng);
+        preprocess::PreprocessParams params;
+        params.crop = test.crop;
+        params.output_width = test.out_width;
+        params.output_height = test.out_height;
+        params.order = test.order;
+        params.matrix = test.matrix;
+        params.mean = {123.675F, 116.28F, 103.53F};
+        params.scale = {1.0F / 58.395F, 1.0F / 57.12F, 1.0F / 57.375F};
+
+        const std::size_t size = 3 * static_cast<std::size_t>(test.out_width) * test.out_height;
+        std::vector<float> reference(size);
+        std::vector<float> simd(size);
+        std::vector<float> banded(size);
+        preprocess::nv12_to_planar(frame.image, params, reference.data(), preprocess::Backend::Scalar);
+        preprocess::nv12_to_planar(frame.image, params, simd.data(), backend);
+        pool.nv12_to_planar(frame.image, params, banded.data());
+
+        const std::string label = std::to_string(test.width) + "x" + std::to_string(test.height) + " -> " +
+                                  std::to_string(test.out_width) + "x" + std::to_string(test.out_height);
+        ok &= check(max_difference(reference, simd) < 1e-3F, label + ": SIMD matches scalar");
+        ok &= check(max_difference(reference, banded) < 1e-3F, label + ": banded pool matches scalar");
+    }
+
+    // The frame-difference gate's SAD: identical frames sum to zero and the
+    // SIMD kernel matches scalar on widths with a scalar tail.
+    for (const std::uint32_t width : {1920U, 641U, 17U}) {
+        const std::uint32_t height = 97;
+        const std::uint32_t row_step = 4;
+        const Frame current = make_frame(width, height, rng);
+        const Frame previous = make_frame(width, height, rng);
+        std::vector<std::uint8_t> reference(
+            static_cast<std::size_t>(preprocess::sampled_rows(height, row_step)) * width);
+        preprocess::copy_sampled_rows(previous.image.y, previous.image.y_stride, width, height, row_step,
+                                      reference.data());
+        const auto scalar = preprocess::sampled_plane_sad(current.image.y, current.image.y_stride, width, height,
+                                                          row_step, reference.data(), preprocess::Backend::Scalar);
+        const auto simd = preprocess::sampled_plane_sad(current.image.y, current.image.y_stride, width, height,
+                                                        row_step, reference.data(), backend);
+        const auto self = preprocess::sampled_plane_sad(previous.image.y, previous.image.y_stride, width, height,
+                                                        row_step, reference.data(), backend);
+        const std::string label = "SAD " + std::to_string(width) + "x" + std::to_string(height);
+        ok &= check(scalar == simd, label + ": SIMD matches scalar");
+        ok &= check(self == 0, label + ": unchanged frame has zero SAD");
+    }
+
+    // Mosaic tile scaling: a flat frame stays flat, SIMD rounds within one
+    // level of scalar, and nothing outside the tile is written.
+    {
+        std::vector<std::uint8_t> data(6 * 4 + 6 * 2, 0);
+        std::fill(data.begin(), data.begin() + 24, 81);
+        std::fill(data.begin() + 24, data.end(), 90);
+        const std::size_t offsets[2] = {0, 24};
+        const std::size_t strides[2] = {6, 6};
+        const auto image = preprocess::nv12_view(data.data(), 6, 4, offsets, strides);
+        std::vector<std::uint8_t> out(4 * 4 + 4 * 2, 0);
+        const std::size_t out_offsets[2] = {0, 16};
+        const std::size_t out_strides[2] = {4, 4};
+        const auto tile = preprocess::nv12_region(out.data(), 4, 4, out_offsets, out_strides, {2, 2, 2, 2});
+        preprocess::nv12_scale(image, tile, preprocess::Backend::Scalar);
+        const std::vector<std::uint8_t> expected = {0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 81, 81, 0, 0, 81, 81,
+                                                    0, 0, 0,  0, 0, 0, 90, 90};
+        ok &= check(out == expected, "flat frame scales into its tile only");
+    }
+
+    struct ScaleCase {
+        std::uint32_t width;
+        std::uint32_t height;
+        preprocess::Rect tile;
+    };
+    const ScaleCase scale_cases[] = {
+        {1920, 1080, {384, 216, 384, 216}},
+        {1280, 720, {0, 0, 640, 360}},
+        {641, 361, {10, 4, 1282, 722}},
+        {64, 48, {2, 2, 14, 6}},
+    };
+    for (const auto& test : scale_cases) {
+        const Frame frame = make_frame(test.width, test.height, rng);
+        const std::uint32_t out_width = 2 * test.tile.x + test.tile.width;
+        const std::uint32_t out_height = 2 * test.tile.y + test.tile.height;
+        const std::size_t strides[2] = {out_width + 32, out_width + 32};
+        const std::size_t offsets[2] = {0, strides[0] * out_height};
+        const std::size_t size = offsets[1] + strides[1] * (out_height / 2);
+        std::vector<std::uint8_t> reference(size, 7);
+        std::vector<std::uint8_t> simd(size, 7);
+        preprocess::nv12_scale(frame.image,
+                               preprocess::nv12_region(reference.data(), out_width, out_height, offsets, strides,
+                                                       test.tile),
+                               preprocess::Backend::Scalar);
+        preprocess::nv12_scale(frame.image,
+                               preprocess::nv12_region(simd.data(), out_width, out_height, offsets, strides,
+                                                       test.tile),
+                               backend);
+
+        int worst = 0;
+        std::size_t written = 0;
+        for (std::size_t index = 0; index < size; ++index) {
+            worst = std::max(worst, std::abs(static_cast<int>(reference[index]) - static_cast<int>(simd[index])));
+            written += reference[index] != 7 ? 1 : 0;
+        }
+        std::size_t outside = 0;
+        for (std::uint32_t y = 0; y < out_height; ++y) {
+            for (std::uint32_t x = 0; x < strides[0]; ++x) {
+                const bool inside = x >= test.tile.x && x < test.tile.x + test.tile.width && y >= test.tile.y &&
+                                    y < test.tile.y + test.tile.height;
+                outside += !inside && reference[y * strides[0] + x] != 7 ? 1 : 0;
+            }
+        }
+        const std::string label = "scale " + std::to_string(test.width) + "x" + std::to_string(test.height) +
+                                  " -> " + std::to_string(test.tile.width) + "x" + std::to_string(test.tile.height);
+        ok &= check(worst <= 1, label + ": SIMD within one level of scalar");
+        ok &= check(outside == 0, label + ": luma outside the tile untouched");
+        ok &= check(written > 0, label + ": tile written");
+    }
+
+    // I420 from software decoders scales without a conversion to NV12 first,
+    // to exactly the bytes of the same frame in NV12.
+    for (const preprocess::Backend which : {preprocess::Backend::Scalar, backend}) {
+        const std::uint32_t width = 641;
+        const std::uint32_t height = 361;
+        const Frame frame = make_frame(width, height, rng);
+        const std::uint32_t chroma_width = (width + 1) / 2;
+        const std::uint32_t chroma_height = (height + 1) / 2;
+        const std::size_t planar_stride = chroma_width + 16;
+        std::vector<std::uint8_t> u(planar_stride * chroma_height);
+        std::vector<std::uint8_t> v(planar_stride * chroma_height);
+        for (std::uint32_t y = 0; y < chroma_height; ++y) {
+            for (std::uint32_t x = 0; x < chroma_width; ++x) {
+                u[y * planar_stride + x] = frame.image.uv[y * frame.image.uv_stride + 2 * x];
+                v[y * planar_stride + x] = frame.image.uv[y * frame.image.uv_stride + 2 * x + 1];
+            }
+        }
+        preprocess::Nv12Image planar = frame.image;
+        planar.uv = u.data();
+        planar.uv_stride = planar_stride;
+        planar.v = v.data();
+        planar.v_stride = planar_stride;
+
+        const std::size_t offsets[2] = {0, 400 * 240};
+        const std::size_t strides[2] = {400, 400};
+        const preprocess::Rect rect{10, 6, 320, 180};
+        std::vector<std::uint8_t> from_nv12(offsets[1] + 400 * 120, 7);
+        std::vector<std::uint8_t> from_i420(from_nv12.size(), 7);
+        preprocess::nv12_scale(frame.image, preprocess::nv12_region(from_nv12.data(), 400, 240, offsets, strides, rect),
+                               which);
+        preprocess::nv12_scale(planar, preprocess::nv12_region(from_i420.data(), 400, 240, offsets, strides, rect),
+                               which);
+        ok &= check(from_nv12 == from_i420,
+                    std::string{"I420 scales like NV12 ("} + preprocess::backend_name(which) + ")");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "gstreamer_worker/pipeline/config.hpp"
+#include "gstreamer_worker/pipeline/replay_source.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+void put_be16(Bytes& out, std::uint32_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void put_be32(Bytes& out, std::uint32_t value) {
+    put_be16(out, value >> 16);
+    put_be16(out, value & 0xFFFFU);
+}
+
+Bytes rtp_packet(std::uint16_t seq, std::uint32_t timestamp, bool marker, std::size_t payload = 8) {
+    Bytes out{0x80, static_cast<std::uint8_t>((marker ? 0x80U : 0U) | 96U)};
+    put_be16(out, seq);
+    put_be32(out, timestamp);
+    put_be32(out, 0x12345678);
+    out.resize(out.size() + payload, 0xAB);
+    return out;
+}
+
+// rtpdump writer that remembers where each record's packet starts.
+class RtpDump {
+  public:
+    RtpDump() {
+        const std::string line = "#!rtpplay1.0 127.0.0.1/5000\n";
+        bytes_.assign(line.begin(), line.end());
+        // start time, source address and port, padding
+        bytes_.resize(bytes_.size() + 16, 0);
+    }
+
+    // `rtp_length` is the packet's original size, which a truncated capture
+    // stores only part of; 0 marks RTCP.
+    std::size_t record(const Bytes& packet, std::uint32_t offset_ms, std::size_t rtp_length) {
+        put_be16(bytes_, static_cast<std::uint32_t>(packet.size() + 8));
+        put_be16(bytes_, static_cast<std::uint32_t>(rtp_length));
+        put_be32(bytes_, offset_ms);
+        const std::size_t offset = bytes_.size();
+        bytes_.insert(bytes_.end(), packet.begin(), packet.end());
+        return offset;
+    }
+
+    std::size_t record(const Bytes& packet, std::uint32_t offset_ms) {
+        return record(packet, offset_ms, packet.size());
+    }
+
+    // A record header whose length runs past the end of the file.
+    void cut_record() {
+        put_be16(bytes_, 200);
+        put_be16(bytes_, 192);
+        put_be32(bytes_, 999);
+        bytes_.resize(bytes_.size() + 20, 0x80);
+    }
+
+    const Bytes& bytes() const { return bytes_; }
+
+  private:
+    Bytes bytes_;
+};
+
+Bytes annex_b(std::initializer_list<Bytes> nals) {
+    Bytes out;
+    for (const auto& unit : nals) {
+        out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+        out.insert(out.end(), unit.begin(), unit.end());
+    }
+    return out;
+}
+
+std::string write_file(const std::string& name, const Bytes& bytes) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return path.string();
+}
+
+Bytes read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return Bytes(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+GstClockTime rtp_pts(std::uint64_t ticks) {
+    return gst_util_uint64_scale(ticks, GST_SECOND, 90000);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    bool ok = true;
+
+    // rtpdump. Timestamps start 4096 ticks before the 32-bit wrap, 3000 a
+    // frame apart.
+    {
+        constexpr std::uint32_t kBase = 0xFFFFF000U;
+        RtpDump dump;
+        Bytes rtcp{0x80, 0xC8, 0x00, 0x06};
+        rtcp.resize(28, 0x00);
+        dump.record(rtcp, 0, 0);
+        // The second frame overtook the first, which lands below the first
+        // packet's timestamp and so sets the PTS origin.
+        const std::size_t early = dump.record(rtp_packet(3, kBase + 3000, true), 10);
+        const std::size_t first = dump.record(rtp_packet(1, kBase, false), 12);
+        const std::size_t first_end = dump.record(rtp_packet(2, kBase, true), 13);
+        // Marker lost in the capture; the next timestamp ends the frame.
+        const std::size_t unmarked = dump.record(rtp_packet(4, kBase + 6000, false), 80);
+        const std::size_t marked = dump.record(rtp_packet(5, kBase + 9000, true), 110);
+        // Captured with a snap length: only 20 of 1200 bytes were kept.
+        const std::size_t truncated = dump.record(rtp_packet(6, kBase + 12000, true), 140, 1200);
+        // Too short for an RTP header.
+        dump.record({0x80, 0x60, 0x00}, 150);
+        dump.cut_record();
+
+        pipeline::ReplayConfig config;
+        config.path = write_file("gstreamer_worker_replay_test.rtpdump", dump.bytes());
+        ok &= check(pipeline::resolve_replay_format(config) == pipeline::ReplayFormat::RtpDump, "rtpdump detected");
+        const Bytes data = read_file(config.path);
+        const auto packets = pipeline::split_rtpdump(data.data(), data.size(), config);
+
+        ok &= check(packets.size() == 6,
+                    "RTCP, short and cut records skipped (" + std::to_string(packets.size()) + " packets)");
+        if (packets.size() == 6) {
+            const std::size_t offsets[] = {early, first, first_end, unmarked, marked, truncated};
+            const bool frame_ends[] = {true, false, true, true, true, true};
+            // Rebased on the overtaken frame, 3000 ticks before the first packet.
+            const GstClockTime pts[] = {rtp_pts(3000), 0, 0, rtp_pts(6000), rtp_pts(9000), rtp_pts(12000)};
+            for (std::size_t index = 0; index < packets.size(); ++index) {
+                const std::string which = "packet " + std::to_string(index);
+                ok &= check(packets[index].offset == offsets[index], which + " offset");
+                ok &= check(packets[index].frame_end == frame_ends[index], which + " frame_end");
+                ok &= check(packets[index].pts == pts[index] && packets[index].due == pts[index],
+                            which + " pts across the timestamp wrap");
+            }
+            ok &= check(packets[0].size == 20 && packets[5].size == 20, "packet sizes, truncated capture kept");
+        }
+
+        config.original_timing = true;
+        const auto timed = pipeline::split_rtpdump(data.data(), data.size(), config);
+        ok &= check(timed.size() == 6 && timed[1].due == 12 * GST_MSECOND && timed[1].pts == 0,
+                    "original timing from record offsets");
+
+        const std::string no_line = "#!rtpplay1.0 no newline";
+        const auto* header = reinterpret_cast<const std::uint8_t*>(no_line.data());
+        ok &= check(pipeline::split_rtpdump(header, no_line.size(), config).empty(), "header without a line end");
+        std::filesystem::remove(config.path);
+    }
+
+    // Annex B elementary stream
+    {
+        const Bytes sps{0x67, 0x42, 0xC0, 0x1F};
+        const Bytes pps{0x68, 0xCE, 0x3C, 0x80};
+        const Bytes idr{0x65, 0x88, 0x84, 0x21};
+        const Bytes p_slice{0x41, 0x9A, 0x21, 0x10};
+        const Bytes first = annex_b({sps, pps, idr});
+        const Bytes second = annex_b({p_slice});
+        Bytes stream = first;
+        stream.insert(stream.end(), second.begin(), second.end());
+        stream.insert(stream.end(), second.begin(), second.end());
+
+        pipeline::ViewerPipelineConfig config;
+        config.codec = pipeline::VideoCodec::H264;
+        config.replay.path = write_file("gstreamer_worker_replay_test.h264", stream);
+        config.replay.framerate = 25;
+        ok &= check(pipeline::resolve_replay_format(config.replay) == pipeline::ReplayFormat::ElementaryStream,
+                    "elementary stream detected");
+        const Bytes data = read_file(config.replay.path);
+        const auto packets = pipeline::split_elementary(data.data(), data.size(), config);
+        ok &= check(packets.size() == 3, "one packet per access unit");
+        if (packets.size() == 3) {
+            ok &= check(packets[0].offset == 0 && packets[0].size == first.size(), "first unit carries the headers");
+            ok &= check(packets[1].offset == first.size() && packets[2].offset == first.size() + second.size() &&
+                            packets[2].size == second.size(),
+                        "unit offsets");
+            ok &= check(packets[1].pts == 40 * GST_MSECOND && packets[2].pts == 80 * GST_MSECOND &&
+                            packets[2].due == packets[2].pts,
+                        "units spaced at the frame rate");
+            ok &= check(packets[0].frame_end && packets[1].frame_end && packets[2].frame_end,
+                        "every unit ends a frame");
+        }
+
+        config.codec = pipeline::VideoCodec::AV1;
+        bool threw = false;
+        try {
+            pipeline::split_elementary(data.data(), data.size(), config);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        ok &= check(threw, "AV1 elementary stream rejected");
+        std::filesystem::remove(config.replay.path);
+    }
+
+    return ok ? 0 : 1;
+}
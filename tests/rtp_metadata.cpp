@@ -0,0 +1,152 @@
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "gstreamer_worker/zerocopy/frame_meta.hpp"
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+#include "gstreamer_worker/zerocopy/rtp_metadata.hpp"
+
+namespace zerocopy = gstreamer_worker::zerocopy;
+
+namespace {
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+// Marker packet as a payloader emits it: fixed header and payload only.
+GstBuffer* make_packet(guint payload_size) {
+    GstBuffer* packet = gst_rtp_buffer_new_allocate(payload_size, 0, 0);
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    gst_rtp_buffer_map(packet, GST_MAP_WRITE, &rtp);
+    gst_rtp_buffer_set_marker(&rtp, TRUE);
+    gst_rtp_buffer_set_payload_type(&rtp, 96);
+    gst_rtp_buffer_unmap(&rtp);
+    return packet;
+}
+
+bool has_extension(GstBuffer* packet, guint8 id) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    gst_rtp_buffer_map(packet, GST_MAP_READ, &rtp);
+    gpointer data = nullptr;
+    guint size = 0;
+    const bool found = gst_rtp_buffer_get_extension_onebyte_header(&rtp, id, 0, &data, &size);
+    gst_rtp_buffer_unmap(&rtp);
+    return found;
+}
+
+zerocopy::FrameSections make_sections(zerocopy::MetaArena& arena, std::size_t boxes) {
+    std::vector<zerocopy::DetectionBox> records(boxes);
+    for (std::size_t index = 0; index < boxes; ++index) {
+        records[index].x = 0.01F * static_cast<float>(index);
+        records[index].label = static_cast<std::uint32_t>(index);
+    }
+    auto writer = arena.writer();
+    writer.append(zerocopy::SectionType::DetectionBoxes, 1, std::span<const zerocopy::DetectionBox>(records));
+    return writer.finish();
+}
+
+zerocopy::FrameMetadata make_metadata() {
+    zerocopy::FrameMetadata metadata = zerocopy::make_frame_metadata(42, 123'456'789, "camera-front-left-0");
+    metadata.clock_error = 250'000;
+    metadata.exposure_ms = 8.5;
+    metadata.gain = 2.0;
+    metadata.imu_rpy = {0.5F, -1.25F, 3.0F};
+    metadata.skipped_frames = 7;
+    return metadata;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    zerocopy::MetaArena arena;
+    bool ok = true;
+
+    // Every field and a section block survive the round trip; the sensor id is
+    // cut to one 16-byte element.
+    {
+        const auto metadata = make_metadata();
+        const auto sections = make_sections(arena, 4);
+        GstBuffer* packet = make_packet(1000);
+        const gsize before = gst_buffer_get_size(packet);
+        ok &= check(zerocopy::write_rtp_metadata(packet, metadata, sections), "write");
+        ok &= check(gst_buffer_get_size(packet) - before <= zerocopy::kRtpMetadataHeadroom,
+                    "extensions within the headroom");
+        ok &= check(has_extension(packet, zerocopy::kRtpExtSensorId), "sensor id (7) written");
+        ok &= check(has_extension(packet, zerocopy::kRtpExtSections), "sections (8) written");
+        ok &= check(has_extension(packet, zerocopy::kRtpExtSkippedFrames), "skipped frames (9) written");
+
+        zerocopy::FrameMetadata read;
+        std::vector<std::byte> bytes;
+        ok &= check(zerocopy::read_rtp_metadata(packet, read, &bytes), "read");
+        ok &= check(read.frame_id == 42 && read.capture_ts == metadata.capture_ts, "frame id and capture_ts");
+        ok &= check(GST_CLOCK_TIME_IS_VALID(read.encode_ts), "encode_ts stamped");
+        ok &= check(read.clock_error == metadata.clock_error, "clock error");
+        ok &= check(read.exposure_ms == 8.5 && read.gain == 2.0, "exposure and gain");
+        ok &= check(read.imu_rpy == metadata.imu_rpy, "imu");
+        ok &= check(std::string{read.sensor_id.data()} == "camera-front-lef", "sensor id");
+        ok &= check(read.skipped_frames == 7, "skipped frames");
+
+        const auto sent = sections.bytes();
+        ok &= check(bytes.size() == sent.size() && std::memcmp(bytes.data(), sent.data(), sent.size()) == 0,
+                    "section bytes");
+        const auto adopted = arena.adopt(bytes);
+        const auto boxes = adopted.find(zerocopy::SectionType::DetectionBoxes);
+        ok &= check(boxes && boxes->as_array<zerocopy::DetectionBox>().size() == 4 &&
+                        boxes->as_array<zerocopy::DetectionBox>()[3].label == 3,
+                    "sections rebuilt");
+        gst_buffer_unref(packet);
+    }
+
+    // A block over the budget stays local; the rest of the metadata still goes.
+    {
+        const auto sections = make_sections(arena, 64);
+        ok &= check(sections.bytes().size() > zerocopy::kRtpSectionsBudget, "oversized block");
+        GstBuffer* packet = make_packet(1000);
+        zerocopy::write_rtp_metadata(packet, make_metadata(), sections);
+        ok &= check(!has_extension(packet, zerocopy::kRtpExtSections), "oversized block not written");
+
+        zerocopy::FrameMetadata read;
+        std::vector<std::byte> bytes{std::byte{1}};
+        ok &= check(zerocopy::read_rtp_metadata(packet, read, &bytes), "read without sections");
+        ok &= check(bytes.empty() && read.frame_id == 42, "no sections read");
+        gst_buffer_unref(packet);
+    }
+
+    // Optional extensions that were not written read back as defaults.
+    {
+        auto metadata = make_metadata();
+        metadata.skipped_frames = 0;
+        metadata.sensor_id = {};
+        GstBuffer* packet = make_packet(100);
+        zerocopy::write_rtp_metadata(packet, metadata, {});
+        ok &= check(!has_extension(packet, zerocopy::kRtpExtSkippedFrames), "no skipped frames (9)");
+        ok &= check(!has_extension(packet, zerocopy::kRtpExtSensorId), "no sensor id (7)");
+
+        zerocopy::FrameMetadata read;
+        read.skipped_frames = 99;
+        ok &= check(zerocopy::read_rtp_metadata(packet, read), "read");
+        ok &= check(read.skipped_frames == 0 && read.sensor_id[0] == '\0', "defaults for missing extensions");
+        gst_buffer_unref(packet);
+    }
+
+    // Packets from senders without the writer carry no frame id.
+    {
+        GstBuffer* packet = make_packet(100);
+        zerocopy::FrameMetadata read;
+        ok &= check(!zerocopy::read_rtp_metadata(packet, read), "plain packet has no metadata");
+        gst_buffer_unref(packet);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gstreamer_worker/control/shared_task_pool.hpp"
+
+using gstreamer_worker::control::SharedTaskPool;
+
+namespace {
+
+bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+    }
+    return condition;
+}
+
+void count_job(gpointer user_data) {
+    static_cast<std::atomic<int>*>(user_data)->fetch_add(1);
+}
+
+// Holds its worker until released, like a streaming task loop.
+struct Gate {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool open{false};
+};
+
+void gated_job(gpointer user_data) {
+    auto* gate = static_cast<Gate*>(user_data);
+    std::unique_lock<std::mutex> lock(gate->mutex);
+    gate->cv.wait(lock, [gate] { return gate->open; });
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+
+    // Many threads starting and joining short tasks at once; the joins race
+    // the completion of each job, pooled or on an overflow thread.
+    {
+        SharedTaskPool pool(4, 64);
+        constexpr int kThreads = 8;
+        constexpr int kJobsPerThread = 2000;
+        std::atomic<int> ran{0};
+        std::atomic<int> refused{0};
+        std::vector<std::thread> threads;
+        for (int thread = 0; thread < kThreads; ++thread) {
+            threads.emplace_back([&pool, &ran, &refused, thread] {
+                for (int index = 0; index < kJobsPerThread; ++index) {
+                    auto* job = pool.push(static_cast<std::size_t>(thread), count_job, &ran);
+                    if (!job) {
+                        refused.fetch_add(1);
+                        continue;
+                    }
+                    pool.join(job);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const auto stats = pool.stats();
+        ok &= check(ran.load() + refused.load() == kThreads * kJobsPerThread, "every job ran or was refused");
+        ok &= check(refused.load() == 0, "no job refused below the overflow bound");
+        ok &= check(stats.workers <= 4, "workers bounded");
+        ok &= check(stats.overflow_threads == 0, "overflow threads joined");
+        for (const auto& pipeline : stats.pipelines) {
+            ok &= check(pipeline.active == 0 && pipeline.pooled == 0, "no job left active");
+        }
+    }
+
+    // Without an overflow bound every task gets a thread, however many the
+    // pipelines start.
+    {
+        SharedTaskPool pool(2);
+        Gate gate;
+        std::vector<SharedTaskPool::Job*> jobs;
+        for (int index = 0; index < 16; ++index) {
+            jobs.push_back(pool.push(static_cast<std::size_t>(index % 4), gated_job, &gate));
+        }
+        auto stats = pool.stats();
+        ok &= check(std::count(jobs.begin(), jobs.end(), nullptr) == 0, "no task refused by default");
+        ok &= check(stats.workers == 2 && stats.overflow_threads == 14 && stats.rejected == 0,
+                    "two workers and fourteen overflow threads");
+        {
+            std::lock_guard<std::mutex> lock(gate.mutex);
+            gate.open = true;
+        }
+        gate.cv.notify_all();
+        for (auto* job : jobs) {
+            if (job) {
+                pool.join(job);
+            }
+        }
+        ok &= check(pool.stats().overflow_threads == 0, "overflow threads joined");
+    }
+
+    // With a bound, tasks past the workers and the overflow threads are
+    // refused, not queued.
+    {
+        SharedTaskPool pool(2, 1);
+        Gate gate;
+        std::vector<SharedTaskPool::Job*> jobs;
+        for (int index = 0; index < 3; ++index) {
+            jobs.push_back(pool.push(0, gated_job, &gate));
+            ok &= check(jobs.back() != nullptr, "task " + std::to_string(index) + " started");
+        }
+        ok &= check(pool.push(0, gated_job, &gate) == nullptr, "task past the bound refused");
+
+        auto stats = pool.stats();
+        ok &= check(stats.workers == 2 && stats.overflow_threads == 1, "two workers and one overflow thread");
+        ok &= check(stats.rejected == 1 && stats.pipelines.front().rejected == 1, "refusal counted");
+
+        {
+            std::lock_guard<std::mutex> lock(gate.mutex);
+            gate.open = true;
+        }
+        gate.cv.notify_all();
+        for (auto* job : jobs) {
+            if (job) {
+                pool.join(job);
+            }
+        }
+        stats = pool.stats();
+        ok &= check(stats.overflow_threads == 0 && stats.pipelines.front().active == 0, "gated tasks finished");
+    }
+
+    return ok ? 0 : 1;
+}
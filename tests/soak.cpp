@@ -0,0 +1,437 @@
+// Loopback soak: runs a synthetic capture pipeline into a viewer pipeline in
+// this process and samples open fds, RSS, MetaArena blocks and live GStreamer
+// objects (leaks tracer) over time. Fails when any of them keeps growing after
+// warm-up; exits 77 (skipped) when the software plugins are missing.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gst/app/gstappsink.h>
+#include <gst/gst.h>
+#if defined(G_OS_UNIX)
+#include <unistd.h>
+#endif
+
+#include "gstreamer_worker/control/pipeline_controller.hpp"
+#include "gstreamer_worker/pipeline/capture_pipeline.hpp"
+#include "gstreamer_worker/pipeline/viewer_pipeline.hpp"
+#include "gstreamer_worker/zerocopy/buffer_exporter.hpp"
+#include "gstreamer_worker/zerocopy/frame_sections.hpp"
+#include "gstreamer_worker/zerocopy/rtp_metadata.hpp"
+
+namespace pipeline = gstreamer_worker::pipeline;
+namespace zerocopy = gstreamer_worker::zerocopy;
+using gstreamer_worker::control::PipelineController;
+
+namespace {
+
+constexpr int kSkipped = 77;
+
+struct Options {
+    std::uint32_t duration_s{60};
+    std::uint32_t interval_s{2};
+    // Samples taken before this are not used for the trend.
+    std::uint32_t warmup_s{10};
+    std::uint32_t width{640};
+    std::uint32_t height{360};
+    std::uint32_t framerate{60};
+    // 0 lets the viewer's udpsrc pick a free port, so parallel runs do not
+    // collide.
+    std::uint16_t port{0};
+};
+
+struct Sample {
+    double seconds{0.0};
+    double fds{0.0};
+    double rss_kib{0.0};
+    // Blocks the MetaArena ever allocated; steady state reuses them.
+    double arena_blocks{0.0};
+    double live_objects{0.0};
+    double live_buffers{0.0};
+    double live_pools{0.0};
+};
+
+// Largest growth over the measured window a metric may show.
+struct Limit {
+    const char* name;
+    double Sample::*field;
+    double max_growth;
+};
+
+constexpr Limit kLimits[] = {
+    {"open fds", &Sample::fds, 2.0},
+    {"RSS KiB", &Sample::rss_kib, 16.0 * 1024.0},
+    {"MetaArena blocks", &Sample::arena_blocks, 8.0},
+    {"live objects", &Sample::live_objects, 256.0},
+    {"live buffers", &Sample::live_buffers, 32.0},
+    {"live buffer pools", &Sample::live_pools, 1.0},
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [--duration 60] [--interval 2] [--warmup 10]\n"
+              << "             [--width 640] [--height 360] [--fps 60] [--port 0]\n";
+}
+
+Options parse_args(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto require_value = [&](const char* flag) -> std::uint32_t {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(std::string(flag) + " requires a value");
+            }
+            return static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        };
+        if (arg == "--duration") {
+            options.duration_s = require_value("--duration");
+        } else if (arg == "--interval") {
+            options.interval_s = std::max(1U, require_value("--interval"));
+        } else if (arg == "--warmup") {
+            options.warmup_s = require_value("--warmup");
+        } else if (arg == "--width") {
+            options.width = require_value("--width");
+        } else if (arg == "--height") {
+            options.height = require_value("--height");
+        } else if (arg == "--fps") {
+            options.framerate = require_value("--fps");
+        } else if (arg == "--port") {
+            options.port = static_cast<std::uint16_t>(require_value("--port"));
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(0);
+        } else {
+            throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    }
+    return options;
+}
+
+bool plugins_available() {
+    const char* factories[] = {"videotestsrc", "videoconvert", "x264enc",       "h264parse", "rtph264pay",
+                               "udpsink",      "udpsrc",       "rtpjitterbuffer", "rtph264depay", "avdec_h264",
+                               "appsink"};
+    for (const char* name : factories) {
+        GstElementFactory* factory = gst_element_factory_find(name);
+        if (!factory) {
+            std::cout << "Missing element " << name << "\n";
+            return false;
+        }
+        gst_object_unref(factory);
+    }
+    return true;
+}
+
+double count_open_fds() {
+    std::error_code error;
+    double count = 0.0;
+    for (auto it = std::filesystem::directory_iterator("/proc/self/fd", error);
+         !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        ++count;
+    }
+    return count;
+}
+
+double resident_kib() {
+    std::ifstream statm("/proc/self/statm");
+    std::uint64_t size = 0;
+    std::uint64_t resident = 0;
+    statm >> size >> resident;
+#if defined(G_OS_UNIX)
+    return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE)) / 1024.0;
+#else
+    return 0.0;
+#endif
+}
+
+GstTracer* find_leaks_tracer() {
+    GstTracer* found = nullptr;
+    GList* tracers = gst_tracing_get_active_tracers();
+    for (GList* item = tracers; item; item = item->next) {
+        if (!found && g_strcmp0(G_OBJECT_TYPE_NAME(item->data), "GstLeaksTracer") == 0) {
+            found = GST_TRACER(gst_object_ref(item->data));
+        }
+    }
+    g_list_free_full(tracers, gst_object_unref);
+    return found;
+}
+
+// Port the viewer's udpsrc bound. udpsrc opens its socket in READY and
+// writes the kernel's choice back to "port" when asked for port 0.
+std::uint16_t bound_port(GstElement* receiver) {
+    gint port = 0;
+    GstIterator* sources = gst_bin_iterate_sources(GST_BIN(receiver));
+    GValue item = G_VALUE_INIT;
+    while (port == 0 && gst_iterator_next(sources, &item) == GST_ITERATOR_OK) {
+        auto* element = GST_ELEMENT(g_value_get_object(&item));
+        GstElementFactory* factory = gst_element_get_factory(element);
+        if (factory && std::strcmp(GST_OBJECT_NAME(factory), "udpsrc") == 0) {
+            g_object_get(element, "port", &port, nullptr);
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(sources);
+    return static_cast<std::uint16_t>(port);
+}
+
+// Live objects as tracked by the leaks tracer, split by type.
+void count_live_objects(GstTracer* tracer, Sample& sample) {
+    if (!tracer) {
+        return;
+    }
+    GstStructure* info = nullptr;
+    g_signal_emit_by_name(tracer, "get-live-objects", &info);
+    if (!info) {
+        return;
+    }
+    const GValue* list = gst_structure_get_value(info, "live-objects-list");
+    const guint count = list ? gst_value_list_get_size(list) : 0;
+    sample.live_objects = count;
+    for (guint index = 0; index < count; ++index) {
+        const GstStructure* live = gst_value_get_structure(gst_value_list_get_value(list, index));
+        const GValue* object = live ? gst_structure_get_value(live, "object") : nullptr;
+        if (!object) {
+            continue;
+        }
+        const GType type = G_VALUE_TYPE(object);
+        if (type == GST_TYPE_BUFFER) {
+            sample.live_buffers += 1.0;
+        } else if (g_type_is_a(type, GST_TYPE_BUFFER_POOL)) {
+            sample.live_pools += 1.0;
+        }
+    }
+    gst_structure_free(info);
+}
+
+// Least-squares slope of `field` against time, times the window length: the
+// steady growth over the run, robust to single-sample spikes.
+double fitted_growth(const std::vector<Sample>& samples, double Sample::*field) {
+    if (samples.size() < 3) {
+        return 0.0;
+    }
+    double mean_t = 0.0;
+    double mean_v = 0.0;
+    for (const Sample& sample : samples) {
+        mean_t += sample.seconds;
+        mean_v += sample.*field;
+    }
+    mean_t /= static_cast<double>(samples.size());
+    mean_v /= static_cast<double>(samples.size());
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (const Sample& sample : samples) {
+        covariance += (sample.seconds - mean_t) * (sample.*field - mean_v);
+        variance += (sample.seconds - mean_t) * (sample.seconds - mean_t);
+    }
+    if (variance <= 0.0) {
+        return 0.0;
+    }
+    return covariance / variance * (samples.back().seconds - samples.front().seconds);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // The leaks tracer must be enabled before gst_init reads GST_TRACERS.
+    const char* tracers = g_getenv("GST_TRACERS");
+    if (!tracers || !std::strstr(tracers, "leaks")) {
+        const std::string value = tracers && *tracers ? std::string{tracers} + ";leaks" : std::string{"leaks"};
+        g_setenv("GST_TRACERS", value.c_str(), TRUE);
+    }
+    gst_init(&argc, &argv);
+
+    Options options;
+    try {
+        options = parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!plugins_available() || !std::filesystem::exists("/proc/self/fd")) {
+        std::cout << "Soak skipped: needs the software codec plugins and /proc\n";
+        return kSkipped;
+    }
+
+    pipeline::ViewerPipelineConfig viewer;
+    viewer.backend = pipeline::DecoderBackend::Software;
+    viewer.request_zero_copy = false;
+    viewer.listen = {"127.0.0.1", options.port};
+
+    pipeline::CapturePipelineConfig capture;
+    capture.use_test_pattern = true;
+    capture.test_pattern = "ball";
+    capture.use_nvenc = false;
+    capture.use_zero_copy = false;
+    capture.width = options.width;
+    capture.height = options.height;
+    capture.framerate = options.framerate;
+    capture.bitrate = 1'000'000;
+
+    // The receiver binds first so the sender targets whatever port it got.
+    GError* error = nullptr;
+    GstElement* receiver = nullptr;
+    GstElement* sender = nullptr;
+    try {
+        receiver = pipeline::make_viewer_pipeline(viewer, &error);
+        if (receiver && gst_element_set_state(receiver, GST_STATE_READY) != GST_STATE_CHANGE_FAILURE) {
+            capture.network = {"127.0.0.1", bound_port(receiver)};
+            if (capture.network.port != 0) {
+                sender = pipeline::make_capture_pipeline(capture, &error);
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << "\n";
+    }
+    if (!sender || !receiver) {
+        std::cerr << "Failed to build pipelines: " << (error ? error->message : "unknown error") << "\n";
+        if (error) {
+            g_error_free(error);
+        }
+        if (receiver) {
+            gst_element_set_state(receiver, GST_STATE_NULL);
+            gst_object_unref(receiver);
+        }
+        return 1;
+    }
+    std::cout << "Streaming over 127.0.0.1:" << capture.network.port << "\n";
+
+    // Same per-frame paths as the apps: RTP metadata both ways, and an export
+    // callback that owns (and closes) every duplicated fd.
+    zerocopy::MetaArena arena;
+    GstElement* payloader = gst_bin_get_by_name(GST_BIN(sender), pipeline::kPayloaderName);
+    GstElement* depayloader = gst_bin_get_by_name(GST_BIN(receiver), pipeline::kDepayloaderName);
+    if (payloader) {
+        zerocopy::install_rtp_metadata_writer(payloader);
+        gst_object_unref(payloader);
+    }
+    if (depayloader) {
+        zerocopy::install_rtp_metadata_reader(depayloader, &arena);
+        gst_object_unref(depayloader);
+    }
+
+    std::atomic<guint64> frames{0};
+    zerocopy::BufferExporter exporter([&frames](const zerocopy::ExportPacket& packet) {
+        frames.fetch_add(1, std::memory_order_relaxed);
+#if defined(G_OS_UNIX)
+        if (packet.dma_fd >= 0) {
+            close(packet.dma_fd);
+        }
+#endif
+    });
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(receiver), viewer.appsink_name.c_str());
+    if (!sink) {
+        std::cerr << "Unable to find appsink named " << viewer.appsink_name << "\n";
+        gst_object_unref(receiver);
+        gst_object_unref(sender);
+        return 1;
+    }
+    g_signal_connect(sink, "new-sample", G_CALLBACK(+[](GstAppSink* appsink, gpointer user_data) {
+                         GstSample* sample = gst_app_sink_pull_sample(appsink);
+                         if (!sample) {
+                             return GST_FLOW_ERROR;
+                         }
+                         static_cast<zerocopy::BufferExporter*>(user_data)->export_sample(sample);
+                         gst_sample_unref(sample);
+                         return GST_FLOW_OK;
+                     }),
+                     &exporter);
+    gst_object_unref(sink);
+
+    std::atomic<bool> failed{false};
+    auto on_error = [&failed](const GstMessage& message) {
+        if (GST_MESSAGE_TYPE(&message) == GST_MESSAGE_ERROR) {
+            failed.store(true);
+        }
+    };
+    PipelineController receive_controller(true);
+    PipelineController send_controller(true);
+    receive_controller.set_pipeline(receiver);
+    receive_controller.set_bus_handler(on_error);
+    send_controller.set_pipeline(sender);
+    send_controller.set_bus_handler(on_error);
+    gst_object_unref(receiver);
+    gst_object_unref(sender);
+
+    if (!receive_controller.play() || !send_controller.play()) {
+        std::cerr << "Unable to transition pipelines to PLAYING.\n";
+        return 1;
+    }
+    receive_controller.start();
+    send_controller.start();
+
+    GstTracer* leaks = find_leaks_tracer();
+    if (!leaks) {
+        std::cout << "Leaks tracer unavailable; live object counts are not sampled\n";
+    }
+
+    std::vector<Sample> samples;
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::seconds(options.duration_s);
+    while (!failed.load() && std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::seconds(options.interval_s));
+        Sample sample;
+        sample.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sample.fds = count_open_fds();
+        sample.rss_kib = resident_kib();
+        const auto blocks = arena.stats();
+        sample.arena_blocks = static_cast<double>(blocks.acquired - blocks.reused);
+        count_live_objects(leaks, sample);
+        std::cout << "t=" << sample.seconds << "s frames=" << frames.load() << " fds=" << sample.fds
+                  << " rss=" << sample.rss_kib << "KiB arena=" << sample.arena_blocks
+                  << " objects=" << sample.live_objects << " buffers=" << sample.live_buffers
+                  << " pools=" << sample.live_pools << std::endl;
+        samples.push_back(sample);
+    }
+
+    send_controller.request_stop();
+    receive_controller.request_stop();
+    send_controller.join();
+    receive_controller.join();
+    send_controller.stop();
+    receive_controller.stop();
+    if (leaks) {
+        gst_object_unref(leaks);
+    }
+
+    bool ok = true;
+    if (failed.load()) {
+        std::cerr << "FAILED: pipeline error during soak\n";
+        ok = false;
+    }
+    if (frames.load() == 0) {
+        std::cerr << "FAILED: no frames reached the viewer\n";
+        ok = false;
+    }
+    std::vector<Sample> steady;
+    for (const Sample& sample : samples) {
+        if (sample.seconds >= options.warmup_s) {
+            steady.push_back(sample);
+        }
+    }
+    if (steady.size() < 3) {
+        std::cerr << "FAILED: too few samples after warm-up; raise --duration\n";
+        return 1;
+    }
+    for (const Limit& limit : kLimits) {
+        const double growth = fitted_growth(steady, limit.field);
+        std::cout << limit.name << ": " << steady.front().*limit.field << " -> " << steady.back().*limit.field
+                  << ", trend " << growth << " over " << steady.back().seconds - steady.front().seconds << " s\n";
+        if (growth > limit.max_growth) {
+            std::cerr << "FAILED: " << limit.name << " grew by " << growth << " (limit " << limit.max_growth
+                      << ")\n";
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}